@@ -538,6 +538,59 @@ clip_and_zoom_demosaic_half_size(__read_only image2d_t in,
   write_imagef (out, (int2)(x, y), color);
 }
 
+/**
+ * demosaic and downscale bayer or x-trans data in one pass, see
+ * dt_iop_clip_and_zoom_demosaic_f() in develop/imageop_math.c
+ */
+__kernel void
+clip_and_zoom_demosaic(__read_only image2d_t in,
+                       __write_only image2d_t out,
+                       const int width,
+                       const int height,
+                       const int rin_wd,
+                       const int rin_ht,
+                       const float r_scale,
+                       const unsigned int filters,
+                       global const unsigned char (*const xtrans)[6])
+{
+  const int x = get_global_id(0);
+  const int y = get_global_id(1);
+
+  if(x >= width || y >= height) return;
+
+  const float px_footprint = 1.0f/r_scale;
+  const float radius = fmax(px_footprint, filters == 9u ? 3.0f : 2.0f);
+  const float inv_radius = 1.0f/radius;
+
+  const float cx = x * px_footprint;
+  const float cy = y * px_footprint;
+  const int x0 = max(0, (int)ceil(cx - radius));
+  const int x1 = min(rin_wd - 1, (int)floor(cx + radius));
+  const int y0 = max(0, (int)ceil(cy - radius));
+  const int y1 = min(rin_ht - 1, (int)floor(cy + radius));
+
+  float sum[3] = { 0.0f, 0.0f, 0.0f };
+  float weight[3] = { 0.0f, 0.0f, 0.0f };
+  for(int j = y0; j <= y1; j++)
+  {
+    const float wy = 1.0f - fabs(j - cy) * inv_radius;
+    if(wy <= 0.0f) continue;
+    for(int i = x0; i <= x1; i++)
+    {
+      const float w = wy * (1.0f - fabs(i - cx) * inv_radius);
+      if(w <= 0.0f) continue;
+      const int c = (filters == 9u) ? FCxtrans(j, i, xtrans) : FC(j, i, filters);
+      sum[c] += w * read_imagef(in, sampleri, (int2)(i, j)).x;
+      weight[c] += w;
+    }
+  }
+  const float4 color = { weight[0] > 0.0f ? fmax(0.0f, sum[0]) / weight[0] : 0.0f,
+                         weight[1] > 0.0f ? fmax(0.0f, sum[1]) / weight[1] : 0.0f,
+                         weight[2] > 0.0f ? fmax(0.0f, sum[2]) / weight[2] : 0.0f,
+                         0.0f };
+  write_imagef (out, (int2)(x, y), color);
+}
+
 
 /**
  * fill greens pass of pattern pixel grouping.
@@ -36,6 +36,7 @@
 #include "common/image_cache.h"
 #include "common/points.h"
 #include "control/conf.h"
+#include "control/jobs/control_jobs.h"
 #include "develop/imageop.h"
 #include "imageio/imageio_common.h"
 #include "imageio/imageio_jpeg.h"
@@ -98,6 +99,8 @@ fprintf(stderr, "darktable %s\n"
                 "   --icc-file <file> specify icc filename, default to NONE\n"
                 "   --icc-intent <intent> specify icc intent, default to LAST\n"
                 "                     use --help icc-intent for list of supported intents\n"
+                "   --merge-hdr merge all input raws as exposure brackets into a\n"
+                "               single HDR DNG and export that instead\n"
                 "   --verbose\n"
                 "   -h, --help [option]\n"
                 "   -v, --version\n",
@@ -220,7 +223,7 @@ int main(int argc, char *arg[])
   int width = 0, height = 0, bpp = 0;
   gboolean verbose = FALSE, high_quality = TRUE, upscale = FALSE,
            style_overwrite = FALSE, custom_presets = TRUE, export_masks = FALSE,
-           output_to_dir = FALSE;
+           output_to_dir = FALSE, merge_hdr = FALSE;
 
   GList* inputs = NULL;
 
@@ -325,6 +328,10 @@ int main(int argc, char *arg[])
       {
         style_overwrite = TRUE;
       }
+      else if(!strcmp(arg[k], "--merge-hdr"))
+      {
+        merge_hdr = TRUE;
+      }
       else if(!strcmp(arg[k], "--apply-custom-presets") && argc > k + 1)
       {
         k++;
@@ -615,6 +622,18 @@ int main(int argc, char *arg[])
       g_list_free_full(inputs, g_free);
   inputs = NULL;
 
+  // merge the brackets, the resulting dng replaces them for the export
+  if(merge_hdr && id_list)
+  {
+    const dt_imgid_t hdr_id = dt_control_merge_hdr_images(id_list);
+    g_list_free(id_list);
+    id_list = NULL;
+    if(dt_is_valid_imgid(hdr_id))
+      id_list = g_list_append(id_list, GINT_TO_POINTER(hdr_id));
+    else
+      fprintf(stderr, "%s\n", _("error: HDR merge failed, all inputs need to be raws of the same size"));
+  }
+
   const int total = g_list_length(id_list);
 
   if(total == 0)
@@ -637,7 +637,23 @@ void dt_box_mean_horizontal(float *const __restrict__ buf,
     const size_t radius,
     float *const __restrict__ user_scratch)
 {
-  if(ch == (4|BOXFILTER_KAHAN_SUM))
+  if(ch == 2 || ch == 4)
+  {
+    float *const __restrict__ scratch
+       = user_scratch ? user_scratch : dt_alloc_align_float(ch * dt_round_size(width, MAX_VECT));
+    if(scratch)
+    {
+      if(ch == 2)
+        _blur_horizontal<2>(buf, width, radius, scratch);
+      else
+        _blur_horizontal<4>(buf, width, radius, scratch);
+      if(!user_scratch)
+        dt_free_align(scratch);
+    }
+    else
+      dt_print(DT_DEBUG_ALWAYS, "[box_mean] unable to allocate scratch memory");
+  }
+  else if(ch == (4|BOXFILTER_KAHAN_SUM))
   {
     float *const __restrict__ scratch
        = user_scratch ? user_scratch : dt_alloc_align_float(4 * dt_round_size(width, MAX_VECT));
@@ -673,14 +689,17 @@ void dt_box_mean_vertical(float *const buf,
     const uint32_t ch,
     const size_t radius)
 {
-  if((ch & BOXFILTER_KAHAN_SUM) && (ch & ~BOXFILTER_KAHAN_SUM) <= 16)
+  const size_t channels = ch & ~BOXFILTER_KAHAN_SUM;
+  if(channels >= 1 && channels <= 16)
   {
-    size_t channels = ch & ~BOXFILTER_KAHAN_SUM;
     size_t padded_size;
     float *const __restrict__ scratch_buf = _alloc_scratch_space(channels, height, width, radius, &padded_size);
     if(scratch_buf == NULL) return;
 
-    _blur_vertical_1ch<true>(buf, height, channels*width, radius, scratch_buf, padded_size);
+    if(ch & BOXFILTER_KAHAN_SUM)
+      _blur_vertical_1ch<true>(buf, height, channels*width, radius, scratch_buf, padded_size);
+    else
+      _blur_vertical_1ch<false>(buf, height, channels*width, radius, scratch_buf, padded_size);
     dt_free_align(scratch_buf);
   }
   else
@@ -1713,24 +1713,6 @@ int dt_init(int argc,
     dt_film_set_folder_status();
   }
 
-  // the update crawl needs to run after db and conf are up, but before LUA
-  // starts any scripts
-  GList *changed_xmp_files = NULL;
-  if(init_gui)
-  {
-    if(dt_conf_get_bool("run_crawler_on_start") && !dt_gimpmode())
-    {
-      darktable_splash_screen_create(NULL, TRUE); // force the splash screen for the crawl even if user-disabled
-      // scan for cases where the database and xmp files have different timestamps
-      changed_xmp_files = dt_control_crawler_run();
-      if(!dt_conf_get_bool("show_splash_screen"))
-      {
-        darktable_splash_screen_destroy();
-        dt_gui_process_events(); // ensure that the splash screen is removed right away
-      }
-    }
-  }
-
   /* for every resourcelevel we have 4 ints defined, either absolute or a fraction
      0 cpu available
      1 cpu singlebuffer
@@ -1850,8 +1832,16 @@ int dt_init(int argc,
   dt_metadata_init();
   dt_pthread_mutex_unlock(&darktable.metadata_threadsafe);
 
-  darktable_splash_screen_set_progress(_("synchronizing local copies"));
-  dt_image_local_copy_synch();
+  // the update crawl needs to run after db, conf and the image cache
+  // are up. It runs in the background while the GUI and the modules get
+  // initialized, we wait for it before anything writes sidecar files.
+  const gboolean run_crawler = init_gui
+    && dt_conf_get_bool("run_crawler_on_start") && !dt_gimpmode();
+  if(run_crawler)
+  {
+    // scan for cases where the database and xmp files have different timestamps
+    dt_control_crawler_start();
+  }
 
 #ifdef HAVE_GPHOTO2
   // Initialize the camera control.  this is done late so that the
@@ -1941,6 +1931,19 @@ int dt_init(int argc,
     dt_view_manager_gui_init(darktable.view_manager);
   }
 
+  // the crawl compares the sidecar timestamps with the database, it has
+  // to be done before the local copies, LUA or the sidecar writer
+  // update them
+  GList *changed_xmp_files = NULL;
+  if(run_crawler)
+  {
+    darktable_splash_screen_set_progress(_("checking for updated sidecar files"));
+    changed_xmp_files = dt_control_crawler_wait();
+  }
+
+  darktable_splash_screen_set_progress(_("synchronizing local copies"));
+  dt_image_local_copy_synch();
+
 /* init lua last, since it's user made stuff it must be in the real environment */
 #ifdef USE_LUA
   darktable_splash_screen_set_progress(_("initializing Lua"));
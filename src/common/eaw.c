@@ -259,17 +259,36 @@ static inline float dn_weight(const float *c1, const float *c2, const float inv_
   for_each_channel(c)      										     \
   {													     \
     sum[c] /= wgt[c];                                                   				     \
-    pcoarse[c] = sum[c];                                                                                     \
     det[c] = (px[c] - sum[c]);									             \
     sum_sq[c] += (det[c]*det[c]);					                                     \
   }                                                                       				     \
-  copy_pixel_nontemporal(pdetail, det);                                                                      \
+  if(prev_threshold)                                                                                         \
+    dn_accumulate(paccum, pcoarse, px, prev_thrs, init_accum);                                               \
+  copy_pixel(pcoarse, sum);                                                                                  \
   px += 4;                                                                                                   \
-  pdetail += 4;                                                                                              \
+  paccum += 4;                                                                                               \
   pcoarse += 4;
 
-void eaw_dn_decompose(float *const restrict out, const float *const restrict in, float *const restrict detail,
-                      dt_aligned_pixel_t sum_squared, const int scale, const float inv_sigma2,
+// fold the detail (fine - coarse) of a completed scale, shrunk by that scale's threshold, into the accumulator
+static inline void dn_accumulate(float *const restrict accum,
+                                 const float *const restrict fine,
+                                 const float *const restrict coarse,
+                                 const dt_aligned_pixel_t thresh,
+                                 const gboolean init)
+{
+  static const dt_aligned_pixel_t boost = { 1.0f, 1.0f, 1.0f, 1.0f };
+  dt_aligned_pixel_t det;
+  for_four_channels(c, aligned(fine, coarse))
+    det[c] = fine[c] - coarse[c];
+  if(init)
+    for_four_channels(c, aligned(accum))
+      accum[c] = 0.0f;
+  accumulate(accum, det, thresh, boost);
+}
+
+void eaw_dn_decompose(float *const restrict out, const float *const restrict in, float *const restrict accum,
+                      dt_aligned_pixel_t sum_squared, const float *const restrict prev_threshold,
+                      const gboolean init_accum, const int scale, const float inv_sigma2,
                       const int32_t width, const int32_t height)
 {
   const int mult = 1u << scale;
@@ -284,6 +303,9 @@ void eaw_dn_decompose(float *const restrict out, const float *const restrict in,
   const int boundary = 2 * mult;
 
   dt_aligned_pixel_t sum_sq = { 0.0f, 0.0f, 0.0f, 0.0f };
+  dt_aligned_pixel_t prev_thrs = { 0.0f, 0.0f, 0.0f, 0.0f };
+  if(prev_threshold)
+    copy_pixel(prev_thrs, prev_threshold);
 
 #if !(defined(__apple_build_version__) && __apple_build_version__ < 11030000) //makes Xcode 11.3.1 compiler crash
   DT_OMP_FOR(reduction(+: sum_sq[0:4]))
@@ -293,7 +315,7 @@ void eaw_dn_decompose(float *const restrict out, const float *const restrict in,
     const size_t j = dwt_interleave_rows(rowid, height, mult);
     const float *px = ((float *)in) + (size_t)4 * j * width;
     const float *px2;
-    float *pdetail = detail + (size_t)4 * j * width;
+    float *paccum = accum + (size_t)4 * j * width;
     float *pcoarse = out + (size_t)4 * j * width;
 
     // for the first and last 'boundary' rows, we have to perform boundary tests for the entire row;
@@ -362,6 +384,29 @@ void eaw_dn_decompose(float *const restrict out, const float *const restrict in,
     sum_squared[c] = sum_sq[c];
 }
 
+void eaw_dn_synthesize_residue(float *const restrict accum, const float *const restrict fine,
+                               const float *const restrict coarse, const float *const restrict threshold,
+                               const gboolean init_accum, const int32_t width, const int32_t height)
+{
+  dt_aligned_pixel_t thrs = { 0.0f, 0.0f, 0.0f, 0.0f };
+  if(threshold)
+    copy_pixel(thrs, threshold);
+  const size_t npixels = (size_t)width * height;
+
+  DT_OMP_FOR()
+  for(size_t k = 0; k < npixels; k++)
+  {
+    float *const restrict pacc = accum + 4*k;
+    if(threshold)
+      dn_accumulate(pacc, fine + 4*k, coarse + 4*k, thrs, init_accum);
+    else if(init_accum)
+      for_four_channels(c, aligned(pacc))
+        pacc[c] = 0.0f;
+    for_four_channels(c, aligned(pacc, coarse))
+      pacc[c] += coarse[4*k+c];
+  }
+}
+
 #undef SUM_PIXEL_CONTRIBUTION
 #undef SUM_PIXEL_PROLOGUE
 #undef SUM_PIXEL_EPILOGUE
@@ -46,14 +46,31 @@ void eaw_synthesize(float *const restrict out,
                     const int32_t width,
                     const int32_t height);
 
-typedef void((*eaw_dn_decompose_t)(float *const restrict out, const float *const restrict in, float *const restrict detail,
-                                   dt_aligned_pixel_t sum_squared, const int scale, const float inv_sigma2,
+// one scale of the edge-aware a-trous decomposition used by denoiseprofile.  On entry, 'out' holds the
+// input of the previous scale (the coarse result of the scale before it); if 'prev_threshold' is not NULL,
+// the previous scale's detail (out - in) is shrunk by that threshold and added to 'accum' (or stored into
+// it if 'init_accum' is set) just before 'out' is overwritten with the new coarse scale.  This saves both
+// the full-size detail buffer and a separate synthesis sweep per scale.
+typedef void((*eaw_dn_decompose_t)(float *const restrict out, const float *const restrict in, float *const restrict accum,
+                                   dt_aligned_pixel_t sum_squared, const float *const restrict prev_threshold,
+                                   const gboolean init_accum, const int scale, const float inv_sigma2,
                                    const int32_t width, const int32_t height));
 
-void eaw_dn_decompose(float *const restrict out, const float *const restrict in, float *const restrict detail,
-                      dt_aligned_pixel_t sum_squared, const int scale, const float inv_sigma2,
+void eaw_dn_decompose(float *const restrict out, const float *const restrict in, float *const restrict accum,
+                      dt_aligned_pixel_t sum_squared, const float *const restrict prev_threshold,
+                      const gboolean init_accum, const int scale, const float inv_sigma2,
                       const int32_t width, const int32_t height);
 
+// add the shrunk detail (fine - coarse) of the last scale, if 'threshold' is not NULL, and the coarse
+// residue to 'accum'
+typedef void((*eaw_dn_synthesize_t)(float *const restrict accum, const float *const restrict fine,
+                                    const float *const restrict coarse, const float *const restrict threshold,
+                                    const gboolean init_accum, const int32_t width, const int32_t height));
+
+void eaw_dn_synthesize_residue(float *const restrict accum, const float *const restrict fine,
+                               const float *const restrict coarse, const float *const restrict threshold,
+                               const gboolean init_accum, const int32_t width, const int32_t height);
+
 // clang-format off
 // modelines: These editor modelines have been set for all relevant files by tools/update_modelines.py
 // vim: shiftwidth=2 expandtab tabstop=2 cindent
@@ -65,16 +65,18 @@
  * - average of guide
  * - variance of guide
  * - average of mask
- * - covariance of mask and guide. */
+ * - covariance of mask and guide.
+ * in is a scratch buffer of the same size as out, provided by the caller
+ * so that it can be reused across iterations. */
 static inline void eigf_variance_analysis(const float *const restrict guide, // I
                                     const float *const restrict mask, //p
                                     float *const restrict out,
+                                    float *const restrict in,
                                     const size_t width, const size_t height,
                                     const float sigma)
 {
   // We also use gaussian blurs instead of the square blurs of the guided filter
   const size_t Ndim = width * height;
-  float *const restrict in = dt_alloc_align_float(Ndim * 4);
 
   float ming = 10000000.0f;
   float maxg = 0.0f;
@@ -118,20 +120,18 @@ static inline void eigf_variance_analysis(const float *const restrict guide, //
     out[4 * k + 1] -= out[4 * k] * out[4 * k];
     out[4 * k + 3] -= out[4 * k] * out[4 * k + 2];
   }
-
-  dt_free_align(in);
 }
 
 // same function as above, but specialized for the case where guide == mask
 // for increased performance
 static inline void eigf_variance_analysis_no_mask(const float *const restrict guide, // I
                                     float *const restrict out,
+                                    float *const restrict in,
                                     const size_t width, const size_t height,
                                     const float sigma)
 {
   // We also use gaussian blurs instead of the square blurs of the guided filter
   const size_t Ndim = width * height;
-  float *const restrict in = dt_alloc_align_float(Ndim * 2);
 
   float ming = 10000000.0f;
   float maxg = 0.0f;
@@ -163,8 +163,6 @@ static inline void eigf_variance_analysis_no_mask(const float *const restrict gu
     const float avg = out[2 * k];
     out[2 * k + 1] -= avg * avg;
   }
-
-  dt_free_align(in);
 }
 
 void eigf_blending(float *const restrict image, const float *const restrict mask,
@@ -254,8 +252,10 @@ static inline void fast_eigf_surface_blur(float *const restrict image,
   // average - variance arrays: store the guide and mask averages and variances
   float *const restrict ds_av = dt_alloc_align_float(num_elem_ds * 4);
   float *const restrict av = dt_alloc_align_float(num_elem * 4);
+  // scratch of the variance analysis, shared by all iterations
+  float *const restrict ds_moments = dt_alloc_align_float(num_elem_ds * 4);
 
-  if(!ds_image || !ds_mask || !ds_av || !av)
+  if(!mask || !ds_image || !ds_mask || !ds_av || !av || !ds_moments)
   {
     dt_control_log(_("fast exposure independent guided filter failed to allocate memory, check your RAM settings"));
     goto clean;
@@ -277,7 +277,7 @@ static inline void fast_eigf_surface_blur(float *const restrict image,
       quantize(image, mask, width * height, quantization, quantize_min, quantize_max);
       // Downsample the image for speed-up
       interpolate_bilinear(mask, width, height, ds_mask, ds_width, ds_height, 1);
-      eigf_variance_analysis(ds_mask, ds_image, ds_av, ds_width, ds_height, ds_sigma);
+      eigf_variance_analysis(ds_mask, ds_image, ds_av, ds_moments, ds_width, ds_height, ds_sigma);
       // Upsample the variances and averages
       interpolate_bilinear(ds_av, ds_width, ds_height, av, width, height, 4);
       // Blend the guided image
@@ -286,7 +286,7 @@ static inline void fast_eigf_surface_blur(float *const restrict image,
     else
     {
       // no need to build a mask.
-      eigf_variance_analysis_no_mask(ds_image, ds_av, ds_width, ds_height, ds_sigma);
+      eigf_variance_analysis_no_mask(ds_image, ds_av, ds_moments, ds_width, ds_height, ds_sigma);
       // Upsample the variances and averages
       interpolate_bilinear(ds_av, ds_width, ds_height, av, width, height, 2);
       // Blend the guided image
@@ -295,6 +295,7 @@ static inline void fast_eigf_surface_blur(float *const restrict image,
   }
 
 clean:
+  dt_free_align(ds_moments);
   dt_free_align(av);
   dt_free_align(ds_av);
   dt_free_align(ds_mask);
@@ -22,6 +22,7 @@
 #include <errno.h>
 #include <exiv2/types.hpp>
 #include <glib.h>
+#include <glib/gstdio.h>
 #include <sqlite3.h>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -589,14 +590,27 @@ static bool _exif_read_xmp_tag(Exiv2::XmpData &xmpData,
 #define FIND_XMP_TAG(key) _exif_read_xmp_tag(xmpData, &pos, key)
 
 
+// the completion of an import done with dt_exif_read_basic() must not
+// override what the sidecar or the user have set in the meantime.
+static bool _exif_metadata_is_set(const dt_imgid_t imgid,
+                                  const char *key)
+{
+  uint32_t count = 0;
+  GList *res = dt_metadata_get(imgid, key, &count);
+  g_list_free_full(res, g_free);
+  return count > 0;
+}
+
 // FIXME: according to
 // http://www.exiv2.org/doc/classExiv2_1_1Metadatum.html#63c2b87249ba96679c29e01218169124
 // there is no need to pass xmpData
 // version = -1 --> version ignored
+// only_unset --> keep the metadata, tags and color labels already set
 static bool _exif_decode_xmp_data(dt_image_t *img,
                                   Exiv2::XmpData &xmpData,
                                   const int version,
-                                  const bool exif_read)
+                                  const bool exif_read,
+                                  const bool only_unset)
 {
   // As this can be called several times during the image lifetime, clean up first
   GList *imgs = NULL;
@@ -618,7 +632,8 @@ static bool _exif_decode_xmp_data(dt_image_t *img,
       for(GList *iter = dt_metadata_get_list(); iter; iter = iter->next)
       {
         dt_metadata_t *metadata = (dt_metadata_t *)iter->data;
-        if(FIND_XMP_TAG(metadata->tagname))
+        if(FIND_XMP_TAG(metadata->tagname)
+           && !(only_unset && _exif_metadata_is_set(img->id, metadata->tagname)))
         {
           char *value = strdup(pos->toString().c_str());
           char *adr = value;
@@ -650,7 +665,11 @@ static bool _exif_decode_xmp_data(dt_image_t *img,
     }
 
     if(!exif_read) dt_colorlabels_remove_all_labels(img->id);
-    if(FIND_XMP_TAG("Xmp.xmp.Label"))
+    if(only_unset && dt_colorlabels_get_labels(img->id))
+    {
+      // keep the color labels of the import or set by the user
+    }
+    else if(FIND_XMP_TAG("Xmp.xmp.Label"))
     {
       std::string label = pos->toString();
       if(label == "Red") // Is it really called like that in XMP files?
@@ -675,8 +694,9 @@ static bool _exif_decode_xmp_data(dt_image_t *img,
       }
     }
 
-    if((dt_image_get_xmp_mode() != DT_WRITE_XMP_NEVER) ||
-       dt_conf_get_bool("ui_last/import_last_tags_imported"))
+    if(((dt_image_get_xmp_mode() != DT_WRITE_XMP_NEVER) ||
+        dt_conf_get_bool("ui_last/import_last_tags_imported"))
+       && !(only_unset && dt_tag_count_attached(img->id, TRUE)))
     {
       GList *tags = NULL;
 
@@ -688,15 +708,23 @@ static bool _exif_decode_xmp_data(dt_image_t *img,
         _exif_import_tags(img, pos);
     }
 
+    // a sidecar read while the exif data is pending: the values set here
+    // have to survive the completion of the import
+    const uint32_t keep_flags = !exif_read && (img->flags & DT_IMAGE_EXIF_PENDING)
+      ? DT_IMAGE_EXIF_KEEP_DATETIME | DT_IMAGE_EXIF_KEEP_GEOLOC | DT_IMAGE_EXIF_KEEP_LENS
+      : 0;
+
     // Read GPS location
     if(FIND_XMP_TAG("Xmp.exif.GPSLatitude"))
     {
       img->geoloc.latitude = dt_util_gps_string_to_number(pos->toString().c_str());
+      img->flags |= keep_flags & DT_IMAGE_EXIF_KEEP_GEOLOC;
     }
 
     if(FIND_XMP_TAG("Xmp.exif.GPSLongitude"))
     {
       img->geoloc.longitude = dt_util_gps_string_to_number(pos->toString().c_str());
+      img->flags |= keep_flags & DT_IMAGE_EXIF_KEEP_GEOLOC;
     }
 
     if(FIND_XMP_TAG("Xmp.exif.GPSAltitude"))
@@ -711,7 +739,10 @@ static bool _exif_decode_xmp_data(dt_image_t *img,
         if(dt_util_gps_elevation_to_number(pos->toRational(0).first,
                                            pos->toRational(0).second,
                                            sign[0], &elevation))
+        {
           img->geoloc.elevation = elevation;
+          img->flags |= keep_flags & DT_IMAGE_EXIF_KEEP_GEOLOC;
+        }
       }
     }
 
@@ -728,6 +759,7 @@ static bool _exif_decode_xmp_data(dt_image_t *img,
       }
       // No need to do any Unicode<->locale conversion, the field is specified as ASCII
       g_strlcpy(img->exif_lens, lens, sizeof(img->exif_lens));
+      img->flags |= keep_flags & DT_IMAGE_EXIF_KEEP_LENS;
       free(adr);
     }
 
@@ -737,6 +769,7 @@ static bool _exif_decode_xmp_data(dt_image_t *img,
     {
       char *datetime = strdup(pos->toString().c_str());
       dt_datetime_exif_to_img(img, datetime);
+      img->flags |= keep_flags & DT_IMAGE_EXIF_KEEP_DATETIME;
       free(datetime);
     }
 
@@ -776,11 +809,27 @@ static bool _exif_read_iptc_tag(Exiv2::IptcData &iptcData,
 #define FIND_IPTC_TAG(key) _exif_read_iptc_tag(iptcData, &pos, key)
 
 
+static void _exif_iptc_metadata_import(const dt_imgid_t imgid,
+                                       const bool only_unset,
+                                       const char *key,
+                                       const char *value)
+{
+  if(only_unset)
+  {
+    dt_pthread_mutex_lock(&darktable.metadata_threadsafe);
+    const gboolean is_set = _exif_metadata_is_set(imgid, key);
+    dt_pthread_mutex_unlock(&darktable.metadata_threadsafe);
+    if(is_set) return;
+  }
+  dt_metadata_set_import_lock(imgid, key, value);
+}
+
 // FIXME: according to
 // http://www.exiv2.org/doc/classExiv2_1_1Metadatum.html#63c2b87249ba96679c29e01218169124
 // there is no need to pass iptcData
 static bool _exif_decode_iptc_data(dt_image_t *img,
-                                   Exiv2::IptcData &iptcData)
+                                   Exiv2::IptcData &iptcData,
+                                   const bool only_unset)
 {
   try
   {
@@ -788,7 +837,8 @@ static bool _exif_decode_iptc_data(dt_image_t *img,
     iptcData.sortByKey(); // this helps to quickly find all Iptc.Application2.Keywords
 
     if((pos = iptcData.findKey(Exiv2::IptcKey("Iptc.Application2.Keywords")))
-       != iptcData.end())
+       != iptcData.end()
+       && !(only_unset && dt_tag_count_attached(img->id, TRUE)))
     {
       while(pos != iptcData.end())
       {
@@ -807,27 +857,27 @@ static bool _exif_decode_iptc_data(dt_image_t *img,
     if(FIND_IPTC_TAG("Iptc.Application2.Caption"))
     {
       std::string str = pos->print(/*&iptcData*/);
-      dt_metadata_set_import_lock(img->id, "Xmp.dc.description", str.c_str());
+      _exif_iptc_metadata_import(img->id, only_unset, "Xmp.dc.description", str.c_str());
     }
     if(FIND_IPTC_TAG("Iptc.Application2.Copyright"))
     {
       std::string str = pos->print(/*&iptcData*/);
-      dt_metadata_set_import_lock(img->id, "Xmp.dc.rights", str.c_str());
+      _exif_iptc_metadata_import(img->id, only_unset, "Xmp.dc.rights", str.c_str());
     }
     if(FIND_IPTC_TAG("Iptc.Application2.Byline"))
     {
       std::string str = pos->print(/*&iptcData*/);
-      dt_metadata_set_import_lock(img->id, "Xmp.dc.creator", str.c_str());
+      _exif_iptc_metadata_import(img->id, only_unset, "Xmp.dc.creator", str.c_str());
     }
     else if(FIND_IPTC_TAG("Iptc.Application2.Writer"))
     {
       std::string str = pos->print(/*&iptcData*/);
-      dt_metadata_set_import_lock(img->id, "Xmp.dc.creator", str.c_str());
+      _exif_iptc_metadata_import(img->id, only_unset, "Xmp.dc.creator", str.c_str());
     }
     else if(FIND_IPTC_TAG("Iptc.Application2.Contact"))
     {
       std::string str = pos->print(/*&iptcData*/);
-      dt_metadata_set_import_lock(img->id, "Xmp.dc.creator", str.c_str());
+      _exif_iptc_metadata_import(img->id, only_unset, "Xmp.dc.creator", str.c_str());
     }
     if(FIND_IPTC_TAG("Iptc.Application2.DateCreated"))
     {
@@ -2514,6 +2564,425 @@ gboolean dt_exif_get_thumbnail(const char *path,
   }
 }
 
+/* Fast metadata scan used at import.
+ *
+ * Only IFD0 and the Exif and GPS sub-IFDs of TIFF based files (most raws,
+ * TIFF, DNG) and of the APP1 segment of JPEG files are walked, and only
+ * the fields needed by the lighttable are decoded. Everything else
+ * (maker notes, DNG color data, IPTC, XMP) is left to exiv2, which runs
+ * later from the loaders or from the background job queued at import.
+ */
+typedef struct dt_exif_scan_t
+{
+  FILE *f;
+  uint64_t base;  // file offset of the TIFF header
+  uint64_t size;  // bytes available after base
+  gboolean be;    // big endian ("MM") byte order
+} dt_exif_scan_t;
+
+typedef struct dt_exif_scan_entry_t
+{
+  uint16_t tag;
+  uint16_t type;
+  uint32_t count;
+  uint8_t value[4];
+} dt_exif_scan_entry_t;
+
+typedef struct dt_exif_scan_data_t
+{
+  char datetime[DT_DATETIME_LENGTH];
+  char subsec[4];
+  float iso_rei;
+  float focal_35mm;
+  char lat_ref, lon_ref, alt_ref;
+  double lat[6], lon[6], alt[2];
+  gboolean has_lat, has_lon, has_alt;
+  uint32_t subfile_type;   // of IFD0, 0 is the full resolution image
+  uint32_t width, height;  // of IFD0
+} dt_exif_scan_data_t;
+
+#define DT_EXIF_SCAN_MAX_ENTRIES 1024
+
+static gboolean _scan_read(const dt_exif_scan_t *s,
+                           const uint64_t offset,
+                           void *buf,
+                           const size_t len)
+{
+  if(offset > s->size || len > s->size - offset) return FALSE;
+  if(fseeko(s->f, (off_t)(s->base + offset), SEEK_SET)) return FALSE;
+  return fread(buf, 1, len, s->f) == len;
+}
+
+static inline uint16_t _scan_get16(const dt_exif_scan_t *s, const uint8_t *p)
+{
+  return s->be ? (uint16_t)((p[0] << 8) | p[1]) : (uint16_t)((p[1] << 8) | p[0]);
+}
+
+static inline uint32_t _scan_get32(const dt_exif_scan_t *s, const uint8_t *p)
+{
+  return s->be
+    ? ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3]
+    : ((uint32_t)p[3] << 24) | ((uint32_t)p[2] << 16) | ((uint32_t)p[1] << 8) | p[0];
+}
+
+static size_t _scan_type_size(const uint16_t type)
+{
+  switch(type)
+  {
+    case 1: case 2: case 6: case 7: return 1;  // BYTE, ASCII, SBYTE, UNDEFINED
+    case 3: case 8: return 2;                  // SHORT, SSHORT
+    case 4: case 9: case 11: return 4;         // LONG, SLONG, FLOAT
+    case 5: case 10: case 12: return 8;        // RATIONAL, SRATIONAL, DOUBLE
+    default: return 0;
+  }
+}
+
+// copy the payload of an entry, values up to 4 bytes are stored inline
+static gboolean _scan_entry_data(const dt_exif_scan_t *s,
+                                 const dt_exif_scan_entry_t *e,
+                                 uint8_t *buf,
+                                 const size_t len)
+{
+  const uint64_t total = (uint64_t)_scan_type_size(e->type) * e->count;
+  if(total == 0 || len > total) return FALSE;
+  if(total <= 4)
+  {
+    memcpy(buf, e->value, len);
+    return TRUE;
+  }
+  return _scan_read(s, _scan_get32(s, e->value), buf, len);
+}
+
+static gboolean _scan_string(const dt_exif_scan_t *s,
+                             const dt_exif_scan_entry_t *e,
+                             char *dst,
+                             const size_t dst_len)
+{
+  if(e->type != 2 && e->type != 7) return FALSE;
+  const size_t len = MIN((size_t)e->count, dst_len - 1);
+  if(len == 0 || !_scan_entry_data(s, e, (uint8_t *)dst, len)) return FALSE;
+  dst[len] = '\0';
+  // strip trailing blanks, as _find_exif_maker() does
+  for(size_t k = strlen(dst); k > 0 && dst[k - 1] == ' '; k--) dst[k - 1] = '\0';
+  return dst[0] != '\0';
+}
+
+static gboolean _scan_number(const dt_exif_scan_t *s,
+                             const dt_exif_scan_entry_t *e,
+                             const uint32_t idx,
+                             double *v)
+{
+  const size_t ts = _scan_type_size(e->type);
+  if(ts == 0 || idx >= e->count) return FALSE;
+
+  uint8_t buf[8];
+  const uint64_t total = (uint64_t)ts * e->count;
+  if(total <= 4)
+    memcpy(buf, e->value + idx * ts, ts);
+  else if(!_scan_read(s, (uint64_t)_scan_get32(s, e->value) + idx * ts, buf, ts))
+    return FALSE;
+
+  switch(e->type)
+  {
+    case 1: case 7: *v = buf[0]; break;
+    case 6: *v = (int8_t)buf[0]; break;
+    case 3: *v = _scan_get16(s, buf); break;
+    case 8: *v = (int16_t)_scan_get16(s, buf); break;
+    case 4: *v = _scan_get32(s, buf); break;
+    case 9: *v = (int32_t)_scan_get32(s, buf); break;
+    case 5:
+    {
+      const uint32_t d = _scan_get32(s, buf + 4);
+      if(d == 0) return FALSE;
+      *v = (double)_scan_get32(s, buf) / d;
+      break;
+    }
+    case 10:
+    {
+      const int32_t d = (int32_t)_scan_get32(s, buf + 4);
+      if(d == 0) return FALSE;
+      *v = (double)(int32_t)_scan_get32(s, buf) / d;
+      break;
+    }
+    case 11:
+    {
+      const uint32_t u = _scan_get32(s, buf);
+      float f;
+      memcpy(&f, &u, sizeof(f));
+      *v = f;
+      break;
+    }
+    default:
+      return FALSE;
+  }
+  return TRUE;
+}
+
+// raw numerator/denominator pairs are needed for the GPS helpers
+static gboolean _scan_rationals(const dt_exif_scan_t *s,
+                                const dt_exif_scan_entry_t *e,
+                                const uint32_t n,
+                                double *v)
+{
+  if(e->type != 5 || e->count < n) return FALSE;
+  uint8_t buf[24];
+  if(n * 8 > sizeof(buf) || !_scan_entry_data(s, e, buf, n * 8)) return FALSE;
+  for(uint32_t i = 0; i < 2 * n; i++)
+    v[i] = _scan_get32(s, buf + 4 * i);
+  return TRUE;
+}
+
+static void _scan_ifd(const dt_exif_scan_t *s,
+                      const uint32_t offset,
+                      const gboolean gps,
+                      const int depth,
+                      dt_image_t *img,
+                      dt_exif_scan_data_t *d)
+{
+  uint8_t buf[12];
+  if(depth > 2 || offset == 0 || !_scan_read(s, offset, buf, 2)) return;
+
+  const uint16_t n = MIN(_scan_get16(s, buf), DT_EXIF_SCAN_MAX_ENTRIES);
+  for(uint16_t i = 0; i < n; i++)
+  {
+    if(!_scan_read(s, (uint64_t)offset + 2 + 12 * i, buf, 12)) return;
+
+    dt_exif_scan_entry_t e;
+    e.tag = _scan_get16(s, buf);
+    e.type = _scan_get16(s, buf + 2);
+    e.count = _scan_get32(s, buf + 4);
+    memcpy(e.value, buf + 8, 4);
+
+    double v = 0.0;
+    char c[2];
+
+    if(gps)
+    {
+      switch(e.tag)
+      {
+        case 0x0001: if(_scan_string(s, &e, c, sizeof(c))) d->lat_ref = c[0]; break;
+        case 0x0002: d->has_lat = _scan_rationals(s, &e, 3, d->lat); break;
+        case 0x0003: if(_scan_string(s, &e, c, sizeof(c))) d->lon_ref = c[0]; break;
+        case 0x0004: d->has_lon = _scan_rationals(s, &e, 3, d->lon); break;
+        case 0x0005: if(_scan_number(s, &e, 0, &v)) d->alt_ref = v ? '1' : '0'; break;
+        case 0x0006: d->has_alt = _scan_rationals(s, &e, 1, d->alt); break;
+        default: break;
+      }
+      continue;
+    }
+
+    switch(e.tag)
+    {
+      case 0x00FE: // NewSubfileType
+        if(depth == 0 && _scan_number(s, &e, 0, &v)) d->subfile_type = v;
+        break;
+      case 0x0100: // ImageWidth
+        if(depth == 0 && _scan_number(s, &e, 0, &v)) d->width = v;
+        break;
+      case 0x0101: // ImageLength
+        if(depth == 0 && _scan_number(s, &e, 0, &v)) d->height = v;
+        break;
+      case 0x010F: // Make
+        _scan_string(s, &e, img->exif_maker, sizeof(img->exif_maker));
+        break;
+      case 0x0110: // Model
+        _scan_string(s, &e, img->exif_model, sizeof(img->exif_model));
+        break;
+      case 0x0112: // Orientation
+        if(_scan_number(s, &e, 0, &v))
+          img->orientation = dt_image_orientation_to_flip_bits((int)v);
+        break;
+      case 0x4746: // Rating
+        if(_scan_number(s, &e, 0, &v)
+           && !dt_conf_get_bool("ui_last/ignore_exif_rating"))
+          dt_image_set_xmp_rating(img, (int)v);
+        break;
+      case 0x829A: // ExposureTime
+        if(_scan_number(s, &e, 0, &v)) img->exif_exposure = v;
+        break;
+      case 0x829D: // FNumber
+        if(_scan_number(s, &e, 0, &v)) img->exif_aperture = v;
+        break;
+      case 0x8827: // ISOSpeedRatings, Nikon stores a pair for Lo and Hi modes
+        if(_scan_number(s, &e, e.count > 1 ? 1 : 0, &v)) img->exif_iso = v;
+        break;
+      case 0x8832: // RecommendedExposureIndex
+        if(_scan_number(s, &e, 0, &v)) d->iso_rei = v;
+        break;
+      case 0x9003: // DateTimeOriginal
+        if(e.count >= DT_DATETIME_EXIF_LENGTH - 1)
+          _scan_string(s, &e, d->datetime, DT_DATETIME_EXIF_LENGTH);
+        break;
+      case 0x9291: // SubSecTimeOriginal
+        _scan_string(s, &e, d->subsec, sizeof(d->subsec));
+        break;
+      case 0x9204: // ExposureBiasValue
+        if(_scan_number(s, &e, 0, &v)) img->exif_exposure_bias = v;
+        break;
+      case 0x920A: // FocalLength
+        if(_scan_number(s, &e, 0, &v)) img->exif_focal_length = v;
+        break;
+      case 0xA405: // FocalLengthIn35mmFilm
+        if(_scan_number(s, &e, 0, &v)) d->focal_35mm = v;
+        break;
+      case 0xA434: // LensModel
+        _scan_string(s, &e, img->exif_lens, sizeof(img->exif_lens));
+        break;
+      case 0x8769: // Exif IFD
+        if(_scan_number(s, &e, 0, &v)) _scan_ifd(s, (uint32_t)v, FALSE, depth + 1, img, d);
+        break;
+      case 0x8825: // GPS IFD
+        if(_scan_number(s, &e, 0, &v)) _scan_ifd(s, (uint32_t)v, TRUE, depth + 1, img, d);
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+// locate the TIFF header, either at the start of the file or in the
+// Exif APP1 segment of a JPEG file.
+static gboolean _scan_find_tiff(dt_exif_scan_t *s)
+{
+  uint8_t buf[10];
+  if(!_scan_read(s, 0, buf, 4)) return FALSE;
+
+  // TIFF, DNG, NEF, ARW, CR2, PEF, ... and the ORF ("IIRO", "IIRS", "MMOR")
+  // and RW2 ("IIU\0") variants which only differ by the magic number.
+  if((buf[0] == 'I' && buf[1] == 'I') || (buf[0] == 'M' && buf[1] == 'M'))
+  {
+    s->be = buf[0] == 'M';
+    return TRUE;
+  }
+
+  if(buf[0] != 0xFF || buf[1] != 0xD8) return FALSE;
+
+  uint64_t pos = 2;
+  while(_scan_read(s, pos, buf, 4) && buf[0] == 0xFF)
+  {
+    const uint8_t marker = buf[1];
+    const uint16_t len = (buf[2] << 8) | buf[3];
+    // start of scan or end of image, there is no Exif data
+    if(marker == 0xDA || marker == 0xD9 || len < 2) return FALSE;
+    if(marker == 0xE1 && len >= 16
+       && _scan_read(s, pos + 4, buf, 8)
+       && !memcmp(buf, "Exif\0\0", 6))
+    {
+      s->base += pos + 10;
+      s->size -= pos + 10;
+      s->be = buf[6] == 'M';
+      return (buf[6] == 'I' || buf[6] == 'M') && buf[6] == buf[7];
+    }
+    pos += 2 + len;
+  }
+  return FALSE;
+}
+
+gboolean dt_exif_read_basic(dt_image_t *img,
+                            const char *path)
+{
+  if(!img) return TRUE;
+
+  struct stat statbuf;
+  if(stat(path, &statbuf)) return TRUE;
+
+  FILE *f = g_fopen(path, "rb");
+  if(!f) return TRUE;
+
+  dt_exif_scan_t s = { f, 0, (uint64_t)statbuf.st_size, FALSE };
+  uint8_t hdr[8];
+  if(!_scan_find_tiff(&s) || !_scan_read(&s, 0, hdr, 8))
+  {
+    fclose(f);
+    return TRUE;
+  }
+
+  // same fallback for 'datetime taken' as dt_exif_read()
+  dt_datetime_unix_to_img(img, &statbuf.st_mtime);
+
+  dt_exif_scan_data_t d;
+  memset(&d, 0, sizeof(d));
+
+  if(!dt_conf_get_bool("ui_last/ignore_exif_rating"))
+    dt_image_set_xmp_rating(img, -2);
+
+  _scan_ifd(&s, _scan_get32(&s, hdr + 4), FALSE, 0, img, &d);
+  fclose(f);
+
+  // without make and model this is not something we can handle here
+  if(!img->exif_maker[0] || !img->exif_model[0]) return TRUE;
+
+  dt_image_refresh_makermodel(img);
+
+  if(d.datetime[0])
+  {
+    if(d.subsec[0])
+      dt_datetime_add_subsec_to_exif(d.datetime, sizeof(d.datetime), d.subsec);
+    dt_datetime_exif_to_img(img, d.datetime);
+  }
+
+  if((img->exif_iso == 65535 || img->exif_iso == 0) && d.iso_rei > 0.0f)
+    img->exif_iso = d.iso_rei;
+
+  if(d.focal_35mm > 0.0f && img->exif_focal_length > 0.0f)
+    img->exif_crop = d.focal_35mm / img->exif_focal_length;
+
+  // raw formats like NEF or DNG have a reduced resolution preview in
+  // IFD0, its size is of no use.
+  if(d.subfile_type == 0 && d.width > 0 && d.height > 0
+     && (img->width <= 0 || img->height <= 0))
+  {
+    img->width = d.width;
+    img->height = d.height;
+  }
+
+  double value = 0.0;
+  if(d.has_lat && d.lat_ref
+     && dt_util_gps_rationale_to_number(d.lat[0], d.lat[1], d.lat[2], d.lat[3],
+                                        d.lat[4], d.lat[5], d.lat_ref, &value))
+    img->geoloc.latitude = value;
+  if(d.has_lon && d.lon_ref
+     && dt_util_gps_rationale_to_number(d.lon[0], d.lon[1], d.lon[2], d.lon[3],
+                                        d.lon[4], d.lon[5], d.lon_ref, &value))
+    img->geoloc.longitude = value;
+  if(d.has_alt && d.alt_ref
+     && dt_util_gps_elevation_to_number(d.alt[0], d.alt[1], d.alt_ref, &value))
+    img->geoloc.elevation = value;
+
+  dt_exif_apply_default_metadata(img);
+
+  // the full exiv2 decoding is still to be done, exif_inited stays
+  // unset so that the loaders do it before the image gets processed.
+  img->flags |= DT_IMAGE_EXIF_PENDING;
+  img->exif_inited = FALSE;
+  return FALSE;
+}
+
+// put back what the sidecar or the user have set while the import was
+// pending, dt_exif_read() must not override it, and clear the pending state.
+static void _exif_restore_pending(dt_image_t *img,
+                                  const uint32_t pending_flags,
+                                  const dt_image_job_flag_t job_flags,
+                                  const GTimeSpan datetime_taken,
+                                  const dt_image_geoloc_t *geoloc,
+                                  const char *lens)
+{
+  if(pending_flags & DT_IMAGE_EXIF_KEEP_DATETIME)
+    img->exif_datetime_taken = datetime_taken;
+  if(pending_flags & DT_IMAGE_EXIF_KEEP_GEOLOC)
+    img->geoloc = *geoloc;
+  if(pending_flags & DT_IMAGE_EXIF_KEEP_LENS)
+    g_strlcpy(img->exif_lens, lens, sizeof(img->exif_lens));
+
+  const uint32_t restored = DT_IMAGE_REJECTED | DT_VIEW_RATINGS_MASK;
+  img->flags = (img->flags & ~(restored | DT_IMAGE_EXIF_PENDING
+                               | DT_IMAGE_EXIF_KEEP_DATETIME
+                               | DT_IMAGE_EXIF_KEEP_GEOLOC
+                               | DT_IMAGE_EXIF_KEEP_LENS))
+    | (pending_flags & restored);
+  img->job_flags = job_flags;
+}
+
 /* Read the metadata of an image.
  * XMP data trumps IPTC data trumps EXIF data.
  */
@@ -2525,11 +2994,25 @@ gboolean dt_exif_read(dt_image_t *img,
     dt_print(DT_DEBUG_ALWAYS, "[dt_exif_read] failed as no img was provided");
     return TRUE;
   }
+  // completing an import done with dt_exif_read_basic(): the rating,
+  // the default metadata and the sidecar have been applied already and
+  // may have been changed by the user since then. Only the fields which
+  // are still unset get filled, the date taken, the location and the
+  // lens only if they have not been set since.
+  const gboolean pending = img->flags & DT_IMAGE_EXIF_PENDING;
+  const uint32_t pending_flags = img->flags;
+  const dt_image_job_flag_t job_flags = img->job_flags;
+  const GTimeSpan datetime_taken = img->exif_datetime_taken;
+  const dt_image_geoloc_t geoloc = img->geoloc;
+  char lens[sizeof(img->exif_lens)];
+  g_strlcpy(lens, img->exif_lens, sizeof(lens));
+  if(pending) img->job_flags |= DT_IMAGE_JOB_NO_METADATA;
+
   // At least set 'datetime taken' to something useful in case there is
   // no Exif data in this file (pfm, png, ...)
   struct stat statbuf;
 
-  if(!stat(path, &statbuf))
+  if(!pending && !stat(path, &statbuf))
   {
     dt_datetime_unix_to_img(img, &statbuf.st_mtime);
   }
@@ -2572,18 +3055,25 @@ gboolean dt_exif_read(dt_image_t *img,
 
     // IPTC metadata.
     Exiv2::IptcData &iptcData = image->iptcData();
-    if(!iptcData.empty()) res = _exif_decode_iptc_data(img, iptcData) && res;
+    if(!iptcData.empty()) res = _exif_decode_iptc_data(img, iptcData, pending) && res;
 
     // XMP metadata.
     Exiv2::XmpData &xmpData = image->xmpData();
     if(!xmpData.empty())
-      res = _exif_decode_xmp_data(img, xmpData, -1, true) && res;
+      res = _exif_decode_xmp_data(img, xmpData, -1, true, pending) && res;
 
     // Initialize size - don't wait for full raw to be loaded to get this
     // information. If use_embedded_thumbnail is set, it will take a
     // change in development history to have this information.
-    img->height = image->pixelHeight();
-    img->width = image->pixelWidth();
+    // A pending image may have been loaded already, keep the real size.
+    if(!pending || img->width <= 0 || img->height <= 0)
+    {
+      img->height = image->pixelHeight();
+      img->width = image->pixelWidth();
+    }
+
+    if(pending)
+      _exif_restore_pending(img, pending_flags, job_flags, datetime_taken, &geoloc, lens);
 
     return res ? FALSE : TRUE;
   }
@@ -2593,6 +3083,9 @@ gboolean dt_exif_read(dt_image_t *img,
              "[exiv2 dt_exif_read] %s: %s",
              path,
              e.what());
+    // don't retry on each load, the basic data is all we get
+    if(pending)
+      _exif_restore_pending(img, pending_flags, job_flags, datetime_taken, &geoloc, lens);
     return TRUE;
   }
 }
@@ -4039,7 +4532,7 @@ gboolean dt_exif_xmp_read(dt_image_t *img,
       const size_t ns_pos =
         image->xmpPacket().find("xmlns:darktable=\"http://darktable.sf.net/\"");
       const bool is_a_dt_xmp = (ns_pos != std::string::npos);
-      _exif_decode_xmp_data(img, xmpData, is_a_dt_xmp ? xmp_version : -1, false);
+      _exif_decode_xmp_data(img, xmpData, is_a_dt_xmp ? xmp_version : -1, false, false);
     }
 
 
@@ -6002,40 +6495,41 @@ gboolean dt_exif_xmp_write(const dt_imgid_t imgid,
   dt_image_full_path(imgid, imgfname, sizeof(imgfname), &from_cache);
   if(!g_file_test(imgfname, G_FILE_TEST_IS_REGULAR)) return TRUE;
 
+  const char *xml_header = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
+  const size_t xml_header_len = strlen(xml_header);
+
+  // we want to avoid writing the sidecar file if it didn't change
+  // to avoid issues when using the same images from different
+  // computers. Sample use case: images on NAS, several computers
+  // using them NOT AT THE SAME TIME and the XMP crawler is used
+  // to find changed sidecars.
+  // The file is read once, outside of the exiv2 lock, so that several
+  // sidecars can be read and written concurrently.
+  char *content = NULL;
+  size_t content_len = 0;
+  if(!force_write && g_file_test(filename, G_FILE_TEST_EXISTS))
+  {
+    errno = 0;
+    content = dt_read_file(filename, &content_len);
+    if(!content)
+    {
+      dt_print(DT_DEBUG_ALWAYS,
+               "cannot read XMP file '%s': '%s'", filename, strerror(errno));
+      dt_control_log(_("cannot read XMP file '%s': '%s'"), filename, strerror(errno));
+      return TRUE;
+    }
+  }
+
+  std::string xmpPacket;
   try
   {
+    // Only the file access happens outside of the exiv2 lock, the xmp
+    // data itself is built under it.
     Lock lock;
     Exiv2::XmpData xmpData;
-    std::string xmpPacket;
-    char *checksum_old = NULL;
-    if(!force_write && g_file_test(filename, G_FILE_TEST_EXISTS))
-    {
-      // we want to avoid writing the sidecar file if it didn't change
-      // to avoid issues when using the same images from different
-      // computers. Sample use case: images on NAS, several computers
-      // using them NOT AT THE SAME TIME and the XMP crawler is used
-      // to find changed sidecars.
-      errno = 0;
-      size_t end;
-      unsigned char *content = (unsigned char*)dt_read_file(filename, &end);
-      if(content)
-      {
-        checksum_old = g_compute_checksum_for_data(G_CHECKSUM_MD5, content, end);
-        free(content);
-      }
-      else
-      {
-        dt_print(DT_DEBUG_ALWAYS,
-                 "cannot read XMP file '%s': '%s'", filename, strerror(errno));
-        dt_control_log(_("cannot read XMP file '%s': '%s'"), filename, strerror(errno));
-      }
-
-      Exiv2::DataBuf buf = Exiv2::readFile(WIDEN(filename));
-#if EXIV2_TEST_VERSION(0,28,0)
-      xmpPacket.assign(buf.c_str(), buf.size());
-#else
-      xmpPacket.assign(reinterpret_cast<char *>(buf.pData_), buf.size_);
-#endif
+    if(content)
+    {
+      xmpPacket.assign(content, content_len);
       Exiv2::XmpParser::decode(xmpData, xmpPacket);
 
       // Because XmpSeq or XmpBag are added to the list, we first have to
@@ -6043,7 +6537,8 @@ gboolean dt_exif_xmp_write(const dt_imgid_t imgid,
       _remove_known_keys(xmpData);
     }
 
-    // Initialize xmp data:
+    // Initialize xmp data, on top of the sidecar content so that keys
+    // cleared by the user are also erased from it:
     _exif_xmp_read_data(xmpData, imgid, "dt_exif_xmp_write");
 
     // Serialize the xmp data and output the xmp packet.
@@ -6052,46 +6547,6 @@ gboolean dt_exif_xmp_write(const dt_imgid_t imgid,
     {
       throw Exiv2::Error(Exiv2::ErrorCode::kerErrorMessage, "[xmp_write] failed to serialize xmp data");
     }
-
-    // Hash the new data and compare it to the old hash (if applicable).
-    const char *xml_header = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
-    gboolean write_sidecar = TRUE;
-    if(checksum_old)
-    {
-      GChecksum *checksum = g_checksum_new(G_CHECKSUM_MD5);
-      if(checksum)
-      {
-        g_checksum_update(checksum, (unsigned char*)xml_header, -1);
-        g_checksum_update(checksum, (unsigned char*)xmpPacket.c_str(), -1);
-        const char *checksum_new = g_checksum_get_string(checksum);
-        write_sidecar = g_strcmp0(checksum_old, checksum_new) != 0;
-        g_checksum_free(checksum);
-      }
-      g_free(checksum_old);
-    }
-
-    if(write_sidecar)
-    {
-      // Using std::ofstream isn't possible here -- on Windows it
-      // doesn't support Unicode filenames with mingw.
-      errno = 0;
-      FILE *fout = g_fopen(filename, "wb");
-      if(fout)
-      {
-        fprintf(fout, "%s", xml_header);
-        fprintf(fout, "%s", xmpPacket.c_str());
-        fclose(fout);
-      }
-      else
-      {
-        dt_print(DT_DEBUG_ALWAYS,
-                 "cannot write XMP file '%s': '%s'", filename, strerror(errno));
-        dt_control_log(_("cannot write XMP file '%s': '%s'"), filename, strerror(errno));
-        return TRUE;
-      }
-    }
-
-    return FALSE;
   }
   catch(const Exiv2::AnyError &e)
   {
@@ -6099,8 +6554,43 @@ gboolean dt_exif_xmp_write(const dt_imgid_t imgid,
              "[dt_exif_xmp_write] %s: caught exiv2 exception '%s'",
              filename,
              e.what());
+    free(content);
     return TRUE;
   }
+
+  // Compare the new packet to the file content, a mismatch in size
+  // already tells us it has changed.
+  gboolean write_sidecar = TRUE;
+  if(content)
+  {
+    write_sidecar = content_len != xml_header_len + xmpPacket.size()
+      || memcmp(content, xml_header, xml_header_len) != 0
+      || memcmp(content + xml_header_len, xmpPacket.data(), xmpPacket.size()) != 0;
+    free(content);
+  }
+
+  if(write_sidecar)
+  {
+    // Using std::ofstream isn't possible here -- on Windows it
+    // doesn't support Unicode filenames with mingw.
+    errno = 0;
+    FILE *fout = g_fopen(filename, "wb");
+    if(fout)
+    {
+      fwrite(xml_header, 1, xml_header_len, fout);
+      fwrite(xmpPacket.data(), 1, xmpPacket.size(), fout);
+      fclose(fout);
+    }
+    else
+    {
+      dt_print(DT_DEBUG_ALWAYS,
+               "cannot write XMP file '%s': '%s'", filename, strerror(errno));
+      dt_control_log(_("cannot write XMP file '%s': '%s'"), filename, strerror(errno));
+      return TRUE;
+    }
+  }
+
+  return FALSE;
 }
 
 dt_colorspaces_color_profile_type_t dt_exif_get_color_space(const uint8_t *data,
@@ -80,6 +80,11 @@ void dt_exif_sanitize_datetime(char *datetime);
  * struct. returns TRUE if no success. */
 gboolean dt_exif_read(dt_image_t *img, const char *path);
 
+/** quickly read the basic exif fields shown in the lighttable (date, maker, model, lens, exposure,
+ * orientation, GPS) from TIFF based and JPEG files without exiv2. the image is flagged so that the
+ * full dt_exif_read() is done later. returns TRUE if the file could not be handled. */
+gboolean dt_exif_read_basic(dt_image_t *img, const char *path);
+
 /** read exif data to image struct from given data blob, wherever you got it from.
     returns TRUE in case of an error */
 gboolean dt_exif_read_from_blob(dt_image_t *img, uint8_t *blob, const int size);
@@ -156,6 +156,9 @@ __DT_CLONE_TARGETS__
 static inline void variance_analyse(const float *const restrict guide, // I
                                     const float *const restrict mask, //p
                                     float *const restrict ab,
+                                    float *const restrict input,
+                                    float *const restrict scratch,
+                                    const size_t scratch_size,
                                     const size_t width,
                                     const size_t height,
                                     const int radius,
@@ -163,43 +166,54 @@ static inline void variance_analyse(const float *const restrict guide, // I
 {
   // Compute a box average (filter) on a grey image over a window of size 2*radius + 1
   // then get the variance of the guide and covariance with its mask
-  // output a and b, the linear blending params
+  // output a and b, the linear blending params, already box-averaged
   // p, the mask is the quantised guide I
-
-  const size_t Ndim = width * height;
-  const size_t Ndimch = Ndim * 4;
+  //
+  // input is a 4 × width × height scratch buffer, scratch holds 4 × width floats per thread,
+  // both are provided by the caller to be reused across iterations.
 
   /*
   * input is array of struct : { { guide , mask, guide * guide, guide * mask } }
   */
-  float *const restrict input = dt_alloc_align_float(Ndimch);
 
-  // Pre-multiply guide and mask and pack all inputs into an array of 4×1 SIMD struct
-  DT_OMP_FOR_SIMD()
-  for(size_t k = 0; k < Ndim; k++)
+  // Pre-multiply guide and mask and pack all inputs into an array of 4×1 SIMD struct,
+  // running the horizontal pass of the box filter while the row is still in cache
+  DT_OMP_FOR()
+  for(size_t row = 0; row < height; row++)
   {
-    const size_t index = k * 4;
-    input[index] = guide[k];
-    input[index + 1] = mask[k];
-    input[index + 2] = guide[k] * guide[k];
-    input[index + 3] = guide[k] * mask[k];
+    float *const restrict in_row = input + 4 * row * width;
+    const float *const restrict guide_row = guide + row * width;
+    const float *const restrict mask_row = mask + row * width;
+    DT_OMP_SIMD()
+    for(size_t k = 0; k < width; k++)
+    {
+      in_row[4 * k] = guide_row[k];
+      in_row[4 * k + 1] = mask_row[k];
+      in_row[4 * k + 2] = guide_row[k] * guide_row[k];
+      in_row[4 * k + 3] = guide_row[k] * mask_row[k];
+    }
+    dt_box_mean_horizontal(in_row, width, 4, radius, dt_get_perthread(scratch, scratch_size));
   }
+  dt_box_mean_vertical(input, height, width, 4, radius);
 
-  // blur the guide and mask as a four-channel image to exploit data locality and SIMD
-  dt_box_mean(input, height, width, 4, radius, 1);
-
-  // blend the result and store in output buffer
+  // get a and b, and box-average them horizontally in the same sweep
   DT_OMP_FOR()
-  for(size_t idx = 0; idx < width*height; idx++)
+  for(size_t row = 0; row < height; row++)
   {
-    const float d = fmaxf((input[4*idx+2] - input[4*idx+0] * input[4*idx+0]) + feathering, 1e-15f); // avoid division by 0.
-    const float a = (input[4*idx+3] - input[4*idx+0] * input[4*idx+1]) / d;
-    const float b = input[4*idx+1] - a * input[4*idx+0];
-    ab[2*idx] = a;
-    ab[2*idx+1] = b;
+    const float *const restrict in_row = input + 4 * row * width;
+    float *const restrict ab_row = ab + 2 * row * width;
+    DT_OMP_SIMD()
+    for(size_t k = 0; k < width; k++)
+    {
+      const float d = fmaxf((in_row[4*k+2] - in_row[4*k+0] * in_row[4*k+0]) + feathering, 1e-15f); // avoid division by 0.
+      const float a = (in_row[4*k+3] - in_row[4*k+0] * in_row[4*k+1]) / d;
+      const float b = in_row[4*k+1] - a * in_row[4*k+0];
+      ab_row[2*k] = a;
+      ab_row[2*k+1] = b;
+    }
+    dt_box_mean_horizontal(ab_row, width, 2, radius, dt_get_perthread(scratch, scratch_size));
   }
-
-  if(input != NULL) dt_free_align(input);
+  dt_box_mean_vertical(ab, height, width, 2, radius);
 }
 
 
@@ -294,8 +308,12 @@ static inline void fast_surface_blur(float *const restrict image,
   float *const restrict ds_mask = dt_alloc_align_float(num_elem_ds);
   float *const restrict ds_ab = dt_alloc_align_float(num_elem_ds * 2);
   float *const restrict ab = dt_alloc_align_float(num_elem * 2);
+  // scratch of the variance analysis, shared by all iterations
+  float *const restrict ds_moments = dt_alloc_align_float(num_elem_ds * 4);
+  size_t scratch_size;
+  float *const restrict scratch = dt_alloc_perthread_float(4 * dt_round_size(ds_width, 16), &scratch_size);
 
-  if(!ds_image || !ds_mask || !ds_ab || !ab)
+  if(!ds_image || !ds_mask || !ds_ab || !ab || !ds_moments || !scratch)
   {
     dt_print(DT_DEBUG_PIPE, "fast guided filter failed to allocate memory");
     dt_control_log(_("fast guided filter failed to allocate memory, check your RAM settings"));
@@ -312,11 +330,10 @@ static inline void fast_surface_blur(float *const restrict image,
     quantize(ds_image, ds_mask, ds_width * ds_height, quantization, quantize_min, quantize_max);
 
     // Perform the patch-wise variance analyse to get
-    // the a and b parameters for the linear blending s.t. mask = a * I + b
-    variance_analyse(ds_mask, ds_image, ds_ab, ds_width, ds_height, ds_radius, feathering);
-
-    // Compute the patch-wise average of parameters a and b
-    dt_box_mean(ds_ab, ds_height, ds_width, 2, ds_radius, 1);
+    // the a and b parameters for the linear blending s.t. mask = a * I + b,
+    // and their patch-wise average
+    variance_analyse(ds_mask, ds_image, ds_ab, ds_moments, scratch, scratch_size,
+                     ds_width, ds_height, ds_radius, feathering);
 
     if(i != iterations - 1)
     {
@@ -335,6 +352,8 @@ static inline void fast_surface_blur(float *const restrict image,
     apply_linear_blending_w_geomean(image, ab, num_elem);
 
 clean:
+  dt_free_align(scratch);
+  dt_free_align(ds_moments);
   dt_free_align(ab);
   dt_free_align(ds_ab);
   dt_free_align(ds_mask);
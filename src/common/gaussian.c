@@ -350,154 +350,199 @@ void dt_gaussian_blur(dt_gaussian_t *g, const float *const in, float *const out)
   }
 }
 
-void dt_gaussian_blur_4c(dt_gaussian_t *g, const float *const in, float *const out)
+// dt_gaussian_blur_4c() runs the recursive filter on blocks of neighbouring
+// columns (vertical pass) and rows (horizontal pass) at once.  For columns,
+// the pixels of a block are contiguous in memory, so every row of the block
+// is a short streamed vector of GAUSS_COLS * 4 independent filter lanes
+// instead of one 16 byte access per cache line.  For rows, interleaving
+// GAUSS_ROWS independent recursions hides the latency of the serial
+// dependency chain.
+#define GAUSS_COLS 16
+#define GAUSS_ROWS 8
+
+typedef struct dt_gaussian_coeffs_t
 {
-  assert(g->channels == 4);
-  const size_t width = g->width;
-  const size_t height = g->height;
-
   float a0, a1, a2, a3, b1, b2, coefp, coefn;
+} dt_gaussian_coeffs_t;
+
+// vertical blur of the columns [i0, i0+ncols) of 'in' into 'temp'
+static inline void _blur_4c_columns(const float *const restrict in,
+                                    float *const restrict temp,
+                                    const size_t width,
+                                    const size_t height,
+                                    const size_t i0,
+                                    const size_t ncols,
+                                    const dt_gaussian_coeffs_t *const c,
+                                    const float *const restrict lmin,
+                                    const float *const restrict lmax)
+{
+  const size_t lanes = 4 * ncols;
+  float DT_ALIGNED_ARRAY xp[4 * GAUSS_COLS];
+  float DT_ALIGNED_ARRAY yb[4 * GAUSS_COLS];
+  float DT_ALIGNED_ARRAY yp[4 * GAUSS_COLS];
+
+  // forward filter
+  const float *const first = in + 4 * i0;
+  for(size_t l = 0; l < lanes; l++)
+  {
+    xp[l] = CLAMPF(first[l], lmin[l], lmax[l]);
+    yb[l] = xp[l] * c->coefp;
+    yp[l] = yb[l];
+  }
 
-  _compute_gauss_params(g->sigma, g->order, &a0, &a1, &a2, &a3, &b1, &b2, &coefp, &coefn);
-
-  float *const temp = g->buf;
-
-  dt_aligned_pixel_t Labmin, Labmax;
-  copy_pixel(Labmin, g->min);
-  copy_pixel(Labmax, g->max);
-
-// vertical blur column by column
-  DT_OMP_FOR()
-  for(size_t i = 0; i < width; i++)
+  for(size_t j = 0; j < height; j++)
   {
-    // forward filter
-    dt_aligned_pixel_t xp;
-    dt_aligned_pixel_t yb;
-    dt_aligned_pixel_t yp;
-    for_four_channels(k)
+    const size_t offset = 4 * (j * width + i0);
+    DT_OMP_SIMD(aligned(xp, yb, yp : 64))
+    for(size_t l = 0; l < lanes; l++)
     {
-      xp[k] = CLAMPF(in[4*i + k], Labmin[k], Labmax[k]);
-      yb[k] = xp[k] * coefp;
-      yp[k] = yb[k];
+      const float xc = CLAMPF(in[offset + l], lmin[l], lmax[l]);
+      const float yc = (c->a0 * xc) + (c->a1 * xp[l]) - (c->b1 * yp[l]) - (c->b2 * yb[l]);
+      temp[offset + l] = yc;
+      xp[l] = xc;
+      yb[l] = yp[l];
+      yp[l] = yc;
     }
+  }
 
-    dt_aligned_pixel_t xc;
-    dt_aligned_pixel_t xn;
-    dt_aligned_pixel_t xa;
-    for(size_t j = 0; j < height; j++)
-    {
-      size_t offset = 4 * (j * width + i);
-
-      dt_aligned_pixel_t yc;
-      for_four_channels(k)
-      {
-        xc[k] = CLAMPF(in[offset + k], Labmin[k], Labmax[k]);
-        yc[k] = (a0 * xc[k]) + (a1 * xp[k]) - (b1 * yp[k]) - (b2 * yb[k]);
+  // backward filter, reusing the state arrays as xn/xa and yn/ya
+  float *const xn = xp;
+  float *const xa = yb;
+  float *const yn = yp;
+  float DT_ALIGNED_ARRAY ya[4 * GAUSS_COLS];
+  const float *const last = in + 4 * ((height - 1) * width + i0);
+  for(size_t l = 0; l < lanes; l++)
+  {
+    xn[l] = CLAMPF(last[l], lmin[l], lmax[l]);
+    xa[l] = xn[l];
+    yn[l] = xn[l] * c->coefn;
+    ya[l] = yn[l];
+  }
 
-        xp[k] = xc[k];
-        yb[k] = yp[k];
-        yp[k] = yc[k];
-      }
-      copy_pixel(temp + offset, yc);
+  for(size_t j = height; j > 0; j--)
+  {
+    const size_t offset = 4 * ((j - 1) * width + i0);
+    DT_OMP_SIMD(aligned(xn, xa, yn, ya : 64))
+    for(size_t l = 0; l < lanes; l++)
+    {
+      const float xc = CLAMPF(in[offset + l], lmin[l], lmax[l]);
+      const float yc = (c->a2 * xn[l]) + (c->a3 * xa[l]) - (c->b1 * yn[l]) - (c->b2 * ya[l]);
+      xa[l] = xn[l];
+      xn[l] = xc;
+      ya[l] = yn[l];
+      yn[l] = yc;
+      temp[offset + l] += yc;
     }
+  }
+}
 
-    // backward filter
-    dt_aligned_pixel_t yn;
-    dt_aligned_pixel_t ya;
+// horizontal blur of the rows [j0, j0+nrows) of 'temp' into 'out'
+static inline void _blur_4c_rows(const float *const restrict temp,
+                                 float *const restrict out,
+                                 const size_t width,
+                                 const size_t j0,
+                                 const size_t nrows,
+                                 const dt_gaussian_coeffs_t *const c,
+                                 const float *const restrict lmin,
+                                 const float *const restrict lmax)
+{
+  dt_aligned_pixel_t xp[GAUSS_ROWS], yb[GAUSS_ROWS], yp[GAUSS_ROWS];
+  const float *const restrict row = temp + 4 * j0 * width;
+  float *const restrict orow = out + 4 * j0 * width;
+  const size_t stride = 4 * width;
+
+  // forward filter
+  for(size_t r = 0; r < nrows; r++)
     for_four_channels(k)
     {
-      xn[k] = CLAMPF(in[4*((height - 1) * width + i) + k], Labmin[k], Labmax[k]);
-      xa[k] = xn[k];
-      yn[k] = xn[k] * coefn;
-      ya[k] = yn[k];
+      xp[r][k] = CLAMPF(row[r * stride + k], lmin[k], lmax[k]);
+      yb[r][k] = xp[r][k] * c->coefp;
+      yp[r][k] = yb[r][k];
     }
 
-    for(size_t j = height; j > 0; j--)
+  for(size_t i = 0; i < width; i++)
+    for(size_t r = 0; r < nrows; r++)
     {
-      size_t offset = 4 * ((j-1) * width + i);
-
-      dt_aligned_pixel_t yc;
+      const size_t offset = r * stride + 4 * i;
       for_four_channels(k)
       {
-        xc[k] = CLAMPF(in[offset + k], Labmin[k], Labmax[k]);
-
-        yc[k] = (a2 * xn[k]) + (a3 * xa[k]) - (b1 * yn[k]) - (b2 * ya[k]);
-
-        xa[k] = xn[k];
-        xn[k] = xc[k];
-        ya[k] = yn[k];
-        yn[k] = yc[k];
-        temp[offset + k] += yc[k];
+        const float xc = CLAMPF(row[offset + k], lmin[k], lmax[k]);
+        const float yc = (c->a0 * xc) + (c->a1 * xp[r][k]) - (c->b1 * yp[r][k]) - (c->b2 * yb[r][k]);
+        orow[offset + k] = yc;
+        xp[r][k] = xc;
+        yb[r][k] = yp[r][k];
+        yp[r][k] = yc;
       }
     }
-  }
 
-// horizontal blur line by line
-  DT_OMP_FOR()
-  for(size_t j = 0; j < height; j++)
-  {
-    // forward filter
-    dt_aligned_pixel_t xp;
-    dt_aligned_pixel_t yb;
-    dt_aligned_pixel_t yp;
-    dt_aligned_pixel_t xc;
+  // backward filter
+  dt_aligned_pixel_t *const xn = xp;
+  dt_aligned_pixel_t *const xa = yb;
+  dt_aligned_pixel_t *const yn = yp;
+  dt_aligned_pixel_t ya[GAUSS_ROWS];
+  for(size_t r = 0; r < nrows; r++)
     for_four_channels(k)
     {
-      xp[k] = CLAMPF(temp[4*(j * width) + k], Labmin[k], Labmax[k]);
-      yb[k] = xp[k] * coefp;
-      yp[k] = yb[k];
+      xn[r][k] = CLAMPF(row[r * stride + 4 * (width - 1) + k], lmin[k], lmax[k]);
+      xa[r][k] = xn[r][k];
+      yn[r][k] = xn[r][k] * c->coefn;
+      ya[r][k] = yn[r][k];
     }
 
-    for(size_t i = 0; i < width; i++)
+  for(size_t i = width; i > 0; i--)
+    for(size_t r = 0; r < nrows; r++)
     {
-      size_t offset = 4 * (j * width + i);
-      dt_aligned_pixel_t yc;
-
+      const size_t offset = r * stride + 4 * (i - 1);
       for_four_channels(k)
       {
-        xc[k] = CLAMPF(temp[offset + k], Labmin[k], Labmax[k]);
-        yc[k] = (a0 * xc[k]) + (a1 * xp[k]) - (b1 * yp[k]) - (b2 * yb[k]);
-
-        out[offset + k] = yc[k];
-
-        xp[k] = xc[k];
-        yb[k] = yp[k];
-        yp[k] = yc[k];
+        const float xc = CLAMPF(row[offset + k], lmin[k], lmax[k]);
+        const float yc = (c->a2 * xn[r][k]) + (c->a3 * xa[r][k]) - (c->b1 * yn[r][k]) - (c->b2 * ya[r][k]);
+        xa[r][k] = xn[r][k];
+        xn[r][k] = xc;
+        ya[r][k] = yn[r][k];
+        yn[r][k] = yc;
+        orow[offset + k] += yc;
       }
     }
+}
 
-    // backward filter
-    dt_aligned_pixel_t xn;
-    dt_aligned_pixel_t xa;
-    dt_aligned_pixel_t ya;
-    dt_aligned_pixel_t yn;
-    for_four_channels(k)
-    {
-      xn[k] = CLAMPF(temp[4*((j + 1) * width - 1) + k], Labmin[k], Labmax[k]);
-      xa[k] = xn[k];
-      yn[k] = xn[k] * coefn;
-      ya[k] = yn[k];
-    }
+void dt_gaussian_blur_4c(dt_gaussian_t *g, const float *const in, float *const out)
+{
+  assert(g->channels == 4);
+  const size_t width = g->width;
+  const size_t height = g->height;
 
-    for(int i = width - 1; i > -1; i--)
-    {
-      size_t offset = 4 * (j * width + i);
+  dt_gaussian_coeffs_t coeffs;
+  _compute_gauss_params(g->sigma, g->order, &coeffs.a0, &coeffs.a1, &coeffs.a2, &coeffs.a3,
+                        &coeffs.b1, &coeffs.b2, &coeffs.coefp, &coeffs.coefn);
 
-      dt_aligned_pixel_t yc;
-      for_four_channels(k)
-      {
-        xc[k] = CLAMPF(temp[offset + k], Labmin[k], Labmax[k]);
+  float *const temp = g->buf;
 
-        yc[k] = (a2 * xn[k]) + (a3 * xa[k]) - (b1 * yn[k]) - (b2 * ya[k]);
+  // clamping bounds replicated for every lane of a column block
+  float DT_ALIGNED_ARRAY lmin[4 * GAUSS_COLS];
+  float DT_ALIGNED_ARRAY lmax[4 * GAUSS_COLS];
+  for(size_t l = 0; l < 4 * GAUSS_COLS; l++)
+  {
+    lmin[l] = g->min[l & 3];
+    lmax[l] = g->max[l & 3];
+  }
 
-        xa[k] = xn[k];
-        xn[k] = xc[k];
-        ya[k] = yn[k];
-        yn[k] = yc[k];
+// vertical blur, blocks of columns
+  const size_t col_blocks = (width + GAUSS_COLS - 1) / GAUSS_COLS;
+  DT_OMP_FOR()
+  for(size_t b = 0; b < col_blocks; b++)
+  {
+    const size_t i0 = b * GAUSS_COLS;
+    _blur_4c_columns(in, temp, width, height, i0, MIN(GAUSS_COLS, width - i0), &coeffs, lmin, lmax);
+  }
 
-        out[offset + k] += yc[k];
-      }
-    }
+// horizontal blur, blocks of rows
+  const size_t row_blocks = (height + GAUSS_ROWS - 1) / GAUSS_ROWS;
+  DT_OMP_FOR()
+  for(size_t b = 0; b < row_blocks; b++)
+  {
+    const size_t j0 = b * GAUSS_ROWS;
+    _blur_4c_rows(temp, out, width, j0, MIN(GAUSS_ROWS, height - j0), &coeffs, lmin, lmax);
   }
 }
 
@@ -54,19 +54,6 @@ typedef struct color_image
   int width, height, stride;
 } color_image;
 
-// allocate space for n-component image of size width x height
-static inline color_image _new_color_image(int width, int height, int ch)
-{
-  return (color_image){ dt_alloc_align_float((size_t)width * height * ch), width, height, ch };
-}
-
-// free space for n-component image
-static inline void _free_color_image(color_image *img_p)
-{
-  dt_free_align(img_p->data);
-  img_p->data = NULL;
-}
-
 // get a pointer to pixel number 'i' within the image
 static inline float *_get_color_pixel(color_image img, size_t i)
 {
@@ -91,14 +78,17 @@ static void _guided_filter_tiling(color_image imgg,
                                   const float eps,
                                   const float guide_weight,
                                   const float min,
-                                  const float max)
+                                  const float max,
+                                  float *const mean_buf,
+                                  float *const variance_buf,
+                                  float *const img_bak,
+                                  const size_t img_bak_sz)
 {
   const int overlap = dt_round_size(3 * w, 16);
   const tile source = { MAX(target.left - overlap, 0),  MIN(target.right + overlap, imgg.width),
                         MAX(target.lower - overlap, 0), MIN(target.upper + overlap, imgg.height) };
   const int width = source.right - source.left;
   const int height = source.upper - source.lower;
-  size_t size = (size_t)width * (size_t)height;
 // since we're packing multiple monochrome planes into a color image, define symbolic constants so that
 // we can keep track of which values we're actually using
 #define INP_MEAN 0
@@ -114,11 +104,9 @@ static void _guided_filter_tiling(color_image imgg,
 #define VAR_GG 6
 #define VAR_BB 8
 #define VAR_GB 7
-  color_image mean = _new_color_image(width, height, 4);
-  color_image variance = _new_color_image(width, height, 9);
-  const size_t img_dimen = dt_round_size(mean.width, 16);
-  size_t img_bak_sz;
-  float *img_bak = dt_alloc_perthread_float(9*img_dimen, &img_bak_sz);
+  // the buffers are allocated once for the largest tile by the caller and reused for every tile
+  color_image mean = { mean_buf, width, height, 4 };
+  color_image variance = { variance_buf, width, height, 9 };
   DT_OMP_FOR(shared(img, imgg, mean, variance, img_bak) dt_omp_sharedconst(source))
   for(int j_imgg = source.lower; j_imgg < source.upper; j_imgg++)
   {
@@ -151,7 +139,6 @@ static void _guided_filter_tiling(color_image imgg,
     dt_box_mean_horizontal(meanpx, mean.width, 4|BOXFILTER_KAHAN_SUM, w, scratch);
     dt_box_mean_horizontal(varpx, variance.width, 9|BOXFILTER_KAHAN_SUM, w, scratch);
   }
-  dt_free_align(img_bak);
   dt_box_mean_vertical(mean.data, mean.height, mean.width, 4|BOXFILTER_KAHAN_SUM, w);
   dt_box_mean_vertical(variance.data, variance.height, variance.width, 9|BOXFILTER_KAHAN_SUM, w);
   // we will recycle memory of 'mean' for the new coefficient arrays a_? and b to reduce memory foot print
@@ -160,63 +147,68 @@ static void _guided_filter_tiling(color_image imgg,
   #define A_GREEN 1
   #define A_BLUE 2
   #define B 3
-  DT_OMP_FOR(shared(mean, variance, a_b))
-  for(size_t i = 0; i < size; i++)
+  // solve row by row and apply the horizontal pass of the box mean of the coefficients while the
+  // cache is still hot
+  DT_OMP_FOR(shared(mean, variance, a_b, img_bak))
+  for(int j = 0; j < height; j++)
   {
-    const float *meanpx = _get_color_pixel(mean, i);
-    const float inp_mean = meanpx[INP_MEAN];
-    const float guide_r = meanpx[GUIDE_MEAN_R];
-    const float guide_g = meanpx[GUIDE_MEAN_G];
-    const float guide_b = meanpx[GUIDE_MEAN_B];
-    float *const varpx = _get_color_pixel(variance, i);
-    // solve linear system of equations of size 3x3 via Cramer's rule
-    // symmetric coefficient matrix
-    const float Sigma_0_0 = varpx[VAR_RR] - (guide_r * guide_r) + eps;
-    const float Sigma_0_1 = varpx[VAR_RG] - (guide_r * guide_g);
-    const float Sigma_0_2 = varpx[VAR_RB] - (guide_r * guide_b);
-    const float Sigma_1_1 = varpx[VAR_GG] - (guide_g * guide_g) + eps;;
-    const float Sigma_1_2 = varpx[VAR_GB] - (guide_g * guide_b);
-    const float Sigma_2_2 = varpx[VAR_BB] - (guide_b * guide_b) + eps;
-    const float det0 = Sigma_0_0 * (Sigma_1_1 * Sigma_2_2 - Sigma_1_2 * Sigma_1_2)
-      - Sigma_0_1 * (Sigma_0_1 * Sigma_2_2 - Sigma_0_2 * Sigma_1_2)
-      + Sigma_0_2 * (Sigma_0_1 * Sigma_1_2 - Sigma_0_2 * Sigma_1_1);
-    float a_r_, a_g_, a_b_, b_;
-    if(fabsf(det0) > 4.f * FLT_EPSILON)
-    {
-      const float cov_r = varpx[COV_R] - guide_r * inp_mean;
-      const float cov_g = varpx[COV_G] - guide_g * inp_mean;
-      const float cov_b = varpx[COV_B] - guide_b * inp_mean;
-      const float det1 = cov_r * (Sigma_1_1 * Sigma_2_2 - Sigma_1_2 * Sigma_1_2)
-        - Sigma_0_1 * (cov_g * Sigma_2_2 - cov_b * Sigma_1_2)
-        + Sigma_0_2 * (cov_g * Sigma_1_2 - cov_b * Sigma_1_1);
-      const float det2 = Sigma_0_0 * (cov_g * Sigma_2_2 - cov_b * Sigma_1_2)
-        - cov_r * (Sigma_0_1 * Sigma_2_2 - Sigma_0_2 * Sigma_1_2)
-        + Sigma_0_2 * (Sigma_0_1 * cov_b - Sigma_0_2 * cov_g);
-      const float det3 = Sigma_0_0 * (Sigma_1_1 * cov_b - Sigma_1_2 * cov_g)
-        - Sigma_0_1 * (Sigma_0_1 * cov_b - Sigma_0_2 * cov_g)
-        + cov_r * (Sigma_0_1 * Sigma_1_2 - Sigma_0_2 * Sigma_1_1);
-      a_r_ = det1 / det0;
-      a_g_ = det2 / det0;
-      a_b_ = det3 / det0;
-      b_ = inp_mean - a_r_ * guide_r - a_g_ * guide_g - a_b_ * guide_b;
-    }
-    else
+    for(size_t i = (size_t)j * width; i < (size_t)(j + 1) * width; i++)
     {
-      // linear system is singular
-      a_r_ = 0.f;
-      a_g_ = 0.f;
-      a_b_ = 0.f;
-      b_ = _get_color_pixel(mean, i)[INP_MEAN];
+      const float *meanpx = _get_color_pixel(mean, i);
+      const float inp_mean = meanpx[INP_MEAN];
+      const float guide_r = meanpx[GUIDE_MEAN_R];
+      const float guide_g = meanpx[GUIDE_MEAN_G];
+      const float guide_b = meanpx[GUIDE_MEAN_B];
+      float *const varpx = _get_color_pixel(variance, i);
+      // solve linear system of equations of size 3x3 via Cramer's rule
+      // symmetric coefficient matrix
+      const float Sigma_0_0 = varpx[VAR_RR] - (guide_r * guide_r) + eps;
+      const float Sigma_0_1 = varpx[VAR_RG] - (guide_r * guide_g);
+      const float Sigma_0_2 = varpx[VAR_RB] - (guide_r * guide_b);
+      const float Sigma_1_1 = varpx[VAR_GG] - (guide_g * guide_g) + eps;;
+      const float Sigma_1_2 = varpx[VAR_GB] - (guide_g * guide_b);
+      const float Sigma_2_2 = varpx[VAR_BB] - (guide_b * guide_b) + eps;
+      const float det0 = Sigma_0_0 * (Sigma_1_1 * Sigma_2_2 - Sigma_1_2 * Sigma_1_2)
+        - Sigma_0_1 * (Sigma_0_1 * Sigma_2_2 - Sigma_0_2 * Sigma_1_2)
+        + Sigma_0_2 * (Sigma_0_1 * Sigma_1_2 - Sigma_0_2 * Sigma_1_1);
+      float a_r_, a_g_, a_b_, b_;
+      if(fabsf(det0) > 4.f * FLT_EPSILON)
+      {
+        const float cov_r = varpx[COV_R] - guide_r * inp_mean;
+        const float cov_g = varpx[COV_G] - guide_g * inp_mean;
+        const float cov_b = varpx[COV_B] - guide_b * inp_mean;
+        const float det1 = cov_r * (Sigma_1_1 * Sigma_2_2 - Sigma_1_2 * Sigma_1_2)
+          - Sigma_0_1 * (cov_g * Sigma_2_2 - cov_b * Sigma_1_2)
+          + Sigma_0_2 * (cov_g * Sigma_1_2 - cov_b * Sigma_1_1);
+        const float det2 = Sigma_0_0 * (cov_g * Sigma_2_2 - cov_b * Sigma_1_2)
+          - cov_r * (Sigma_0_1 * Sigma_2_2 - Sigma_0_2 * Sigma_1_2)
+          + Sigma_0_2 * (Sigma_0_1 * cov_b - Sigma_0_2 * cov_g);
+        const float det3 = Sigma_0_0 * (Sigma_1_1 * cov_b - Sigma_1_2 * cov_g)
+          - Sigma_0_1 * (Sigma_0_1 * cov_b - Sigma_0_2 * cov_g)
+          + cov_r * (Sigma_0_1 * Sigma_1_2 - Sigma_0_2 * Sigma_1_1);
+        a_r_ = det1 / det0;
+        a_g_ = det2 / det0;
+        a_b_ = det3 / det0;
+        b_ = inp_mean - a_r_ * guide_r - a_g_ * guide_g - a_b_ * guide_b;
+      }
+      else
+      {
+        // linear system is singular
+        a_r_ = 0.f;
+        a_g_ = 0.f;
+        a_b_ = 0.f;
+        b_ = _get_color_pixel(mean, i)[INP_MEAN];
+      }
+      // now data of imgg_mean_? is no longer needed, we can safely overwrite aliasing arrays
+      a_b.data[4*i+A_RED] = a_r_;
+      a_b.data[4*i+A_GREEN] = a_g_;
+      a_b.data[4*i+A_BLUE] = a_b_;
+      a_b.data[4*i+B] = b_;
     }
-    // now data of imgg_mean_? is no longer needed, we can safely overwrite aliasing arrays
-    a_b.data[4*i+A_RED] = a_r_;
-    a_b.data[4*i+A_GREEN] = a_g_;
-    a_b.data[4*i+A_BLUE] = a_b_;
-    a_b.data[4*i+B] = b_;
+    float *const restrict scratch = dt_get_perthread(img_bak, img_bak_sz);
+    dt_box_mean_horizontal(a_b.data + (size_t)4 * j * width, width, 4|BOXFILTER_KAHAN_SUM, w, scratch);
   }
-  _free_color_image(&variance);
-
-  dt_box_mean(a_b.data, a_b.height, a_b.width, a_b.stride|BOXFILTER_KAHAN_SUM, w, 1);
+  dt_box_mean_vertical(a_b.data, a_b.height, a_b.width, 4|BOXFILTER_KAHAN_SUM, w);
 
   DT_OMP_FOR(shared(target, imgg, a_b, img_out) dt_omp_sharedconst(source))
   for(int j_imgg = target.lower; j_imgg < target.upper; j_imgg++)
@@ -236,7 +228,6 @@ static void _guided_filter_tiling(color_image imgg,
       img_out.data[i_imgg + (size_t)j_imgg * imgg.width] = CLAMP(res, min, max);
     }
   }
-  _free_color_image(&mean);
 }
 
 void guided_filter(const float *const guide,
@@ -260,15 +251,35 @@ void guided_filter(const float *const guide,
   const int tile_dim = MAX(dt_round_size(3 * w, 16), GF_TILE_SIZE);
   const float eps = sqrt_eps * sqrt_eps; // this is the regularization parameter of the original papers
 
+  // scratch space for the largest possible tile including its overlap, shared by all tiles
+  const int overlap = dt_round_size(3 * w, 16);
+  const size_t max_width = MIN(width, tile_dim + 2 * overlap);
+  const size_t max_height = MIN(height, tile_dim + 2 * overlap);
+  float *const mean = dt_alloc_align_float(max_width * max_height * 4);
+  float *const variance = dt_alloc_align_float(max_width * max_height * 9);
+  size_t img_bak_sz;
+  float *const img_bak = dt_alloc_perthread_float(9 * dt_round_size(max_width, 16), &img_bak_sz);
+  if(!mean || !variance || !img_bak)
+  {
+    dt_print(DT_DEBUG_ALWAYS, "[guided filter] unable to allocate scratch memory");
+    goto cleanup;
+  }
+
   for(int j = 0; j < height; j += tile_dim)
   {
     for(int i = 0; i < width; i += tile_dim)
     {
       tile target = { i, MIN(i + tile_dim, width),
                       j, MIN(j + tile_dim, height) };
-      _guided_filter_tiling(img_guide, img_in, img_out, target, w, eps, guide_weight, min, max);
+      _guided_filter_tiling(img_guide, img_in, img_out, target, w, eps, guide_weight, min, max,
+                            mean, variance, img_bak, img_bak_sz);
     }
   }
+
+cleanup:
+  dt_free_align(img_bak);
+  dt_free_align(variance);
+  dt_free_align(mean);
 }
 
 #ifdef HAVE_OPENCL
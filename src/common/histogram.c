@@ -19,6 +19,7 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <assert.h>
+#include <float.h>
 #include <stdlib.h>
 
 #include "common/colorspaces_inline_conversions.h"
@@ -294,6 +295,72 @@ void dt_histogram_helper(dt_dev_histogram_collection_params_t *histogram_params,
             dt_get_lap_time(&start_time.clock), dt_get_lap_utime(&start_time.user));
 }
 
+//------------------------------------------------------------------------------
+
+void dt_histogram_log_stats(const float *const pixel,
+                            const size_t npixels,
+                            const int ch,
+                            const dt_iop_order_iccprofile_info_t *const profile,
+                            dt_histogram_log_stats_t *stats)
+{
+  dt_times_t start_time = { 0 };
+  dt_get_perf_times(&start_time);
+
+  // hack to make reduction clause work
+  uint32_t DT_ALIGNED_PIXEL *bins = stats->bins;
+  memset(bins, 0, sizeof(stats->bins));
+  float lmin = FLT_MAX;
+  float lmax = -FLT_MAX;
+  double sum = 0.0;
+
+  DT_OMP_FOR(reduction(+:bins[:DT_HISTOGRAM_LOG_BINS], sum) reduction(min:lmin) reduction(max:lmax))
+  for(size_t k = 0; k < npixels; k++)
+  {
+    const float lum = (ch == 1)
+      ? pixel[k]
+      : (profile
+         ? dt_ioppr_get_rgb_matrix_luminance(pixel + 4 * k,
+                                             profile->matrix_in,
+                                             profile->lut_in,
+                                             profile->unbounded_coeffs_in,
+                                             profile->lutsize,
+                                             profile->nonlinearlut)
+         : dt_camera_rgb_luminance(pixel + 4 * k));
+
+    // log2f(0) is -inf and lands in the first bin like all negative values
+    const float ev = log2f(fmaxf(lum, 0.0f)) - DT_HISTOGRAM_LOG_MIN_EV;
+    const int bin = CLAMP((int)(ev * DT_HISTOGRAM_LOG_BINS_PER_EV), 0, DT_HISTOGRAM_LOG_BINS - 1);
+    bins[bin]++;
+    lmin = fminf(lmin, lum);
+    lmax = fmaxf(lmax, lum);
+    sum += lum;
+  }
+
+  stats->pixels = npixels;
+  stats->min = lmin;
+  stats->max = lmax;
+  stats->mean = npixels ? sum / npixels : 0.0f;
+
+  dt_print(DT_DEBUG_PERF,
+           "log histogram calculation %d channels %zu pixels took %.3f secs (%.3f CPU)",
+           ch, npixels,
+           dt_get_lap_time(&start_time.clock), dt_get_lap_utime(&start_time.user));
+}
+
+float dt_histogram_log_percentile(const dt_histogram_log_stats_t *const stats,
+                                  const float percentile)
+{
+  const size_t wanted = MAX((size_t)1, (size_t)(percentile * stats->pixels));
+  size_t population = 0;
+  int bin = 0;
+  for(; bin < DT_HISTOGRAM_LOG_BINS - 1; bin++)
+  {
+    population += stats->bins[bin];
+    if(population >= wanted) break;
+  }
+  return DT_HISTOGRAM_LOG_MIN_EV + (bin + 0.5f) / DT_HISTOGRAM_LOG_BINS_PER_EV;
+}
+
 // clang-format off
 // modelines: These editor modelines have been set for all relevant files by tools/update_modelines.py
 // vim: shiftwidth=2 expandtab tabstop=2 cindent
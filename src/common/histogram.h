@@ -48,6 +48,38 @@ void dt_histogram_helper(dt_dev_histogram_collection_params_t *histogram_params,
                          const gboolean compensate_middle_grey,
                          const dt_iop_order_iccprofile_info_t *const profile_info);
 
+/*
+ * log2 luminance statistics
+ *
+ * used by the automatic settings of modules, 32 bins per EV between
+ * DT_HISTOGRAM_LOG_MIN_EV and DT_HISTOGRAM_LOG_MAX_EV, luminances outside
+ * of this range are counted in the first or last bin.
+ */
+#define DT_HISTOGRAM_LOG_MIN_EV -16.0f
+#define DT_HISTOGRAM_LOG_MAX_EV 8.0f
+#define DT_HISTOGRAM_LOG_BINS_PER_EV 32
+#define DT_HISTOGRAM_LOG_BINS 768
+
+typedef struct dt_histogram_log_stats_t
+{
+  uint32_t bins[DT_HISTOGRAM_LOG_BINS];
+  size_t pixels;  // count of pixels sampled
+  float min, max; // luminance extremes
+  float mean;     // mean luminance
+} dt_histogram_log_stats_t;
+
+// collects the statistics of a luminance plane (ch == 1) or of the
+// luminance of a 4 channel RGB buffer in the given profile (ch == 4)
+void dt_histogram_log_stats(const float *const pixel,
+                            const size_t npixels,
+                            const int ch,
+                            const dt_iop_order_iccprofile_info_t *const profile,
+                            dt_histogram_log_stats_t *stats);
+
+// EV of the bin holding the given percentile in [0, 1] of the pixels
+float dt_histogram_log_percentile(const dt_histogram_log_stats_t *const stats,
+                                  const float percentile);
+
 // clang-format off
 // modelines: These editor modelines have been set for all relevant files by tools/update_modelines.py
 // vim: shiftwidth=2 expandtab tabstop=2 cindent
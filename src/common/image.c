@@ -627,7 +627,11 @@ static void _set_location(const dt_imgid_t imgid, const dt_image_geoloc_t *geolo
   dt_image_t *image = dt_image_cache_get(imgid, 'w');
 
   if(image)
+  {
     memcpy(&image->geoloc, geoloc, sizeof(dt_image_geoloc_t));
+    if(image->flags & DT_IMAGE_EXIF_PENDING)
+      image->flags |= DT_IMAGE_EXIF_KEEP_GEOLOC;
+  }
 
   dt_image_cache_write_release_info(image, DT_IMAGE_CACHE_SAFE, "_set_location");
 }
@@ -638,7 +642,11 @@ static void _set_datetime(const dt_imgid_t imgid, const char *datetime)
   dt_image_t *image = dt_image_cache_get(imgid, 'w');
 
   if(image)
+  {
     dt_datetime_exif_to_img(image, datetime);
+    if(image->flags & DT_IMAGE_EXIF_PENDING)
+      image->flags |= DT_IMAGE_EXIF_KEEP_DATETIME;
+  }
 
   dt_image_cache_write_release_info(image, DT_IMAGE_CACHE_SAFE, "_set_datetime");
 }
@@ -2020,9 +2028,14 @@ static dt_imgid_t _image_import_internal(const dt_filmid_t film_id,
   {
     img->group_id = group_id;
 
-    // read dttags and exif for database queries!
-    if(dt_exif_read(img, normalized_filename))
-      img->exif_inited = FALSE;
+    // read dttags and exif for database queries! the fast scan only
+    // gets what the lighttable needs, exiv2 does the rest later.
+    if(!dt_conf_get_bool("ui/fast_exif_import")
+       || dt_exif_read_basic(img, normalized_filename))
+    {
+      if(dt_exif_read(img, normalized_filename))
+        img->exif_inited = FALSE;
+    }
     char dtfilename[PATH_MAX] = { 0 };
     g_strlcpy(dtfilename, normalized_filename, sizeof(dtfilename));
     // dt_image_path_append_version(id, dtfilename, sizeof(dtfilename));
@@ -101,6 +101,15 @@ typedef enum
   DT_IMAGE_MONOCHROME_BAYER = 1 << 19,
   // image has a flag set to use the monochrome workflow in the modules supporting it
   DT_IMAGE_MONOCHROME_WORKFLOW = 1 << 20,
+  // only the basic exif data has been read at import, the full
+  // exiv2 decoding is still to be done
+  DT_IMAGE_EXIF_PENDING = 1 << 21,
+  // while the exif data is pending: the date taken, the location or the
+  // lens have been set by the sidecar or the user and must be kept when
+  // the full exif data is read
+  DT_IMAGE_EXIF_KEEP_DATETIME = 1 << 22,
+  DT_IMAGE_EXIF_KEEP_GEOLOC = 1 << 23,
+  DT_IMAGE_EXIF_KEEP_LENS = 1 << 24,
 } dt_image_flags_t;
 
 typedef enum dt_image_colorspace_t
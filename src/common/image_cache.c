@@ -93,7 +93,9 @@ static void _image_cache_allocate(void *data,
     img->exif_crop = sqlite3_column_double(stmt, 15);
     img->orientation = sqlite3_column_int(stmt, 16);
     img->exif_focus_distance = sqlite3_column_double(stmt, 17);
-    if(img->exif_focus_distance >= 0 && img->orientation >= 0) img->exif_inited = TRUE;
+    if(img->exif_focus_distance >= 0 && img->orientation >= 0
+       && !(img->flags & DT_IMAGE_EXIF_PENDING))
+      img->exif_inited = TRUE;
     uint32_t tmp = sqlite3_column_int(stmt, 18);
     memcpy(&img->legacy_flip, &tmp, sizeof(dt_image_raw_parameters_t));
     if(sqlite3_column_type(stmt, 19) == SQLITE_FLOAT)
@@ -1008,6 +1008,58 @@ static gboolean _prepare_resampling_plan(const dt_interpolation_t *itor,
   return FALSE;
 }
 
+/** Finds the range of input samples referenced by a resampling plan
+ */
+static void _plan_index_range(const int *const length,
+                              const int *const index,
+                              const int out,
+                              int *imin,
+                              int *imax)
+{
+  size_t ntaps = 0;
+  for(int x = 0; x < out; x++)
+    ntaps += length[x];
+  for(size_t k = 0; k < ntaps; k++)
+  {
+    *imin = MIN(*imin, index[k]);
+    *imax = MAX(*imax, index[k]);
+  }
+}
+
+/** Vertical pass of the separable resampling: accumulates vl input
+ *  lines of n contiguous floats, weighted by the kernel taps, into row.
+ *  The inner loop runs over contiguous memory and vectorizes.
+ */
+static inline void _resample_vertical(float *const restrict row,
+                                      const float *const restrict in,
+                                      const size_t in_stride,
+                                      const size_t n,
+                                      const int *const restrict index,
+                                      const float *const restrict kernel,
+                                      const int vl)
+{
+  if(vl <= 0)
+  {
+    memset(row, 0, n * sizeof(float));
+    return;
+  }
+
+  const float *const first = in + (size_t)index[0] * in_stride;
+  const float tap0 = kernel[0];
+  DT_OMP_SIMD(aligned(row:64))
+  for(size_t k = 0; k < n; k++)
+    row[k] = first[k] * tap0;
+
+  for(int iy = 1; iy < vl; iy++)
+  {
+    const float *const line = in + (size_t)index[iy] * in_stride;
+    const float tap = kernel[iy];
+    DT_OMP_SIMD(aligned(row:64))
+    for(size_t k = 0; k < n; k++)
+      row[k] += line[k] * tap;
+  }
+}
+
 /** Applies resampling (re-scaling) on *full* input and output buffers.
  *  roi_in and roi_out define the part of the buffers that is affected.
  */
@@ -1086,78 +1138,62 @@ void dt_interpolation_resample(const dt_interpolation_t *itor,
                               &vlength, &vkernel, &vindex, &vmeta))
     goto exit;
 
+  // The horizontal plan only ever touches this range of input columns
+  int hmin = roi_in->width - 1;
+  int hmax = 0;
+  _plan_index_range(hlength, hindex, roi_out->width, &hmin, &hmax);
+  const size_t ncols = hmax >= hmin ? hmax - hmin + 1 : 0;
+  if(!ncols) goto exit;
+
+  // One vertically filtered input row per thread, small enough to stay
+  // in cache while the horizontal pass gathers from it
+  size_t padded_rowsize;
+  float *const vrows = dt_alloc_perthread_float(4 * ncols, &padded_rowsize);
+  if(!vrows) goto exit;
+
   dt_get_perf_times(&mid);
 
-  // Process each output line
+  // Process each output line in two separable passes
   DT_OMP_FOR()
   for(size_t oy = 0; oy < (size_t)roi_out->height; oy++)
   {
-    // Initialize column resampling indexes
-    int vlidx = vmeta[3 * oy + 0]; // V(ertical) L(ength) I(n)d(e)x
-    int vkidx = vmeta[3 * oy + 1]; // V(ertical) K(ernel) I(n)d(e)x
-    int viidx = vmeta[3 * oy + 2]; // V(ertical) I(ndex) I(n)d(e)x
-
-    // Initialize row resampling indexes
-    int hlidx = 0; // H(orizontal) L(ength) I(n)d(e)x
-    int hkidx = 0; // H(orizontal) K(ernel) I(n)d(e)x
+    float *const vrow = dt_get_perthread(vrows, padded_rowsize);
 
-    // Number of lines contributing to the output line
-    int vl = vlength[vlidx++]; // V(ertical) L(ength)
+    // Vertical pass: weighted sum of the contributing input lines
+    const int vl = vlength[vmeta[3 * oy + 0]]; // V(ertical) L(ength)
+    const int vkidx = vmeta[3 * oy + 1];        // V(ertical) K(ernel) I(n)d(e)x
+    const int viidx = vmeta[3 * oy + 2];        // V(ertical) I(ndex) I(n)d(e)x
+    _resample_vertical(vrow, in + 4 * hmin, in_stride_floats, 4 * ncols,
+                       vindex + viidx, vkernel + vkidx, vl);
 
-    // Process each output column
+    // Horizontal pass: gather and weight the filtered pixels
+    int hkidx = 0; // H(orizontal) K(ernel) I(n)d(e)x
+    float *const orow = out + oy * out_stride_floats;
     for(size_t ox = 0; ox < (size_t)roi_out->width; ox++)
     {
       // This will hold the resulting pixel
       dt_aligned_pixel_t vs = { 0.0f, 0.0f, 0.0f, 0.0f };
 
       // Number of horizontal samples contributing to the output
-      int hl = hlength[hlidx++]; // H(orizontal) L(ength)
-
-      for(size_t iy = 0; iy < vl; iy++)
+      const int hl = hlength[ox]; // H(orizontal) L(ength)
+      for(int ix = 0; ix < hl; ix++, hkidx++)
       {
-        // This is our input line
-        size_t baseidx_vindex = (size_t)vindex[viidx++] * in_stride_floats;
-
-        dt_aligned_pixel_t vhs = { 0.0f, 0.0f, 0.0f, 0.0f };
-
-        for(size_t ix = 0; ix < hl; ix++)
-        {
-          // Apply the precomputed filter kernel
-          const size_t baseidx = baseidx_vindex + (size_t)hindex[hkidx] * 4;
-          const float htap = hkernel[hkidx++];
-          dt_aligned_pixel_t tmp;
-          copy_pixel(tmp, in + baseidx);
-          for_each_channel(c, aligned(tmp,vhs:16))
-            vhs[c] += tmp[c] * htap;
-        }
-
-        // Accumulate contribution from this line
-        const float vtap = vkernel[vkidx++];
-        for_each_channel(c, aligned(vhs,vs:16)) vs[c] += vhs[c] * vtap;
-
-        // Reset horizontal resampling context
-        hkidx -= hl;
+        const float *const px = vrow + 4 * (hindex[hkidx] - hmin);
+        const float htap = hkernel[hkidx];
+        for_each_channel(c, aligned(vs:16))
+          vs[c] += px[c] * htap;
       }
 
-      // Output pixel is ready
-      const size_t baseidx = (size_t)oy * out_stride_floats + (size_t)ox * 4;
-
       // Clip negative RGB that may be produced by Lanczos undershooting
       // Negative RGB are invalid values no matter the RGB space (light is positive)
       dt_aligned_pixel_t pixel;
       for_each_channel(c, aligned(vs:16))
         pixel[c] = MAX(vs[c], 0.f);
-      copy_pixel_nontemporal(out + baseidx, pixel);
-
-      // Reset vertical resampling context
-      viidx -= vl;
-      vkidx -= vl;
-
-      // Progress in horizontal context
-      hkidx += hl;
+      copy_pixel_nontemporal(orow + ox * 4, pixel);
     }
   }
   dt_omploop_sfence();
+  dt_free_align(vrows);
 
 exit:
   /* Free the resampling plans. It's nasty to optimize allocs like that, but
@@ -1189,6 +1225,147 @@ void dt_interpolation_resample_roi(const dt_interpolation_t *itor,
   dt_interpolation_resample(itor, out, &oroi, in, &iroi);
 }
 
+/* --------------------------------------------------------------------------
+ * Warping with a coordinate map evaluated on a coarse grid
+ * ------------------------------------------------------------------------*/
+
+// size of the coarse grid cells, a power of two
+#define WARP_CELL 16
+
+typedef struct _warp_t
+{
+  const dt_interpolation_t *itor;
+  float *out;
+  const float *in;
+  int out_width, out_height;
+  int in_width, in_height;
+  dt_interpolation_warp_map_t map;
+  const void *data;
+  float max_error;
+} _warp_t;
+
+// the corners of a cell are at (x0, y0), (x0 + size, y0), (x0, y0 + size), (x0 + size, y0 + size)
+static inline float _warp_bilinear(const float c[4],
+                                   const float fx,
+                                   const float fy)
+{
+  return (1.0f - fy) * (c[0] + fx * (c[1] - c[0])) + fy * (c[2] + fx * (c[3] - c[2]));
+}
+
+static gboolean _warp_grid_precise(const _warp_t *w,
+                                   const float cx[4],
+                                   const float cy[4],
+                                   const int x0,
+                                   const int y0,
+                                   const int size)
+{
+  // the deviation of smooth maps is largest in the middle of the cell and its edges
+  static const float check[5][2] = { { 0.5f, 0.5f }, { 0.5f, 0.0f }, { 0.0f, 0.5f },
+                                     { 0.5f, 1.0f }, { 1.0f, 0.5f } };
+  for(int k = 0; k < 5; k++)
+  {
+    float xin, yin;
+    w->map(w->data, x0 + check[k][0] * size, y0 + check[k][1] * size, &xin, &yin);
+    if(fabsf(xin - _warp_bilinear(cx, check[k][0], check[k][1])) > w->max_error
+       || fabsf(yin - _warp_bilinear(cy, check[k][0], check[k][1])) > w->max_error)
+      return FALSE;
+  }
+  return TRUE;
+}
+
+static void _warp_cell(const _warp_t *w,
+                       const int x0,
+                       const int y0,
+                       const int size)
+{
+  const int x1 = MIN(x0 + size, w->out_width);
+  const int y1 = MIN(y0 + size, w->out_height);
+  const int linestride = 4 * w->in_width;
+
+  float cx[4], cy[4];
+  gboolean grid = w->max_error > 0.0f && size > 1;
+  if(grid)
+  {
+    for(int k = 0; k < 4; k++)
+      w->map(w->data, x0 + (k & 1) * size, y0 + (k >> 1) * size, &cx[k], &cy[k]);
+    grid = _warp_grid_precise(w, cx, cy, x0, y0, size);
+  }
+
+  if(!grid && size > 2 && w->max_error > 0.0f)
+  {
+    const int half = size / 2;
+    for(int j = y0; j < y1; j += half)
+      for(int i = x0; i < x1; i += half)
+        _warp_cell(w, i, j, half);
+    return;
+  }
+
+  float DT_ALIGNED_ARRAY xin[WARP_CELL];
+  float DT_ALIGNED_ARRAY yin[WARP_CELL];
+  const float oosize = 1.0f / size;
+  for(int j = y0; j < y1; j++)
+  {
+    const int n = x1 - x0;
+    if(grid)
+    {
+      const float fy = (j - y0) * oosize;
+      const float lx = cx[0] + fy * (cx[2] - cx[0]);
+      const float rx = cx[1] + fy * (cx[3] - cx[1]);
+      const float ly = cy[0] + fy * (cy[2] - cy[0]);
+      const float ry = cy[1] + fy * (cy[3] - cy[1]);
+      DT_OMP_SIMD(aligned(xin, yin : 64))
+      for(int i = 0; i < n; i++)
+      {
+        const float fx = i * oosize;
+        xin[i] = lx + fx * (rx - lx);
+        yin[i] = ly + fx * (ry - ly);
+      }
+    }
+    else
+    {
+      for(int i = 0; i < n; i++)
+        w->map(w->data, x0 + i, j, &xin[i], &yin[i]);
+    }
+
+    float *const out = w->out + (size_t)4 * ((size_t)j * w->out_width + x0);
+    for(int i = 0; i < n; i++)
+      dt_interpolation_compute_pixel4c(w->itor, w->in, out + 4 * i, xin[i], yin[i],
+                                       w->in_width, w->in_height, linestride);
+  }
+}
+
+void dt_interpolation_warp(const dt_interpolation_t *itor,
+                           float *out,
+                           const dt_iop_roi_t *const roi_out,
+                           const float *const in,
+                           const dt_iop_roi_t *const roi_in,
+                           dt_interpolation_warp_map_t map,
+                           const void *data,
+                           const float max_error)
+{
+  const _warp_t w = { .itor = itor,
+                      .out = out,
+                      .in = in,
+                      .out_width = roi_out->width,
+                      .out_height = roi_out->height,
+                      .in_width = roi_in->width,
+                      .in_height = roi_in->height,
+                      .map = map,
+                      .data = data,
+                      .max_error = max_error };
+
+  const int cells_x = (roi_out->width + WARP_CELL - 1) / WARP_CELL;
+  const int cells_y = (roi_out->height + WARP_CELL - 1) / WARP_CELL;
+
+  // refined cells take longer, so hand them out dynamically
+  DT_OMP_PRAGMA(parallel for default(firstprivate) schedule(dynamic) collapse(2))
+  for(int cy = 0; cy < cells_y; cy++)
+    for(int cx = 0; cx < cells_x; cx++)
+      _warp_cell(&w, cx * WARP_CELL, cy * WARP_CELL, WARP_CELL);
+}
+
+#undef WARP_CELL
+
 #ifdef HAVE_OPENCL
 dt_interpolation_cl_global_t *dt_interpolation_init_cl_global()
 {
@@ -1510,72 +1687,49 @@ void dt_interpolation_resample_1c(const dt_interpolation_t *itor,
     goto exit;
   }
 
+  // The horizontal plan only ever touches this range of input columns
+  int hmin = roi_in->width - 1;
+  int hmax = 0;
+  _plan_index_range(hlength, hindex, roi_out->width, &hmin, &hmax);
+  const size_t ncols = hmax >= hmin ? hmax - hmin + 1 : 0;
+  if(!ncols) goto exit;
+
+  size_t padded_rowsize;
+  float *const vrows = dt_alloc_perthread_float(ncols, &padded_rowsize);
+  if(!vrows)
+  {
+    error = TRUE;
+    goto exit;
+  }
+
   dt_get_perf_times(&mid);
 
-  // Process each output line
+  // Process each output line in two separable passes
   DT_OMP_FOR()
   for(int oy = 0; oy < roi_out->height; oy++)
   {
-    // Initialize column resampling indexes
-    int vlidx = vmeta[3 * oy + 0]; // V(ertical) L(ength) I(n)d(e)x
-    int vkidx = vmeta[3 * oy + 1]; // V(ertical) K(ernel) I(n)d(e)x
-    int viidx = vmeta[3 * oy + 2]; // V(ertical) I(ndex) I(n)d(e)x
-
-    // Initialize row resampling indexes
-    int hlidx = 0; // H(orizontal) L(ength) I(n)d(e)x
-    int hkidx = 0; // H(orizontal) K(ernel) I(n)d(e)x
-    int hiidx = 0; // H(orizontal) I(ndex) I(n)d(e)x
+    float *const vrow = dt_get_perthread(vrows, padded_rowsize);
 
-    // Number of lines contributing to the output line
-    int vl = vlength[vlidx++]; // V(ertical) L(ength)
+    // Vertical pass: weighted sum of the contributing input lines
+    const int vl = vlength[vmeta[3 * oy + 0]]; // V(ertical) L(ength)
+    const int vkidx = vmeta[3 * oy + 1];        // V(ertical) K(ernel) I(n)d(e)x
+    const int viidx = vmeta[3 * oy + 2];        // V(ertical) I(ndex) I(n)d(e)x
+    _resample_vertical(vrow, in + hmin, roi_in->width, ncols,
+                       vindex + viidx, vkernel + vkidx, vl);
 
-    // Process each output column
+    // Horizontal pass
+    int hkidx = 0; // H(orizontal) K(ernel) I(n)d(e)x
+    float *const o = (float *)((char *)out + (size_t)oy * out_stride);
     for(int ox = 0; ox < roi_out->width; ox++)
     {
-      // This will hold the resulting pixel
+      const int hl = hlength[ox]; // H(orizontal) L(ength)
       float vs = 0.0f;
-
-      // Number of horizontal samples contributing to the output
-      const int hl = hlength[hlidx++]; // H(orizontal) L(ength)
-
-      for(int iy = 0; iy < vl; iy++)
-      {
-        // This is our input line
-        const float *i = (float *)((char *)in + in_stride * vindex[viidx++]);
-
-        float vhs = 0.0f;
-
-        for(int ix = 0; ix < hl; ix++)
-        {
-          // Apply the precomputed filter kernel
-          const size_t baseidx = (size_t)hindex[hiidx++];
-          const float htap = hkernel[hkidx++];
-          vhs += i[baseidx] * htap;
-        }
-
-        // Accumulate contribution from this line
-        const float vtap = vkernel[vkidx++];
-        vs += vhs * vtap;
-
-        // Reset horizontal resampling context
-        hkidx -= hl;
-        hiidx -= hl;
-      }
-
-      // Output pixel is ready
-      float *o = (float *)((char *)out + (size_t)oy * out_stride
-                           + (size_t)ox * sizeof(float));
-      *o = vs;
-
-      // Reset vertical resampling context
-      viidx -= vl;
-      vkidx -= vl;
-
-      // Progress in horizontal context
-      hiidx += hl;
-      hkidx += hl;
+      for(int ix = 0; ix < hl; ix++, hkidx++)
+        vs += vrow[hindex[hkidx] - hmin] * hkernel[hkidx];
+      o[ox] = vs;
     }
   }
+  dt_free_align(vrows);
 
   exit:
   if(error)
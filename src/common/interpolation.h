@@ -136,6 +136,51 @@ void dt_interpolation_resample_roi(const dt_interpolation_t *itor, float *out,
                                    const dt_iop_roi_t *const roi_out,
                                    const float *const in, const dt_iop_roi_t *const roi_in);
 
+/** Coordinate map of a warp.
+ *
+ * @param data [in] Data of the caller
+ * @param x [in] X-Coordinate in the output buffer
+ * @param y [in] Y-Coordinate in the output buffer
+ * @param xin [out] X-Coordinate in the input buffer
+ * @param yin [out] Y-Coordinate in the input buffer
+ */
+typedef void (*dt_interpolation_warp_map_t)(const void *data,
+                                            const float x,
+                                            const float y,
+                                            float *xin,
+                                            float *yin);
+
+/** default precision of the coarse grid of dt_interpolation_warp() in pixels */
+#define DT_INTERPOLATION_WARP_PRECISION 0.01f
+
+/** Image warper.
+ *
+ * Every output pixel gets the input interpolated at the location given by
+ * map, as if dt_interpolation_compute_pixel4c() was called per pixel.
+ * The map is evaluated on a coarse grid, inside a grid cell the
+ * coordinates are interpolated bilinearly if that deviates by less than
+ * max_error pixels from the map, otherwise the cell is refined.
+ * The map must also be defined for coordinates just outside the output
+ * buffer. A max_error of 0 evaluates the map for all pixels.
+ *
+ * @param itor [in] Interpolator to use
+ * @param out [out] Will hold the warped image
+ * @param roi_out [in] Region of interest of the warped image
+ * @param in [in] Image to be warped
+ * @param roi_in [in] Region of interest of the original image
+ * @param map [in] Coordinate map from output to input buffer
+ * @param data [in] Data passed to map
+ * @param max_error [in] Tolerated deviation of the grid in pixels
+ */
+void dt_interpolation_warp(const dt_interpolation_t *itor,
+                           float *out,
+                           const dt_iop_roi_t *const roi_out,
+                           const float *const in,
+                           const dt_iop_roi_t *const roi_in,
+                           dt_interpolation_warp_map_t map,
+                           const void *data,
+                           const float max_error);
+
 #ifdef HAVE_OPENCL
 typedef struct dt_interpolation_cl_global_t
 {
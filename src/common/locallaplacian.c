@@ -30,6 +30,8 @@
 #define max_levels 30
 // the number of segments for the piecewise linear interpolation
 #define num_gamma 6
+// the number of coarse rows per strip when reducing the curve-mapped finest level
+#define LL_STRIP 32
 
 // downsample width/height to given level
 static inline int dl(int size, const int level)
@@ -123,16 +125,55 @@ static void pad_by_replication(
   }
 }
 
+// upsample one row of the fine buffer, 1<=i<((wd-1)&~1), same stencils as ll_expand_gaussian()
+// but with the case distinction hoisted out of the loop so that it vectorizes
+static inline void _expand_row(
+    const float *const coarse,
+    float *const fine,
+    const int j,
+    const int wd)
+{
+  const int cw = (wd-1)/2+1;
+  const float *const c0 = coarse + (j/2)*cw;
+  const float *const cp = c0 + cw;
+  const int i_end = (wd-1)&~1;
+  if(j & 1)
+  {
+    // j is odd: 3x2 stencil on even columns, 2x2 stencil on odd ones
+    DT_OMP_SIMD()
+    for(int i = 1; i < i_end; i++)
+    {
+      const int k = i/2;
+      fine[i] = (i & 1)
+        ? .25f * (c0[k] + c0[k+1] + cp[k] + cp[k+1])
+        : 4./256. * (24.0*(c0[k] + cp[k]) + 4.0*(c0[k-1] + c0[k+1] + cp[k-1] + cp[k+1]));
+    }
+  }
+  else
+  {
+    // j is even: 3x3 stencil on even columns, 2x3 stencil on odd ones
+    const float *const cm = c0 - cw;
+    DT_OMP_SIMD()
+    for(int i = 1; i < i_end; i++)
+    {
+      const int k = i/2;
+      fine[i] = (i & 1)
+        ? 4./256. * (24.0*(c0[k] + c0[k+1]) + 4.0*(cm[k] + cm[k+1] + cp[k] + cp[k+1]))
+        : 4./256. * (6.0f*(cm[k] + c0[k-1] + 6.0f*c0[k] + c0[k+1] + cp[k])
+                     + cm[k-1] + cm[k+1] + cp[k-1] + cp[k+1]);
+    }
+  }
+}
+
 static inline void gauss_expand(
     const float *const input, // coarse input
     float *const fine,        // upsampled, blurry output
     const int wd,             // fine res
     const int ht)
 {
-  DT_OMP_FOR(collapse(2))
+  DT_OMP_FOR(if((size_t)wd*ht>8000))
   for(int j=1;j<((ht-1)&~1);j++)  // even ht: two px boundary. odd ht: one px.
-    for(int i=1;i<((wd-1)&~1);i++)
-      fine[j*wd+i] = ll_expand_gaussian(input, i, j, wd, ht);
+    _expand_row(input, fine + (size_t)j*wd, j, wd);
   ll_fill_boundary2(fine, wd, ht);
 }
 
@@ -160,6 +201,47 @@ static inline void _convolve_14641_vert(dt_aligned_pixel_t conv, const float *in
   }
 }
 
+// blur and subsample the five fine rows starting at 'base' into one row of the coarse buffer,
+// skipping the boundary pixel on either side
+static inline void _reduce_row(
+    const float *base,        // first of the five fine input rows
+    float *const out,         // coarse output row, starting at the second pixel
+    const size_t wd,          // fine res
+    const size_t cw)          // coarse res
+{
+  // prime the vertical axis
+  static const dt_aligned_pixel_t kernel = { 1.0f, 4.0f, 6.0f, 4.0f };
+  dt_aligned_pixel_t left;
+  _convolve_14641_vert(left,base,wd);
+  for(size_t col=0; col<cw-3; col += 2)
+  {
+    // convolve the next four pixel wide vertical slice
+    base += 4;
+    dt_aligned_pixel_t right;
+    _convolve_14641_vert(right,base,wd);
+    // horizontal pass, generate two output values from convolving with 1 4 6 4 1
+    // the first uses pixels 0-4, the second uses 2-6
+    dt_aligned_pixel_t conv;
+    for_four_channels(c)
+      conv[c] = left[c] * kernel[c];
+    out[col] = (conv[0] + conv[1] + conv[2] + conv[3] + right[0]) / 256.0f;
+    out[col+1] = (left[2] + 4*(left[3]+right[1]) + 6.0f*right[0] + right[2]) / 256.0f;
+    // shift to next pair of output columns (four input columns)
+    copy_pixel(left, right);
+  }
+  // handle the left-over pixel if the output size is odd
+  if(cw % 2)
+  {
+    base += 4;
+    // convolve the right-most column
+    float right = base[0] + 4.0f*(base[wd]+base[3*wd]) + 6.0f*base[2*wd] + base[4*wd];
+    dt_aligned_pixel_t conv;
+    for_four_channels(c)
+      conv[c] = left[c] * kernel[c];
+    out[cw-3] = (conv[0] + conv[1] + conv[2] + conv[3] + right) / 256.0f;
+  }
+}
+
 static inline void gauss_reduce(
     const float *const input, // fine input buffer
     float *const coarse,      // coarse scale, blurred input buf
@@ -172,41 +254,7 @@ static inline void gauss_reduce(
   // is greater than the time needed to do it sequentially
   DT_OMP_FOR(if(ch*cw>2000))
   for(size_t j=1;j<ch-1;j++)
-  {
-    const float *base = input + 2*(j-1)*wd;
-    float *const out = coarse + j*cw + 1;
-    // prime the vertical axis
-    static const dt_aligned_pixel_t kernel = { 1.0f, 4.0f, 6.0f, 4.0f };
-    dt_aligned_pixel_t left;
-    _convolve_14641_vert(left,base,wd);
-    for(size_t col=0; col<cw-3; col += 2)
-    {
-      // convolve the next four pixel wide vertical slice
-      base += 4;
-      dt_aligned_pixel_t right;
-      _convolve_14641_vert(right,base,wd);
-      // horizontal pass, generate two output values from convolving with 1 4 6 4 1
-      // the first uses pixels 0-4, the second uses 2-6
-      dt_aligned_pixel_t conv;
-      for_four_channels(c)
-        conv[c] = left[c] * kernel[c];
-      out[col] = (conv[0] + conv[1] + conv[2] + conv[3] + right[0]) / 256.0f;
-      out[col+1] = (left[2] + 4*(left[3]+right[1]) + 6.0f*right[0] + right[2]) / 256.0f;
-      // shift to next pair of output columns (four input columns)
-      copy_pixel(left, right);
-    }
-    // handle the left-over pixel if the output size is odd
-    if(cw % 2)
-    {
-      base += 4;
-      // convolve the right-most column
-      float right = base[0] + 4.0f*(base[wd]+base[3*wd]) + 6.0f*base[2*wd] + base[4*wd];
-      dt_aligned_pixel_t conv;
-      for_four_channels(c)
-        conv[c] = left[c] * kernel[c];
-      out[cw-3] = (conv[0] + conv[1] + conv[2] + conv[3] + right) / 256.0f;
-    }
-  }
+    _reduce_row(input + 2*(j-1)*wd, coarse + j*cw + 1, wd, cw);
   dt_omploop_sfence();
   ll_fill_boundary1(coarse, cw, ch);
 }
@@ -342,9 +390,34 @@ static inline float curve_scalar(
   return val;
 }
 
-void apply_curve(
+// one row of the curve-mapped finest level, padded by replicating the
+// mapped boundary of the unpadded region
+static inline void ll_curve_row(
     float *const out,
     const float *const in,
+    const int row,
+    const uint32_t w,
+    const uint32_t h,
+    const uint32_t padding,
+    const float g,
+    const float sigma,
+    const float shadows,
+    const float highlights,
+    const float clarity)
+{
+  const float *const in2 = in + (size_t)CLAMPS(row, (int)padding, (int)(h-padding-1)) * w;
+  for(uint32_t i=padding;i<w-padding;i++)
+    out[i] = curve_scalar(in2[i], g, sigma, shadows, highlights, clarity);
+  for(int i=0;i<padding;i++)   out[i] = out[padding];
+  for(int i=w-padding;i<w;i++) out[i] = out[w-padding-1];
+}
+
+// gaussian reduction of the curve-mapped finest level.  The mapped level
+// itself is never stored: each thread maps only the fine rows needed for
+// a strip of coarse rows into a small scratch buffer.
+static gboolean ll_reduce_curve(
+    const float *const input,    // padded finest level
+    float *const coarse,         // coarse output
     const uint32_t w,
     const uint32_t h,
     const uint32_t padding,
@@ -354,18 +427,26 @@ void apply_curve(
     const float highlights,
     const float clarity)
 {
+  const size_t cw = (w-1)/2+1, ch = (h-1)/2+1;
+  // _reduce_row() may read a few floats past the end of its last row
+  size_t padded_size;
+  float *const scratch = dt_alloc_perthread_float((2 * LL_STRIP + 3) * (size_t)w + 4, &padded_size);
+  if(!scratch) return FALSE;
+
   DT_OMP_FOR()
-  for(uint32_t j=padding;j<h-padding;j++)
+  for(size_t j0=1;j0<ch-1;j0+=LL_STRIP)
   {
-    const float *in2  = in  + j*w + padding;
-    float *out2 = out + j*w + padding;
-    for(uint32_t i=padding;i<w-padding;i++)
-      (*out2++) = curve_scalar(*(in2++), g, sigma, shadows, highlights, clarity);
-    out2 = out + j*w;
-    for(int i=0;i<padding;i++)   out2[i] = out2[padding];
-    for(int i=w-padding;i<w;i++) out2[i] = out2[w-padding-1];
+    float *const rows = dt_get_perthread(scratch, padded_size);
+    const size_t j1 = MIN(j0 + LL_STRIP, ch-1);
+    const int row0 = 2*(j0-1);
+    for(size_t r=0;r<2*(j1-j0)+3;r++)
+      ll_curve_row(rows + r*w, input, row0 + r, w, h, padding, g, sigma, shadows, highlights, clarity);
+    for(size_t j=j0;j<j1;j++)
+      _reduce_row(rows + 2*(j-j0)*w, coarse + j*cw + 1, w, cw);
   }
-  pad_by_replication(out, w, h, padding);
+  dt_free_align(scratch);
+  ll_fill_boundary1(coarse, cw, ch);
+  return TRUE;
 }
 
 void local_laplacian_internal(
@@ -406,9 +487,12 @@ void local_laplacian_internal(
     }
   }
 
-  // allocate pyramid pointers for output
+  // allocate pyramid pointers for output.  The finest level is assembled
+  // straight into the output buffer unless the whole pyramid has to be
+  // passed on for preview rendering.
+  const gboolean keep_finest = b && b->mode == 1;
   float *output[max_levels] = {0};
-  for(int l=0;l<=last_level;l++)
+  for(int l=keep_finest?0:1;l<=last_level;l++)
   {
     output[l] = dt_alloc_align_float((size_t)dl(w,l) * dl(h,l));
     if(!output[l])
@@ -445,10 +529,12 @@ void local_laplacian_internal(
   for(int k=0;k<num_gamma;k++) gamma[k] = (k+.5f)/(float)num_gamma;
   // for(int k=0;k<num_gamma;k++) gamma[k] = k/(num_gamma-1.0f);
 
-  // allocate memory for intermediate laplacian pyramids
+  // allocate memory for intermediate laplacian pyramids.  The finest
+  // level of these is the curve-mapped input, which is cheap enough to
+  // be evaluated on the fly and so is never stored.
   float *buf[num_gamma][max_levels] = {{0}};
   for(int k=0;k<num_gamma;k++)
-    for(int l=0;l<=last_level;l++)
+    for(int l=1;l<=last_level;l++)
     {
       buf[k][l] = dt_alloc_align_float((size_t)dl(w,l)*dl(h,l));
       if(!buf[k][l])
@@ -466,10 +552,15 @@ void local_laplacian_internal(
   // willing to pay the cost).
   for(int k=0;k<num_gamma;k++)
   { // process images
-    apply_curve(buf[k][0], padded[0], w, h, max_supp, gamma[k], sigma, shadows, highlights, clarity);
+    if(!ll_reduce_curve(padded[0], buf[k][1], w, h, max_supp, gamma[k], sigma, shadows, highlights, clarity))
+    {
+      for(size_t p = 0; p < (size_t)4 * wd * ht; p++)
+        out[p] = input[p];
+      goto cleanup;
+    }
 
     // create gaussian pyramids
-    for(int l=1;l<=last_level;l++)
+    for(int l=2;l<=last_level;l++)
       gauss_reduce(buf[k][l-1], buf[k][l], dl(w,l-1), dl(h,l-1));
   }
 
@@ -534,7 +625,7 @@ void local_laplacian_internal(
   }
 
   // assemble output pyramid coarse to fine
-  for(int l=last_level-1;l >= 0; l--)
+  for(int l=last_level-1;l >= 1; l--)
   {
     const int pw = dl(w,l), ph = dl(h,l);
 
@@ -551,19 +642,51 @@ void local_laplacian_internal(
       const float l0 = ll_laplacian(buf[lo][l+1], buf[lo][l], i, j, pw, ph);
       const float l1 = ll_laplacian(buf[hi][l+1], buf[hi][l], i, j, pw, ph);
       output[l][j*pw+i] += l0 * (1.0f-a) + l1 * a;
-      // we could do this to save on memory (no need for finest buf[][]).
-      // unfortunately it results in a quite noticeable loss of sharpness, i think
-      // the extra level is worth it.
-      // else if(l == 0) // use finest scale from input to not amplify noise (and use less memory)
-      //   output[l][j*pw+i] += ll_laplacian(padded[l+1], padded[l], i, j, pw, ph);
     }
   }
+
+  // finest level: same as above, but with the curve-mapped fine values
+  // computed on the fly.  We could use the finest scale from the input
+  // here to not amplify noise, but it results in a quite noticeable loss
+  // of sharpness; the extra octave is worth it.
+  const int j0 = keep_finest ? 0 : max_supp, j1 = keep_finest ? h : max_supp + ht;
+  const int i0 = keep_finest ? 0 : max_supp, i1 = keep_finest ? w : max_supp + wd;
   DT_OMP_FOR(collapse(2))
-  for(int j=0;j<ht;j++) for(int i=0;i<wd;i++)
+  for(int j=j0;j<j1;j++) for(int i=i0;i<i1;i++)
   {
-    out[4*(j*wd+i)+0] = 100.0f * output[0][(j+max_supp)*w+max_supp+i]; // [0,1] -> L
-    out[4*(j*wd+i)+1] = input[4*(j*wd+i)+1]; // copy original colour channels
-    out[4*(j*wd+i)+2] = input[4*(j*wd+i)+2];
+    const float v = padded[0][j*w+i];
+    int hi = 1;
+    for(;hi<num_gamma-1 && gamma[hi] <= v;hi++);
+    int lo = hi-1;
+    const float a = CLAMPS((v - gamma[lo])/(gamma[hi]-gamma[lo]), 0.0f, 1.0f);
+    // the curve-mapped level replicates its unpadded boundary, the
+    // expanded levels their outermost valid pixels
+    const float vc = padded[0][CLAMPS(j, max_supp, h-max_supp-1)*w + CLAMPS(i, max_supp, w-max_supp-1)];
+    const int ie = CLAMPS(i, 1, ((w-1)&~1)-1), je = CLAMPS(j, 1, ((h-1)&~1)-1);
+    const float l0 = curve_scalar(vc, gamma[lo], sigma, shadows, highlights, clarity)
+      - ll_expand_gaussian(buf[lo][1], ie, je, w, h);
+    const float l1 = curve_scalar(vc, gamma[hi], sigma, shadows, highlights, clarity)
+      - ll_expand_gaussian(buf[hi][1], ie, je, w, h);
+    const float res = ll_expand_gaussian(output[1], ie, je, w, h) + (l0 * (1.0f-a) + l1 * a);
+    if(keep_finest)
+      output[0][j*w+i] = res;
+    else
+    {
+      const size_t k = (size_t)(j-max_supp)*wd + i-max_supp;
+      out[4*k+0] = 100.0f * res; // [0,1] -> L
+      out[4*k+1] = input[4*k+1]; // copy original colour channels
+      out[4*k+2] = input[4*k+2];
+    }
+  }
+  if(keep_finest)
+  {
+    DT_OMP_FOR(collapse(2))
+    for(int j=0;j<ht;j++) for(int i=0;i<wd;i++)
+    {
+      out[4*(j*wd+i)+0] = 100.0f * output[0][(j+max_supp)*w+max_supp+i]; // [0,1] -> L
+      out[4*(j*wd+i)+1] = input[4*(j*wd+i)+1]; // copy original colour channels
+      out[4*(j*wd+i)+2] = input[4*(j*wd+i)+2];
+    }
   }
   if(b && b->mode == 1)
   { // output the buffers for later re-use
@@ -594,9 +717,12 @@ size_t local_laplacian_memory_use(const int width,     // width of input image
   const int paddwd = width  + 2*max_supp;
   const int paddht = height + 2*max_supp;
 
-  size_t memory_use = 0;
+  // the finest level only holds the padded input, plus a strip of
+  // curve-mapped rows per thread
+  size_t memory_use = sizeof(float) * (size_t)paddwd * paddht
+    + sizeof(float) * (2 * LL_STRIP + 3) * (size_t)paddwd * dt_get_num_threads();
 
-  for(int l=0;l<num_levels;l++)
+  for(int l=1;l<num_levels;l++)
     memory_use += sizeof(float) * (2 + num_gamma) * dl(paddwd, l) * dl(paddht, l);
 
   return memory_use;
@@ -50,6 +50,12 @@
 // architectures with slower multiplication.
 //#define CACHE_PIXDIFFS
 
+// in fast mode, candidate patches are tested against the pixel's own patch on a grid with this spacing
+//   within each chunk, and dropped for the entire chunk if none of the sample points would have given them
+//   a weight above 2^-(log2(num_patches) + FAST_REJECT_BITS) relative to the center pixel's own weight
+#define FAST_SAMPLE_STEP 8
+#define FAST_REJECT_BITS 8.0f
+
 // number of intermediate buffers used by OpenCL code path.  If you change this, you must also change
 //   the definition in src/iop/nlmeans.c and src/iop/denoiseprofile.c
 #define NUM_BUCKETS 4
@@ -273,6 +279,75 @@ static void init_column_sums(
 }
 
 
+// sum the pixel differences between the patch centered on (row,col) and the one displaced by 'offset',
+//   stopping as soon as the running total exceeds 'limit'.  Both patches must lie entirely within the RoI.
+static inline float bounded_patch_distance(
+        const float *const inbuf,
+        const size_t stride,
+        const int row,
+        const int col,
+        const int radius,
+        const int offset,
+        const float *const norm,
+        const float limit)
+{
+  float dist = 0.0f;
+  for(int r = row - radius; r <= row + radius; r++)
+  {
+    const float *const px = inbuf + r * stride + 4 * (col - radius);
+    for(int c = 0; c <= 2 * radius; c++)
+      dist += pixel_difference(px + 4*c, px + 4*c + offset, norm);
+    if(dist > limit) break;	// early rejection, no need to look at the rest of the patch
+  }
+  return dist;
+}
+
+// fast mode: collect the indices of those patches which may contribute a non-negligible weight anywhere
+//   in the given chunk, judging from a sub-sampled set of pixels.  Returns the number of active patches.
+static int select_patches(
+        const patch_t *const patches,
+        const int num_patches,
+        int *const active,
+        const float *const inbuf,
+        const size_t stride,
+        const int width,
+        const int height,
+        const int chunk_top,
+        const int chunk_bot,
+        const int chunk_left,
+        const int chunk_right,
+        const int radius,
+        const float *const norm,
+        const float limit)
+{
+  int n_active = 0;
+  for(int p = 0; p < num_patches; p++)
+  {
+    const patch_t *const patch = &patches[p];
+    // only sample where both the pixel's patch and the displaced patch are entirely inside the RoI
+    const int row_lo = MAX(chunk_top, radius + MAX(0, -patch->rows));
+    const int row_hi = MIN(chunk_bot, height - radius - MAX(0, patch->rows));
+    const int col_lo = MAX(chunk_left, radius + MAX(0, -patch->cols));
+    const int col_hi = MIN(chunk_right, width - radius - MAX(0, patch->cols));
+    // always keep the pixel's own patch, and any patch we can't judge
+    gboolean keep = (patch->rows == 0 && patch->cols == 0) || row_lo >= row_hi || col_lo >= col_hi;
+    for(int row = row_lo; row < row_hi && !keep; row += FAST_SAMPLE_STEP)
+    {
+      for(int col = col_lo; col < col_hi; col += FAST_SAMPLE_STEP)
+      {
+        if(bounded_patch_distance(inbuf, stride, row, col, radius, patch->offset, norm, limit) <= limit)
+        {
+          keep = TRUE;
+          break;
+        }
+      }
+    }
+    if(keep)
+      active[n_active++] = p;
+  }
+  return n_active;
+}
+
 // determine the height of the horizontal slice each thread will process
 static int compute_slice_height(const int height)
 {
@@ -355,6 +430,16 @@ void nlmeans_denoise(
   float *const restrict scratch_buf = dt_alloc_perthread_float(scratch_size, &padded_scratch_size);
   const int chk_height = compute_slice_height(roi_out->height);
   const int chk_width = compute_slice_width(roi_out->width);
+  // in fast mode, determine the patch distance beyond which a patch's weight becomes negligible.  For
+  //   denoiseprofile, the center-pixel term only ever increases the dissimilarity, so ignoring it keeps the
+  //   bound conservative.
+  const gboolean fast = params->fast && params->sharpness > 0.0f;
+  const float reject_bits = log2f(num_patches) + FAST_REJECT_BITS;
+  const float reject_dist = params->center_weight < 0.0f
+    ? reject_bits / params->sharpness
+    : (reject_bits + 2.0f) * (1.0f + params->center_weight) / params->sharpness;
+  size_t padded_active_size = 0;
+  int *const restrict active_buf = fast ? dt_alloc_perthread(num_patches, sizeof(int), &padded_active_size) : NULL;
   DT_OMP_FOR(collapse(2))
   for(int chunk_top = 0 ; chunk_top < roi_out->height; chunk_top += chk_height)
   {
@@ -373,11 +458,17 @@ void nlmeans_denoise(
       {
         memset(outbuf + 4*(i*roi_out->width+chunk_left), '\0', sizeof(float) * 4 * (chunk_right-chunk_left));
       }
-      // cycle through all of the patches over our slice of the image
-      for(int p = 0; p < num_patches; p++)
+      // in fast mode, weed out those patches which can't contribute anywhere in this chunk
+      int *const active = active_buf ? dt_get_perthread(active_buf, padded_active_size) : NULL;
+      const int n_active = active
+        ? select_patches(patches, num_patches, active, inbuf, stride, roi_out->width, roi_out->height,
+                         chunk_top, chunk_bot, chunk_left, chunk_right, radius, params->norm, reject_dist)
+        : num_patches;
+      // cycle through all of the (remaining) patches over our slice of the image
+      for(int p = 0; p < n_active; p++)
       {
         // retrieve info about the current patch
-        const patch_t *patch = &patches[p];
+        const patch_t *patch = &patches[active ? active[p] : p];
         // skip any rows where the patch center would be above top of RoI or below bottom of RoI
         const int height = roi_out->height;
         const int row_min = MAX(chunk_top,MAX(0,-patch->rows));
@@ -539,6 +630,7 @@ void nlmeans_denoise(
   // clean up: free the work space
   dt_free_align(patches);
   dt_free_align(scratch_buf);
+  dt_free_align(active_buf);
   return;
 }
 
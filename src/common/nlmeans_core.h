@@ -30,6 +30,7 @@ struct dt_nlmeans_param_t
   int patch_radius;	// radius of patches which are compared, 1..4
   int search_radius;	// radius around a pixel in which to compare patches (default = 7)
   int decimate;         // set to 1 to search only half the patches in the neighborhood (default = 0)
+  gboolean fast;        // skip patches which are too dissimilar over a whole chunk (CPU only, default = FALSE)
   const float* const norm; // array of four per-channel weight factors
   dt_dev_pixelpipe_type_t pipetype;
   int kernel_init;	// CL: initialization (runs once)
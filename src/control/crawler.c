@@ -27,8 +27,10 @@
 #include "common/debug.h"
 #include "common/history.h"
 #include "common/image.h"
+#include "common/image_cache.h"
 #include "control/conf.h"
 #include "control/control.h"
+#include "control/jobs.h"
 #include "crawler.h"
 #include "gui/gtk.h"
 #include "gui/splash.h"
@@ -106,199 +108,307 @@ static void _set_modification_time(char *filename,
   if(info) g_clear_object(&info);
 }
 
-// pregress update intervals in seconds
-#define FAST_UPDATE 0.2
-#define SLOW_UPDATE 1.0
-
-GList *dt_control_crawler_run(void)
+// one row of the images table, filled in by the parallel file checks
+typedef struct dt_control_crawler_entry_t
 {
-  sqlite3_stmt *stmt, *inner_stmt;
-  GList *result = NULL;
-  const gboolean look_for_xmp = dt_image_get_xmp_mode() != DT_WRITE_XMP_NEVER;
+  dt_imgid_t id;
+  time_t timestamp;
+  int version;
+  int flags;
+  int new_flags;
+  gchar *image_path;
+  time_t timestamp_xmp;
+  gboolean newer_xmp;
+} dt_control_crawler_entry_t;
 
-  int total_images = 1;
-  // clang-format off
-  DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db),
-                              "SELECT COUNT(*) FROM main.images", -1, &stmt, 0);
-  // clang-format on
-  if(sqlite3_step(stmt) == SQLITE_ROW)
+static gboolean _crawler_stat_mtime(const char *path, time_t *mtime)
+{
+  // on Windows the encoding might not be UTF8
+  gchar *path_locale = dt_util_normalize_path(path);
+  int stat_res = -1;
+#ifdef _WIN32
+  // UTF8 paths fail in this context, but converting to UTF16 works
+  struct _stati64 statbuf;
+  if(path_locale) // in Windows dt_util_normalize_path returns
+                  // NULL if file does not exist
   {
-    total_images = sqlite3_column_int(stmt, 0);
-    sqlite3_finalize(stmt);
+    wchar_t *wfilename = g_utf8_to_utf16(path_locale, -1, NULL, NULL, NULL);
+    stat_res = _wstati64(wfilename, &statbuf);
+    g_free(wfilename);
   }
+#else
+  struct stat statbuf;
+  stat_res = path_locale ? stat(path_locale, &statbuf) : -1;
+#endif
+  g_free(path_locale);
+  if(stat_res) return FALSE;
+  *mtime = statbuf.st_mtime;
+  return TRUE;
+}
 
-  // clang-format off
-  sqlite3_prepare_v2(dt_database_get(darktable.db),
-                     "SELECT i.id, write_timestamp, version,"
-                     "       folder || '" G_DIR_SEPARATOR_S "' || filename, flags"
-                     " FROM main.images i, main.film_rolls f"
-                     " ON i.film_id = f.id"
-                     " ORDER BY f.id, filename",
-                     -1, &stmt, NULL);
-  sqlite3_prepare_v2(dt_database_get(darktable.db),
-                     "UPDATE main.images SET flags = ?1 WHERE id = ?2", -1,
-                     &inner_stmt, NULL);
-  // clang-format on
-
-  // let's wrap this into a transaction, it might make it a little faster.
-  dt_database_start_transaction(darktable.db);
-
-  int image_count = 0;
-  const double start_time = dt_get_wtime();
-  // set the "previous update" time to 10ms after a notional previous
-  // update to ensure visibility of the first update (which might not
-  // appear when done with zero delay) while minimizing the delay
-  double last_time = start_time - (FAST_UPDATE-0.01);
+// all file system accesses for one image, independent of the others
+static void _crawler_check_entry(dt_control_crawler_entry_t *e,
+                                 const gboolean look_for_xmp)
+{
+  const gchar *image_path = e->image_path;
+  e->new_flags = e->flags;
 
-  while(sqlite3_step(stmt) == SQLITE_ROW)
+  // if the image is missing we ignore it.
+  if(!g_file_test(image_path, G_FILE_TEST_EXISTS))
   {
-    const dt_imgid_t id = sqlite3_column_int(stmt, 0);
-    const time_t timestamp = sqlite3_column_int64(stmt, 1);
-    const int version = sqlite3_column_int(stmt, 2);
-    const gchar *image_path = (char *)sqlite3_column_text(stmt, 3);
-    int flags = sqlite3_column_int(stmt, 4);
-    ++image_count;
-
-    // update the progress message - five times per second for first four seconds, then once per second
-    const double curr_time = dt_get_wtime();
-    if(curr_time >= last_time + ((curr_time - start_time > 4.0) ? SLOW_UPDATE : FAST_UPDATE))
-    {
-      const double fraction = image_count / (double)total_images;
-      darktable_splash_screen_set_progress_percent(_("checking for updated sidecar files (%d%%)"),
-                                                   fraction,
-                                                   curr_time - start_time);
-      last_time = curr_time;
-    }
-
-    // if the image is missing we ignore it.
-    if(!g_file_test(image_path, G_FILE_TEST_EXISTS))
-    {
-      dt_print(DT_DEBUG_CONTROL, "[crawler] `%s' (id: %d) is missing", image_path, id);
-      continue;
-    }
+    dt_print(DT_DEBUG_CONTROL, "[crawler] `%s' (id: %d) is missing", image_path, e->id);
+    return;
+  }
 
-    // no need to look for xmp files if none get written anyway.
-    if(look_for_xmp)
+  // no need to look for xmp files if none get written anyway.
+  if(look_for_xmp)
+  {
+    // construct the xmp filename for this image
+    gchar xmp_path[PATH_MAX] = { 0 };
+    g_strlcpy(xmp_path, image_path, sizeof(xmp_path));
+    dt_image_path_append_version_no_db(e->version, xmp_path, sizeof(xmp_path));
+    if(strlen(xmp_path) + 4 < PATH_MAX)
     {
-      // construct the xmp filename for this image
-      gchar xmp_path[PATH_MAX] = { 0 };
-      g_strlcpy(xmp_path, image_path, sizeof(xmp_path));
-      dt_image_path_append_version_no_db(version, xmp_path, sizeof(xmp_path));
-      size_t len = strlen(xmp_path);
-      if(len + 4 >= PATH_MAX) continue;
-      xmp_path[len++] = '.';
-      xmp_path[len++] = 'x';
-      xmp_path[len++] = 'm';
-      xmp_path[len++] = 'p';
-      xmp_path[len] = '\0';
-
-      // on Windows the encoding might not be UTF8
-      gchar *xmp_path_locale = dt_util_normalize_path(xmp_path);
-      int stat_res = -1;
-#ifdef _WIN32
-      // UTF8 paths fail in this context, but converting to UTF16 works
-      struct _stati64 statbuf;
-      if(xmp_path_locale) // in Windows dt_util_normalize_path returns
-                          // NULL if file does not exist
-      {
-        wchar_t *wfilename = g_utf8_to_utf16(xmp_path_locale, -1, NULL, NULL, NULL);
-        stat_res = _wstati64(wfilename, &statbuf);
-        g_free(wfilename);
-      }
- #else
-      struct stat statbuf;
-      stat_res = stat(xmp_path_locale, &statbuf);
-#endif
-      g_free(xmp_path_locale);
-      if(stat_res) continue; // TODO: shall we report these?
+      g_strlcat(xmp_path, ".xmp", sizeof(xmp_path));
 
       // step 1: check if the xmp is newer than our db entry
-      if(timestamp + MAX_TIME_SKEW < statbuf.st_mtime)
+      // older timestamps are the case for all images after the db
+      // upgrade. better not report these
+      time_t mtime = 0;
+      if(_crawler_stat_mtime(xmp_path, &mtime)
+         && e->timestamp + MAX_TIME_SKEW < mtime)
       {
-        dt_control_crawler_result_t *item = malloc(sizeof(dt_control_crawler_result_t));
-        item->id = id;
-        item->timestamp_xmp = statbuf.st_mtime;
-        item->timestamp_db = timestamp;
-        item->image_path = g_strdup(image_path);
-        item->xmp_path = g_strdup(xmp_path);
-
-        result = g_list_prepend(result, item);
+        e->newer_xmp = TRUE;
+        e->timestamp_xmp = mtime;
         dt_print(DT_DEBUG_CONTROL,
-                 "[crawler] `%s' (id: %d) is a newer XMP file", xmp_path, id);
+                 "[crawler] `%s' (id: %d) is a newer XMP file", xmp_path, e->id);
       }
-      // older timestamps are the case for all images after the db
-      // upgrade. better not report these
     }
+  }
 
-    // step 2: check if the image has associated files (.txt, .wav)
-    size_t len = strlen(image_path);
-    const char *c = image_path + len;
-    while((c > image_path) && (*c != '.')) c--;
-    len = c - image_path + 1;
+  // step 2: check if the image has associated files (.txt, .wav)
+  size_t len = strlen(image_path);
+  const char *c = image_path + len;
+  while((c > image_path) && (*c != '.')) c--;
+  len = c - image_path + 1;
 
-    char *extra_path = calloc(len + 3 + 1, sizeof(char));
-    if(extra_path)
-    {
-      g_strlcpy(extra_path, image_path, len + 1);
+  char *extra_path = calloc(len + 3 + 1, sizeof(char));
+  if(!extra_path) return;
 
-      extra_path[len] = 't';
-      extra_path[len + 1] = 'x';
-      extra_path[len + 2] = 't';
-      gboolean has_txt = g_file_test(extra_path, G_FILE_TEST_EXISTS);
+  g_strlcpy(extra_path, image_path, len + 1);
 
-      if(!has_txt)
-      {
-        extra_path[len] = 'T';
-        extra_path[len + 1] = 'X';
-        extra_path[len + 2] = 'T';
-        has_txt = g_file_test(extra_path, G_FILE_TEST_EXISTS);
-      }
+  extra_path[len] = 't';
+  extra_path[len + 1] = 'x';
+  extra_path[len + 2] = 't';
+  gboolean has_txt = g_file_test(extra_path, G_FILE_TEST_EXISTS);
 
-      extra_path[len] = 'w';
-      extra_path[len + 1] = 'a';
-      extra_path[len + 2] = 'v';
-      gboolean has_wav = g_file_test(extra_path, G_FILE_TEST_EXISTS);
+  if(!has_txt)
+  {
+    extra_path[len] = 'T';
+    extra_path[len + 1] = 'X';
+    extra_path[len + 2] = 'T';
+    has_txt = g_file_test(extra_path, G_FILE_TEST_EXISTS);
+  }
 
-      if(!has_wav)
-      {
-        extra_path[len] = 'W';
-        extra_path[len + 1] = 'A';
-        extra_path[len + 2] = 'V';
-        has_wav = g_file_test(extra_path, G_FILE_TEST_EXISTS);
-      }
+  extra_path[len] = 'w';
+  extra_path[len + 1] = 'a';
+  extra_path[len + 2] = 'v';
+  gboolean has_wav = g_file_test(extra_path, G_FILE_TEST_EXISTS);
+
+  if(!has_wav)
+  {
+    extra_path[len] = 'W';
+    extra_path[len + 1] = 'A';
+    extra_path[len + 2] = 'V';
+    has_wav = g_file_test(extra_path, G_FILE_TEST_EXISTS);
+  }
+
+  // TODO: decide if we want to remove the flag for images that lost
+  // their extra file. currently we do (the else cases)
+  if(has_txt)
+    e->new_flags |= DT_IMAGE_HAS_TXT;
+  else
+    e->new_flags &= ~DT_IMAGE_HAS_TXT;
+  if(has_wav)
+    e->new_flags |= DT_IMAGE_HAS_WAV;
+  else
+    e->new_flags &= ~DT_IMAGE_HAS_WAV;
+
+  free(extra_path);
+}
 
-      // TODO: decide if we want to remove the flag for images that lost
-      // their extra file. currently we do (the else cases)
-      int new_flags = flags;
-      if(has_txt)
-        new_flags |= DT_IMAGE_HAS_TXT;
-      else
-        new_flags &= ~DT_IMAGE_HAS_TXT;
-      if(has_wav)
-        new_flags |= DT_IMAGE_HAS_WAV;
-      else
-        new_flags &= ~DT_IMAGE_HAS_WAV;
-      if(flags != new_flags)
+// number of images checked in parallel between two progress updates
+#define CRAWLER_CHUNK 256
+// seconds between two updates of the splash screen while waiting
+#define CRAWLER_UPDATE 0.2
+
+// the crawl started by dt_control_crawler_start()
+typedef struct dt_control_crawler_job_t
+{
+  GMutex mutex;
+  GCond cond;
+  gboolean running;
+  gboolean done;
+  double progress;
+  GList *result;
+} dt_control_crawler_job_t;
+
+static dt_control_crawler_job_t _crawler_job;
+
+static void _crawler_set_progress(const double progress)
+{
+  g_mutex_lock(&_crawler_job.mutex);
+  _crawler_job.progress = progress;
+  g_mutex_unlock(&_crawler_job.mutex);
+}
+
+static GList *_crawler_run(void)
+{
+  sqlite3_stmt *stmt;
+  GList *result = NULL;
+  const gboolean look_for_xmp = dt_image_get_xmp_mode() != DT_WRITE_XMP_NEVER;
+
+  // step 0: get everything we need from the database in one go, the
+  // file system checks below don't touch it.
+  GArray *entries = g_array_new(FALSE, TRUE, sizeof(dt_control_crawler_entry_t));
+  // clang-format off
+  DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db),
+                              "SELECT i.id, write_timestamp, version,"
+                              "       folder || '" G_DIR_SEPARATOR_S "' || filename, flags"
+                              " FROM main.images i, main.film_rolls f"
+                              " ON i.film_id = f.id"
+                              " ORDER BY f.id, filename",
+                              -1, &stmt, NULL);
+  // clang-format on
+  while(sqlite3_step(stmt) == SQLITE_ROW)
+  {
+    dt_control_crawler_entry_t e = { 0 };
+    e.id = sqlite3_column_int(stmt, 0);
+    e.timestamp = sqlite3_column_int64(stmt, 1);
+    e.version = sqlite3_column_int(stmt, 2);
+    e.image_path = g_strdup((char *)sqlite3_column_text(stmt, 3));
+    e.flags = sqlite3_column_int(stmt, 4);
+    g_array_append_val(entries, e);
+  }
+  sqlite3_finalize(stmt);
+
+  const size_t total_images = entries->len;
+  dt_control_crawler_entry_t *list = (dt_control_crawler_entry_t *)entries->data;
+
+  // the checks are latency bound on network shares, run many of them
+  // concurrently.
+  for(size_t start = 0; start < total_images; start += CRAWLER_CHUNK)
+  {
+    const size_t end = MIN(total_images, start + CRAWLER_CHUNK);
+    DT_OMP_PRAGMA(parallel for default(firstprivate) schedule(dynamic, 4) shared(list))
+    for(size_t k = start; k < end; k++)
+      _crawler_check_entry(&list[k], look_for_xmp);
+
+    _crawler_set_progress(end / (double)total_images);
+  }
+
+  // the image might be in the image cache already, go through it to
+  // update the flags so that they don't get overwritten later on.
+  for(size_t k = 0; k < total_images; k++)
+  {
+    dt_control_crawler_entry_t *e = &list[k];
+    if(e->flags != e->new_flags)
+    {
+      dt_image_t *img = dt_image_cache_get(e->id, 'w');
+      if(img)
       {
-        sqlite3_bind_int(inner_stmt, 1, new_flags);
-        sqlite3_bind_int(inner_stmt, 2, id);
-        sqlite3_step(inner_stmt);
-        sqlite3_reset(inner_stmt);
-        sqlite3_clear_bindings(inner_stmt);
+        img->flags = (img->flags & ~(DT_IMAGE_HAS_TXT | DT_IMAGE_HAS_WAV))
+                     | (e->new_flags & (DT_IMAGE_HAS_TXT | DT_IMAGE_HAS_WAV));
+        dt_image_cache_write_release_info(img, DT_IMAGE_CACHE_RELAXED, "dt_control_crawler_run");
       }
+    }
 
-      free(extra_path);
+    if(e->newer_xmp)
+    {
+      dt_control_crawler_result_t *item = malloc(sizeof(dt_control_crawler_result_t));
+      item->id = e->id;
+      item->timestamp_xmp = e->timestamp_xmp;
+      item->timestamp_db = e->timestamp;
+      gchar xmp_path[PATH_MAX] = { 0 };
+      g_strlcpy(xmp_path, e->image_path, sizeof(xmp_path));
+      dt_image_path_append_version_no_db(e->version, xmp_path, sizeof(xmp_path));
+      g_strlcat(xmp_path, ".xmp", sizeof(xmp_path));
+      item->image_path = g_strdup(e->image_path);
+      item->xmp_path = g_strdup(xmp_path);
+      result = g_list_prepend(result, item);
     }
+    g_free(e->image_path);
   }
+  g_array_free(entries, TRUE);
 
-  dt_database_release_transaction(darktable.db);
+  return g_list_reverse(result); // list was built in reverse order, so un-reverse it
+}
 
-  sqlite3_finalize(stmt);
-  sqlite3_finalize(inner_stmt);
+static int32_t _control_crawler_job_run(dt_job_t *job)
+{
+  GList *result = _crawler_run();
+
+  g_mutex_lock(&_crawler_job.mutex);
+  _crawler_job.result = result;
+  _crawler_job.done = TRUE;
+  g_cond_signal(&_crawler_job.cond);
+  g_mutex_unlock(&_crawler_job.mutex);
+  return 0;
+}
 
-  return g_list_reverse(result); // list was built in reverse order, so un-reverse it
+void dt_control_crawler_start(void)
+{
+  dt_job_t *job = dt_control_job_create(&_control_crawler_job_run, "%s",
+                                        N_("check sidecar files"));
+  if(!job) return;
+
+  g_mutex_lock(&_crawler_job.mutex);
+  _crawler_job.running = TRUE;
+  _crawler_job.done = FALSE;
+  _crawler_job.progress = 0.0;
+  _crawler_job.result = NULL;
+  g_mutex_unlock(&_crawler_job.mutex);
+
+  dt_control_add_job(DT_JOB_QUEUE_USER_BG, job);
 }
 
+GList *dt_control_crawler_wait(void)
+{
+  const double start_time = dt_get_wtime();
+  gboolean splash = FALSE;
+
+  g_mutex_lock(&_crawler_job.mutex);
+  while(_crawler_job.running && !_crawler_job.done)
+  {
+    const gint64 end_time = g_get_monotonic_time() + CRAWLER_UPDATE * G_TIME_SPAN_SECOND;
+    if(g_cond_wait_until(&_crawler_job.cond, &_crawler_job.mutex, end_time))
+      continue;
+
+    const double progress = _crawler_job.progress;
+    g_mutex_unlock(&_crawler_job.mutex);
+
+    // force the splash screen for the crawl even if user-disabled
+    if(!splash)
+    {
+      darktable_splash_screen_create(NULL, TRUE);
+      splash = TRUE;
+    }
+    darktable_splash_screen_set_progress_percent(_("checking for updated sidecar files (%d%%)"),
+                                                 progress, dt_get_wtime() - start_time);
+    g_mutex_lock(&_crawler_job.mutex);
+  }
+  GList *result = _crawler_job.result;
+  _crawler_job.result = NULL;
+  _crawler_job.running = FALSE;
+  g_mutex_unlock(&_crawler_job.mutex);
+
+  if(splash && !dt_conf_get_bool("show_splash_screen"))
+  {
+    darktable_splash_screen_destroy();
+    dt_gui_process_events(); // ensure that the splash screen is removed right away
+  }
+  return result;
+}
 
 /********************* the gui stuff *********************/
 
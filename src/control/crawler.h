@@ -20,18 +20,17 @@
 
 #include <glib.h>
 
-/** this isn't a background job on purpose. it has to be really fast so it shouldn't
- *  require locking from image cache or anything like that.
- *  should we find out that we want to have a background job that crawls over all images
- *  we can maybe refactor this, but for now it's good the way it is.
- */
-
 // this function iterates over ALL images from the database and checks whether
 // - the XMP file on disk is newer than the timestamp from db
 // - there is a .txt or .wav file associated with the image and mark so in the db
 //   or if such a file no longer exists
+// the file checks are done in parallel by a background job, flag changes go through
+// the image cache.
+void dt_control_crawler_start(void);
+
+// wait for the crawl to finish, showing its progress on the splash screen.
 // it returns the list of images with a (supposedly) updated xmp file to let the user decide
-GList *dt_control_crawler_run();
+GList *dt_control_crawler_wait(void);
 
 // show a popup with the images, let the user decide what to do and free the list afterwards
 void dt_control_crawler_show_image_list(GList *images);
@@ -336,6 +336,9 @@ static dt_job_t *_control_generic_image_job_create(dt_job_execute_callback execu
   return job;
 }
 
+// number of sidecars handled in parallel between two progress updates
+#define DT_SIDECAR_WRITE_CHUNK 64
+
 static int32_t _control_write_sidecar_files_job_run(dt_job_t *job)
 {
   dt_control_image_enumerator_t *params = dt_control_job_get_params(job);
@@ -343,6 +346,12 @@ static int32_t _control_write_sidecar_files_job_run(dt_job_t *job)
   dt_control_job_set_progress_message(job,
              ngettext("writing sidecar file","writing %zu sidecar files",nb_imgs), nb_imgs);
 
+  dt_imgid_t *imgids = g_malloc_n(nb_imgs, sizeof(dt_imgid_t));
+  gboolean *written = g_malloc_n(nb_imgs, sizeof(gboolean));
+  size_t k = 0;
+  for(GList *t = params->index; t; t = g_list_next(t))
+    imgids[k++] = GPOINTER_TO_INT(t->data);
+
   sqlite3_stmt *stmt;
   DT_DEBUG_SQLITE3_PREPARE_V2
     (dt_database_get(darktable.db),
@@ -350,36 +359,51 @@ static int32_t _control_write_sidecar_files_job_run(dt_job_t *job)
      " SET write_timestamp = STRFTIME('%s', 'now')"
      " WHERE id = ?1", -1,
      &stmt, NULL);
-  size_t count = 0;
   double prev_time = 0;
-  for(GList *t = params->index ; t && !_job_cancelled(job) ; t = g_list_next(t))
+  for(size_t start = 0; start < nb_imgs && !_job_cancelled(job); start += DT_SIDECAR_WRITE_CHUNK)
   {
-    const dt_imgid_t imgid = GPOINTER_TO_INT(t->data);
-    const dt_image_t *img = dt_image_cache_get(imgid, 'r');
-    if(img)
+    const size_t end = MIN(nb_imgs, start + DT_SIDECAR_WRITE_CHUNK);
+
+    // the sidecars are mostly unchanged, the time goes into reading and
+    // comparing them which is done concurrently. only the exiv2 part in
+    // dt_exif_xmp_write() is serialized.
+    DT_OMP_PRAGMA(parallel for default(firstprivate) schedule(dynamic, 1) shared(imgids, written))
+    for(size_t i = start; i < end; i++)
     {
-      char dtfilename[PATH_MAX] = { 0 };
-      dt_image_full_path(img->id, dtfilename, sizeof(dtfilename), NULL);
-      dt_image_path_append_version(img->id, dtfilename, sizeof(dtfilename));
-      g_strlcat(dtfilename, ".xmp", sizeof(dtfilename));
-      // write the sidecar, but ONLY if it is missing or its contents have changed
-      // this ensures that the sidecar is up-to-date with the database without
-      // modifying the file's timestamp if it is already up-to-date
-      if(!dt_exif_xmp_write(imgid, dtfilename, FALSE))
+      const dt_imgid_t imgid = imgids[i];
+      written[i] = FALSE;
+      const dt_image_t *img = dt_image_cache_get(imgid, 'r');
+      if(img)
       {
-        // put the timestamp into db. this can't be done in exif.cc
-        // since that code gets called for the copy exporter, too
-        DT_DEBUG_SQLITE3_BIND_INT(stmt, 1, imgid);
-        sqlite3_step(stmt);
-        sqlite3_reset(stmt);
-        sqlite3_clear_bindings(stmt);
+        char dtfilename[PATH_MAX] = { 0 };
+        dt_image_full_path(img->id, dtfilename, sizeof(dtfilename), NULL);
+        dt_image_path_append_version(img->id, dtfilename, sizeof(dtfilename));
+        g_strlcat(dtfilename, ".xmp", sizeof(dtfilename));
+        // write the sidecar, but ONLY if it is missing or its contents have changed
+        // this ensures that the sidecar is up-to-date with the database without
+        // modifying the file's timestamp if it is already up-to-date
+        written[i] = !dt_exif_xmp_write(imgid, dtfilename, FALSE);
+        dt_image_cache_read_release(img);
       }
-      dt_image_cache_read_release(img);
     }
-    const double fraction = ++count / (double)nb_imgs;
+
+    // put the timestamp into db. this can't be done in exif.cc
+    // since that code gets called for the copy exporter, too
+    for(size_t i = start; i < end; i++)
+    {
+      if(!written[i]) continue;
+      DT_DEBUG_SQLITE3_BIND_INT(stmt, 1, imgids[i]);
+      sqlite3_step(stmt);
+      sqlite3_reset(stmt);
+      sqlite3_clear_bindings(stmt);
+    }
+
+    const double fraction = end / (double)nb_imgs;
     _update_progress(job, fraction, &prev_time);
   }
   sqlite3_finalize(stmt);
+  g_free(imgids);
+  g_free(written);
   return 0;
 }
 
@@ -426,24 +450,142 @@ static const char *_control_merge_hdr_mime(dt_imageio_module_data_t *data)
   return "memory";
 }
 
-static float _envelope(const float xx)
+// branchless so that the loop over a row of pattern blocks vectorizes
+DT_OMP_DECLARE_SIMD()
+static inline float _envelope(const float xx)
 {
   const float x = CLAMPS(xx, 0.0f, 1.0f);
   // const float alpha = 2.0f;
   const float beta = 0.5f;
-  if(x < beta)
-  {
-    // return 1.0f-fabsf(x/beta-1.0f)^2
-    const float tmp = fabsf(x / beta - 1.0f);
-    return 1.0f - tmp * tmp;
-  }
-  else
-  {
-    const float tmp1 = (1.0f - x) / (1.0f - beta);
-    const float tmp2 = tmp1 * tmp1;
-    const float tmp3 = tmp2 * tmp1;
-    return 3.0f * tmp2 - 2.0f * tmp3;
+  // x < beta: 1.0f-fabsf(x/beta-1.0f)^2
+  const float tmp = x / beta - 1.0f;
+  const float lo = 1.0f - tmp * tmp;
+  // x >= beta: smoothstep down to zero at x = 1
+  const float tmp1 = (1.0f - x) / (1.0f - beta);
+  const float tmp2 = tmp1 * tmp1;
+  const float hi = 3.0f * tmp2 - 2.0f * tmp2 * tmp1;
+  return x < beta ? lo : hi;
+}
+
+// accumulate one bracket into the merge buffers. the weights depend on
+// the maximum of the 3x3 neighbourhood of each 2x2 pattern block, so
+// we work on pairs of rows: first collect the block extrema and
+// envelope weights for the row pair, then update its pixels. row pairs
+// are independent so they are distributed over the threads.
+static gboolean _control_merge_hdr_accumulate(dt_control_merge_hdr_t *d,
+                                              const float *const in,
+                                              const float photoncnt,
+                                              const float cal,
+                                              const float saturation)
+{
+  const int wd = d->wd;
+  const int ht = d->ht;
+  const int nblocks = (wd + 1) / 2;
+  // blocks with a full 3x3 neighbourhood inside the image
+  const int nvalid = wd > 2 ? (wd - 1) / 2 : 0;
+
+  size_t padded;
+  float *const scratch = dt_alloc_perthread_float(3 * nblocks, &padded);
+  if(!scratch) return TRUE;
+
+  // need some safety margin due to upsampling and 16-bit quantization + dithering?
+  const float offset = 3000.0f / (float)UINT16_MAX;
+  const float whitelevel = d->whitelevel;
+  const float epsw = d->epsw;
+  float *const pixels = d->pixels;
+  float *const weight = d->weight;
+
+  DT_OMP_FOR()
+  for(int yy = 0; yy < ht; yy += 2)
+  {
+    float *const bmax = dt_get_perthread(scratch, padded);
+    float *const bmin = bmax + nblocks;
+    float *const benv = bmin + nblocks;
+
+    for(int b = 0; b < nblocks; b++)
+    {
+      bmax[b] = 0.0f;
+      bmin[b] = FLT_MAX;
+      benv[b] = 1.0f;
+    }
+
+    // cannot do an envelope based on single pixel values here, need
+    // to get maximum value of all color channels. to find that, go
+    // through the pattern block (we conservatively do a 3x3 for
+    // bayer or xtrans):
+    if(yy < ht - 2)
+    {
+      for(int b = 0; b < nvalid; b++)
+      {
+        const float *const blk = in + (size_t)wd * yy + 2 * b;
+        float M = 0.0f, m = FLT_MAX;
+        for(int j = 0; j < 3; j++)
+          for(int i = 0; i < 3; i++)
+          {
+            M = MAX(M, blk[(size_t)wd * j + i]);
+            m = MIN(m, blk[(size_t)wd * j + i]);
+          }
+        bmax[b] = M;
+        bmin[b] = m;
+      }
+      // move envelope a little to allow non-zero weight even for
+      // clipped regions.  this is because even if the 2x2 block is
+      // clipped somewhere, the other channels might still prove
+      // useful. we'll check for individual channel saturation
+      // below.
+      DT_OMP_SIMD()
+      for(int b = 0; b < nvalid; b++)
+        benv[b] = epsw + _envelope((bmax[b] + offset) / saturation);
+    }
+
+    const int yend = MIN(yy + 2, ht);
+    for(int y = yy; y < yend; y++)
+    {
+      const size_t row = (size_t)wd * y;
+      for(int x = 0; x < wd; x++)
+      {
+        const size_t k = row + x;
+        const float M = bmax[x >> 1];
+        const float m = bmin[x >> 1];
+        // weights based on siggraph 12 poster zijian zhu, zhengguo li,
+        // susanto rahardja, pasi fraenti 2d denoising factor for high
+        // dynamic range imaging
+        const float w = photoncnt * benv[x >> 1];
+
+        if(M + offset >= saturation)
+        {
+          if(weight[k] <= 0.0f)
+          { // only consider saturated pixels in case we have nothing better:
+            if(weight[k] == 0 || m < -weight[k])
+            {
+              if(m + offset >= saturation)
+                pixels[k] = 1.0f; // let's admit we were completely clipped, too
+              else
+                pixels[k] = in[k] * cal / whitelevel;
+              weight[k] = -m; // could use -cal here, but m is per pixel and
+                              // safer for varying illumination conditions
+            }
+          }
+          // else silently ignore, others have filled in a better color here already
+        }
+        else
+        {
+          if(weight[k] <= 0.0)
+          { // cleanup potentially blown highlights from earlier images
+            pixels[k] = 0.0f;
+            weight[k] = 0.0f;
+          }
+          // read unclamped raw value with subtracted black and rescaled
+          // to 1.0 saturation.  this is the output of the rawprepare iop.
+          pixels[k] += w * in[k] * cal;
+          weight[k] += w;
+        }
+      }
+    }
   }
+
+  dt_free_align(scratch);
+  return FALSE;
 }
 
 static int _control_merge_hdr_process(dt_imageio_module_data_t *datai,
@@ -543,85 +685,28 @@ static int _control_merge_hdr_process(dt_imageio_module_data_t *datai,
   const float photoncnt = 100.0f * aperture * exp / iso;
   float saturation = 1.0f;
   d->whitelevel = fmaxf(d->whitelevel, saturation * cal);
-  DT_OMP_FOR(collapse(2))
-  for(int y = 0; y < d->ht; y++)
-    for(int x = 0; x < d->wd; x++)
-    {
-      // read unclamped raw value with subtracted black and rescaled
-      // to 1.0 saturation.  this is the output of the rawprepare iop.
-      const float in = ((float *)ivoid)[x + d->wd * y];
-      // weights based on siggraph 12 poster zijian zhu, zhengguo li,
-      // susanto rahardja, pasi fraenti 2d denoising factor for high
-      // dynamic range imaging
-      float w = photoncnt;
-
-      // need some safety margin due to upsampling and 16-bit quantization + dithering?
-      float offset = 3000.0f / (float)UINT16_MAX;
-
-      // cannot do an envelope based on single pixel values here, need
-      // to get maximum value of all color channels. to find that, go
-      // through the pattern block (we conservatively do a 3x3 for
-      // bayer or xtrans):
-      int xx = x & ~1, yy = y & ~1;
-      float M = 0.0f, m = FLT_MAX;
-      if(xx < d->wd - 2 && yy < d->ht - 2)
-      {
-        for(int i = 0; i < 3; i++)
-          for(int j = 0; j < 3; j++)
-          {
-            M = MAX(M, ((float *)ivoid)[xx + i + d->wd * (yy + j)]);
-            m = MIN(m, ((float *)ivoid)[xx + i + d->wd * (yy + j)]);
-          }
-        // move envelope a little to allow non-zero weight even for
-        // clipped regions.  this is because even if the 2x2 block is
-        // clipped somewhere, the other channels might still prove
-        // useful. we'll check for individual channel saturation
-        // below.
-        w *= d->epsw + _envelope((M + offset) / saturation);
-      }
-
-      if(M + offset >= saturation)
-      {
-        if(d->weight[x + d->wd * y] <= 0.0f)
-        { // only consider saturated pixels in case we have nothing better:
-          if(d->weight[x + d->wd * y] == 0 || m < -d->weight[x + d->wd * y])
-          {
-            if(m + offset >= saturation)
-              d->pixels[x + d->wd * y] = 1.0f; // let's admit we were completely clipped, too
-            else
-              d->pixels[x + d->wd * y] = in * cal / d->whitelevel;
-            d->weight[x + d->wd * y]
-                = -m; // could use -cal here, but m is per pixel and
-                      // safer for varying illumination conditions
-          }
-        }
-        // else silently ignore, others have filled in a better color here already
-      }
-      else
-      {
-        if(d->weight[x + d->wd * y] <= 0.0)
-        { // cleanup potentially blown highlights from earlier images
-          d->pixels[x + d->wd * y] = 0.0f;
-          d->weight[x + d->wd * y] = 0.0f;
-        }
-        d->pixels[x + d->wd * y] += w * in * cal;
-        d->weight[x + d->wd * y] += w;
-      }
-    }
+  if(_control_merge_hdr_accumulate(d, (const float *)ivoid, photoncnt, cal, saturation))
+  {
+    dt_control_log(_("unable to allocate memory for HDR merge"));
+    d->abort = TRUE;
+    return 1;
+  }
 
   return 0;
 }
 
-static int32_t _control_merge_hdr_job_run(dt_job_t *job)
+// merge the given brackets into a -hdr.dng next to the first one and
+// import it. returns the id of the new image or NO_IMGID on failure.
+static dt_imgid_t _control_merge_hdr_images(dt_job_t *job, GList *imgs)
 {
-  dt_control_image_enumerator_t *params = dt_control_job_get_params(job);
-  GList *t = params->index;
+  GList *t = imgs;
   const guint total = g_list_length(t);
   double fraction = 0;
   dt_control_job_set_progress_message(job, ngettext("merging %d image",
                                                     "merging %d images", total), total);
 
   dt_control_merge_hdr_t d = (dt_control_merge_hdr_t){.epsw = 1e-8f, .abort = FALSE };
+  dt_imgid_t imageid = NO_IMGID;
 
   dt_imageio_module_format_t buf = (dt_imageio_module_format_t)
     {.mime = _control_merge_hdr_mime,
@@ -635,24 +720,27 @@ static int32_t _control_merge_hdr_job_run(dt_job_t *job)
   int num = 1;
   while(t)
   {
-    if(d.abort) goto end;
+    if(d.abort || _job_cancelled(job)) goto end;
 
     const dt_imgid_t imgid = GPOINTER_TO_INT(t->data);
+    t = g_list_next(t);
+
+    // let the kernel fetch the next bracket while this one runs through the pipe
+    if(t) dt_imageio_readahead(GPOINTER_TO_INT(t->data));
+
     dt_imageio_export_with_flags(imgid, "unused", &buf, (dt_imageio_module_data_t *)&dat,
                                  TRUE, FALSE, TRUE, TRUE, FALSE, 1.0,
                                  FALSE, "pre:rawprepare", FALSE,
                                  FALSE, DT_COLORSPACE_NONE, NULL, DT_INTENT_LAST, NULL,
                                  NULL, num, total, NULL, -1);
 
-    t = g_list_next(t);
-
     /* update the progress bar */
     fraction += 1.0 / (total + 1);
     dt_control_job_set_progress(job, fraction);
     num++;
   }
 
-  if(d.abort) goto end;
+  if(d.abort || !d.pixels) goto end;
 
 // normalize by white level to make clipping at 1.0 work as expected
 
@@ -663,6 +751,10 @@ static int32_t _control_merge_hdr_job_run(dt_job_t *job)
       d.pixels[k] = fmaxf(0.0f, d.pixels[k] / (d.whitelevel * d.weight[k]));
   }
 
+  // the weights are not needed anymore, release them before the dng is assembled
+  free(d.weight);
+  d.weight = NULL;
+
   // output hdr as digital negative with exif data.
   uint8_t *exif = NULL;
   char pathname[PATH_MAX] = { 0 };
@@ -696,20 +788,31 @@ static int32_t _control_merge_hdr_job_run(dt_job_t *job)
   gchar *directory = g_path_get_dirname((const gchar *)pathname);
   dt_film_t film;
   const dt_filmid_t filmid = dt_film_new(&film, directory);
-  const dt_imgid_t imageid = dt_image_import(filmid, pathname, TRUE, TRUE);
+  imageid = dt_image_import(filmid, pathname, TRUE, TRUE);
   g_free(directory);
 
-  // refresh the thumbtable view
-  dt_collection_update_query(darktable.collection,
-                             DT_COLLECTION_CHANGE_RELOAD, DT_COLLECTION_PROP_UNDEF,
-                             g_list_prepend(NULL, GINT_TO_POINTER(imageid)));
-  DT_CONTROL_SIGNAL_RAISE(DT_SIGNAL_FILMROLLS_CHANGED);
-  dt_control_queue_redraw_center();
-
 end:
   free(d.pixels);
   free(d.weight);
 
+  return imageid;
+}
+
+static int32_t _control_merge_hdr_job_run(dt_job_t *job)
+{
+  dt_control_image_enumerator_t *params = dt_control_job_get_params(job);
+  const dt_imgid_t imageid = _control_merge_hdr_images(job, params->index);
+
+  if(dt_is_valid_imgid(imageid))
+  {
+    // refresh the thumbtable view
+    dt_collection_update_query(darktable.collection,
+                               DT_COLLECTION_CHANGE_RELOAD, DT_COLLECTION_PROP_UNDEF,
+                               g_list_prepend(NULL, GINT_TO_POINTER(imageid)));
+    DT_CONTROL_SIGNAL_RAISE(DT_SIGNAL_FILMROLLS_CHANGED);
+    dt_control_queue_redraw_center();
+  }
+
   return 0;
 }
 
@@ -1574,6 +1677,71 @@ static int32_t _control_refresh_exif_run(dt_job_t *job)
   return 0;
 }
 
+// second phase of a fast import: run the full exiv2 decoding for the
+// images where only the basic exif data has been read.
+static int32_t _control_complete_exif_job_run(dt_job_t *job)
+{
+  dt_control_image_enumerator_t *params = dt_control_job_get_params(job);
+  const guint total = g_list_length(params->index);
+  double fraction = 0.0;
+  double prev_time = 0;
+  GList *imgs = NULL;
+
+  for(GList *t = params->index; t && !_job_cancelled(job); t = g_list_next(t))
+  {
+    const dt_imgid_t imgid = GPOINTER_TO_INT(t->data);
+
+    const dt_image_t *cimg = dt_image_cache_get(imgid, 'r');
+    const gboolean pending = cimg && (cimg->flags & DT_IMAGE_EXIF_PENDING);
+    dt_image_cache_read_release(cimg);
+
+    if(pending)
+    {
+      gboolean from_cache = TRUE;
+      char sourcefile[PATH_MAX] = { 0 };
+      dt_image_full_path(imgid, sourcefile, sizeof(sourcefile), &from_cache);
+
+      dt_image_t *img = dt_image_cache_get(imgid, 'w');
+      if(img)
+      {
+        // the image may have been opened in the meantime
+        if(img->flags & DT_IMAGE_EXIF_PENDING)
+          dt_exif_read(img, sourcefile);
+        dt_image_cache_write_release_info(img, DT_IMAGE_CACHE_RELAXED,
+                                          "_control_complete_exif_job_run");
+        imgs = g_list_prepend(imgs, GINT_TO_POINTER(imgid));
+      }
+    }
+
+    fraction += 1.0 / total;
+    _update_progress(job, fraction, &prev_time);
+  }
+
+  if(imgs)
+  {
+    DT_CONTROL_SIGNAL_RAISE(DT_SIGNAL_TAG_CHANGED);
+    DT_CONTROL_SIGNAL_RAISE(DT_SIGNAL_IMAGE_INFO_CHANGED, imgs);
+  }
+  return 0;
+}
+
+static dt_job_t *_control_complete_exif_job_create(GList *imgs)
+{
+  dt_job_t *job = dt_control_job_create(&_control_complete_exif_job_run, "%s",
+                                        N_("read EXIF"));
+  if(!job) return NULL;
+  dt_control_image_enumerator_t *params = _control_image_enumerator_alloc();
+  if(!params)
+  {
+    dt_control_job_dispose(job);
+    return NULL;
+  }
+  dt_control_job_add_progress(job, _("read EXIF"), TRUE);
+  params->index = g_list_copy(imgs);
+  dt_control_job_set_params(job, params, _control_image_enumerator_cleanup);
+  return job;
+}
+
 static inline gboolean _safe_history_job_on_imgid(dt_job_t *job, const dt_imgid_t imgid)
 {
   // it is safe to run a history-modifying operation if:
@@ -1903,6 +2071,9 @@ static int32_t _control_export_job_run(dt_job_t *job)
     t = g_list_next(t);
     const guint num = total - g_list_length(t);
 
+    // let the next file arrive while this one is exported
+    if(t) dt_imageio_readahead(GPOINTER_TO_INT(t->data));
+
     // progress message
     // update the message. initialize_store() might have changed the number of images
     dt_control_job_set_progress_message(job, _("exporting %d / %d to %s"),
@@ -2030,6 +2201,11 @@ void dt_control_merge_hdr()
                                           NULL, PROGRESS_CANCELLABLE, TRUE));
 }
 
+dt_imgid_t dt_control_merge_hdr_images(GList *imgs)
+{
+  return _control_merge_hdr_images(NULL, imgs);
+}
+
 void dt_control_gpx_apply(const gchar *filename,
                           const int32_t filmid,
                           const gchar *tz,
@@ -3032,6 +3208,8 @@ static int32_t _control_import_job_run(dt_job_t *job)
 
   dt_control_log(ngettext("imported %d image", "imported %d images", cntr), cntr);
   dt_control_queue_redraw_center();
+  if(imgs && dt_conf_get_bool("ui/fast_exif_import"))
+    dt_control_add_job(DT_JOB_QUEUE_USER_BG, _control_complete_exif_job_create(imgs));
   DT_CONTROL_SIGNAL_RAISE(DT_SIGNAL_TAG_CHANGED);
   DT_CONTROL_SIGNAL_RAISE(DT_SIGNAL_GEOTAG_CHANGED, imgs, 0);
   DT_CONTROL_SIGNAL_RAISE(DT_SIGNAL_FILMROLLS_IMPORTED, filmid);
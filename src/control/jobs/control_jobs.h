@@ -66,6 +66,8 @@ void dt_control_export(GList *imgid_list,
                        const dt_iop_color_intent_t icc_intent,
                        const gchar *metadata_export);
 void dt_control_merge_hdr(void);
+/** merge the raw brackets in imgs into a -hdr.dng in the calling thread, returns the imported image */
+dt_imgid_t dt_control_merge_hdr_images(GList *imgs);
 void dt_control_import(GList *imgs, const char *datetime_override, const gboolean inplace);
 void dt_control_refresh_exif(void);
 
@@ -2159,6 +2159,10 @@ void dt_iop_commit_params(dt_iop_module_t *module,
   if(module->flags() & IOP_FLAGS_ALLOW_TILING)
     piece->process_tiling_ready = TRUE;
 
+  // fusing with neighbour modules must be requested by commit_params
+  piece->raw_frontend_ready = FALSE;
+  piece->pointwise_ready = FALSE;
+
   if((piece->enabled || module->enabled) // better to check for both
     && module->so->get_introspection()
     && darktable.unmuted & DT_DEBUG_PARAMS)
@@ -939,6 +939,65 @@ void dt_iop_clip_and_zoom_demosaic_third_size_xtrans_f(float *out,
   }
 }
 
+void dt_iop_clip_and_zoom_demosaic_f(float *out,
+                                     const float *const in,
+                                     const dt_iop_roi_t *const roi_out,
+                                     const dt_iop_roi_t *const roi_in,
+                                     const int32_t out_stride,
+                                     const int32_t in_stride,
+                                     const uint32_t filters,
+                                     const uint8_t (*const xtrans)[6])
+{
+  // Demosaic and downscale in one pass: every output pixel is the
+  // normalized convolution of the CFA samples of each color with a tent
+  // filter centered on the output pixel.  The tent spans the pixel
+  // footprint, which anti-aliases the downscaling, but at least 2 (Bayer)
+  // or 3 (X-Trans) input pixels so that all three colors are present.
+  // Output pixels map to the input like in dt_iop_clip_and_zoom() and the
+  // half size samplers.
+  const float px_footprint = 1.f / roi_out->scale;
+  const gboolean is_xtrans = filters == 9u;
+  const float radius = fmaxf(px_footprint, is_xtrans ? 3.0f : 2.0f);
+  const float inv_radius = 1.0f / radius;
+
+  DT_OMP_FOR()
+  for(int y = 0; y < roi_out->height; y++)
+  {
+    float *outc = out + 4 * ((size_t)out_stride * y);
+    const float cy = y * px_footprint;
+    const int y0 = MAX(0, (int)ceilf(cy - radius));
+    const int y1 = MIN(roi_in->height - 1, (int)floorf(cy + radius));
+
+    for(int x = 0; x < roi_out->width; x++, outc += 4)
+    {
+      const float cx = x * px_footprint;
+      const int x0 = MAX(0, (int)ceilf(cx - radius));
+      const int x1 = MIN(roi_in->width - 1, (int)floorf(cx + radius));
+
+      dt_aligned_pixel_t col = { 0.0f, 0.0f, 0.0f, 0.0f };
+      dt_aligned_pixel_t weight = { 0.0f, 0.0f, 0.0f, 0.0f };
+      for(int j = y0; j <= y1; j++)
+      {
+        const float wy = 1.0f - fabsf(j - cy) * inv_radius;
+        if(wy <= 0.0f) continue;
+        const float *const row = in + (size_t)in_stride * j;
+        for(int i = x0; i <= x1; i++)
+        {
+          const float w = wy * (1.0f - fabsf(i - cx) * inv_radius);
+          if(w <= 0.0f) continue;
+          const int c = is_xtrans ? FCxtrans(j, i, NULL, xtrans) : FC(j, i, filters);
+          col[c] += w * row[i];
+          weight[c] += w;
+        }
+      }
+
+      for(int c = 0; c < 3; c++)
+        outc[c] = weight[c] > 0.0f ? fmaxf(0.0f, col[c]) / weight[c] : 0.0f;
+      outc[3] = 0.0f;
+    }
+  }
+}
+
 // clang-format off
 // modelines: These editor modelines have been set for all relevant files by tools/update_modelines.py
 // vim: shiftwidth=2 expandtab tabstop=2 cindent
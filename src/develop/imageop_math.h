@@ -88,6 +88,14 @@ void dt_iop_clip_and_zoom_demosaic_third_size_xtrans_f(float *out, const float *
                                                        const int32_t out_stride, const int32_t in_stride,
                                                        const uint8_t (*const xtrans)[6]);
 
+/** bayer and x-trans demosaic and downscale in one pass, with anti-aliasing.
+ * for scales the half and third size samplers can't serve */
+void dt_iop_clip_and_zoom_demosaic_f(float *out, const float *const in,
+                                     const struct dt_iop_roi_t *const roi_out,
+                                     const struct dt_iop_roi_t *const roi_in,
+                                     const int32_t out_stride, const int32_t in_stride,
+                                     const uint32_t filters, const uint8_t (*const xtrans)[6]);
+
 /** as dt_iop_clip_and_zoom, but for rgba 8-bit channels. */
 void dt_iop_clip_and_zoom_8(const uint8_t *i, int32_t ix, int32_t iy, int32_t iw, int32_t ih, int32_t ibw,
                             int32_t ibh, uint8_t *o, int32_t ox, int32_t oy, int32_t ow, int32_t oh,
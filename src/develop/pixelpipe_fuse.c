@@ -0,0 +1,191 @@
+/*
+    This file is part of darktable,
+    Copyright (C) 2025 darktable developers.
+
+    darktable is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    darktable is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with darktable.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "develop/pixelpipe_fuse.h"
+#include "common/darktable.h"
+#include "common/interpolation.h"
+#include "develop/imageop.h"
+#include "develop/pixelpipe.h"
+
+#include <math.h>
+
+void dt_dev_raw_frontend_init(dt_dev_raw_frontend_t *fe)
+{
+  fe->crop_x = fe->crop_y = 0;
+  for(int r = 0; r < DT_RAW_FRONTEND_ROWS; r++)
+  {
+    for(int c = 0; c < DT_RAW_FRONTEND_COLS; c++)
+    {
+      fe->sub[r][c] = 0.0f;
+      fe->div[r][c] = 1.0f;
+      fe->coeff[r][c] = 1.0f;
+      fe->clip[r][c] = INFINITY;
+    }
+  }
+}
+
+void dt_dev_raw_frontend_process(const dt_dev_raw_frontend_t *fe,
+                                 const void *const ivoid,
+                                 float *const out,
+                                 const gboolean uint16_input,
+                                 const dt_iop_roi_t *const roi_in,
+                                 const dt_iop_roi_t *const roi_out)
+{
+  const int width = roi_out->width;
+
+  DT_OMP_FOR()
+  for(int row = 0; row < roi_out->height; row++)
+  {
+    const int r = row % DT_RAW_FRONTEND_ROWS;
+    const float *const sub = fe->sub[r];
+    const float *const div = fe->div[r];
+    const float *const coeff = fe->coeff[r];
+    const float *const clip = fe->clip[r];
+    const size_t pin = (size_t)roi_in->width * (row + fe->crop_y) + fe->crop_x;
+    float *const o = out + (size_t)row * width;
+
+    // the locations of a row repeat every DT_RAW_FRONTEND_COLS, full blocks vectorize
+    if(uint16_input)
+    {
+      const uint16_t *const in = (const uint16_t *)ivoid + pin;
+      int col = 0;
+      for(; col <= width - DT_RAW_FRONTEND_COLS; col += DT_RAW_FRONTEND_COLS)
+      {
+        DT_OMP_SIMD()
+        for(int c = 0; c < DT_RAW_FRONTEND_COLS; c++)
+          o[col + c] = fminf(clip[c], (in[col + c] - sub[c]) / div[c] * coeff[c]);
+      }
+      for(int c = 0; col + c < width; c++)
+        o[col + c] = fminf(clip[c], (in[col + c] - sub[c]) / div[c] * coeff[c]);
+    }
+    else
+    {
+      const float *const in = (const float *)ivoid + pin;
+      int col = 0;
+      for(; col <= width - DT_RAW_FRONTEND_COLS; col += DT_RAW_FRONTEND_COLS)
+      {
+        DT_OMP_SIMD()
+        for(int c = 0; c < DT_RAW_FRONTEND_COLS; c++)
+          o[col + c] = fminf(clip[c], (in[col + c] - sub[c]) / div[c] * coeff[c]);
+      }
+      for(int c = 0; col + c < width; c++)
+        o[col + c] = fminf(clip[c], (in[col + c] - sub[c]) / div[c] * coeff[c]);
+    }
+  }
+}
+
+void dt_dev_pointwise_process(dt_dev_pixelpipe_iop_t **pieces,
+                              const int num,
+                              const float *const in,
+                              float *const out,
+                              const size_t npixels)
+{
+  const size_t nstrips = (npixels + DT_POINTWISE_STRIP - 1) / DT_POINTWISE_STRIP;
+
+  DT_OMP_FOR()
+  for(size_t s = 0; s < nstrips; s++)
+  {
+    const size_t start = s * DT_POINTWISE_STRIP;
+    const size_t n = MIN(DT_POINTWISE_STRIP, npixels - start);
+    const float *src = in + 4 * start;
+    float *const dst = out + 4 * start;
+    // the first module writes the output strip, all others work in place
+    for(int i = 0; i < num; i++)
+    {
+      dt_iop_module_t *module = pieces[i]->module;
+      module->process_pointwise(module, pieces[i], src, dst, n);
+      src = dst;
+    }
+  }
+}
+
+typedef struct _warp_chain_t
+{
+  const dt_dev_warp_step_t *steps;
+  int num;
+} _warp_chain_t;
+
+static void _warp_translate(const void *data,
+                            const float x,
+                            const float y,
+                            float *xin,
+                            float *yin)
+{
+  const float *const d = data;
+  *xin = x + d[0];
+  *yin = y + d[1];
+}
+
+static void _warp_chain(const void *data,
+                        const float x,
+                        const float y,
+                        float *xin,
+                        float *yin)
+{
+  const _warp_chain_t *chain = data;
+  float px = x, py = y;
+  for(int i = 0; i < chain->num; i++)
+  {
+    float qx, qy;
+    chain->steps[i].map(chain->steps[i].data, px, py, &qx, &qy);
+    px = qx;
+    py = qy;
+  }
+  *xin = px;
+  *yin = py;
+}
+
+void dt_dev_warp_set_translation(dt_dev_warp_step_t *step,
+                                 const float dx,
+                                 const float dy)
+{
+  float *d = dt_alloc_align_float(2);
+  d[0] = dx;
+  d[1] = dy;
+  step->map = _warp_translate;
+  step->data = d;
+}
+
+void dt_dev_warp_process(const dt_dev_warp_step_t *steps,
+                         const int num,
+                         const dt_interpolation_t *itor,
+                         const float *const in,
+                         float *const out,
+                         const dt_iop_roi_t *const roi_in,
+                         const dt_iop_roi_t *const roi_out)
+{
+  const _warp_chain_t chain = { .steps = steps, .num = num };
+  dt_interpolation_warp(itor, out, roi_out, in, roi_in, _warp_chain, &chain,
+                        DT_INTERPOLATION_WARP_PRECISION);
+}
+
+void dt_dev_warp_cleanup(dt_dev_warp_step_t *steps,
+                         const int num)
+{
+  for(int i = 0; i < num; i++)
+  {
+    dt_free_align(steps[i].data);
+    steps[i].data = NULL;
+  }
+}
+
+// clang-format off
+// modelines: These editor modelines have been set for all relevant files by tools/update_modelines.py
+// vim: shiftwidth=2 expandtab tabstop=2 cindent
+// kate: tab-indents: off; indent-width 2; replace-tabs on; indent-mode cstyle; remove-trailing-spaces modified;
+// clang-format on
@@ -0,0 +1,146 @@
+/*
+    This file is part of darktable,
+    Copyright (C) 2025 darktable developers.
+
+    darktable is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    darktable is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with darktable.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <glib.h>
+#include <stdint.h>
+
+struct dt_iop_roi_t;
+
+/*
+  Fused raw front-end
+
+  The first raw modules (rawprepare, temperature and highlights in clip mode) are
+  pointwise on the CFA data. If they are adjacent in the pipe, have no blending and
+  flag themselves via piece->raw_frontend_ready in commit_params, the pixelpipe
+  processes them in a single pass over the sensor data.
+
+  Each module describes its operation per CFA location in its fuse_raw_frontend()
+  callback, which also must do all the side effects process() would do to the pipe.
+  The tables are indexed by [row % DT_RAW_FRONTEND_ROWS][col % DT_RAW_FRONTEND_COLS]
+  of the output roi, a multiple of the bayer (8x2), xtrans (6x6) and black level
+  (2x2) patterns. The row length is also a multiple of the SIMD width.
+
+  For every location the result is
+    out = fminf(clip, (in - sub) / div * coeff)
+  evaluated in exactly this order so the output is identical to the unfused modules.
+*/
+
+#define DT_RAW_FRONTEND_ROWS 24
+#define DT_RAW_FRONTEND_COLS 24
+
+typedef struct dt_dev_raw_frontend_t
+{
+  int crop_x, crop_y;  // offset of the output roi in the input buffer
+  float sub[DT_RAW_FRONTEND_ROWS][DT_RAW_FRONTEND_COLS];   // black level
+  float div[DT_RAW_FRONTEND_ROWS][DT_RAW_FRONTEND_COLS];   // white - black level
+  float coeff[DT_RAW_FRONTEND_ROWS][DT_RAW_FRONTEND_COLS]; // white balance
+  float clip[DT_RAW_FRONTEND_ROWS][DT_RAW_FRONTEND_COLS];  // highlights clipping
+} dt_dev_raw_frontend_t;
+
+/** set all operations to identity */
+void dt_dev_raw_frontend_init(dt_dev_raw_frontend_t *fe);
+
+/** process the fused operations, input is either uint16_t or float mosaiced data */
+void dt_dev_raw_frontend_process(const dt_dev_raw_frontend_t *fe,
+                                 const void *const ivoid,
+                                 float *const out,
+                                 const gboolean uint16_input,
+                                 const struct dt_iop_roi_t *const roi_in,
+                                 const struct dt_iop_roi_t *const roi_out);
+
+/*
+  Fused pointwise modules
+
+  Many RGB modules are pure per-pixel transforms. Such a module sets
+  piece->pointwise_ready in commit_params and implements process_pointwise(),
+  working on a strip of npixels 4-channel pixels. in and out might be the same buffer,
+  the callback is called from within a parallel region and must not parallelize itself.
+  The optional fuse_pointwise() callback is called once before the strips are
+  processed, it prepares the strip processing and does the side effects process() has.
+
+  A run of adjacent modules without blending is processed strip by strip, each strip
+  stays in the cache while all modules of the run are applied. Only the output of the
+  last module of the run is written to the pixelpipe cache.
+
+  The module's own process() should use dt_dev_pointwise_process() with the single
+  piece, this guarantees fused and unfused output to be identical.
+*/
+
+// pixels per strip, four floats per pixel keep a strip in the L2 cache
+#define DT_POINTWISE_STRIP 4096
+
+struct dt_dev_pixelpipe_iop_t;
+
+/** process the pieces in given order strip by strip */
+void dt_dev_pointwise_process(struct dt_dev_pixelpipe_iop_t **pieces,
+                              const int num,
+                              const float *const in,
+                              float *const out,
+                              const size_t npixels);
+
+/*
+  Composed geometric transforms
+
+  Distorting modules resample their input, a run of them softens the image with every
+  interpolation and costs a full resampling each. If the pipe's compose_warps switch is
+  set, a run of adjacent distorting modules without blending is resampled only once.
+
+  Every module of the run describes its backward mapping from output to input buffer
+  coordinates in its fuse_warp() callback, as used for its own process(). The pipe
+  chains the maps from the last module of the run to the first and warps the input of
+  the run in one pass with dt_interpolation_warp() and the user's warp interpolator.
+
+  The result differs from the sequential modules by the interpolation done only once;
+  also locations mapped outside an intermediate roi get image data instead of the
+  border handling of that module.
+*/
+
+typedef struct dt_dev_warp_step_t
+{
+  // same as dt_interpolation_warp_map_t, output to input buffer coordinates
+  void (*map)(const void *data, const float x, const float y, float *xin, float *yin);
+  void *data;  // allocated with dt_alloc_aligned(), freed by dt_dev_warp_cleanup()
+} dt_dev_warp_step_t;
+
+struct dt_interpolation_t;
+
+/** set the step to a translation by dx, dy from output to input buffer */
+void dt_dev_warp_set_translation(dt_dev_warp_step_t *step,
+                                 const float dx,
+                                 const float dy);
+
+/** warp the input by the steps, steps[0] is the last module in pipe order */
+void dt_dev_warp_process(const dt_dev_warp_step_t *steps,
+                         const int num,
+                         const struct dt_interpolation_t *itor,
+                         const float *const in,
+                         float *const out,
+                         const struct dt_iop_roi_t *const roi_in,
+                         const struct dt_iop_roi_t *const roi_out);
+
+/** free the data of the steps */
+void dt_dev_warp_cleanup(dt_dev_warp_step_t *steps,
+                         const int num);
+
+// clang-format off
+// modelines: These editor modelines have been set for all relevant files by tools/update_modelines.py
+// vim: shiftwidth=2 expandtab tabstop=2 cindent
+// kate: tab-indents: off; indent-width 2; replace-tabs on; indent-mode cstyle; remove-trailing-spaces modified;
+// clang-format on
@@ -60,6 +60,7 @@ typedef enum dt_pixelpipe_flow_t
 } dt_pixelpipe_flow_t;
 
 #include "develop/pixelpipe_cache.c"
+#include "develop/pixelpipe_fuse.c"
 
 const char *dt_dev_pixelpipe_type_to_str(const dt_dev_pixelpipe_type_t pipe_type)
 {
@@ -259,6 +260,7 @@ gboolean dt_dev_pixelpipe_init_cached(dt_dev_pixelpipe_t *pipe,
   pipe->tiling = FALSE;
   pipe->mask_display = DT_DEV_PIXELPIPE_DISPLAY_NONE;
   pipe->bypass_blendif = FALSE;
+  pipe->compose_warps = dt_conf_get_bool("pixelpipe_compose_warps");
   pipe->input_timestamp = 0;
   pipe->levels = IMAGEIO_RGB | IMAGEIO_INT8;
   dt_pthread_mutex_init(&pipe->mutex, NULL);
@@ -452,6 +454,8 @@ void dt_dev_pixelpipe_create_nodes(dt_dev_pixelpipe_t *pipe,
     piece->hash = DT_INVALID_HASH;
     piece->process_cl_ready = FALSE;
     piece->process_tiling_ready = FALSE;
+    piece->raw_frontend_ready = FALSE;
+    piece->pointwise_ready = FALSE;
     piece->raster_masks = g_hash_table_new_full(g_direct_hash,
                                                 g_direct_equal, NULL, dt_free_align_ptr);
     memset(&piece->processed_roi_in, 0, sizeof(piece->processed_roi_in));
@@ -1534,6 +1538,531 @@ static inline gboolean _skip_piece_on_tags(const dt_dev_pixelpipe_iop_t *piece)
           && (piece->pipe->type & DT_DEV_PIXELPIPE_BASIC);
 }
 
+static gboolean _dev_pixelpipe_process_rec(dt_dev_pixelpipe_t *pipe,
+                                           dt_develop_t *dev,
+                                           void **output,
+                                           void **cl_mem_output,
+                                           dt_iop_buffer_dsc_t **out_format,
+                                           const dt_iop_roi_t *roi_out,
+                                           GList *modules,
+                                           GList *pieces,
+                                           const int pos);
+
+#define DT_RAW_FRONTEND_MAX 8
+#define DT_POINTWISE_MAX 16
+#define DT_WARP_MAX 8
+
+// pieces without blending, picker or histogram don't need their own output buffer
+static inline gboolean _fusable_piece(const dt_dev_pixelpipe_iop_t *piece)
+{
+  const dt_develop_blend_params_t *bp = piece->blendop_data;
+  return (!bp || bp->mask_mode == DEVELOP_MASK_DISABLED)
+    && piece->module->request_color_pick == DT_REQUEST_COLORPICK_OFF
+    && !(piece->request_histogram & DT_REQUEST_ON)
+    && !(piece->module->request_histogram & DT_REQUEST_ON);
+}
+
+static inline gboolean _raw_frontend_piece(const dt_dev_pixelpipe_iop_t *piece)
+{
+  return piece->raw_frontend_ready
+    && piece->module->fuse_raw_frontend
+    && _fusable_piece(piece);
+}
+
+static inline gboolean _pointwise_piece(const dt_dev_pixelpipe_iop_t *piece)
+{
+  return piece->pointwise_ready
+    && piece->module->process_pointwise
+    && _fusable_piece(piece);
+}
+
+static inline gboolean _warp_piece(const dt_dev_pixelpipe_iop_t *piece)
+{
+  return piece->module->fuse_warp
+    && _fusable_piece(piece);
+}
+
+/* The fused raw front-end processes all pieces from the pipe input up to the
+   current one in a single pass if they all are flagged raw_frontend_ready.
+   Only the output of the last piece is written to the cache.
+
+   Returns TRUE in case of unfinished work or error like _dev_pixelpipe_process_rec(),
+   *done tells if the pieces have been processed or the pipe has to process them one by one.
+*/
+static gboolean _process_raw_frontend(dt_dev_pixelpipe_t *pipe,
+                                      dt_develop_t *dev,
+                                      void **output,
+                                      dt_iop_buffer_dsc_t **out_format,
+                                      const dt_iop_roi_t *roi_out,
+                                      GList *modules,
+                                      GList *pieces,
+                                      const int pos,
+                                      const dt_hash_t hash,
+                                      const size_t bufsize,
+                                      gboolean *done)
+{
+  *done = FALSE;
+  if(pipe->mask_display != DT_DEV_PIXELPIPE_DISPLAY_NONE
+     || !_raw_frontend_piece(pieces->data))
+    return FALSE;
+
+#ifdef HAVE_OPENCL
+  // the modules are processed on the GPU
+  if(_opencl_pipe_isok(pipe))
+    return FALSE;
+#endif
+
+  // collect the run of pieces down to the pipe input, tail first
+  dt_dev_pixelpipe_iop_t *run[DT_RAW_FRONTEND_MAX];
+  int run_pos[DT_RAW_FRONTEND_MAX];
+  GList *head_module = NULL;
+  GList *head_piece = NULL;
+  int num = 0;
+  int k = pos;
+  for(GList *m = modules, *p = pieces; m; m = g_list_previous(m), p = g_list_previous(p), k--)
+  {
+    dt_dev_pixelpipe_iop_t *it = p->data;
+    if(_skip_piece_on_tags(it)) continue;
+    if(!_raw_frontend_piece(it) || num == DT_RAW_FRONTEND_MAX)
+      return FALSE;
+    run[num] = it;
+    run_pos[num] = k;
+    head_module = m;
+    head_piece = p;
+    num++;
+  }
+  if(num < 2) return FALSE;
+
+  // regions of interest from the tail to the head
+  dt_iop_roi_t rois_out[DT_RAW_FRONTEND_MAX];
+  dt_iop_roi_t rois_in[DT_RAW_FRONTEND_MAX];
+  rois_out[0] = *roi_out;
+  for(int i = 0; i < num; i++)
+  {
+    if(i > 0) rois_out[i] = rois_in[i-1];
+    rois_in[i] = rois_out[i];
+    run[i]->module->modify_roi_in(run[i]->module, run[i], &rois_out[i], &rois_in[i]);
+  }
+
+  // if the input of the last piece is still cached we are faster without fusing
+  const size_t tail_insize = sizeof(float) * rois_in[0].width * rois_in[0].height;
+  if(dt_dev_pixelpipe_cache_available(pipe,
+                                      dt_dev_pixelpipe_cache_hash(&rois_in[0], pipe, pos - 1),
+                                      tail_insize))
+    return FALSE;
+
+  for(int i = 0; i < num; i++)
+  {
+    run[i]->processed_roi_in = rois_in[i];
+    run[i]->processed_roi_out = rois_out[i];
+  }
+
+  void *input = NULL;
+  void *cl_mem_input = NULL;
+  dt_iop_buffer_dsc_t _input_format = { 0 };
+  dt_iop_buffer_dsc_t *input_format = &_input_format;
+  if(_dev_pixelpipe_process_rec(pipe, dev, &input, &cl_mem_input, &input_format,
+                                &rois_in[num-1],
+                                g_list_previous(head_module),
+                                g_list_previous(head_piece), run_pos[num-1] - 1))
+    return TRUE;
+
+  if(input_format->channels != 1
+     || (input_format->datatype != TYPE_UINT16 && input_format->datatype != TYPE_FLOAT))
+    return FALSE;
+
+  const gboolean uint16_input = input_format->datatype == TYPE_UINT16;
+
+  // let the modules describe their work in pipe order, this also does their side effects
+  dt_dev_raw_frontend_t fe;
+  dt_dev_raw_frontend_init(&fe);
+  dt_iop_buffer_dsc_t dsc = *input_format;
+  char names[256] = { 0 };
+  for(int i = num - 1; i >= 0; i--)
+  {
+    dt_dev_pixelpipe_iop_t *it = run[i];
+    dt_iop_module_t *mod = it->module;
+    it->dsc_out = it->dsc_in = dsc;
+    mod->output_format(mod, pipe, it, &it->dsc_out);
+    pipe->dsc = it->dsc_out;
+    mod->position = run_pos[i];
+
+    if(!mod->fuse_raw_frontend(mod, it, &fe, &rois_in[i], &rois_out[i]))
+    {
+      dt_print_pipe(DT_DEBUG_PIPE,
+                    "raw front-end declined", pipe, mod, DT_DEVICE_CPU, &rois_in[i], &rois_out[i]);
+      return FALSE;
+    }
+    dsc = it->dsc_out = pipe->dsc;
+    g_strlcat(names, mod->op, sizeof(names));
+    if(i) g_strlcat(names, "+", sizeof(names));
+  }
+
+  if(dt_pipe_shutdown(pipe))
+    return TRUE;
+
+  **out_format = pipe->dsc;
+  dt_dev_pixelpipe_cache_get(pipe, hash, bufsize, output, out_format, run[0]->module, FALSE);
+
+  if(dt_pipe_shutdown(pipe))
+    return TRUE;
+
+  dt_times_t start;
+  dt_get_perf_times(&start);
+
+  dt_print_pipe(DT_DEBUG_PIPE,
+                "raw front-end", pipe, run[0]->module, DT_DEVICE_CPU, &rois_in[num-1], roi_out,
+                "%s, %s input", names, uint16_input ? "uint16" : "float");
+
+  dt_dev_raw_frontend_process(&fe, input, (float *)*output, uint16_input, &rois_in[num-1], roi_out);
+
+  dt_show_times_f(&start, "[dev_pixelpipe]", "[%s] processed fused `%s' on CPU",
+                  dt_dev_pixelpipe_type_to_str(pipe->type), names);
+
+  **out_format = pipe->dsc;
+  *done = TRUE;
+  return dt_pipe_shutdown(pipe);
+}
+
+/* A run of adjacent pointwise pieces ending with the current one is processed strip by
+   strip, only the output of the last piece is written to the cache.
+   The run starts after the last piece with a cached output, a piece with gui focus
+   starts a new run so it's input stays available while the user edits it.
+
+   Returns TRUE in case of unfinished work or error like _dev_pixelpipe_process_rec(),
+   *done tells if the pieces have been processed or the pipe has to process them one by one.
+*/
+static gboolean _process_pointwise(dt_dev_pixelpipe_t *pipe,
+                                   dt_develop_t *dev,
+                                   void **output,
+                                   dt_iop_buffer_dsc_t **out_format,
+                                   const dt_iop_roi_t *roi_out,
+                                   GList *modules,
+                                   GList *pieces,
+                                   const int pos,
+                                   const dt_hash_t hash,
+                                   const size_t bufsize,
+                                   gboolean *done)
+{
+  *done = FALSE;
+  if(pipe->mask_display != DT_DEV_PIXELPIPE_DISPLAY_NONE
+     || darktable.dump_pfm_pipe
+     || !_pointwise_piece(pieces->data))
+    return FALSE;
+
+#ifdef HAVE_OPENCL
+  // the modules are processed on the GPU
+  if(_opencl_pipe_isok(pipe))
+    return FALSE;
+#endif
+
+  const gboolean basic = pipe->type & DT_DEV_PIXELPIPE_BASIC;
+  const dt_iop_module_t *gui_module = dt_dev_gui_module();
+  const size_t insize = sizeof(float) * 4 * roi_out->width * roi_out->height;
+
+  // collect the run of pieces, tail first
+  dt_dev_pixelpipe_iop_t *run[DT_POINTWISE_MAX];
+  int run_pos[DT_POINTWISE_MAX];
+  GList *head_module = NULL;
+  GList *head_piece = NULL;
+  int num = 0;
+  int k = pos;
+  for(GList *m = modules, *p = pieces; m && num < DT_POINTWISE_MAX;
+      m = g_list_previous(m), p = g_list_previous(p), k--)
+  {
+    dt_dev_pixelpipe_iop_t *it = p->data;
+    if(_skip_piece_on_tags(it)) continue;
+    if(!_pointwise_piece(it)) break;
+
+    // all pieces of the run must work on the same roi and colorspace
+    dt_iop_roi_t roi_in = *roi_out;
+    it->module->modify_roi_in(it->module, it, roi_out, &roi_in);
+    if(memcmp(&roi_in, roi_out, sizeof(dt_iop_roi_t))
+       || (num && run[num-1]->module->input_colorspace(run[num-1]->module, pipe, run[num-1])
+                  != it->module->output_colorspace(it->module, pipe, it)))
+      break;
+
+    run[num] = it;
+    run_pos[num] = k;
+    head_module = m;
+    head_piece = p;
+    num++;
+
+    if(dt_dev_pixelpipe_cache_available(pipe, dt_dev_pixelpipe_cache_hash(roi_out, pipe, k - 1), insize)
+       || (basic && it->module == gui_module))
+      break;
+  }
+  if(num < 2) return FALSE;
+
+  for(int i = 0; i < num; i++)
+  {
+    run[i]->processed_roi_in = *roi_out;
+    run[i]->processed_roi_out = *roi_out;
+  }
+
+  void *input = NULL;
+  void *cl_mem_input = NULL;
+  dt_iop_buffer_dsc_t _input_format = { 0 };
+  dt_iop_buffer_dsc_t *input_format = &_input_format;
+  if(_dev_pixelpipe_process_rec(pipe, dev, &input, &cl_mem_input, &input_format, roi_out,
+                                g_list_previous(head_module),
+                                g_list_previous(head_piece), run_pos[num-1] - 1))
+    return TRUE;
+
+  if(input_format->channels != 4 || input_format->datatype != TYPE_FLOAT)
+    return FALSE;
+
+  // prepare the pieces in pipe order, this also does their side effects
+  dt_iop_buffer_dsc_t dsc = *input_format;
+  dt_dev_pixelpipe_iop_t *order[DT_POINTWISE_MAX];
+  char names[256] = { 0 };
+  for(int i = num - 1; i >= 0; i--)
+  {
+    dt_dev_pixelpipe_iop_t *it = run[i];
+    dt_iop_module_t *mod = it->module;
+    it->dsc_out = it->dsc_in = dsc;
+    mod->output_format(mod, pipe, it, &it->dsc_out);
+    pipe->dsc = it->dsc_out;
+    mod->position = run_pos[i];
+
+    if(it->dsc_out.channels != 4
+       || it->dsc_out.datatype != TYPE_FLOAT
+       || (mod->fuse_pointwise && !mod->fuse_pointwise(mod, it, roi_out)))
+    {
+      dt_print_pipe(DT_DEBUG_PIPE,
+                    "pointwise declined", pipe, mod, DT_DEVICE_CPU, roi_out, roi_out);
+      return FALSE;
+    }
+    pipe->dsc.cst = mod->output_colorspace(mod, pipe, it);
+    dsc = it->dsc_out = pipe->dsc;
+    order[num - 1 - i] = it;
+    g_strlcat(names, mod->op, sizeof(names));
+    if(i) g_strlcat(names, "+", sizeof(names));
+  }
+
+  if(dt_pipe_shutdown(pipe))
+    return TRUE;
+
+  // transform to the input colorspace of the first module
+  dt_iop_module_t *head = run[num-1]->module;
+  const int cst_to = head->input_colorspace(head, pipe, run[num-1]);
+  if(input_format->cst != cst_to)
+  {
+    const dt_iop_order_iccprofile_info_t *const work_profile =
+      dt_ioppr_get_pipe_work_profile_info(pipe);
+    dt_print_pipe(DT_DEBUG_PIPE,
+                  "transform colorspace",
+                  pipe, head, DT_DEVICE_CPU, roi_out, NULL, "%s -> %s",
+                  dt_iop_colorspace_to_name(input_format->cst),
+                  dt_iop_colorspace_to_name(cst_to));
+    dt_ioppr_transform_image_colorspace(head, input, input,
+                                        roi_out->width, roi_out->height,
+                                        input_format->cst, cst_to, &input_format->cst,
+                                        work_profile);
+  }
+
+  **out_format = pipe->dsc;
+  dt_dev_pixelpipe_cache_get(pipe, hash, bufsize, output, out_format, run[0]->module, FALSE);
+
+  if(dt_pipe_shutdown(pipe))
+    return TRUE;
+
+  dt_times_t start;
+  dt_get_perf_times(&start);
+
+  dt_print_pipe(DT_DEBUG_PIPE,
+                "pointwise", pipe, run[0]->module, DT_DEVICE_CPU, roi_out, roi_out,
+                "%s", names);
+
+  dt_dev_pointwise_process(order, num, input, *output,
+                           (size_t)roi_out->width * roi_out->height);
+
+  dt_show_times_f(&start, "[dev_pixelpipe]", "[%s] processed fused `%s' on CPU",
+                  dt_dev_pixelpipe_type_to_str(pipe->type), names);
+
+  **out_format = pipe->dsc;
+  *done = TRUE;
+  return dt_pipe_shutdown(pipe);
+}
+
+/* If the pipe composes warps, a run of adjacent distorting pieces ending with the current
+   one is resampled once with the chained coordinate mappings of all pieces. Only the
+   output of the last piece is written to the cache. As for pointwise runs a cached input
+   or the gui focus ends the run.
+
+   Returns TRUE in case of unfinished work or error like _dev_pixelpipe_process_rec(),
+   *done tells if the pieces have been processed or the pipe has to process them one by one.
+*/
+static gboolean _process_warp(dt_dev_pixelpipe_t *pipe,
+                              dt_develop_t *dev,
+                              void **output,
+                              dt_iop_buffer_dsc_t **out_format,
+                              const dt_iop_roi_t *roi_out,
+                              GList *modules,
+                              GList *pieces,
+                              const int pos,
+                              const dt_hash_t hash,
+                              const size_t bufsize,
+                              gboolean *done)
+{
+  *done = FALSE;
+  if(!pipe->compose_warps
+     || pipe->mask_display != DT_DEV_PIXELPIPE_DISPLAY_NONE
+     || darktable.dump_pfm_pipe
+     || !_warp_piece(pieces->data))
+    return FALSE;
+
+#ifdef HAVE_OPENCL
+  // the modules are processed on the GPU
+  if(_opencl_pipe_isok(pipe))
+    return FALSE;
+#endif
+
+  const gboolean basic = pipe->type & DT_DEV_PIXELPIPE_BASIC;
+  const dt_iop_module_t *gui_module = dt_dev_gui_module();
+
+  // collect the run of pieces and their mappings, tail first
+  dt_dev_pixelpipe_iop_t *run[DT_WARP_MAX];
+  int run_pos[DT_WARP_MAX];
+  dt_iop_roi_t rois_in[DT_WARP_MAX];
+  dt_iop_roi_t rois_out[DT_WARP_MAX];
+  dt_dev_warp_step_t steps[DT_WARP_MAX];
+  GList *head_module = NULL;
+  GList *head_piece = NULL;
+  int num = 0;
+  int k = pos;
+  for(GList *m = modules, *p = pieces; m && num < DT_WARP_MAX;
+      m = g_list_previous(m), p = g_list_previous(p), k--)
+  {
+    dt_dev_pixelpipe_iop_t *it = p->data;
+    if(_skip_piece_on_tags(it)) continue;
+    if(!_warp_piece(it)) break;
+
+    // all pieces of the run must keep the same colorspace
+    const int cst = it->module->input_colorspace(it->module, pipe, it);
+    if(cst != it->module->output_colorspace(it->module, pipe, it)
+       || (num && cst != run[0]->module->input_colorspace(run[0]->module, pipe, run[0])))
+      break;
+
+    rois_out[num] = num ? rois_in[num-1] : *roi_out;
+    rois_in[num] = rois_out[num];
+    it->module->modify_roi_in(it->module, it, &rois_out[num], &rois_in[num]);
+    if(!it->module->fuse_warp(it->module, it, &rois_in[num], &rois_out[num], &steps[num]))
+      break;
+
+    run[num] = it;
+    run_pos[num] = k;
+    head_module = m;
+    head_piece = p;
+    num++;
+
+    const size_t insize = sizeof(float) * 4 * rois_in[num-1].width * rois_in[num-1].height;
+    if(dt_dev_pixelpipe_cache_available(pipe,
+                                        dt_dev_pixelpipe_cache_hash(&rois_in[num-1], pipe, k - 1),
+                                        insize)
+       || (basic && it->module == gui_module))
+      break;
+  }
+  if(num < 2)
+  {
+    dt_dev_warp_cleanup(steps, num);
+    return FALSE;
+  }
+
+  for(int i = 0; i < num; i++)
+  {
+    run[i]->processed_roi_in = rois_in[i];
+    run[i]->processed_roi_out = rois_out[i];
+  }
+
+  void *input = NULL;
+  void *cl_mem_input = NULL;
+  dt_iop_buffer_dsc_t _input_format = { 0 };
+  dt_iop_buffer_dsc_t *input_format = &_input_format;
+  if(_dev_pixelpipe_process_rec(pipe, dev, &input, &cl_mem_input, &input_format,
+                                &rois_in[num-1],
+                                g_list_previous(head_module),
+                                g_list_previous(head_piece), run_pos[num-1] - 1))
+  {
+    dt_dev_warp_cleanup(steps, num);
+    return TRUE;
+  }
+
+  if(input_format->channels != 4 || input_format->datatype != TYPE_FLOAT)
+  {
+    dt_dev_warp_cleanup(steps, num);
+    return FALSE;
+  }
+
+  // the output format of the pieces in pipe order
+  dt_iop_buffer_dsc_t dsc = *input_format;
+  char names[256] = { 0 };
+  for(int i = num - 1; i >= 0; i--)
+  {
+    dt_dev_pixelpipe_iop_t *it = run[i];
+    dt_iop_module_t *mod = it->module;
+    it->dsc_out = it->dsc_in = dsc;
+    mod->output_format(mod, pipe, it, &it->dsc_out);
+    pipe->dsc = it->dsc_out;
+    mod->position = run_pos[i];
+    pipe->dsc.cst = mod->output_colorspace(mod, pipe, it);
+    dsc = it->dsc_out = pipe->dsc;
+    g_strlcat(names, mod->op, sizeof(names));
+    if(i) g_strlcat(names, "+", sizeof(names));
+  }
+
+  if(dt_pipe_shutdown(pipe))
+  {
+    dt_dev_warp_cleanup(steps, num);
+    return TRUE;
+  }
+
+  // transform to the colorspace of the run
+  dt_iop_module_t *head = run[num-1]->module;
+  const int cst_to = head->input_colorspace(head, pipe, run[num-1]);
+  if(input_format->cst != cst_to)
+  {
+    const dt_iop_order_iccprofile_info_t *const work_profile =
+      dt_ioppr_get_pipe_work_profile_info(pipe);
+    dt_print_pipe(DT_DEBUG_PIPE,
+                  "transform colorspace",
+                  pipe, head, DT_DEVICE_CPU, &rois_in[num-1], NULL, "%s -> %s",
+                  dt_iop_colorspace_to_name(input_format->cst),
+                  dt_iop_colorspace_to_name(cst_to));
+    dt_ioppr_transform_image_colorspace(head, input, input,
+                                        rois_in[num-1].width, rois_in[num-1].height,
+                                        input_format->cst, cst_to, &input_format->cst,
+                                        work_profile);
+  }
+
+  **out_format = pipe->dsc;
+  dt_dev_pixelpipe_cache_get(pipe, hash, bufsize, output, out_format, run[0]->module, FALSE);
+
+  if(dt_pipe_shutdown(pipe))
+  {
+    dt_dev_warp_cleanup(steps, num);
+    return TRUE;
+  }
+
+  dt_times_t start;
+  dt_get_perf_times(&start);
+
+  dt_print_pipe(DT_DEBUG_PIPE,
+                "composed warp", pipe, run[0]->module, DT_DEVICE_CPU, &rois_in[num-1], roi_out,
+                "%s", names);
+
+  const dt_interpolation_t *itor = dt_interpolation_new(DT_INTERPOLATION_USERPREF_WARP);
+  dt_dev_warp_process(steps, num, itor, input, *output, &rois_in[num-1], roi_out);
+  dt_dev_warp_cleanup(steps, num);
+
+  dt_show_times_f(&start, "[dev_pixelpipe]", "[%s] processed composed `%s' on CPU",
+                  dt_dev_pixelpipe_type_to_str(pipe->type), names);
+
+  **out_format = pipe->dsc;
+  *done = TRUE;
+  return dt_pipe_shutdown(pipe);
+}
+
 // recursive helper for process, returns TRUE in case of unfinished work or error
 static gboolean _dev_pixelpipe_process_rec(dt_dev_pixelpipe_t *pipe,
                                            dt_develop_t *dev,
@@ -1765,6 +2294,28 @@ static gboolean _dev_pixelpipe_process_rec(dt_dev_pixelpipe_t *pipe,
   if(dt_pipe_shutdown(pipe))
     return TRUE;
 
+  // the leading raw modules might be processed in one pass
+  gboolean fused = FALSE;
+  if(_process_raw_frontend(pipe, dev, output, out_format, roi_out,
+                           modules, pieces, pos, hash, bufsize, &fused))
+    return TRUE;
+  if(fused)
+    return FALSE;
+
+  // as well as runs of pointwise modules
+  if(_process_pointwise(pipe, dev, output, out_format, roi_out,
+                        modules, pieces, pos, hash, bufsize, &fused))
+    return TRUE;
+  if(fused)
+    return FALSE;
+
+  // and runs of distorting modules if the pipe composes them
+  if(_process_warp(pipe, dev, output, out_format, roi_out,
+                   modules, pieces, pos, hash, bufsize, &fused))
+    return TRUE;
+  if(fused)
+    return FALSE;
+
   module->modify_roi_in(module, piece, roi_out, &roi_in);
   if((darktable.unmuted & DT_DEBUG_PIPE) && memcmp(roi_out, &roi_in, sizeof(dt_iop_roi_t)))
   {
@@ -25,6 +25,7 @@
 #include "develop/develop.h"
 #include "develop/imageop.h"
 #include "develop/pixelpipe_cache.h"
+#include "develop/pixelpipe_fuse.h"
 #include "imageio/imageio_common.h"
 
 G_BEGIN_DECLS
@@ -56,6 +57,8 @@ typedef struct dt_dev_pixelpipe_iop_t
   dt_iop_roi_t processed_roi_out;
   gboolean process_cl_ready;      // set this to FALSE in commit_params to temporarily disable the use of process_cl
   gboolean process_tiling_ready;  // set this to FALSE in commit_params to temporarily disable tiling
+  gboolean raw_frontend_ready;    // set this to TRUE in commit_params if fuse_raw_frontend() can be used
+  gboolean pointwise_ready;       // set this to TRUE in commit_params if process_pointwise() can be used
 
   // the following are used internally for caching:
   dt_iop_buffer_dsc_t dsc_in;
@@ -178,6 +181,8 @@ typedef struct dt_dev_pixelpipe_t
   dt_dev_pixelpipe_display_mask_t mask_display;
   // should this pixelpipe completely suppressed the blendif module?
   gboolean bypass_blendif;
+  // resample runs of distorting modules only once?
+  gboolean compose_warps;
   // input data based on this timestamp:
   int input_timestamp;
   uint32_t average_delay;
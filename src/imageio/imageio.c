@@ -83,6 +83,7 @@
 #endif
 
 #include <assert.h>
+#include <fcntl.h>
 #include <glib/gstdio.h>
 #include <inttypes.h>
 #include <math.h>
@@ -90,6 +91,9 @@
 #include <stdlib.h>
 #include <string.h>
 #include <strings.h>
+#ifndef _WIN32
+#include <unistd.h>
+#endif
 
 #ifdef USE_LUA
 #include "lua/image.h"
@@ -857,6 +861,28 @@ gboolean dt_imageio_has_mono_preview(const char *filename)
   return mono;
 }
 
+void dt_imageio_readahead(const dt_imgid_t imgid)
+{
+#if defined(POSIX_FADV_WILLNEED)
+  if(!dt_is_valid_imgid(imgid)) return;
+
+  char filename[PATH_MAX] = { 0 };
+  gboolean from_cache = TRUE;
+  dt_image_full_path(imgid, filename, sizeof(filename), &from_cache);
+  if(!*filename) return;
+
+  const int fd = g_open(filename, O_RDONLY, 0);
+  if(fd < 0) return;
+
+  // this only schedules the read, the kernel fills the page cache in the
+  // background while the current image is still being processed.
+  (void)posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+  close(fd);
+
+  dt_print(DT_DEBUG_IMAGEIO, "[dt_imageio_readahead] `%s'", filename);
+#endif
+}
+
 void dt_imageio_flip_buffers(char *out,
                              const char *in,
                              const size_t bpp,
@@ -62,6 +62,8 @@ gboolean dt_imageio_is_raw_by_extension(const char *extension);
 gboolean dt_imageio_is_ldr(const char *filename);
 // checks that the image has a monochrome preview attached
 gboolean dt_imageio_has_mono_preview(const char *filename);
+// Hint the OS to start reading the image file into the page cache
+void dt_imageio_readahead(const dt_imgid_t imgid);
 // Set the darktable/mode/hdr tag
 void dt_imageio_set_hdr_tag(dt_image_t *img);
 // Update the tag for b&w workflow
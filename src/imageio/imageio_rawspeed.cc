@@ -41,8 +41,22 @@
 #include "develop/imageop.h"
 #include "imageio/imageio_common.h"
 #include "imageio/imageio_rawspeed.h"
+#include <limits>
+#include <tuple>
 #include <stdint.h>
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <sys/vfs.h>
+#elif defined(__APPLE__)
+#include <sys/mount.h>
+#endif
+#endif
+
 // define this function, it is only declared in rawspeed:
 int rawspeed_get_number_of_processor_cores()
 {
@@ -126,6 +140,100 @@ uint32_t dt_rawspeed_crop_dcraw_filters(const uint32_t filters,
     return ColorFilterArray::shiftDcrawFilter(filters, crop_x, crop_y);
 }
 
+// read-only mapping of the raw file. decoding straight from the page cache
+// avoids copying the whole file into a heap buffer first. the mapping is
+// released when going out of scope, also when rawspeed throws.
+struct dt_rawspeed_mmap_t
+{
+  void *addr = nullptr;
+  size_t size = 0;
+
+  void unmap()
+  {
+#ifndef _WIN32
+    if(addr) munmap(addr, size);
+#endif
+    addr = nullptr;
+    size = 0;
+  }
+
+  ~dt_rawspeed_mmap_t() { unmap(); }
+};
+
+#ifndef _WIN32
+// pages of a mapping on a network share are faulted in with small
+// synchronous requests and a file changed on the server side can raise
+// SIGBUS while decoding, so we keep the plain read for those.
+static gboolean _is_network_fs(const int fd)
+{
+#if defined(__linux__)
+  struct statfs sfs;
+  if(fstatfs(fd, &sfs) != 0) return TRUE;
+  switch((unsigned long)sfs.f_type)
+  {
+    case 0x6969UL:     // NFS
+    case 0x517bUL:     // SMB
+    case 0xff534d42UL: // CIFS
+    case 0xfe534d42UL: // SMB2
+    case 0x65735546UL: // FUSE (sshfs, gvfs, ...)
+    case 0x5346414fUL: // AFS
+    case 0x73757245UL: // CODA
+    case 0x564c:       // NCP
+      return TRUE;
+    default:
+      return FALSE;
+  }
+#elif defined(__APPLE__)
+  struct statfs sfs;
+  if(fstatfs(fd, &sfs) != 0) return TRUE;
+  return (sfs.f_flags & MNT_LOCAL) ? FALSE : TRUE;
+#else
+  return FALSE;
+#endif
+}
+#endif
+
+static gboolean _rawspeed_map_file(const char *filename,
+                                   dt_rawspeed_mmap_t *map)
+{
+#ifdef _WIN32
+  return FALSE;
+#else
+  const int fd = open(filename, O_RDONLY);
+  if(fd < 0) return FALSE;
+
+  struct stat st;
+  if(fstat(fd, &st) != 0
+     || st.st_size <= 0
+     || (uint64_t)st.st_size > std::numeric_limits<Buffer::size_type>::max()
+     || _is_network_fs(fd))
+  {
+    close(fd);
+    return FALSE;
+  }
+
+  // like the plain read the caller holds darktable.readFile_mutex, fault
+  // the pages in right away so concurrent loads don't compete for the disk.
+#ifdef MAP_POPULATE
+  const int flags = MAP_PRIVATE | MAP_POPULATE;
+#else
+  const int flags = MAP_PRIVATE;
+#endif
+  void *addr = mmap(NULL, st.st_size, PROT_READ, flags, fd, 0);
+  close(fd);
+  if(addr == MAP_FAILED) return FALSE;
+
+  // the decoders mostly walk the file front to back, let the kernel
+  // read ahead aggressively and start fetching everything right now.
+  madvise(addr, st.st_size, MADV_SEQUENTIAL);
+  madvise(addr, st.st_size, MADV_WILLNEED);
+
+  map->addr = addr;
+  map->size = st.st_size;
+  return TRUE;
+#endif
+}
+
 // CR3 files are for now handled by LibRaw, we do not want RawSpeed to try to open them
 // as this issues a lot of error messages on the console.
 
@@ -186,8 +294,21 @@ dt_imageio_retval_t dt_imageio_open_rawspeed(dt_image_t *img,
   {
     dt_rawspeed_load_meta();
 
+    dt_rawspeed_mmap_t map;
+    decltype(f.readFile().first) storage;
+    Buffer storageBuf;
+
     dt_pthread_mutex_lock(&darktable.readFile_mutex);
-    auto [storage, storageBuf] = f.readFile();
+    if(_rawspeed_map_file(filen, &map))
+    {
+      dt_print(DT_DEBUG_IMAGEIO, "[rawspeed_open] mapped `%s'", filen);
+      storageBuf = Buffer(static_cast<const uint8_t *>(map.addr),
+                          static_cast<Buffer::size_type>(map.size));
+    }
+    else
+    {
+      std::tie(storage, storageBuf) = f.readFile();
+    }
     dt_pthread_mutex_unlock(&darktable.readFile_mutex);
 
     RawParser t(storageBuf);
@@ -252,6 +373,7 @@ dt_imageio_retval_t dt_imageio_open_rawspeed(dt_image_t *img,
     /* free auto pointers on spot */
     d.reset();
     storage.reset();
+    map.unmap();
 
     // Grab the WB
     if(r->metadata.wbCoeffs) {
@@ -43,6 +43,8 @@ DAMAGE.
 
 #include <iostream>
 
+#include "common/atomic.h"
+
 /*******************************************************************
  * Hash table implementation for permutohedral lattice             *
  *                                                                 *
@@ -216,6 +218,14 @@ public:
   // Struct for an associated value
   typedef HashTablePermutohedralValue<VD> Value;
 
+  // Struct for the hash table entries.  The hash is kept next to the key
+  // index so that probing only touches the keys array on a likely match.
+  struct Entry
+  {
+    int keyIdx{ -1 };
+    unsigned hash{ 0 };
+  };
+
 public:
   /* Constructor
    *  kd_: the dimensionality of the position vectors on the hyperplane.
@@ -290,11 +300,12 @@ public:
         // need to create an entry. Store the given key.
         keys[filled] = key;
         entries[h].keyIdx = filled;
+        entries[h].hash = key.hash;
         return filled++;
       }
 
       // check if the cell has a matching key
-      if(keys[e.keyIdx] == key) return e.keyIdx;
+      if(e.hash == key.hash && keys[e.keyIdx] == key) return e.keyIdx;
 
       // increment the bucket with wraparound
       h = (h + 1) & capacity_bits;
@@ -376,7 +387,7 @@ public:
     for(size_t i = 0; i < oldCapacity; i++)
     {
       if(entries[i].keyIdx == -1) continue;
-      size_t h = keys[entries[i].keyIdx].hash & capacity_bits;
+      size_t h = entries[i].hash & capacity_bits;
       while(newEntries[h].keyIdx != -1)
       {
         h = (h + 1) & capacity_bits;
@@ -388,13 +399,35 @@ public:
     total_alloc = capacity * sizeof(Entry) + maxFill() * sizeof(Key) + maxFill() * sizeof(Value);
   }
 
-private:
-  // Private struct for the hash table entries.
-  struct Entry
+  /* Replace the contents of the hash table by the given arrays, which
+   * the table takes ownership of.  'num_capacity' must be a power of two
+   * and 'num_entries' the number of keys and values.
+   */
+  void adopt(Entry *newEntries, Key *newKeys, Value *newValues, size_t num_capacity, size_t num_entries)
   {
-    int keyIdx{ -1 };
-  };
+    release();
+    entries = newEntries;
+    keys = newKeys;
+    values = newValues;
+    capacity = num_capacity;
+    capacity_bits = num_capacity - 1;
+    filled = alloc_entries = num_entries;
+    total_alloc = capacity * sizeof(Entry) + filled * (sizeof(Key) + sizeof(Value));
+  }
 
+  /* Free all storage, leaving an empty table */
+  void release()
+  {
+    delete[] entries;
+    delete[] keys;
+    delete[] values;
+    entries = nullptr;
+    keys = nullptr;
+    values = nullptr;
+    filled = alloc_entries = 0;
+  }
+
+private:
   Key *keys;
   Value *values;
   Entry *entries;
@@ -420,6 +453,7 @@ private:
   typedef HashTablePermutohedral<D, VD> HashTable;
   typedef typename HashTable::Key Key;
   typedef typename HashTable::Value Value;
+  typedef typename HashTable::Entry Entry;
 
 public:
   /* Constructor
@@ -512,9 +546,11 @@ public:
      size_t round_up = 1;
      while (round_up < 2*hash_entries) round_up <<= 1;
      // we need to store not only the Key, Value, and Entry arrays, we
-     // also need an additional copy of the Value array while blurring
-     // and storage for the remapping array while merging
-     size_t mergesize = hash_entries * 2 * (sizeof(Value)+sizeof(Key)) + round_up * sizeof(int);
+     // also need an additional copy of the Value array while blurring,
+     // and while merging a copy of all keys, the merged table and the
+     // index arrays used to build it
+     size_t mergesize = hash_entries * (2 * (sizeof(Value)+sizeof(Key)) + sizeof(Key) + 2 * sizeof(int))
+       + round_up * (sizeof(Entry) + sizeof(int));
      size_t blursize = hash_entries * (2*sizeof(Value)+sizeof(Key)) + (hash_entries+round_up) * sizeof(int);
      return MAX(mergesize, blursize);
   }
@@ -628,67 +664,149 @@ public:
     }
   }
 
-  /* Merge the multiple threads' hash tables into the totals. */
+  /* Merge the multiple threads' hash tables into the totals.
+   *
+   * All keys are first inserted concurrently into a fresh open-addressing
+   * index, keeping the lowest (table, entry) number for every distinct key.
+   * The surviving keys are then compacted in that order, and the values of
+   * duplicates are added to their survivor in increasing table order, which
+   * gives the same sums as merging the tables one after the other.
+   */
   void merge_splat_threads()
   {
     if(nThreads <= 1) return;
 
-    /* Because growing the hash table is expensive, we want to avoid having to do it multiple times.
-     * Only a small percentage of entries in the individual hash tables have the same key, so we
-     * won't waste much space if we simply grow the destination table enough to hold the sum of the
-     * entries in the individual tables
-     */
-    size_t alloc_entries = hashTables[0].maxFill();
+    // global numbering of all entries of all tables
+    size_t *base = new size_t[nThreads + 1];
+    size_t alloc_entries = 0;
     size_t total_bytes = 0;
-    size_t total_grows = hashTables[0].auto_grow;
-    size_t init_bytes = hashTables[0].init_alloc;
-    size_t total_entries = hashTables[0].size();
-    for(size_t i = 1; i < nThreads; i++)
+    size_t total_grows = 0;
+    size_t init_bytes = 0;
+    base[0] = 0;
+    for(size_t i = 0; i < nThreads; i++)
+    {
+      base[i + 1] = base[i] + hashTables[i].size();
+      alloc_entries += hashTables[i].maxFill();
+      init_bytes += hashTables[i].init_alloc;
+      total_bytes += hashTables[i].total_alloc;
+      total_grows += hashTables[i].auto_grow;
+    }
+    const size_t total_entries = base[nThreads];
+
+    Key *allKeys = new Key[total_entries];
+    for(size_t i = 0; i < nThreads; i++)
+      std::copy(hashTables[i].getKeys(), hashTables[i].getKeys() + hashTables[i].size(), allKeys + base[i]);
+
+    size_t capacity = 1 << 15;
+    while(capacity < 2 * total_entries) capacity <<= 1;
+    const size_t capacity_bits = capacity - 1;
+    dt_atomic_int *slots = new dt_atomic_int[capacity];
+    int *slot_of = new int[total_entries];
+
+    DT_OMP_FOR(if(capacity >= 100000))
+    for(size_t h = 0; h < capacity; h++)
+      dt_atomic_set_int(&slots[h], -1);
+
+    DT_OMP_FOR()
+    for(size_t g = 0; g < total_entries; g++)
+    {
+      const Key &key = allKeys[g];
+      size_t h = key.hash & capacity_bits;
+      while(1)
+      {
+        int cur = dt_atomic_get_int(&slots[h]);
+        if(cur == -1)
+        {
+          if(dt_atomic_CAS_int(&slots[h], &cur, (int)g)) break;
+          // someone else claimed the slot in the meantime, look at it again
+          continue;
+        }
+        if(allKeys[cur] == key)
+        {
+          // same key: make sure the lowest index survives
+          while((int)g < cur && !dt_atomic_CAS_int(&slots[h], &cur, (int)g))
+            ;
+          break;
+        }
+        h = (h + 1) & capacity_bits;
+      }
+      slot_of[g] = h;
+    }
+
+    // number the surviving keys densely, in order
+    int *newIdx = new int[total_entries];
+    size_t unique = 0;
+    for(size_t g = 0; g < total_entries; g++)
+      newIdx[g] = (dt_atomic_get_int(&slots[slot_of[g]]) == (int)g) ? (int)unique++ : -1;
+
+    Key *newKeys = new Key[unique];
+    Value *newValues = new Value[unique];
+    Entry *newEntries = new Entry[capacity];
+
+    DT_OMP_FOR(if(capacity >= 100000))
+    for(size_t h = 0; h < capacity; h++)
+    {
+      const int g = dt_atomic_get_int(&slots[h]);
+      if(g < 0) continue;
+      newEntries[h].keyIdx = newIdx[g];
+      newEntries[h].hash = allKeys[g].hash;
+    }
+
+    for(size_t i = 0; i < nThreads; i++)
     {
-       alloc_entries += hashTables[i].maxFill();
-       total_entries += hashTables[i].size();
-       init_bytes += hashTables[i].init_alloc;
-       total_bytes += hashTables[i].total_alloc;
-       total_grows += hashTables[i].auto_grow;
-    }
-    hashTables[0].growExact(total_entries);
-    total_bytes += hashTables[0].total_alloc;
-    /* Merge the multiple hash tables into one, creating an offset remap table. */
-    int **offset_remap = new int *[nThreads];
-    size_t remap_bytes = 0;
+      const Value *oldVals = hashTables[i].getValues();
+      DT_OMP_FOR(if(hashTables[i].size() >= 100000))
+      for(size_t j = 0; j < hashTables[i].size(); j++)
+      {
+        const int n = newIdx[base[i] + j];
+        if(n < 0) continue;
+        newKeys[n] = allKeys[base[i] + j];
+        newValues[n] = oldVals[j];
+      }
+    }
+    // duplicates are rare, add them in sequentially to keep the summation order fixed
     for(size_t i = 1; i < nThreads; i++)
     {
-      const Key *oldKeys = hashTables[i].getKeys();
       const Value *oldVals = hashTables[i].getValues();
-      const size_t filled = hashTables[i].size();
-      offset_remap[i] = new int[filled];
-      remap_bytes += filled * sizeof(int);
-      for(size_t j = 0; j < filled; j++)
+      for(size_t j = 0; j < hashTables[i].size(); j++)
       {
-        Value *val = hashTables[0].lookup(oldKeys[j], true);
-        val->add(oldVals[j]);
-        offset_remap[i][j] = val - hashTables[0].getValues();
+        const size_t g = base[i] + j;
+        if(newIdx[g] < 0)
+          newValues[newIdx[dt_atomic_get_int(&slots[slot_of[g]])]].add(oldVals[j]);
       }
     }
-    dt_print(DT_DEBUG_MEMORY,
-      "[permutohedral] hash tables %lu bytes (%lu initially), %lu entries, [permutohedral] tables grew %lu times, "
-      "replay using %lu bytes for %lu pixels, [permutohedral] fill factor %f%%, remap using %lu bytes",
-      total_bytes, init_bytes, total_entries, total_grows,
-      (sizeof(ReplayEntry)*nData), nData, (float)100.0f * total_entries / alloc_entries, remap_bytes);
 
-    /* Rewrite the offsets in the replay structure from the above generated table. */
+    /* Rewrite the offsets in the replay structure to point into the merged table. */
     DT_OMP_FOR(if(nData >= 100000))
     for(size_t i = 0; i < nData; i++)
     {
-      if(replay[i].table > 0)
+      const size_t b = base[replay[i].table];
+      for(int dim = 0; dim <= D; dim++)
       {
-        for(int dim = 0; dim <= D; dim++)
-          replay[i].offset[dim] = offset_remap[replay[i].table][replay[i].offset[dim]];
+        const size_t g = b + replay[i].offset[dim];
+        replay[i].offset[dim] = newIdx[dt_atomic_get_int(&slots[slot_of[g]])];
       }
+      replay[i].table = 0;
     }
 
-    for(size_t i = 1; i < nThreads; i++) delete[] offset_remap[i];
-    delete[] offset_remap;
+    // the per-thread tables are no longer needed
+    for(size_t i = 1; i < nThreads; i++)
+      hashTables[i].release();
+    hashTables[0].adopt(newEntries, newKeys, newValues, capacity, unique);
+
+    dt_print(DT_DEBUG_MEMORY,
+      "[permutohedral] hash tables %lu bytes (%lu initially), %lu entries (%lu unique), "
+      "[permutohedral] tables grew %lu times, replay using %lu bytes for %lu pixels, "
+      "[permutohedral] fill factor %f%%, merge using %lu bytes",
+      total_bytes, init_bytes, total_entries, unique, total_grows,
+      (sizeof(ReplayEntry)*nData), nData, (float)100.0f * total_entries / alloc_entries,
+      total_entries * (sizeof(Key) + 2 * sizeof(int)) + capacity * sizeof(dt_atomic_int));
+
+    delete[] newIdx;
+    delete[] slot_of;
+    delete[] slots;
+    delete[] allKeys;
+    delete[] base;
   }
 
   /* Performs slicing out of position vectors. Note that the barycentric weights and the simplex
@@ -404,6 +404,13 @@ typedef struct dt_iop_ashift_gui_data_t
   dt_hash_t lines_hash;
   dt_hash_t grid_hash;
   dt_hash_t buf_hash;
+  dt_iop_ashift_line_t *lsd_lines;  // detected lines before outlier removal, reused for
+  int lsd_lines_count;              // a new structure request on the same buffer
+  int lsd_vertical_count;
+  int lsd_horizontal_count;
+  float lsd_vertical_weight;
+  float lsd_horizontal_weight;
+  dt_hash_t lsd_hash;               // buffer, roi and enhancement of the cached lines
   dt_iop_ashift_fitaxis_t lastfit;
   float lastx;
   float lasty;
@@ -1678,6 +1685,7 @@ static int _get_structure(dt_iop_module_t *self,
   int x_off = 0;
   int y_off = 0;
   float scale = 0.0f;
+  dt_hash_t lsd_hash = DT_INVALID_HASH;
 
   dt_iop_gui_enter_critical_section(self);
   // read buffer data if they are available
@@ -1689,14 +1697,28 @@ static int _get_structure(dt_iop_module_t *self,
     y_off = g->buf_y_off;
     scale = g->buf_scale;
 
+    // the detected lines only depend on the buffer contents, its roi
+    // and the enhancement
+    if(g->buf_hash != DT_INVALID_HASH)
+    {
+      const int roi[4] = { width, height, x_off, y_off };
+      lsd_hash = dt_hash(g->buf_hash, roi, sizeof(roi));
+      lsd_hash = dt_hash(lsd_hash, &scale, sizeof(scale));
+      lsd_hash = dt_hash(lsd_hash, &enhance, sizeof(enhance));
+    }
+
     // create a temporary buffer to hold image data
-    buffer = dt_alloc_align_float((size_t)4 * width * height);
-    if(buffer != NULL)
-      dt_iop_image_copy_by_size(buffer, g->buf, width, height, 4);
+    if(lsd_hash == DT_INVALID_HASH || lsd_hash != g->lsd_hash)
+    {
+      buffer = dt_alloc_align_float((size_t)4 * width * height);
+      if(buffer != NULL)
+        dt_iop_image_copy_by_size(buffer, g->buf, width, height, 4);
+    }
   }
   dt_iop_gui_leave_critical_section(self);
 
-  if(buffer == NULL) goto error;
+  const gboolean cached = lsd_hash != DT_INVALID_HASH && lsd_hash == g->lsd_hash;
+  if(buffer == NULL && !cached) goto error;
 
   // get rid of old structural data
   g->lines_count = 0;
@@ -1712,11 +1734,41 @@ static int _get_structure(dt_iop_module_t *self,
   float vertical_weight;
   float horizontal_weight;
 
-  // get new structural data
-  if(!line_detect(buffer, width, height, x_off, y_off, scale, &lines, &lines_count,
-                  &vertical_count, &horizontal_count, &vertical_weight, &horizontal_weight,
-                  enhance, dt_image_is_raw(&self->dev->image_storage)))
-    goto error;
+  if(cached)
+  {
+    // same buffer and enhancement as before, skip the line detection
+    lines = malloc(sizeof(dt_iop_ashift_line_t) * g->lsd_lines_count);
+    if(lines == NULL) goto error;
+    memcpy(lines, g->lsd_lines, sizeof(dt_iop_ashift_line_t) * g->lsd_lines_count);
+    lines_count = g->lsd_lines_count;
+    vertical_count = g->lsd_vertical_count;
+    horizontal_count = g->lsd_horizontal_count;
+    vertical_weight = g->lsd_vertical_weight;
+    horizontal_weight = g->lsd_horizontal_weight;
+  }
+  else
+  {
+    // get new structural data
+    if(!line_detect(buffer, width, height, x_off, y_off, scale, &lines, &lines_count,
+                    &vertical_count, &horizontal_count, &vertical_weight, &horizontal_weight,
+                    enhance, dt_image_is_raw(&self->dev->image_storage)))
+      goto error;
+
+    // keep a copy, outlier removal and line selection change the line types
+    free(g->lsd_lines);
+    g->lsd_lines = malloc(sizeof(dt_iop_ashift_line_t) * lines_count);
+    g->lsd_hash = DT_INVALID_HASH;
+    if(g->lsd_lines && lsd_hash != DT_INVALID_HASH)
+    {
+      memcpy(g->lsd_lines, lines, sizeof(dt_iop_ashift_line_t) * lines_count);
+      g->lsd_lines_count = lines_count;
+      g->lsd_vertical_count = vertical_count;
+      g->lsd_horizontal_count = horizontal_count;
+      g->lsd_vertical_weight = vertical_weight;
+      g->lsd_horizontal_weight = horizontal_weight;
+      g->lsd_hash = lsd_hash;
+    }
+  }
 
   // save new structural data
   g->lines_in_width = width;
@@ -2376,9 +2428,10 @@ static dt_iop_ashift_nmsresult_t nmsfit(dt_iop_module_t *self,
     return NMS_NOT_ENOUGH_LINES;
   }
 
-  // start the simplex fit
+  // start the simplex fit, model_fitness() visits all lines and is worth
+  // evaluating the candidates in parallel
   const int iter = simplex(model_fitness, params, fit.params_count,
-                           NMS_EPSILON, NMS_SCALE, NMS_ITERATIONS, NULL, (void*)&fit);
+                           NMS_EPSILON, NMS_SCALE, NMS_ITERATIONS, NULL, (void*)&fit, TRUE);
 
   // error case: the fit did not converge
   if(iter >= NMS_ITERATIONS)
@@ -2745,7 +2798,7 @@ static void do_crop(const dt_iop_module_t *self, dt_iop_ashift_params_t *p)
   // start the simplex fit
   const int iter = simplex(crop_fitness, params, pcount,
                            NMS_CROP_EPSILON, NMS_CROP_SCALE, NMS_CROP_ITERATIONS,
-                           crop_constraint, (void*)&cropfit);
+                           crop_constraint, (void*)&cropfit, FALSE);
   // in case the fit did not converge -> failed
   if(iter >= NMS_CROP_ITERATIONS) goto failed;
 
@@ -3433,6 +3486,87 @@ static void do_fit(dt_iop_module_t *self,
   --darktable.gui->reset;
 }
 
+typedef struct _ashift_warp_t
+{
+  float DT_ALIGNED_ARRAY ihomograph[3][3];
+  float cx, cy;
+  dt_iop_roi_t roi_in;
+  dt_iop_roi_t roi_out;
+} _ashift_warp_t;
+
+// output to input buffer coordinates for dt_interpolation_warp()
+static void _ashift_warp_map(const void *data,
+                             const float x,
+                             const float y,
+                             float *xin,
+                             float *yin)
+{
+  const _ashift_warp_t *w = data;
+  float pin[3], pout[3];
+
+  // convert output pixel coordinates to original image coordinates
+  pout[0] = w->roi_out.x + x + w->cx;
+  pout[1] = w->roi_out.y + y + w->cy;
+  pout[0] /= w->roi_out.scale;
+  pout[1] /= w->roi_out.scale;
+  pout[2] = 1.0f;
+
+  // apply homograph
+  mat3mulv(pin, (float *)w->ihomograph, pout);
+
+  // convert to input pixel coordinates
+  pin[0] /= pin[2];
+  pin[1] /= pin[2];
+  pin[0] *= w->roi_in.scale;
+  pin[1] *= w->roi_in.scale;
+  *xin = pin[0] - w->roi_in.x;
+  *yin = pin[1] - w->roi_in.y;
+}
+
+static void _ashift_warp_init(const dt_dev_pixelpipe_iop_t *piece,
+                              const dt_iop_roi_t *const roi_in,
+                              const dt_iop_roi_t *const roi_out,
+                              _ashift_warp_t *w)
+{
+  const dt_iop_ashift_data_t *data = piece->data;
+
+  w->roi_in = *roi_in;
+  w->roi_out = *roi_out;
+  _homography((float *)w->ihomograph, data->rotation, data->lensshift_v, data->lensshift_h,
+              data->shear, data->f_length_kb,
+              data->orthocorr, data->aspect,
+              piece->buf_in.width, piece->buf_in.height, ASHIFT_HOMOGRAPH_INVERTED);
+
+  // clipping offset
+  const float fullwidth = (float)piece->buf_out.width / (data->cr - data->cl);
+  const float fullheight = (float)piece->buf_out.height / (data->cb - data->ct);
+  w->cx = roi_out->scale * fullwidth * data->cl;
+  w->cy = roi_out->scale * fullheight * data->ct;
+}
+
+gboolean fuse_warp(dt_iop_module_t *self,
+                   dt_dev_pixelpipe_iop_t *piece,
+                   const dt_iop_roi_t *const roi_in,
+                   const dt_iop_roi_t *const roi_out,
+                   dt_dev_warp_step_t *step)
+{
+  // process() collects the preview input for the gui
+  if(self->gui_data && self->dev->gui_attached && (piece->pipe->type & DT_DEV_PIXELPIPE_PREVIEW))
+    return FALSE;
+
+  if(_isneutral(piece->data))
+  {
+    dt_dev_warp_set_translation(step, 0.0f, 0.0f);
+    return TRUE;
+  }
+
+  _ashift_warp_t *w = dt_alloc1_align_type(_ashift_warp_t);
+  _ashift_warp_init(piece, roi_in, roi_out, w);
+  step->map = _ashift_warp_map;
+  step->data = w;
+  return TRUE;
+}
+
 void process(dt_iop_module_t *self,
              dt_dev_pixelpipe_iop_t *piece,
              const void *const ivoid,
@@ -3444,7 +3578,6 @@ void process(dt_iop_module_t *self,
   dt_iop_ashift_gui_data_t *g = self->gui_data;
 
   const int ch = piece->colors;
-  const int ch_width = ch * roi_in->width;
 
   // only for preview pipe: collect input buffer data and do some other evaluations
   if(g && self->dev->gui_attached && (piece->pipe->type & DT_DEV_PIXELPIPE_PREVIEW))
@@ -3520,51 +3653,11 @@ void process(dt_iop_module_t *self,
 
   const dt_interpolation_t *interpolation = dt_interpolation_new(DT_INTERPOLATION_USERPREF_WARP);
 
-  float DT_ALIGNED_ARRAY ihomograph[3][3];
-  _homography((float *)ihomograph, data->rotation, data->lensshift_v, data->lensshift_h,
-              data->shear, data->f_length_kb,
-              data->orthocorr, data->aspect,
-              piece->buf_in.width, piece->buf_in.height, ASHIFT_HOMOGRAPH_INVERTED);
-
-  // clipping offset
-  const float fullwidth = (float)piece->buf_out.width / (data->cr - data->cl);
-  const float fullheight = (float)piece->buf_out.height / (data->cb - data->ct);
-  const float cx = roi_out->scale * fullwidth * data->cl;
-  const float cy = roi_out->scale * fullheight * data->ct;
-
-  DT_OMP_FOR(shared(ihomograph))
-  // go over all pixels of output image
-  for(int j = 0; j < roi_out->height; j++)
-  {
-    float *const restrict out = ((float *)ovoid) + (size_t)ch * j * roi_out->width;
-    for(int i = 0; i < roi_out->width; i++)
-    {
-      float pin[3], pout[3];
-
-      // convert output pixel coordinates to original image coordinates
-      pout[0] = roi_out->x + i + cx;
-      pout[1] = roi_out->y + j + cy;
-      pout[0] /= roi_out->scale;
-      pout[1] /= roi_out->scale;
-      pout[2] = 1.0f;
+  _ashift_warp_t w;
+  _ashift_warp_init(piece, roi_in, roi_out, &w);
 
-      // apply homograph
-      mat3mulv(pin, (float *)ihomograph, pout);
-
-      // convert to input pixel coordinates
-      pin[0] /= pin[2];
-      pin[1] /= pin[2];
-      pin[0] *= roi_in->scale;
-      pin[1] *= roi_in->scale;
-      pin[0] -= roi_in->x;
-      pin[1] -= roi_in->y;
-
-      // get output values by interpolation from input image
-      dt_interpolation_compute_pixel4c(interpolation, (float *)ivoid, out + ch*i,
-                                       pin[0], pin[1], roi_in->width,
-                                       roi_in->height, ch_width);
-    }
-  }
+  dt_interpolation_warp(interpolation, (float *)ovoid, roi_out, (const float *)ivoid, roi_in,
+                        _ashift_warp_map, &w, DT_INTERPOLATION_WARP_PRECISION);
 }
 
 #ifdef HAVE_OPENCL
@@ -5732,6 +5825,10 @@ void reload_defaults(dt_iop_module_t *self)
     g->vertical_count = 0;
     g->grid_hash = DT_INVALID_HASH;
     g->lines_hash = DT_INVALID_HASH;
+    free(g->lsd_lines);
+    g->lsd_lines = NULL;
+    g->lsd_lines_count = 0;
+    g->lsd_hash = DT_INVALID_HASH;
     g->rotation_range = ROTATION_RANGE_SOFT;
     g->lensshift_v_range = LENSSHIFT_RANGE_SOFT;
     g->lensshift_h_range = LENSSHIFT_RANGE_SOFT;
@@ -5941,6 +6038,9 @@ void gui_init(dt_iop_module_t *self)
   g->points_version = 0;
   g->grid_hash = DT_INVALID_HASH;
   g->lines_hash = DT_INVALID_HASH;
+  g->lsd_lines = NULL;
+  g->lsd_lines_count = 0;
+  g->lsd_hash = DT_INVALID_HASH;
   g->rotation_range = ROTATION_RANGE_SOFT;
   g->lensshift_v_range = LENSSHIFT_RANGE_SOFT;
   g->lensshift_h_range = LENSSHIFT_RANGE_SOFT;
@@ -6157,6 +6257,7 @@ void gui_cleanup(dt_iop_module_t *self)
 
   const dt_iop_ashift_gui_data_t *g = self->gui_data;
   if(g->lines) free(g->lines);
+  free(g->lsd_lines);
   dt_free_align(g->buf);
   if(g->points) free(g->points);
   if(g->points_idx) free(g->points_idx);
@@ -25,6 +25,11 @@
  *      catch (unlikely) division by zero near line 2035
  *      rename rad1 and rad2 to radius1 and radius2 in reduce_region_radius()
  *        to avoid naming conflict in windows build
+ *      parallelize the gaussian sampler and the gradient computation, the
+ *        results are identical to the serial code. The region growing stays
+ *        serial as it depends on the order of processing.
+ *      remove free_ntuple_list(), the kernels of the gaussian sampler are
+ *        on the stack now
  *
  */
 
@@ -273,17 +278,6 @@ typedef struct ntuple_list_s
   double * values;
 } * ntuple_list;
 
-/*----------------------------------------------------------------------------*/
-/** Free memory used in n-tuple 'in'.
- */
-static void free_ntuple_list(const ntuple_list in)
-{
-  if( in == NULL || in->values == NULL )
-    error("free_ntuple_list: invalid n-tuple input.");
-  free( (void *) in->values );
-  free( (void *) in );
-}
-
 /*----------------------------------------------------------------------------*/
 /** Create an n-tuple list and allocate memory for one element.
     @param dim the dimension (n) of the n-tuple.
@@ -642,10 +636,9 @@ static image_double gaussian_sampler(const image_double in, const double scale,
                                       const double sigma_scale )
 {
   image_double aux,out;
-  ntuple_list kernel;
-  unsigned int N,M,h,n,x,y,i;
-  int xc,yc,j,double_x_size,double_y_size;
-  double sigma,xx,yy,sum,prec;
+  unsigned int N,M,h,n;
+  int double_x_size,double_y_size;
+  double sigma,prec;
 
   /* check parameters */
   if( in == NULL || in->data == NULL || in->xsize == 0 || in->ysize == 0 )
@@ -676,82 +669,89 @@ static image_double gaussian_sampler(const image_double in, const double scale,
   prec = 3.0;
   h = (unsigned int) ceil( sigma * sqrt( 2.0 * prec * log(10.0) ) );
   n = 1+2*h; /* kernel size */
-  kernel = new_ntuple_list(n);
 
   /* auxiliary double image size variables */
   double_x_size = (int) (2 * in->xsize);
   double_y_size = (int) (2 * in->ysize);
 
-  /* First subsampling: x axis */
-  for(x=0;x<aux->xsize;x++)
+  /* First subsampling: x axis, the columns are independent */
+  DT_OMP_FOR()
+  for(unsigned int x=0;x<aux->xsize;x++)
     {
+      /* every column needs its own kernel when running in parallel */
+      double values[n];
+      struct ntuple_list_s col_kernel = { 0, 1, n, values };
+
       /*
          x   is the coordinate in the new image.
          xx  is the corresponding x-value in the original size image.
          xc  is the integer value, the pixel coordinate of xx.
        */
-      xx = (double) x / scale;
+      const double xx = (double) x / scale;
       /* coordinate (0.0,0.0) is in the center of pixel (0,0),
          so the pixel with xc=0 get the values of xx from -0.5 to 0.5 */
-      xc = (int) floor( xx + 0.5 );
-      gaussian_kernel( kernel, sigma, (double) h + xx - (double) xc );
+      const int xc = (int) floor( xx + 0.5 );
+      gaussian_kernel( &col_kernel, sigma, (double) h + xx - (double) xc );
       /* the kernel must be computed for each x because the fine
          offset xx-xc is different in each case */
 
-      for(y=0;y<aux->ysize;y++)
+      for(unsigned int y=0;y<aux->ysize;y++)
         {
-          sum = 0.0;
-          for(i=0;i<kernel->dim;i++)
+          double sum = 0.0;
+          for(unsigned int i=0;i<col_kernel.dim;i++)
             {
-              j = xc - h + i;
+              int j = xc - h + i;
 
               /* symmetry boundary condition */
               while( j < 0 ) j += double_x_size;
               while( j >= double_x_size ) j -= double_x_size;
               if( j >= (int) in->xsize ) j = double_x_size-1-j;
 
-              sum += in->data[ j + y * in->xsize ] * kernel->values[i];
+              sum += in->data[ j + y * in->xsize ] * col_kernel.values[i];
             }
           aux->data[ x + y * aux->xsize ] = sum;
         }
     }
 
-  /* Second subsampling: y axis */
-  for(y=0;y<out->ysize;y++)
+  /* Second subsampling: y axis, the rows are independent */
+  DT_OMP_FOR()
+  for(unsigned int y=0;y<out->ysize;y++)
     {
+      double values[n];
+      struct ntuple_list_s row_kernel = { 0, 1, n, values };
+
       /*
          y   is the coordinate in the new image.
          yy  is the corresponding x-value in the original size image.
          yc  is the integer value, the pixel coordinate of xx.
        */
-      yy = (double) y / scale;
+      const double yy = (double) y / scale;
       /* coordinate (0.0,0.0) is in the center of pixel (0,0),
          so the pixel with yc=0 get the values of yy from -0.5 to 0.5 */
-      yc = (int) floor( yy + 0.5 );
-      gaussian_kernel( kernel, sigma, (double) h + yy - (double) yc );
+      const int yc = (int) floor( yy + 0.5 );
+      gaussian_kernel( &row_kernel, sigma, (double) h + yy - (double) yc );
       /* the kernel must be computed for each y because the fine
          offset yy-yc is different in each case */
 
-      for(x=0;x<out->xsize;x++)
+      for(unsigned int x=0;x<out->xsize;x++)
         {
-          sum = 0.0;
-          for(i=0;i<kernel->dim;i++)
+          double sum = 0.0;
+          for(unsigned int i=0;i<row_kernel.dim;i++)
             {
-              j = yc - h + i;
+              int j = yc - h + i;
 
               /* symmetry boundary condition */
               while( j < 0 ) j += double_y_size;
               while( j >= double_y_size ) j -= double_y_size;
               if( j >= (int) in->ysize ) j = double_y_size-1-j;
 
-              sum += aux->data[ x + j * aux->xsize ] * kernel->values[i];
+              sum += aux->data[ x + j * aux->xsize ] * row_kernel.values[i];
             }
           out->data[ x + y * out->xsize ] = sum;
         }
     }
 
   /* free memory */
-  free_ntuple_list(kernel);
   free_image_double(aux);
 
   return out;
@@ -784,8 +784,8 @@ static image_double ll_angle(const image_double in, const double threshold,
                               image_double * modgrad, const unsigned int n_bins )
 {
   image_double g;
-  unsigned int n,p,x,y,adr,i;
-  double com1,com2,gx,gy,norm,norm2;
+  unsigned int n,p,x,y,i;
+  double norm;
   /* the rest of the variables are used for pseudo-ordering
      the gradient magnitude values */
   int list_count = 0;
@@ -835,11 +835,12 @@ static image_double ll_angle(const image_double in, const double threshold,
   for(x=0;x<p;x++) g->data[(n-1)*p+x] = NOTDEF;
   for(y=0;y<n;y++) g->data[p*y+p-1]   = NOTDEF;
 
-  /* compute gradient on the remaining pixels */
-  for(x=0;x<p-1;x++)
-    for(y=0;y<n-1;y++)
+  /* compute gradient on the remaining pixels, row by row in parallel */
+  DT_OMP_FOR(reduction(max:max_grad))
+  for(unsigned int row=0;row<n-1;row++)
+    for(unsigned int col=0;col<p-1;col++)
       {
-        adr = y*p+x;
+        const unsigned int adr = row*p+col;
 
         /*
            Norm 2 computation using 2x2 pixel window:
@@ -852,17 +853,17 @@ static image_double ll_angle(const image_double in, const double threshold,
              gy = C+D - (A+B)   vertical difference
            com1 and com2 are just to avoid 2 additions.
          */
-        com1 = in->data[adr+p+1] - in->data[adr];
-        com2 = in->data[adr+1]   - in->data[adr+p];
+        const double com1 = in->data[adr+p+1] - in->data[adr];
+        const double com2 = in->data[adr+1]   - in->data[adr+p];
 
-        gx = com1+com2; /* gradient x component */
-        gy = com1-com2; /* gradient y component */
-        norm2 = gx*gx+gy*gy;
-        norm = sqrt( norm2 / 4.0 ); /* gradient norm */
+        const double gx = com1+com2; /* gradient x component */
+        const double gy = com1-com2; /* gradient y component */
+        const double norm2 = gx*gx+gy*gy;
+        const double grad = sqrt( norm2 / 4.0 ); /* gradient norm */
 
-        (*modgrad)->data[adr] = norm; /* store gradient norm */
+        (*modgrad)->data[adr] = grad; /* store gradient norm */
 
-        if( norm <= threshold ) /* norm too small, gradient no defined */
+        if( grad <= threshold ) /* norm too small, gradient no defined */
           g->data[adr] = NOTDEF; /* gradient angle not defined */
         else
           {
@@ -870,7 +871,7 @@ static image_double ll_angle(const image_double in, const double threshold,
             g->data[adr] = atan2(gx,-gy);
 
             /* look for the maximum of the gradient */
-            if( norm > max_grad ) max_grad = norm;
+            if( grad > max_grad ) max_grad = grad;
           }
       }
 
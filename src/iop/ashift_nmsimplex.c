@@ -28,6 +28,10 @@
  *      initialize i and j to avoid compiler warnings
  *      comment out printing of status inormation
  *      reformat according to darktable's clang standards
+ *      optionally evaluate independent vertices in parallel: the initial
+ *        simplex, the shrunk vertices and, speculatively, all candidates of
+ *        an iteration (reflection, expansion, outside and inside contraction).
+ *        The result is identical to the serial evaluation.
  */
 
 /*==================================================================================
@@ -77,8 +81,20 @@
 
 //#include "nmsimplex.h"
 
+/* evaluate objfunc for num vertices, objfunc must not have side effects
+   if done in parallel */
+static void simplex_eval(double (*objfunc)(double[], void *params), double **x, double *fx, const int num,
+                         void *params, const gboolean parallel)
+{
+  DT_OMP_FOR(num_threads(num) if(parallel))
+  for(int k = 0; k < num; k++)
+  {
+    fx[k] = objfunc(x[k], params);
+  }
+}
+
 static int simplex(double (*objfunc)(double[], void *params), double start[], int n, double EPSILON, double scale,
-                   int maxiter, void (*constrain)(double[], int n), void *params)
+                   int maxiter, void (*constrain)(double[], int n), void *params, const gboolean parallel)
 {
 
   int vs; /* vertex with smallest value */
@@ -98,6 +114,9 @@ static int simplex(double (*objfunc)(double[], void *params), double start[], in
   double *ve;    /* expansion - coordinates */
   double *vc;    /* contraction - coordinates */
   double *vm;    /* centroid - coordinates */
+  double *vco;   /* speculative outside contraction - coordinates */
+  double *vci;   /* speculative inside contraction - coordinates */
+  double fcand[4] = { 0.0, 0.0, 0.0, 0.0 }; /* speculative values at reflection, expansion and contraction points */
   //double min;
 
   double fsum, favg, s, cent;
@@ -111,6 +130,8 @@ static int simplex(double (*objfunc)(double[], void *params), double start[], in
   ve = (double *)malloc(sizeof(double) * n);
   vc = (double *)malloc(sizeof(double) * n);
   vm = (double *)malloc(sizeof(double) * n);
+  vco = (double *)malloc(sizeof(double) * n);
+  vci = (double *)malloc(sizeof(double) * n);
 
   /* allocate the columns of the arrays */
   for(i = 0; i <= n; i++)
@@ -149,10 +170,7 @@ static int simplex(double (*objfunc)(double[], void *params), double start[], in
     constrain(v[j], n);
   }
   /* find the initial function values */
-  for(j = 0; j <= n; j++)
-  {
-    f[j] = objfunc(v[j], params);
-  }
+  simplex_eval(objfunc, v, f, n + 1, params, parallel);
 
 #if 0
   /* print out the initial values */
@@ -223,7 +241,27 @@ static int simplex(double (*objfunc)(double[], void *params), double start[], in
     {
       constrain(vr, n);
     }
-    fr = objfunc(vr, params);
+
+    if(parallel)
+    {
+      /* all candidates only depend on the centroid and the reflected vertex,
+         evaluate them at once and take the needed values below */
+      for(j = 0; j <= n - 1; j++)
+      {
+        ve[j] = vm[j] + NMS_GAMMA * (vr[j] - vm[j]);
+        vco[j] = vm[j] + NMS_BETA * (vr[j] - vm[j]);
+        vci[j] = vm[j] - NMS_BETA * (vm[j] - v[vg][j]);
+      }
+      if(constrain != NULL)
+      {
+        constrain(ve, n);
+        constrain(vco, n);
+        constrain(vci, n);
+      }
+      double *cand[4] = { vr, ve, vco, vci };
+      simplex_eval(objfunc, cand, fcand, 4, params, TRUE);
+    }
+    fr = parallel ? fcand[0] : objfunc(vr, params);
 
     if(fr < f[vh] && fr >= f[vs])
     {
@@ -246,7 +284,7 @@ static int simplex(double (*objfunc)(double[], void *params), double start[], in
       {
         constrain(ve, n);
       }
-      fe = objfunc(ve, params);
+      fe = parallel ? fcand[1] : objfunc(ve, params);
 
       /* by making fe < fr as opposed to fe < f[vs],
          Rosenbrocks function takes 63 iterations as opposed
@@ -285,7 +323,7 @@ static int simplex(double (*objfunc)(double[], void *params), double start[], in
         {
           constrain(vc, n);
         }
-        fc = objfunc(vc, params);
+        fc = parallel ? fcand[2] : objfunc(vc, params);
       }
       else
       {
@@ -299,7 +337,7 @@ static int simplex(double (*objfunc)(double[], void *params), double start[], in
         {
           constrain(vc, n);
         }
-        fc = objfunc(vc, params);
+        fc = parallel ? fcand[3] : objfunc(vc, params);
       }
 
 
@@ -331,13 +369,13 @@ static int simplex(double (*objfunc)(double[], void *params), double start[], in
         if(constrain != NULL)
         {
           constrain(v[vg], n);
-        }
-        f[vg] = objfunc(v[vg], params);
-        if(constrain != NULL)
-        {
           constrain(v[vh], n);
         }
-        f[vh] = objfunc(v[vh], params);
+        double *shrunk[2] = { v[vg], v[vh] };
+        double fshrunk[2];
+        simplex_eval(objfunc, shrunk, fshrunk, 2, params, parallel);
+        f[vg] = fshrunk[0];
+        f[vh] = fshrunk[1];
       }
     }
 #if 0
@@ -400,6 +438,8 @@ static int simplex(double (*objfunc)(double[], void *params), double start[], in
   free(ve);
   free(vc);
   free(vm);
+  free(vco);
+  free(vci);
   for(i = 0; i <= n; i++)
   {
     free(v[i]);
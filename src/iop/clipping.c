@@ -992,6 +992,110 @@ void modify_roi_in(dt_iop_module_t *self, dt_dev_pixelpipe_iop_t *piece,
   roi_in->height = CLAMP(roi_in->height, 1, (int)ceilf(scheight) - roi_in->y);
 }
 
+typedef struct _clipping_warp_t
+{
+  const dt_iop_clipping_data_t *d;
+  dt_iop_roi_t roi_in;
+  dt_iop_roi_t roi_out;
+  dt_boundingbox_t k_space;
+  float kxa, kya;
+  float ma, mb, md, me, mg, mh;
+} _clipping_warp_t;
+
+// output to input buffer coordinates for dt_interpolation_warp()
+static void _clipping_warp_map(const void *data,
+                               const float x,
+                               const float y,
+                               float *xin,
+                               float *yin)
+{
+  const _clipping_warp_t *w = data;
+  const dt_iop_clipping_data_t *d = w->d;
+  const dt_iop_roi_t *roi_in = &w->roi_in;
+  const dt_iop_roi_t *roi_out = &w->roi_out;
+  float pi[2], po[2];
+
+  pi[0] = roi_out->x - roi_out->scale * d->enlarge_x + roi_out->scale * d->cix + x + 0.5f;
+  pi[1] = roi_out->y - roi_out->scale * d->enlarge_y + roi_out->scale * d->ciy + y + 0.5f;
+
+  // transform this point using matrix m
+  if(d->flip)
+  {
+    pi[1] -= d->tx * roi_out->scale;
+    pi[0] -= d->ty * roi_out->scale;
+  }
+  else
+  {
+    pi[0] -= d->tx * roi_out->scale;
+    pi[1] -= d->ty * roi_out->scale;
+  }
+  pi[0] /= roi_out->scale;
+  pi[1] /= roi_out->scale;
+  backtransform(pi, po, d->m, d->k_h, d->k_v);
+  po[0] *= roi_in->scale;
+  po[1] *= roi_in->scale;
+  po[0] += d->tx * roi_in->scale;
+  po[1] += d->ty * roi_in->scale;
+  if(d->k_apply == 1)
+    keystone_backtransform(po, w->k_space, w->ma, w->mb, w->md, w->me, w->mg, w->mh, w->kxa, w->kya);
+  *xin = po[0] - (roi_in->x + 0.5f);
+  *yin = po[1] - (roi_in->y + 0.5f);
+}
+
+static void _clipping_warp_init(const dt_dev_pixelpipe_iop_t *piece,
+                                const dt_iop_roi_t *const roi_in,
+                                const dt_iop_roi_t *const roi_out,
+                                _clipping_warp_t *w)
+{
+  const dt_iop_clipping_data_t *d = piece->data;
+  const float rx = piece->buf_in.width * roi_in->scale;
+  const float ry = piece->buf_in.height * roi_in->scale;
+
+  w->d = d;
+  w->roi_in = *roi_in;
+  w->roi_out = *roi_out;
+  w->k_space[0] = d->k_space[0] * rx;
+  w->k_space[1] = d->k_space[1] * ry;
+  w->k_space[2] = d->k_space[2] * rx;
+  w->k_space[3] = d->k_space[3] * ry;
+  w->kxa = d->kxa * rx;
+  w->kya = d->kya * ry;
+  if(d->k_apply == 1)
+    keystone_get_matrix(w->k_space, w->kxa, d->kxb * rx, d->kxc * rx, d->kxd * rx,
+                        w->kya, d->kyb * ry, d->kyc * ry, d->kyd * ry,
+                        &w->ma, &w->mb, &w->md, &w->me, &w->mg, &w->mh);
+}
+
+// only crop, no rotation or keystone
+static inline gboolean _clipping_crop_only(const dt_iop_clipping_data_t *d,
+                                           const dt_iop_roi_t *const roi_in,
+                                           const dt_iop_roi_t *const roi_out)
+{
+  return !d->flags && d->angle == 0.0 && d->all_off && roi_in->width == roi_out->width
+         && roi_in->height == roi_out->height;
+}
+
+gboolean fuse_warp(dt_iop_module_t *self,
+                   dt_dev_pixelpipe_iop_t *piece,
+                   const dt_iop_roi_t *const roi_in,
+                   const dt_iop_roi_t *const roi_out,
+                   dt_dev_warp_step_t *step)
+{
+  if(piece->colors != 4) return FALSE;
+
+  if(_clipping_crop_only(piece->data, roi_in, roi_out))
+  {
+    dt_dev_warp_set_translation(step, 0.0f, 0.0f);
+    return TRUE;
+  }
+
+  _clipping_warp_t *w = dt_alloc1_align_type(_clipping_warp_t);
+  _clipping_warp_init(piece, roi_in, roi_out, w);
+  step->map = _clipping_warp_map;
+  step->data = w;
+  return TRUE;
+}
+
 // 3rd (final) pass: you get this input region (may be different from what was requested above),
 // do your best to fill the output region!
 void process(dt_iop_module_t *self, dt_dev_pixelpipe_iop_t *piece, const void *const ivoid,
@@ -1004,66 +1108,20 @@ void process(dt_iop_module_t *self, dt_dev_pixelpipe_iop_t *piece, const void *c
   const dt_iop_clipping_data_t *d = piece->data;
 
   const int ch = 4;
-  const int ch_width = ch * roi_in->width;
 
   // only crop, no rot fast and sharp path:
-  if(!d->flags && d->angle == 0.0 && d->all_off && roi_in->width == roi_out->width
-     && roi_in->height == roi_out->height)
+  if(_clipping_crop_only(d, roi_in, roi_out))
   {
     dt_iop_image_copy_by_size(ovoid, ivoid, roi_out->width, roi_out->height, ch);
   }
   else
   {
     const dt_interpolation_t *interpolation = dt_interpolation_new(DT_INTERPOLATION_USERPREF_WARP);
-    const float rx = piece->buf_in.width * roi_in->scale;
-    const float ry = piece->buf_in.height * roi_in->scale;
-    const dt_boundingbox_t k_space =
-      { d->k_space[0] * rx, d->k_space[1] * ry, d->k_space[2] * rx, d->k_space[3] * ry };
-    const float kxa = d->kxa * rx, kxb = d->kxb * rx, kxc = d->kxc * rx, kxd = d->kxd * rx;
-    const float kya = d->kya * ry, kyb = d->kyb * ry, kyc = d->kyc * ry, kyd = d->kyd * ry;
-    float ma, mb, md, me, mg, mh;
-    if(d->k_apply == 1)
-      keystone_get_matrix(k_space, kxa, kxb, kxc, kxd, kya, kyb, kyc, kyd, &ma, &mb, &md, &me, &mg, &mh);
-
-    DT_OMP_FOR(dt_omp_sharedconst(k_space))
-    // (slow) point-by-point transformation.
-    // TODO: optimize with scanlines and linear steps between?
-    for(int j = 0; j < roi_out->height; j++)
-    {
-      float *out = ((float *)ovoid) + (size_t)ch * j * roi_out->width;
-      for(int i = 0; i < roi_out->width; i++)
-      {
-        float pi[2], po[2];
-
-        pi[0] = roi_out->x - roi_out->scale * d->enlarge_x + roi_out->scale * d->cix + i + 0.5f;
-        pi[1] = roi_out->y - roi_out->scale * d->enlarge_y + roi_out->scale * d->ciy + j + 0.5f;
-
-        // transform this point using matrix m
-        if(d->flip)
-        {
-          pi[1] -= d->tx * roi_out->scale;
-          pi[0] -= d->ty * roi_out->scale;
-        }
-        else
-        {
-          pi[0] -= d->tx * roi_out->scale;
-          pi[1] -= d->ty * roi_out->scale;
-        }
-        pi[0] /= roi_out->scale;
-        pi[1] /= roi_out->scale;
-        backtransform(pi, po, d->m, d->k_h, d->k_v);
-        po[0] *= roi_in->scale;
-        po[1] *= roi_in->scale;
-        po[0] += d->tx * roi_in->scale;
-        po[1] += d->ty * roi_in->scale;
-        if(d->k_apply == 1) keystone_backtransform(po, k_space, ma, mb, md, me, mg, mh, kxa, kya);
-        po[0] -= roi_in->x + 0.5f;
-        po[1] -= roi_in->y + 0.5f;
+    _clipping_warp_t w;
+    _clipping_warp_init(piece, roi_in, roi_out, &w);
 
-        dt_interpolation_compute_pixel4c(interpolation, (float *)ivoid, out + ch*i, po[0], po[1], roi_in->width,
-                                         roi_in->height, ch_width);
-      }
-    }
+    dt_interpolation_warp(interpolation, (float *)ovoid, roi_out, (const float *)ivoid, roi_in,
+                          _clipping_warp_map, &w, DT_INTERPOLATION_WARP_PRECISION);
   }
 }
 
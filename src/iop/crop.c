@@ -578,6 +578,20 @@ void modify_roi_in(dt_iop_module_t *self,
   roi_in->y = CLAMP(roi_in->y, 0, (int)floorf(ih));
 }
 
+gboolean fuse_warp(dt_iop_module_t *self,
+                   dt_dev_pixelpipe_iop_t *piece,
+                   const dt_iop_roi_t *const roi_in,
+                   const dt_iop_roi_t *const roi_out,
+                   dt_dev_warp_step_t *step)
+{
+  // same as dt_iop_copy_image_roi() in process()
+  const gboolean same_size = roi_in->width == roi_out->width && roi_in->height == roi_out->height;
+  dt_dev_warp_set_translation(step,
+                              same_size ? 0.0f : roi_out->x - roi_in->x,
+                              same_size ? 0.0f : roi_out->y - roi_in->y);
+  return TRUE;
+}
+
 void process(dt_iop_module_t *self,
              dt_dev_pixelpipe_iop_t *piece,
              const void *const ivoid,
@@ -201,6 +201,7 @@ typedef struct dt_iop_demosaic_global_data_t
   int kernel_ppg_green;
   int kernel_ppg_redblue;
   int kernel_zoom_half_size;
+  int kernel_zoom_demosaic;
   int kernel_border_interpolate;
   int kernel_color_smoothing;
   int kernel_zoom_passthrough_monochrome;
@@ -279,23 +280,41 @@ static gboolean _get_thumb_quality(const int width, const int height)
   return (level >= min_s);
 }
 
+typedef enum dt_iop_demosaic_zoom_t
+{
+  DT_DEMOSAIC_ZOOM_FULL = 0,  // full demosaic, downscaled afterwards if needed
+  DT_DEMOSAIC_ZOOM_DOWNSCALE, // demosaic and downscale in one pass from the CFA data
+  DT_DEMOSAIC_ZOOM_APPROX     // half or third size sampling of the CFA data
+} dt_iop_demosaic_zoom_t;
+
 // can we avoid full demosaicing and use a fast interpolator instead?
-static gboolean _demosaic_full(const dt_dev_pixelpipe_iop_t *const piece,
-                               const dt_image_t *const img,
-                               const dt_iop_roi_t *const roi_out)
+static dt_iop_demosaic_zoom_t _demosaic_zoom(const dt_dev_pixelpipe_iop_t *const piece,
+                                             const dt_image_t *const img,
+                                             const dt_iop_roi_t *const roi_out)
 {
   if((img->flags & DT_IMAGE_4BAYER)   // half_size_f doesn't support 4bayer images
       || dt_image_is_mono_sraw(img)
       || piece->pipe->want_detail_mask)
-    return TRUE;
+    return DT_DEMOSAIC_ZOOM_FULL;
+
+  const dt_iop_demosaic_data_t *d = piece->data;
+  const int method = d->demosaicing_method & ~DT_DEMOSAIC_DUAL;
+  const gboolean passthru = method == DT_IOP_DEMOSAIC_PASSTHROUGH_MONOCHROME
+                         || method == DT_IOP_DEMOSAIC_PASSTHROUGH_COLOR;
+
+  const gboolean approx = roi_out->scale <= (piece->pipe->dsc.filters == 9u ? 0.667f : 0.5f);
+  // downscaled output, skip the full resolution demosaic and its buffer
+  const dt_iop_demosaic_zoom_t downscale = roi_out->scale < 1.0f && !passthru
+                                           ? DT_DEMOSAIC_ZOOM_DOWNSCALE
+                                           : DT_DEMOSAIC_ZOOM_FULL;
 
   if(piece->pipe->type & DT_DEV_PIXELPIPE_THUMBNAIL)
-    return _get_thumb_quality(roi_out->width, roi_out->height);
+    return _get_thumb_quality(roi_out->width, roi_out->height) ? downscale : DT_DEMOSAIC_ZOOM_APPROX;
 
   if(piece->pipe->type & DT_DEV_PIXELPIPE_PREVIEW)
-    return roi_out->scale > (piece->pipe->dsc.filters == 9u ? 0.667f : 0.5f);
+    return approx ? DT_DEMOSAIC_ZOOM_APPROX : downscale;
 
-  return TRUE;
+  return DT_DEMOSAIC_ZOOM_FULL;
 }
 
 // Implemented in demosaicing/amaze.cc
@@ -665,7 +684,7 @@ void process(dt_iop_module_t *self,
   const dt_iop_demosaic_gui_data_t *g = self->gui_data;
   const uint32_t filters = dt_rawspeed_crop_dcraw_filters(pipe->dsc.filters, roi_in->x, roi_in->y);
 
-  const gboolean fullscale = _demosaic_full(piece, img, roi_out);
+  const dt_iop_demosaic_zoom_t zoom = _demosaic_zoom(piece, img, roi_out);
   const gboolean is_xtrans = filters == 9u;
   const gboolean is_4bayer = img->flags & DT_IMAGE_4BAYER;
   const gboolean is_bayer = !is_4bayer && !is_xtrans && filters != 0;
@@ -703,11 +722,14 @@ void process(dt_iop_module_t *self,
   }
 
   float *in = (float *)i;
-  if(!fullscale)
+  if(zoom != DT_DEMOSAIC_ZOOM_FULL)
   {
-    dt_print_pipe(DT_DEBUG_PIPE, "demosaic approx zoom", pipe, self, DT_DEVICE_CPU, roi_in, roi_out);
+    dt_print_pipe(DT_DEBUG_PIPE, zoom == DT_DEMOSAIC_ZOOM_DOWNSCALE ? "demosaic downscale" : "demosaic approx zoom",
+                  pipe, self, DT_DEVICE_CPU, roi_in, roi_out);
     if(method == DT_IOP_DEMOSAIC_PASSTHROUGH_MONOCHROME || method == DT_IOP_DEMOSAIC_PASSTHROUGH_COLOR)
       dt_iop_clip_and_zoom_demosaic_passthrough_monochrome_f((float *)o, in, roi_out, roi_in, roi_out->width, width);
+    else if(zoom == DT_DEMOSAIC_ZOOM_DOWNSCALE)
+      dt_iop_clip_and_zoom_demosaic_f((float *)o, in, roi_out, roi_in, roi_out->width, width, filters, xtrans);
     else if(is_xtrans)
       dt_iop_clip_and_zoom_demosaic_third_size_xtrans_f((float *)o, in, roi_out, roi_in, roi_out->width, width, xtrans);
     else
@@ -930,7 +952,7 @@ int process_cl(dt_iop_module_t *self,
   cl_mem dev_xtrans = NULL;
 
   const uint32_t filters = dt_rawspeed_crop_dcraw_filters(pipe->dsc.filters, roi_in->x, roi_in->y);
-  const gboolean fullscale = _demosaic_full(piece, img, roi_out);
+  const dt_iop_demosaic_zoom_t zoom = _demosaic_zoom(piece, img, roi_out);
   const gboolean is_xtrans = filters == 9u;
   const gboolean is_bayer = !is_xtrans && filters != 0 && !true_monochrome;
 
@@ -994,7 +1016,18 @@ int process_cl(dt_iop_module_t *self,
     if(!dev_xtrans) return err;
   }
 
-  if(!fullscale)
+  const gboolean passthru_mono = method == DT_IOP_DEMOSAIC_PASSTHROUGH_MONOCHROME;
+  if(zoom == DT_DEMOSAIC_ZOOM_DOWNSCALE)
+  {
+    dt_print_pipe(DT_DEBUG_PIPE, "demosaic downscale", pipe, self, devid, roi_in, roi_out);
+    err = dt_opencl_enqueue_kernel_2d_args(devid, gd->kernel_zoom_demosaic, roi_out->width, roi_out->height,
+        CLARG(dev_in), CLARG(dev_out), CLARG(roi_out->width), CLARG(roi_out->height),
+        CLARG(iwidth), CLARG(iheight), CLARG(roi_out->scale), CLARG(filters), CLARG(dev_xtrans));
+    dt_opencl_release_mem_object(dev_xtrans);
+    return err;
+  }
+
+  if(zoom != DT_DEMOSAIC_ZOOM_FULL)
   {
     dt_print_pipe(DT_DEBUG_PIPE, "demosaic approx zoom", pipe, self, devid, roi_in, roi_out);
     if(is_xtrans)
@@ -1006,7 +1039,7 @@ int process_cl(dt_iop_module_t *self,
       dt_opencl_release_mem_object(dev_xtrans);
       return err;
     }
-    else if(method == DT_IOP_DEMOSAIC_PASSTHROUGH_MONOCHROME)
+    else if(passthru_mono)
       return dt_opencl_enqueue_kernel_2d_args(devid, gd->kernel_zoom_passthrough_monochrome, roi_out->width, roi_out->height,
           CLARG(dev_in), CLARG(dev_out), CLARG(roi_out->width), CLARG(roi_out->height),
           CLARG(iwidth), CLARG(iheight), CLARG(roi_out->scale));
@@ -1242,6 +1275,7 @@ void init_global(dt_iop_module_so_t *self)
   self->data = gd;
 
   gd->kernel_zoom_half_size = dt_opencl_create_kernel(program, "clip_and_zoom_demosaic_half_size");
+  gd->kernel_zoom_demosaic = dt_opencl_create_kernel(program, "clip_and_zoom_demosaic");
   gd->kernel_ppg_green = dt_opencl_create_kernel(program, "ppg_demosaic_green");
   gd->kernel_green_eq_lavg = dt_opencl_create_kernel(program, "green_equilibration_lavg");
   gd->kernel_green_eq_favg_reduce_first = dt_opencl_create_kernel(program, "green_equilibration_favg_reduce_first");
@@ -1319,6 +1353,7 @@ void cleanup_global(dt_iop_module_so_t *self)
 {
   dt_iop_demosaic_global_data_t *gd = self->data;
   dt_opencl_free_kernel(gd->kernel_zoom_half_size);
+  dt_opencl_free_kernel(gd->kernel_zoom_demosaic);
   dt_opencl_free_kernel(gd->kernel_ppg_green);
   dt_opencl_free_kernel(gd->kernel_pre_median);
   dt_opencl_free_kernel(gd->kernel_green_eq_lavg);
@@ -92,7 +92,7 @@ typedef enum dt_iop_denoiseprofile_channel_t
 
 // this is the version of the modules parameters,
 // and includes version information about compile-time dt
-DT_MODULE_INTROSPECTION(12, dt_iop_denoiseprofile_params_t)
+DT_MODULE_INTROSPECTION(13, dt_iop_denoiseprofile_params_t)
 
 typedef struct dt_iop_denoiseprofile_params_t
 {
@@ -124,6 +124,7 @@ typedef struct dt_iop_denoiseprofile_params_t
   dt_iop_denoiseprofile_wavelet_mode_t wavelet_color_mode; /* switch between RGB and Y0U0V0 modes.
                                                               $DEFAULT: MODE_Y0U0V0 $DESCRIPTION: "color mode"*/
   gboolean compensate_hilite_pres; // $DEFAULT: TRUE $DESCRIPTION: "compensate highlight preservation"
+  gboolean fast_nlmeans; // $DEFAULT: FALSE $DESCRIPTION: "fast mode" skip dissimilar patches in non-local means
 } dt_iop_denoiseprofile_params_t;
 
 typedef struct dt_iop_denoiseprofile_gui_data_t
@@ -138,6 +139,7 @@ typedef struct dt_iop_denoiseprofile_gui_data_t
   GtkWidget *bias;
   GtkWidget *scattering;
   GtkWidget *central_pixel_weight;
+  GtkWidget *fast_nlmeans;
   GtkWidget *overshooting;
   GtkWidget *wavelet_color_mode;
   dt_noiseprofile_t interpolated; // don't use name, maker or model, they may point to garbage
@@ -190,6 +192,7 @@ typedef struct dt_iop_denoiseprofile_data_t
   gboolean fix_anscombe_and_nlmeans_norm; // backward compatibility options
   gboolean use_new_vst;                   // backward compatibility options
   dt_iop_denoiseprofile_wavelet_mode_t wavelet_color_mode; // switch between RGB and Y0U0V0 modes.
+  gboolean fast_nlmeans;                  // approximate non-local means by skipping dissimilar patches
 } dt_iop_denoiseprofile_data_t;
 
 typedef struct dt_iop_denoiseprofile_global_data_t
@@ -734,6 +737,28 @@ int legacy_params(dt_iop_module_t *self,
     gboolean compensate_hilite_pres;
   } dt_iop_denoiseprofile_params_v12_t;
 
+  typedef struct dt_iop_denoiseprofile_params_v13_t
+  {
+    float radius;
+    float nbhood;
+    float strength;
+    float shadows;
+    float bias;
+    float scattering;
+    float central_pixel_weight;
+    float overshooting;
+    float a[3], b[3];
+    dt_iop_denoiseprofile_mode_t mode;
+    float x[DT_DENOISE_PROFILE_NONE][DT_IOP_DENOISE_PROFILE_BANDS];
+    float y[DT_DENOISE_PROFILE_NONE][DT_IOP_DENOISE_PROFILE_BANDS];
+    gboolean wb_adaptive_anscombe;
+    gboolean fix_anscombe_and_nlmeans_norm;
+    gboolean use_new_vst;
+    dt_iop_denoiseprofile_wavelet_mode_t wavelet_color_mode;
+    gboolean compensate_hilite_pres;
+    gboolean fast_nlmeans;
+  } dt_iop_denoiseprofile_params_v13_t;
+
   if(old_version < 11)
   {
     *new_params = (dt_iop_denoiseprofile_params_v11_t *)
@@ -764,6 +789,21 @@ int legacy_params(dt_iop_module_t *self,
     *new_version = 12;
     return 0;
   }
+  if(old_version == 12)
+  {
+    const dt_iop_denoiseprofile_params_v12_t *o = (dt_iop_denoiseprofile_params_v12_t *)old_params;
+    dt_iop_denoiseprofile_params_v13_t *n = malloc(sizeof(dt_iop_denoiseprofile_params_v13_t));
+
+    // layout is the same except for the addition of a new field
+    memset(n, 0, sizeof(dt_iop_denoiseprofile_params_v13_t));
+    memcpy(n, o, sizeof(dt_iop_denoiseprofile_params_v12_t));
+    n->fast_nlmeans = FALSE;
+
+    *new_params = n;
+    *new_params_size = sizeof(dt_iop_denoiseprofile_params_v13_t);
+    *new_version = 13;
+    return 0;
+  }
 
   return 1;
 }
@@ -899,7 +939,7 @@ void tiling_callback(dt_iop_module_t *self,
 
     const int max_filter_radius = (1u << max_scale); // 2 * 2^max_scale
 
-    tiling->factor = 5.0f; // in + out + precond + tmp + reducebuffer
+    tiling->factor = 4.0f; // in + out + precond + tmp
     tiling->factor_cl = 3.5f + max_scale; // in + out + tmp + reducebuffer + scale buffers
     tiling->maxbuf = 1.0f;
     tiling->maxbuf_cl = 1.0f;
@@ -1431,7 +1471,7 @@ static void process_wavelets(dt_iop_module_t *self,
                              const dt_iop_roi_t *const roi_in,
                              const dt_iop_roi_t *const roi_out,
                              const eaw_dn_decompose_t decompose,
-                             const eaw_synthesize_t synthesize)
+                             const eaw_dn_synthesize_t synthesize)
 {
   // this is called for preview and full pipe separately, each with
   // its own pixelpipe piece.  get our data struct:
@@ -1473,11 +1513,10 @@ static void process_wavelets(dt_iop_module_t *self,
     return;
   }
 
-  float *buf = NULL;
   float *restrict precond = NULL;
   float *restrict tmp = NULL;
 
-  if(!dt_iop_alloc_image_buffers(self, roi_in, roi_out, 4, &precond, 4, &tmp, 4, &buf, 0, NULL))
+  if(!dt_iop_alloc_image_buffers(self, roi_in, roi_out, 4, &precond, 4, &tmp, 0, NULL))
   {
     dt_iop_copy_image_roi(out, in, piece->colors, roi_in, roi_out);
     return;
@@ -1556,34 +1595,31 @@ static void process_wavelets(dt_iop_module_t *self,
   float *restrict buf1 = precond;
   float *restrict buf2 = tmp;
 
-  // clear the output buffer, which will be accumulating all of the detail scales
-  dt_iop_image_fill(out, 0.0f, width, height, 4);
-
+  // the threshold of a scale depends on the statistics of its whole
+  // detail band, so its detail can only be shrunk and accumulated into
+  // the output once the band is complete.  Rather than storing the
+  // band, it is recovered from the previous input and coarse buffers
+  // while decomposing the next scale, which overwrites the former.
+  dt_aligned_pixel_t thrs = { 0.0f, 0.0f, 0.0f, 0.0f };
   for(int scale = 0; scale < max_scale; scale++)
   {
     const float sigma = 1.0f;
     const float varf = sqrtf(2.0f + 2.0f * 4.0f * 4.0f + 6.0f * 6.0f) / 16.0f; // about 0.5
     const float sigma_band = powf(varf, scale) * sigma;
     dt_aligned_pixel_t sum_y2;
-    decompose(buf2, buf1, buf, sum_y2,
+    decompose(buf2, buf1, out, sum_y2, scale > 0 ? thrs : NULL, scale == 1,
               scale, 1.0f / (sigma_band * sigma_band), width, height);
     debug_dump_PFM(piece, "coarse_%d", buf2, width, height, scale);
-    debug_dump_PFM(piece, "detail_%d", buf, width, height, scale);
 
-    const dt_aligned_pixel_t boost = { 1.0f, 1.0f, 1.0f, 1.0f };
-    dt_aligned_pixel_t thrs;
     variance_stabilizing_xform(thrs, scale, max_scale, npixels, sum_y2, d);
-    synthesize(out, out, buf, thrs, boost, width, height);
 
     float *buf3 = buf2;
     buf2 = buf1;
     buf1 = buf3;
   }
 
-  // add in the final residue
-  DT_OMP_SIMD(aligned(buf1, out : 64))
-  for(size_t k = 0; k < 4U * npixels; k++)
-    out[k] += buf1[k];
+  // add in the detail of the last scale and the final residue
+  synthesize(out, buf2, buf1, max_scale > 0 ? thrs : NULL, max_scale <= 1, width, height);
 
   if(!d->use_new_vst)
   {
@@ -1600,7 +1636,6 @@ static void process_wavelets(dt_iop_module_t *self,
                          p, d->b[1], d->bias - 0.5 * logf(in_scale), wb, toRGB_trans);
   }
 
-  dt_free_align(buf);
   dt_free_align(tmp);
   dt_free_align(precond);
 
@@ -1822,6 +1857,7 @@ static void process_nlmeans(dt_iop_module_t *self,
                                       .patch_radius = P,
                                       .search_radius = K,
                                       .decimate = 0,
+                                      .fast = d->fast_nlmeans,
                                       .norm = norm2 };
   nlmeans_denoise(in, ovoid, roi_in, roi_out, &params);
 
@@ -2782,7 +2818,7 @@ void process(dt_iop_module_t *self,
   else if(d->mode == MODE_WAVELETS
           || d->mode == MODE_WAVELETS_AUTO)
     process_wavelets(self, piece, ivoid, ovoid, roi_in, roi_out,
-                     eaw_dn_decompose, eaw_synthesize);
+                     eaw_dn_decompose, eaw_dn_synthesize_residue);
   else
     process_variance(self, piece, ivoid, ovoid, roi_in, roi_out);
 }
@@ -3125,6 +3161,11 @@ void commit_params(dt_iop_module_t *self,
   d->wb_adaptive_anscombe = p->wb_adaptive_anscombe;
   d->fix_anscombe_and_nlmeans_norm = p->fix_anscombe_and_nlmeans_norm;
   d->use_new_vst = p->use_new_vst;
+  d->fast_nlmeans = p->fast_nlmeans;
+
+  // fast mode for non-local means not implemented in OpenCL yet
+  if(d->fast_nlmeans && (d->mode == MODE_NLMEANS || d->mode == MODE_NLMEANS_AUTO))
+    piece->process_cl_ready = FALSE;
 }
 
 void init_pipe(dt_iop_module_t *self,
@@ -3293,6 +3334,7 @@ void gui_update(dt_iop_module_t *self)
   gtk_widget_set_visible(g->fix_anscombe_and_nlmeans_norm,
                          !p->fix_anscombe_and_nlmeans_norm);
   gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(g->use_new_vst), p->use_new_vst);
+  gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(g->fast_nlmeans), p->fast_nlmeans);
   gtk_widget_set_visible(g->use_new_vst, !p->use_new_vst);
 
   const int iso_shift = _get_iso_highlight_preservation_shift(&self->dev->image_storage);
@@ -3762,6 +3804,7 @@ void gui_init(dt_iop_module_t *self)
   dt_bauhaus_slider_set_soft_max(g->scattering, 1.0f);
   g->central_pixel_weight = dt_bauhaus_slider_from_params(self, "central_pixel_weight");
   dt_bauhaus_slider_set_soft_max(g->central_pixel_weight, 1.0f);
+  g->fast_nlmeans = dt_bauhaus_toggle_from_params(self, "fast_nlmeans");
 
   g->box_wavelets = self->widget = dt_gui_vbox();
 
@@ -3931,6 +3974,11 @@ void gui_init(dt_iop_module_t *self)
                                 "of the patch in the patch comparison.\n"
                                 "useful to recover details when patch size\n"
                                 "is quite big."));
+  gtk_widget_set_tooltip_text(g->fast_nlmeans,
+                              _("skip candidate patches which are clearly dissimilar\n"
+                                "over a whole tile of the image.\n"
+                                "much faster on textured images at a small loss of accuracy.\n"
+                                "the module is always processed on the CPU when enabled."));
   gtk_widget_set_tooltip_text(g->strength, _("finetune denoising strength"));
   gtk_widget_set_tooltip_text(g->overshooting,
                               _("controls the way parameters are autoset.\n"
@@ -43,9 +43,16 @@
 #include "gui/presets.h"
 #include "iop/iop_api.h"
 
-DT_MODULE_INTROSPECTION(2, dt_iop_diffuse_params_t)
+DT_MODULE_INTROSPECTION(3, dt_iop_diffuse_params_t)
 
 #define MAX_NUM_SCALES 10
+
+typedef enum dt_iop_diffuse_solver_t
+{
+  DT_DIFFUSE_SOLVER_REFERENCE = 0, // $DESCRIPTION: "reference"
+  DT_DIFFUSE_SOLVER_MULTIGRID = 1, // $DESCRIPTION: "coarse-to-fine"
+} dt_iop_diffuse_solver_t;
+
 typedef struct dt_iop_diffuse_params_t
 {
   // global parameters
@@ -70,6 +77,9 @@ typedef struct dt_iop_diffuse_params_t
   // v2
   int radius_center;        // $MIN: 0    $MAX: 1024 $DEFAULT: 0  $DESCRIPTION: "central radius"
 
+  // v3
+  dt_iop_diffuse_solver_t solver; // $DEFAULT: DT_DIFFUSE_SOLVER_REFERENCE $DESCRIPTION: "solver"
+
   // new versions add params mandatorily at the end, so we can memcpy old parameters at the beginning
 
 } dt_iop_diffuse_params_t;
@@ -77,7 +87,7 @@ typedef struct dt_iop_diffuse_params_t
 
 typedef struct dt_iop_diffuse_gui_data_t
 {
-  GtkWidget *iterations, *fourth, *third, *second, *radius, *radius_center, *sharpness, *threshold, *regularization, *first,
+  GtkWidget *iterations, *solver, *fourth, *third, *second, *radius, *radius_center, *sharpness, *threshold, *regularization, *first,
       *anisotropy_first, *anisotropy_second, *anisotropy_third, *anisotropy_fourth, *regularization_first, *variance_threshold;
 } dt_iop_diffuse_gui_data_t;
 
@@ -229,6 +239,51 @@ int legacy_params(dt_iop_module_t *self,
     *new_version = 2;
     return 0;
   }
+
+  if(old_version == 2)
+  {
+    typedef struct dt_iop_diffuse_params_v3_t
+    {
+      // global parameters
+      int iterations;
+      float sharpness;
+      int radius;
+      float regularization;
+      float variance_threshold;
+
+      float anisotropy_first;
+      float anisotropy_second;
+      float anisotropy_third;
+      float anisotropy_fourth;
+
+      float threshold;
+
+      float first;
+      float second;
+      float third;
+      float fourth;
+
+      // v2
+      int radius_center;
+
+      // v3
+      dt_iop_diffuse_solver_t solver;
+    } dt_iop_diffuse_params_v3_t;
+
+    const dt_iop_diffuse_params_v2_t *o = (dt_iop_diffuse_params_v2_t *)old_params;
+    dt_iop_diffuse_params_v3_t *n = malloc(sizeof(dt_iop_diffuse_params_v3_t));
+
+    // copy common parameters
+    memcpy(n, o, sizeof(dt_iop_diffuse_params_v2_t));
+
+    // init only new parameters
+    n->solver = DT_DIFFUSE_SOLVER_REFERENCE;
+
+    *new_params = n;
+    *new_params_size = sizeof(dt_iop_diffuse_params_v3_t);
+    *new_version = 3;
+    return 0;
+  }
   return 1;
 }
 
@@ -774,6 +829,25 @@ void init_presets(dt_iop_module_so_t *self)
                              DEVELOP_BLEND_CS_RGB_SCENE);
 }
 
+static inline int _diffuse_scales(const dt_iop_diffuse_data_t *const data,
+                                  const float zoom)
+{
+  const float final_radius = (data->radius + data->radius_center) * 2.f / zoom;
+  const int diffusion_scales = num_steps_to_reach_equivalent_sigma(B_SPLINE_SIGMA, final_radius);
+  return CLAMP(diffusion_scales, 1, MAX_NUM_SCALES);
+}
+
+static inline gboolean _use_multigrid(const dt_iop_diffuse_data_t *const data,
+                                      const float zoom,
+                                      const size_t width,
+                                      const size_t height)
+{
+  // with a single wavelet scale there is nothing to solve on the coarse grid
+  return data->solver == DT_DIFFUSE_SOLVER_MULTIGRID
+    && _diffuse_scales(data, zoom) > 1
+    && width >= 64 && height >= 64;
+}
+
 void tiling_callback(dt_iop_module_t *self,
                      dt_dev_pixelpipe_iop_t *piece,
                      const dt_iop_roi_t *roi_in,
@@ -790,7 +864,8 @@ void tiling_callback(dt_iop_module_t *self,
   const int max_filter_radius = (1 << scales);
 
   // in + out + 2 * tmp + 2 * LF + s details + grey mask
-  tiling->factor = 6.25f + scales;
+  // the coarse-to-fine solver needs one more full resolution buffer, CPU only
+  tiling->factor = 6.25f + scales + (_use_multigrid(data, scale, roi_out->width, roi_out->height) ? 1.f : 0.f);
   tiling->factor_cl = 6.25f + scales;
 
   tiling->maxbuf = 1.0f;
@@ -1156,11 +1231,14 @@ static inline gboolean wavelets_process(const float *const restrict in,
                                     const dt_iop_diffuse_data_t *const data,
                                     const float final_radius,
                                     const float zoom,
+                                    const float grid,
                                     const int scales,
                                     const gboolean has_mask,
                                     float *const restrict HF[MAX_NUM_SCALES],
                                     float *const restrict LF_odd,
-                                    float *const restrict LF_even)
+                                    float *const restrict LF_even,
+                                    float *const restrict tempbuf,
+                                    const size_t padded_size)
 {
   gboolean success = TRUE;
 
@@ -1184,9 +1262,6 @@ static inline gboolean wavelets_process(const float *const restrict in,
   // https://jo.dreggn.org/home/2010_atrous.pdf the wavelets
   // decomposition here is the same as the equalizer/atrous module,
   float *restrict residual; // will store the temp buffer containing the last step of blur
-  // allocate a one-row temporary buffer for the decomposition
-  size_t padded_size;
-  float *const restrict tempbuf = dt_alloc_perthread_float(4 * width, &padded_size); //TODO: alloc in caller
   for(int s = 0; s < scales; ++s)
   {
     /* fprintf(stdout, "Wavelet decompose : scale %i\n", s); */
@@ -1226,7 +1301,6 @@ static inline gboolean wavelets_process(const float *const restrict in,
       dt_dump_pfm(name, buffer_out, width, height, 4 * sizeof(float), "diffuse");
     }
   }
-  dt_free_align(tempbuf);
 
   // will store the temp buffer NOT containing the last step of blur
   float *restrict temp = (residual == LF_even) ? LF_odd : LF_even;
@@ -1275,7 +1349,7 @@ static inline gboolean wavelets_process(const float *const restrict in,
     // Compute wavelets low-frequency scales
     heat_PDE_diffusion(HF[s], buffer_in, mask, has_mask, buffer_out, width, height,
                        anisotropy, isotropy_type, regularization,
-                       variance_threshold, sqf(current_radius), mult, ABCD, strength);
+                       variance_threshold, sqf(current_radius * grid), mult, ABCD, strength);
 
     if(darktable.dump_pfm_module)
     {
@@ -1338,6 +1412,223 @@ static inline void inpaint_mask(float *const restrict inpainted,
   }
 }
 
+// run the diffusion iterations on the whole buffer over the given number
+// of wavelet scales. zoom is the size of one pixel of in/out in
+// full-resolution pixels, grid its size in pixels of the roi being
+// processed (> 1 on the coarse grid of the coarse-to-fine solver).
+static gboolean _diffuse_iterations(const float *const restrict in,
+                                    float *const restrict out,
+                                    const uint8_t *const restrict mask,
+                                    const size_t width,
+                                    const size_t height,
+                                    const dt_iop_diffuse_data_t *const data,
+                                    const float zoom,
+                                    const float grid,
+                                    const int scales,
+                                    const int iterations,
+                                    const gboolean has_mask)
+{
+  const float final_radius = (data->radius + data->radius_center) * 2.f / zoom;
+
+  // iterations ping-pong between temp and out, ordered so that the
+  // last one writes into out
+  float *const restrict temp = iterations > 1 ? dt_alloc_align_float(width * height * 4) : NULL;
+  // temp buffer for blurs. We will need to cycle between them for memory efficiency
+  float *const restrict LF_odd = dt_alloc_align_float(width * height * 4);
+  float *const restrict LF_even = dt_alloc_align_float(width * height * 4);
+  // one-row temporary buffer for the decomposition
+  size_t padded_size;
+  float *const restrict tempbuf = dt_alloc_perthread_float(4 * width, &padded_size);
+
+  gboolean out_of_memory = (iterations > 1 && !temp) || !LF_odd || !LF_even || !tempbuf;
+
+  // wavelets scales buffers
+  float *restrict HF[MAX_NUM_SCALES] = { NULL };
+  for(int s = 0; s < scales && !out_of_memory; s++)
+  {
+    HF[s] = dt_alloc_align_float(width * height * 4);
+    if(!HF[s]) out_of_memory = TRUE;
+  }
+
+  if(!out_of_memory)
+  {
+    const float *restrict temp_in = in;
+    for(int it = 0; it < iterations; it++)
+    {
+      float *const restrict temp_out = ((iterations - 1 - it) % 2 == 0) ? out : temp;
+
+      wavelets_process(temp_in, temp_out, mask, width, height,
+                       data, final_radius, zoom, grid, scales, has_mask, HF, LF_odd, LF_even,
+                       tempbuf, padded_size);
+      temp_in = temp_out;
+    }
+  }
+
+  dt_free_align(temp);
+  dt_free_align(LF_even);
+  dt_free_align(LF_odd);
+  dt_free_align(tempbuf);
+  for(int s = 0; s < scales; s++)
+    dt_free_align(HF[s]);
+
+  return !out_of_memory;
+}
+
+static void _downsample_2x(const float *const restrict in,
+                           float *const restrict out,
+                           const size_t width,
+                           const size_t height,
+                           const size_t cwidth,
+                           const size_t cheight)
+{
+  DT_OMP_FOR()
+  for(size_t i = 0; i < cheight; i++)
+  {
+    const size_t i0 = 2 * i;
+    const size_t i1 = MIN(i0 + 1, height - 1);
+    for(size_t j = 0; j < cwidth; j++)
+    {
+      const size_t j0 = 2 * j;
+      const size_t j1 = MIN(j0 + 1, width - 1);
+      for_four_channels(c)
+        out[4 * (i * cwidth + j) + c] = 0.25f * (in[4 * (i0 * width + j0) + c] + in[4 * (i0 * width + j1) + c]
+                                               + in[4 * (i1 * width + j0) + c] + in[4 * (i1 * width + j1) + c]);
+    }
+  }
+}
+
+static void _downsample_mask_2x(const uint8_t *const restrict in,
+                                uint8_t *const restrict out,
+                                const size_t width,
+                                const size_t height,
+                                const size_t cwidth,
+                                const size_t cheight)
+{
+  DT_OMP_FOR()
+  for(size_t i = 0; i < cheight; i++)
+  {
+    const size_t i0 = 2 * i;
+    const size_t i1 = MIN(i0 + 1, height - 1);
+    for(size_t j = 0; j < cwidth; j++)
+    {
+      const size_t j0 = 2 * j;
+      const size_t j1 = MIN(j0 + 1, width - 1);
+      out[i * cwidth + j] = in[i0 * width + j0] || in[i0 * width + j1]
+                         || in[i1 * width + j0] || in[i1 * width + j1];
+    }
+  }
+}
+
+// out = in + bilinear upsampling of (coarse_out - coarse_in), only
+// inside the mask if there is one
+static void _add_coarse_correction(const float *const restrict in,
+                                   const float *const restrict coarse_in,
+                                   const float *const restrict coarse_out,
+                                   const uint8_t *const restrict mask,
+                                   const gboolean has_mask,
+                                   float *const restrict out,
+                                   const size_t width,
+                                   const size_t height,
+                                   const size_t cwidth,
+                                   const size_t cheight)
+{
+  DT_OMP_FOR()
+  for(size_t i = 0; i < height; i++)
+  {
+    const float y = CLAMPF(0.5f * i - 0.25f, 0.f, (float)(cheight - 1));
+    const size_t y0 = (size_t)y;
+    const size_t y1 = MIN(y0 + 1, cheight - 1);
+    const float wy = y - y0;
+    for(size_t j = 0; j < width; j++)
+    {
+      const float x = CLAMPF(0.5f * j - 0.25f, 0.f, (float)(cwidth - 1));
+      const size_t x0 = (size_t)x;
+      const size_t x1 = MIN(x0 + 1, cwidth - 1);
+      const float wx = x - x0;
+      const size_t k00 = 4 * (y0 * cwidth + x0);
+      const size_t k01 = 4 * (y0 * cwidth + x1);
+      const size_t k10 = 4 * (y1 * cwidth + x0);
+      const size_t k11 = 4 * (y1 * cwidth + x1);
+      const size_t k = 4 * (i * width + j);
+      if(has_mask && !mask[i * width + j])
+      {
+        for_four_channels(c)
+          out[k + c] = in[k + c];
+        continue;
+      }
+      for_four_channels(c)
+      {
+        const float d00 = coarse_out[k00 + c] - coarse_in[k00 + c];
+        const float d01 = coarse_out[k01 + c] - coarse_in[k01 + c];
+        const float d10 = coarse_out[k10 + c] - coarse_in[k10 + c];
+        const float d11 = coarse_out[k11 + c] - coarse_in[k11 + c];
+        const float d = (1.f - wy) * ((1.f - wx) * d00 + wx * d01) + wy * ((1.f - wx) * d10 + wx * d11);
+        out[k + c] = in[k + c] + d;
+      }
+    }
+  }
+}
+
+// Coarse-to-fine solver: the scale s of the full resolution wavelets
+// decomposition has the scale s - 1 of a half resolution copy as an
+// equivalent, 4 times cheaper to compute. So the iterations are first run
+// on the half resolution copy for all scales but the finest one, the
+// change they produce is upsampled onto the full resolution image, then
+// the iterations are run again at full resolution for the finest scale
+// only. Every scale still sees all the iterations, but in coarse-to-fine
+// order instead of interleaved, which is what makes the result deviate a
+// bit from the reference solver. The edge sensitivity is kept in full
+// resolution units on the coarse grid, otherwise it would be 4 times
+// weaker there.
+static gboolean _diffuse_multigrid(const float *const restrict in,
+                                   float *const restrict out,
+                                   const uint8_t *const restrict mask,
+                                   const size_t width,
+                                   const size_t height,
+                                   const dt_iop_diffuse_data_t *const data,
+                                   const float zoom,
+                                   const int iterations,
+                                   const gboolean has_mask)
+{
+  const size_t cwidth = (width + 1) / 2;
+  const size_t cheight = (height + 1) / 2;
+
+  float *const restrict coarse_in = dt_alloc_align_float(cwidth * cheight * 4);
+  float *const restrict coarse_out = dt_alloc_align_float(cwidth * cheight * 4);
+  uint8_t *const restrict coarse_mask = has_mask ? dt_alloc_align_uint8(cwidth * cheight) : NULL;
+  float *const restrict fine_in = dt_alloc_align_float(width * height * 4);
+
+  size_t padded_size;
+  float *const restrict tempbuf = dt_alloc_perthread_float(4 * width, &padded_size);
+
+  gboolean success = coarse_in && coarse_out && fine_in && tempbuf && (!has_mask || coarse_mask);
+  if(success)
+  {
+    // remove the finest scale before decimating, so the coarse grid starts
+    // from the same low frequencies as the second scale of the reference
+    blur_2D_Bspline(in, fine_in, tempbuf, padded_size, width, height, 1, FALSE);
+    _downsample_2x(fine_in, coarse_in, width, height, cwidth, cheight);
+    if(has_mask) _downsample_mask_2x(mask, coarse_mask, width, height, cwidth, cheight);
+
+    success = _diffuse_iterations(coarse_in, coarse_out, coarse_mask, cwidth, cheight,
+                                  data, 2.f * zoom, 2.f, _diffuse_scales(data, 2.f * zoom), iterations, has_mask);
+  }
+  if(success)
+    _add_coarse_correction(in, coarse_in, coarse_out, mask, has_mask, fine_in, width, height, cwidth, cheight);
+
+  dt_free_align(coarse_in);
+  dt_free_align(coarse_out);
+  dt_free_align(coarse_mask);
+  dt_free_align(tempbuf);
+
+  if(success)
+    success = _diffuse_iterations(fine_in, out, mask, width, height,
+                                  data, zoom, 1.f, 1, iterations, has_mask);
+
+  dt_free_align(fine_in);
+  return success;
+}
+
 void process(dt_iop_module_t *self,
              dt_dev_pixelpipe_iop_t *piece,
              const void *const restrict ivoid,
@@ -1360,95 +1651,47 @@ void process(dt_iop_module_t *self,
     return;
   }
 
+  const gboolean has_mask = (data->threshold > 0.f);
+
   uint8_t *const restrict mask = dt_alloc_align_uint8(width * height);
+  float *const restrict inpainted = has_mask ? dt_alloc_align_float(width * height * 4) : NULL;
 
-  float *restrict in = DT_IS_ALIGNED((float *const restrict)ivoid);
+  const float *restrict in = DT_IS_ALIGNED((const float *const restrict)ivoid);
   float *const restrict out = DT_IS_ALIGNED((float *const restrict)ovoid);
 
-  float *restrict temp1, *restrict temp2;
-  // temp buffer for blurs. We will need to cycle between them for memory efficiency
-  float *restrict LF_odd, *restrict LF_even;
-
-  float *restrict temp_in = NULL;
-  float *restrict temp_out = NULL;
-
-  gboolean out_of_memory = !mask
-    || !dt_iop_alloc_image_buffers(self, roi_in, roi_out,
-                                 4 | DT_IMGSZ_OUTPUT, &temp1,
-                                 4 | DT_IMGSZ_OUTPUT, &temp2,
-                                 4 | DT_IMGSZ_OUTPUT, &LF_odd,
-                                 4 | DT_IMGSZ_OUTPUT, &LF_even,
-                                 0, NULL); // if failing all pointers are NULL
-
   const float scale = fmaxf(piece->iscale / roi_in->scale, 1.f);
-  const float final_radius = (data->radius + data->radius_center) * 2.f / scale;
-
   const int iterations = MAX(ceilf((float)data->iterations), 1);
-  const int diffusion_scales = num_steps_to_reach_equivalent_sigma(B_SPLINE_SIGMA, final_radius);
-  const int scales = CLAMP(diffusion_scales, 1, MAX_NUM_SCALES);
 
-  // wavelets scales buffers
-  float *restrict HF[MAX_NUM_SCALES];
-  for(int s = 0; s < scales; s++)
-  {
-    HF[s] = out_of_memory ? NULL : dt_alloc_align_float(width * height * 4);
-    if(!HF[s]) out_of_memory = TRUE;
-  }
-
-  // check that all buffers exist before processing because we use a lot of memory here.
-  if(out_of_memory)
-  {
-    dt_iop_copy_image_roi(ovoid, ivoid, piece->colors, roi_in, roi_out);
-    dt_control_log(_("diffuse/sharpen failed to allocate memory, check your RAM settings"));
-    goto finish;
-  }
-
-  const gboolean has_mask = (data->threshold > 0.f);
-  if(has_mask)
+  gboolean success = mask && (!has_mask || inpainted);
+  if(success && has_mask)
   {
     // build a boolean mask, TRUE where image is above threshold, FALSE otherwise
-    build_mask(in, mask, data->threshold, roi_out->width, roi_out->height);
+    build_mask(in, mask, data->threshold, width, height);
 
     // init the inpainting area with noise
-    inpaint_mask(temp1, in, mask, roi_out->width, roi_out->height);
+    inpaint_mask(inpainted, in, mask, width, height);
 
-    in = temp1;
+    in = inpainted;
   }
 
-  for(int it = 0; it < iterations; it++)
+  if(success)
   {
-    if(it == 0)
-    {
-      temp_in = in;
-      temp_out = temp2;
-    }
-    else if(it % 2 == 0)
-    {
-      temp_in = temp1;
-      temp_out = temp2;
-    }
+    if(_use_multigrid(data, scale, width, height))
+      success = _diffuse_multigrid(in, out, mask, width, height, data, scale, iterations, has_mask);
     else
-    {
-      temp_in = temp2;
-      temp_out = temp1;
-    }
-
-    if(it == iterations - 1)
-      temp_out = out;
+      success = _diffuse_iterations(in, out, mask, width, height, data, scale, 1.f,
+                                    _diffuse_scales(data, scale), iterations, has_mask);
+  }
 
-    wavelets_process(temp_in, temp_out, mask,
-                     roi_out->width, roi_out->height,
-                     data, final_radius, scale, scales, has_mask, HF, LF_odd, LF_even);
+  // check that all buffers exist because we use a lot of memory here.
+  if(!success)
+  {
+    dt_iop_copy_image_roi(ovoid, ivoid, piece->colors, roi_in, roi_out);
+    dt_control_log(_("diffuse/sharpen failed to allocate memory, check your RAM settings"));
   }
 
-finish:
   dt_free_align(mask);
-  dt_free_align(temp1);
-  dt_free_align(temp2);
-  dt_free_align(LF_even);
-  dt_free_align(LF_odd);
-  for(int s = 0; s < scales; s++)
-    if(HF[s]) dt_free_align(HF[s]);
+  dt_free_align(inpainted);
 }
 
 #if HAVE_OPENCL
@@ -1633,6 +1876,13 @@ int process_cl(dt_iop_module_t *self,
   if(fastmode)
     return dt_opencl_enqueue_copy_image(devid, dev_in, dev_out, origin, origin, region);
 
+  if(_use_multigrid(data, fmaxf(piece->iscale / roi_in->scale, 1.f), width, height))
+  {
+    dt_print(DT_DEBUG_OPENCL,
+             "[opencl_diffuse] coarse-to-fine solver not yet supported by opencl code");
+    return DT_OPENCL_PROCESS_CL;
+  }
+
   size_t sizes[] = { ROUNDUPDWD(width, devid), ROUNDUPDHT(height, devid), 1 };
 
   cl_mem in = dev_in;
@@ -1777,6 +2027,16 @@ void gui_init(dt_iop_module_t *self)
        "if you plan on sharpening or inpainting, \n"
        "more iterations help reconstruction."));
 
+  g->solver = dt_bauhaus_combobox_from_params(self, "solver");
+  gtk_widget_set_tooltip_text
+    (g->solver,
+     _("reference runs all iterations at full resolution.\n"
+       "coarse-to-fine runs most iterations at half resolution\n"
+       "and refines the finest details at full resolution.\n"
+       "it is much faster with many iterations, at the price\n"
+       "of a slightly weaker effect on the finest details.\n"
+       "it is always processed on the CPU."));
+
   g->radius_center = dt_bauhaus_slider_from_params(self, "radius_center");
   dt_bauhaus_slider_set_soft_range(g->radius_center, 0., 512.);
   dt_bauhaus_slider_set_format(g->radius_center, _(" px"));
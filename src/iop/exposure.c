@@ -538,33 +538,46 @@ error:
 }
 #endif
 
-void process(dt_iop_module_t *self,
-             dt_dev_pixelpipe_iop_t *piece,
-             const void *const i,
-             void *const o,
-             const dt_iop_roi_t *const roi_in,
-             const dt_iop_roi_t *const roi_out)
+gboolean fuse_pointwise(dt_iop_module_t *self,
+                        dt_dev_pixelpipe_iop_t *piece,
+                        const dt_iop_roi_t *const roi)
 {
   const dt_iop_exposure_data_t *const d = piece->data;
 
   _process_common_setup(self, piece);
 
-  const int ch = piece->colors;
+  for(int k = 0; k < 3; k++)
+    piece->pipe->dsc.processed_maximum[k] *= d->scale;
+  return TRUE;
+}
 
-  const float *const restrict in = (float*)i;
-  float *const restrict out = (float*)o;
+void process_pointwise(dt_iop_module_t *self,
+                       dt_dev_pixelpipe_iop_t *piece,
+                       const float *const in,
+                       float *const out,
+                       const size_t npixels)
+{
+  const dt_iop_exposure_data_t *const d = piece->data;
   const float black = d->black;
   const float scale = d->scale;
-  const size_t npixels = (size_t)roi_out->width * roi_out->height;
-  DT_OMP_FOR_SIMD(aligned(in, out : 64))
-  for(size_t k = 0; k < ch * npixels; k++)
+  DT_OMP_SIMD(aligned(in, out : 64))
+  for(size_t k = 0; k < 4 * npixels; k++)
   {
     out[k] = (in[k] - black) * scale;
   }
-  for(int k = 0; k < 3; k++)
-    piece->pipe->dsc.processed_maximum[k] *= d->scale;
 }
 
+void process(dt_iop_module_t *self,
+             dt_dev_pixelpipe_iop_t *piece,
+             const void *const i,
+             void *const o,
+             const dt_iop_roi_t *const roi_in,
+             const dt_iop_roi_t *const roi_out)
+{
+  fuse_pointwise(self, piece, roi_out);
+  dt_dev_pointwise_process(&piece, 1, (const float *)i, (float *)o,
+                           (size_t)roi_out->width * roi_out->height);
+}
 
 static float _get_exposure_bias(const dt_iop_module_t *self)
 {
@@ -640,6 +653,8 @@ void commit_params(dt_iop_module_t *self,
   {
     d->deflicker = 1;
   }
+
+  piece->pointwise_ready = TRUE;
 }
 
 void init_pipe(dt_iop_module_t *self,
@@ -349,6 +349,48 @@ void modify_roi_in(dt_iop_module_t *self,
   roi_in->height = aabb_in[3] - aabb_in[1] + 1;
 }
 
+typedef struct _flip_warp_t
+{
+  dt_image_orientation_t orientation;
+  int width, height;  // of the input buffer
+} _flip_warp_t;
+
+// output to input buffer coordinates, same as dt_imageio_flip_buffers()
+static void _flip_warp_map(const void *data,
+                           const float x,
+                           const float y,
+                           float *xin,
+                           float *yin)
+{
+  const _flip_warp_t *w = data;
+  float i = x, j = y;
+  if(w->orientation & ORIENTATION_SWAP_XY)
+  {
+    i = y;
+    j = x;
+  }
+  if(w->orientation & ORIENTATION_FLIP_X) i = w->width - 1 - i;
+  if(w->orientation & ORIENTATION_FLIP_Y) j = w->height - 1 - j;
+  *xin = i;
+  *yin = j;
+}
+
+gboolean fuse_warp(dt_iop_module_t *self,
+                   dt_dev_pixelpipe_iop_t *piece,
+                   const dt_iop_roi_t *const roi_in,
+                   const dt_iop_roi_t *const roi_out,
+                   dt_dev_warp_step_t *step)
+{
+  const dt_iop_flip_data_t *d = piece->data;
+  _flip_warp_t *w = dt_alloc1_align_type(_flip_warp_t);
+  w->orientation = d->orientation;
+  w->width = roi_in->width;
+  w->height = roi_in->height;
+  step->map = _flip_warp_map;
+  step->data = w;
+  return TRUE;
+}
+
 // 3rd (final) pass: you get this input region (may be different from
 // what was requested above), do your best to fill the output region!
 void process(dt_iop_module_t *self,
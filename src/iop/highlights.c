@@ -1024,6 +1024,44 @@ void process(dt_iop_module_t *self,
   }
 }
 
+gboolean fuse_raw_frontend(dt_iop_module_t *self,
+                           dt_dev_pixelpipe_iop_t *piece,
+                           dt_dev_raw_frontend_t *fe,
+                           const dt_iop_roi_t *const roi_in,
+                           const dt_iop_roi_t *const roi_out)
+{
+  dt_dev_pixelpipe_t *pipe = piece->pipe;
+  const uint32_t filters = pipe->dsc.filters;
+  const dt_iop_highlights_data_t *d = piece->data;
+  const dt_iop_highlights_gui_data_t *g = self->gui_data;
+
+  // only the plain clipping as done by process_clip()
+  if(!filters
+     || d->mode != DT_IOP_HIGHLIGHTS_CLIP
+     || pipe->mask_display != DT_DEV_PIXELPIPE_DISPLAY_NONE
+     || (g && (pipe->type & DT_DEV_PIXELPIPE_FULL) && g->hlr_mask_mode != DT_HIGHLIGHTS_MASK_OFF)
+     || dt_iop_piece_is_raster_mask_used(piece, BLEND_RASTER_ID))
+    return FALSE;
+
+  const float clip = d->clip * dt_iop_get_processed_minimum(piece);
+  const dt_dev_chroma_t *chr = &self->dev->chroma;
+  dt_aligned_pixel_t clips = { clip, clip, clip, clip};
+  if(chr->late_correction)
+  {
+    for_each_channel(c) clips[c] *= chr->as_shot[c] / chr->D65coeffs[c];
+  }
+
+  const uint8_t(*const xtrans)[6] = (const uint8_t(*const)[6])pipe->dsc.xtrans;
+  for(int j = 0; j < DT_RAW_FRONTEND_ROWS; j++)
+    for(int i = 0; i < DT_RAW_FRONTEND_COLS; i++)
+      fe->clip[j][i] = clips[filters == 9u ? FCxtrans(j, i, roi_in, xtrans) : FC(j, i, filters)];
+
+  dt_iop_piece_clear_raster(piece, NULL);
+  const float m = dt_iop_get_processed_maximum(piece);
+  for_three_channels(k) pipe->dsc.processed_maximum[k] = m;
+  return TRUE;
+}
+
 void commit_params(dt_iop_module_t *self,
                    dt_iop_params_t *p1,
                    dt_dev_pixelpipe_t *pipe,
@@ -1055,6 +1093,8 @@ void commit_params(dt_iop_module_t *self,
   if((d->mode == DT_IOP_HIGHLIGHTS_SEGMENTS) || (d->mode == DT_IOP_HIGHLIGHTS_OPPOSED))
     piece->process_tiling_ready = FALSE;
 
+  piece->raw_frontend_ready = (d->mode == DT_IOP_HIGHLIGHTS_CLIP) && !linear;
+
   const gboolean fullpipe = piece->pipe->type & DT_DEV_PIXELPIPE_FULL;
 
   dt_iop_highlights_gui_data_t *g = self->gui_data;
@@ -129,17 +129,18 @@ static void _calc_plane_candidates(const float *plane,
   DT_OMP_PRAGMA(parallel for default(firstprivate) schedule(dynamic))
   for(uint32_t id = 2; id < seg->nr; id++)
   {
-    seg->val1[id] = 0.0f;
-    seg->val2[id] = 0.0f;
+    dt_iop_segment_t *sg = &seg->stats[id];
+    sg->val1 = 0.0f;
+    sg->val2 = 0.0f;
     // avoid very small segments
-    if((seg->ymax[id] - seg->ymin[id] > 2) && (seg->xmax[id] - seg->xmin[id] > 2))
+    if((sg->ymax - sg->ymin > 2) && (sg->xmax - sg->xmin > 2))
     {
       size_t testref = 0;
       float testweight = 0.0f;
       // make sure we don't calc a candidate from duplicated border data
-      for(int row = MAX(seg->border+2, seg->ymin[id]-2); row < MIN(seg->height - seg->border-2, seg->ymax[id]+3); row++)
+      for(int row = MAX(seg->border+2, sg->ymin-2); row < MIN(seg->height - seg->border-2, sg->ymax+3); row++)
       {
-        for(int col = MAX(seg->border+2, seg->xmin[id]-2); col < MIN(seg->width - seg->border-2, seg->xmax[id]+3); col++)
+        for(int col = MAX(seg->border+2, sg->xmin-2); col < MIN(seg->width - seg->border-2, sg->xmax+3); col++)
         {
           const size_t pos = row * seg->width + col;
           const uint32_t sid = _get_segment_id(seg, pos);
@@ -177,8 +178,8 @@ static void _calc_plane_candidates(const float *plane,
         const float av = sum / fmaxf(1.0f, pix);
         if(av > 0.125f * clipval)
         {
-          seg->val1[id] = fminf(clipval, av);
-          seg->val2[id] = refavg[testref];
+          sg->val1 = fminf(clipval, av);
+          sg->val2 = refavg[testref];
         }
       }
     }
@@ -247,10 +248,11 @@ static float _segment_maxdistance(float *distance,
                                   dt_iop_segmentation_t *seg,
                                   const uint32_t id)
 {
-  const int xmin = MAX(seg->xmin[id]-2, seg->border);
-  const int xmax = MIN(seg->xmax[id]+3, seg->width - seg->border);
-  const int ymin = MAX(seg->ymin[id]-2, seg->border);
-  const int ymax = MIN(seg->ymax[id]+3, seg->height - seg->border);
+  const dt_iop_segment_t *sg = &seg->stats[id];
+  const int xmin = MAX(sg->xmin-2, seg->border);
+  const int xmax = MIN(sg->xmax+3, seg->width - seg->border);
+  const int ymin = MAX(sg->ymin-2, seg->border);
+  const int ymax = MIN(sg->ymax+3, seg->height - seg->border);
   float max_distance = 0.0f;
 
   DT_OMP_FOR(reduction(max : max_distance) collapse(2))
@@ -273,7 +275,7 @@ static float _segment_attenuation(dt_iop_segmentation_t *seg, const uint32_t id,
     return attenuate[mode];
   else
   {
-    const float maxdist = fmaxf(1.0f, seg->val1[id]);
+    const float maxdist = fmaxf(1.0f, seg->stats[id].val1);
     return fminf(1.7f, 0.9f + (3.0f / maxdist));
   }
 }
@@ -337,15 +339,16 @@ static void _segment_gradients(float *distance,
                                const uint32_t id,
                                const int recovery_close)
 {
-  const int xmin = MAX(seg->xmin[id]-1, seg->border);
-  const int xmax = MIN(seg->xmax[id]+2, seg->width - seg->border);
-  const int ymin = MAX(seg->ymin[id]-1, seg->border);
-  const int ymax = MIN(seg->ymax[id]+2, seg->height - seg->border);
+  const dt_iop_segment_t *sg = &seg->stats[id];
+  const int xmin = MAX(sg->xmin-1, seg->border);
+  const int xmax = MIN(sg->xmax+2, seg->width - seg->border);
+  const int ymin = MAX(sg->ymin-1, seg->border);
+  const int ymax = MIN(sg->ymax+2, seg->height - seg->border);
   const float attenuate = _segment_attenuation(seg, id, mode);
   const float strength = _segment_correction(seg, id, mode, recovery_close);
 
   float maxdist = 1.5f;
-  while(maxdist < seg->val1[id])
+  while(maxdist < sg->val1)
   {
     _calc_distance_ring(xmin, xmax, ymin, ymax, gradient, distance, attenuate, maxdist, seg, id);
     maxdist += 1.5f;
@@ -390,10 +393,11 @@ static void _add_poisson_noise(float *lum,
                                const uint32_t id,
                                const float noise_level)
 {
-  const int xmin = MAX(seg->xmin[id], seg->border);
-  const int xmax = MIN(seg->xmax[id]+1, seg->width - seg->border);
-  const int ymin = MAX(seg->ymin[id], seg->border);
-  const int ymax = MIN(seg->ymax[id]+1, seg->height - seg->border);
+  const dt_iop_segment_t *sg = &seg->stats[id];
+  const int xmin = MAX(sg->xmin, seg->border);
+  const int xmax = MIN(sg->xmax+1, seg->width - seg->border);
+  const int ymin = MAX(sg->ymin, seg->border);
+  const int ymax = MIN(sg->ymax+1, seg->height - seg->border);
   uint32_t DT_ALIGNED_ARRAY state[4] = { splitmix32(ymin), splitmix32(xmin), splitmix32(1337), splitmix32(666) };
   xoshiro128plus(state);
   xoshiro128plus(state);
@@ -500,9 +504,11 @@ static void _process_segmentation(dt_dev_pixelpipe_iop_t *piece,
 
   gboolean segerror = FALSE;
 
+  // the planes are segmentized one after the other so they can share the scratch buffer
+  uint32_t *segtmp = dt_alloc_align_type(uint32_t, p_size);
   dt_iop_segmentation_t isegments[HL_SEGMENT_PLANES];
   for(int i = 0; i < HL_SEGMENT_PLANES; i++)
-    segerror |= dt_segmentation_init_struct(&isegments[i], pwidth, pheight, HL_BORDER+1, segmentation_limit);
+    segerror |= dt_segmentation_init_struct(&isegments[i], pwidth, pheight, HL_BORDER+1, segmentation_limit, segtmp);
 
   if(segerror)
   {
@@ -510,6 +516,7 @@ static void _process_segmentation(dt_dev_pixelpipe_iop_t *piece,
     for(int i = 0; i < HL_SEGMENT_PLANES; i++)
       dt_segmentation_free_struct(&isegments[i]);
 
+    dt_free_align(segtmp);
     dt_free_align(fbuffer);
     return;
   }
@@ -575,19 +582,9 @@ static void _process_segmentation(dt_dev_pixelpipe_iop_t *piece,
     _masks_extend_border(plane[i], pwidth, pheight, HL_BORDER);
 
   for(int p = 0; p < HL_RGB_PLANES; p++)
-    dt_segments_combine(&isegments[p], d->combine);
-
-  if(dt_get_num_threads() >= HL_RGB_PLANES)
-  {
-    DT_OMP_PRAGMA(parallel num_threads(HL_RGB_PLANES))
-    {
-      dt_segmentize_plane(&isegments[dt_get_thread_num()]);
-    }
-  }
-  else
   {
-    for(int p = 0; p < HL_RGB_PLANES; p++)
-      dt_segmentize_plane(&isegments[p]);
+    dt_segments_combine(&isegments[p], d->combine);
+    dt_segmentize_plane(&isegments[p]);
   }
 
   for(int p = 0; p < HL_RGB_PLANES; p++)
@@ -607,10 +604,10 @@ static void _process_segmentation(dt_dev_pixelpipe_iop_t *piece,
         const uint32_t pid = _get_segment_id(&isegments[color], o);
         if((pid > 1) && (pid < isegments[color].nr))
         {
-          const float candidate = isegments[color].val1[pid];
+          const float candidate = isegments[color].stats[pid].val1;
           if(candidate != 0.0f)
           {
-            const float cand_reference = isegments[color].val2[pid];
+            const float cand_reference = isegments[color].stats[pid].val2;
             const float refavg_here = _calc_refavg(input, xtrans, filters, row, col, roi_in, correction, FALSE);
             const float oval = powf(refavg_here + candidate - cand_reference, HL_POWERF);
             tmpout[idx] = plane[color][o] = fmaxf(inval, oval);
@@ -663,9 +660,9 @@ static void _process_segmentation(dt_dev_pixelpipe_iop_t *piece,
       // now we check for significant all-clipped-segments and reconstruct data
       for(uint32_t id = 2; id < segall->nr; id++)
       {
-        segall->val1[id] = _segment_maxdistance(distance, segall, id);
+        segall->stats[id].val1 = _segment_maxdistance(distance, segall, id);
 
-        if(segall->val1[id] > 2.0f)
+        if(segall->stats[id].val1 > 2.0f)
           _segment_gradients(distance, recout, tmp, recovery_mode, segall, id, recovery_close);
       }
 
@@ -676,7 +673,7 @@ static void _process_segmentation(dt_dev_pixelpipe_iop_t *piece,
       {
         for(uint32_t id = 2; id < segall->nr; id++)
         {
-          if(segall->val1[id] > 3.0f)
+          if(segall->stats[id].val1 > 3.0f)
             _add_poisson_noise(gradient, segall, id, noise_level);
         }
       }
@@ -729,7 +726,7 @@ static void _process_segmentation(dt_dev_pixelpipe_iop_t *piece,
 
           else if(vmode == DT_HIGHLIGHTS_MASK_CANDIDATING)
           {
-            if(pid && !feqf(isegments[color].val1[pid], 0.0f, 1e-9))
+            if(pid && !feqf(isegments[color].stats[pid].val1, 0.0f, 1e-9))
               output[odx] += 1.0f;
           }
 
@@ -755,6 +752,7 @@ static void _process_segmentation(dt_dev_pixelpipe_iop_t *piece,
 
   for(int i = 0; i < HL_SEGMENT_PLANES; i++)
     dt_segmentation_free_struct(&isegments[i]);
+  dt_free_align(segtmp);
   dt_free_align(fbuffer);
 }
 
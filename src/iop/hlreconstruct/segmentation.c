@@ -21,7 +21,10 @@
 
    Morphological closing operation supporting radius up to 8, tuned for performance
 
-   The segmentation algorithm uses a modified floodfill, while floddfilling it
+   The segmentation algorithm labels 4-connected components with a union-find
+   working on horizontal strips in parallel, the strips are merged afterwards.
+   Segment id's are given in order of the first location found in raster order.
+   While labelling it
    - also takes keeps track of the surrounding rectangle of every segment and
    - marks the segment border locations.
 
@@ -29,24 +32,28 @@
 */
 
 #define DT_SEG_ID_MASK 0x40000
+#define DT_SEG_ROOT 0x80000000u
+#define DT_SEG_LISTED 0x40000000u
+#define DT_SEG_SIZE (DT_SEG_LISTED - 1)
+#define DT_SEG_STRIP 64
 
-typedef struct dt_pos_t
+typedef struct dt_iop_segment_t
 {
-  int xpos;
-  int ypos;
-} dt_pos_t;
+  int size;       // size of the segment
+  int xmin;       // bounding rectangle of the segment
+  int xmax;
+  int ymin;
+  int ymax;
+  float val1;     // val1 and val2 are free to be used by the segmentation user
+  float val2;
+} dt_iop_segment_t;
 
 typedef struct dt_iop_segmentation_t
 {
   uint32_t *data; // holding segment id's for every location
-  uint32_t *tmp;  // pointer to temporary buffer used for morphological operations
-  int *size;      // size of each segment
-  int *xmin;      // bounding rectangle for each segment
-  int *xmax;
-  int *ymin;
-  int *ymax;
-  float *val1;    // val1 and val2 are free to be used by the segmentation user
-  float *val2;
+  uint32_t *tmp;  // temporary buffer used for morphological operations and labelling,
+                  // owned by the caller and may be shared by segmentations not processed concurrently
+  dt_iop_segment_t *stats; // per segment data
   int nr;         // next index for found segments, starting with 2
   int border;     // while segmentizing we have a border region not used by the algo
   int slots;      // available segment id's
@@ -54,42 +61,12 @@ typedef struct dt_iop_segmentation_t
   int height;
 } dt_iop_segmentation_t;
 
-typedef struct dt_ff_stack_t
-{
-  int pos;
-  int size;
-  dt_pos_t *el;
-} dt_ff_stack_t;
-
-static inline void _push_stack(int xpos, int ypos, dt_ff_stack_t *stack)
-{
-  const int i = stack->pos;
-  if(i >= stack->size - 1)
-  {
-    dt_print(DT_DEBUG_ALWAYS, "[segmentation stack overflow] %i", stack->size);
-    return;
-  }
-  stack->el[i].xpos = xpos;
-  stack->el[i].ypos = ypos;
-  stack->pos++;
-}
-
 static inline void _clear_segment_slot(dt_iop_segmentation_t *seg, uint32_t id)
 {
   if(id > seg->slots-1)
     return;
 
-  seg->size[id] = seg->xmin[id] = seg->xmax[id] = seg->ymin[id] = seg->ymax[id] = 0;
-  seg->val1[id] = seg->val2[id] = 0.0f;
-}
-
-static inline dt_pos_t * _pop_stack(dt_ff_stack_t *stack)
-{
-  if(stack->pos > 0)
-    stack->pos--;
-  else
-    dt_print(DT_DEBUG_ALWAYS, "[segmentation stack underflow]");
-  return &stack->el[stack->pos];
+  memset(&seg->stats[id], 0, sizeof(dt_iop_segment_t));
 }
 
 static inline uint32_t _get_segment_id(dt_iop_segmentation_t *seg, const size_t loc)
@@ -316,270 +293,347 @@ static inline void _intimage_borderfill(uint32_t *d,
   }
 }
 
-static gboolean _floodfill_segmentize(int yin,
-                                      int xin,
-                                      dt_iop_segmentation_t *seg,
-                                      const int w,
-                                      const int h,
-                                      const int id,
-                                      dt_ff_stack_t *stack)
+static inline uint32_t _uf_find(uint32_t *parent, uint32_t i)
 {
-  if(id >= seg->slots - 2) return FALSE;
+  while(parent[i] != i)
+  {
+    parent[i] = parent[parent[i]];
+    i = parent[i];
+  }
+  return i;
+}
 
-  const int border = seg->border;
-  uint32_t *d = seg->data;
-  int xp = 0;
-  int yp = 0;
-  size_t rp = 0;
-  int min_x = xin;
-  int max_x = xin;
-  int min_y = yin;
-  int max_y = yin;
-  int cnt = 0;
-  stack->pos = 0;
-  _clear_segment_slot(seg, id);
+// the root is always the smallest location of a component, so it's the one
+// a raster scan finds first
+static inline uint32_t _uf_union(uint32_t *parent, const uint32_t a, const uint32_t b)
+{
+  const uint32_t ra = _uf_find(parent, a);
+  const uint32_t rb = _uf_find(parent, b);
+  if(ra < rb)      parent[rb] = ra;
+  else if(rb < ra) parent[ra] = rb;
+  return MIN(ra, rb);
+}
+
+static int _cmp_location(const void *a, const void *b)
+{
+  const uint32_t la = *(const uint32_t *)a;
+  const uint32_t lb = *(const uint32_t *)b;
+  return (la > lb) - (la < lb);
+}
+
+// while labelling, the root of a strip component holds the flagged size, all other
+// locations hold their root
+static inline uint32_t _local_root(const uint32_t *d, const uint32_t i)
+{
+  return (d[i] & DT_SEG_ROOT) ? i : d[i];
+}
+
+// once the id's are known, parent holds them flagged at the roots
+static inline uint32_t _final_id(const uint32_t *parent, uint32_t i)
+{
+  while(TRUE)
+  {
+    const uint32_t p = parent[i];
+    if(p & DT_SEG_ROOT) return p & ~DT_SEG_ROOT;
+    if(p == i) return 1;
+    i = p;
+  }
+}
 
-  _push_stack(xin, yin, stack);
-  while(stack->pos)
+/* Label one strip, afterwards
+   - d holds the strip root for every location of a component, the root itself holds the flagged size
+   - parent[root] == root for all strip roots
+   - list holds the roots in raster order of all components large enough or touching the strip borders
+*/
+static int _label_strip(uint32_t *d,
+                        uint32_t *parent,
+                        uint32_t *list,
+                        int *span,
+                        const int rfrom,
+                        const int rto,
+                        const int width,
+                        const int border)
+{
+  // union-find over the runs, every run is linked to its start. We also keep the
+  // span of every row holding segment locations so following passes can skip the rest
+  for(int row = rfrom; row < rto; row++)
   {
-    dt_pos_t *coord = _pop_stack(stack);
-    const int x = coord->xpos;
-    const int y = coord->ypos;
-    if(d[y*w+x] == 1)
+    const uint32_t rowstart = (uint32_t)row * width;
+    int col = border;
+    int *const rspan = span + 2 * row;
+    while(col < width - border)
     {
-      int yUp = y - 1, yDown = y + 1;
-      gboolean lastXUp = FALSE, lastXDown = FALSE, firstXUp = FALSE, firstXDown = FALSE;
-      d[y*w+x] = id;
-      cnt++;
-      if(yUp >= border && d[yUp*w+x] == 1)
+      if(d[rowstart + col] != 1)
       {
-        _push_stack(x, yUp, stack); firstXUp = lastXUp = TRUE;
+        col++;
+        continue;
       }
-      else
+      const uint32_t start = rowstart + col;
+      rspan[0] = MIN(rspan[0], col);
+      for(; col < width - border && d[rowstart + col] == 1; col++)
       {
-        xp = x;
-        yp = yUp;
-        rp = yp*w + xp;
-        if(xp > border+1 && d[rp] == 0)
-        {
-          min_x = MIN(min_x, xp);
-          max_x = MAX(max_x, xp);
-          min_y = MIN(min_y, yp);
-          max_y = MAX(max_y, yp);
-          d[rp] = DT_SEG_ID_MASK | id;
-        }
+        const uint32_t i = rowstart + col;
+        parent[i] = start;
+        if(row > rfrom && d[i-width] == 1 && (i == start || d[i-width-1] != 1))
+          _uf_union(parent, i-width, start);
       }
+      rspan[1] = col;
+    }
+  }
 
-      if(yDown < h-border && d[yDown*w+x] == 1)
-      {
-        _push_stack(x, yDown, stack); firstXDown = lastXDown = TRUE;
-      }
+  // parents are always located before, so in raster order we can flatten in one go
+  int cnt = 0;
+  for(int row = rfrom; row < rto; row++)
+  {
+    for(uint32_t i = (uint32_t)row * width + span[2*row]; i < (uint32_t)row * width + span[2*row+1]; i++)
+    {
+      if(d[i] != 1) continue;
+      const uint32_t p = parent[i];
+      if(p == i)
+        d[i] = DT_SEG_ROOT | 1;
       else
       {
-        xp = x;
-        yp = yDown;
-        rp = yp*w + xp;
-        if(yp < h-border-2 && d[rp] == 0)
-        {
-          min_x = MIN(min_x, xp);
-          max_x = MAX(max_x, xp);
-          min_y = MIN(min_y, yp);
-          max_y = MAX(max_y, yp);
-          d[rp] = DT_SEG_ID_MASK | id;
-        }
-      }
-
-      int xr = x + 1;
-      while(xr < w-border && d[y*w+xr] == 1)
-      {
-        d[y*w+xr] = id;
-        cnt++;
-        if(yUp >= border && d[yUp*w + xr] == 1)
-        {
-          if(!lastXUp) { _push_stack(xr, yUp, stack); lastXUp = TRUE; }
-        }
-        else
-        {
-          xp = xr;
-          yp = yUp;
-          rp = yp*w + xp;
-          if(yp > border+1 && d[rp] == 0)
-          {
-            min_x = MIN(min_x, xp);
-            max_x = MAX(max_x, xp);
-            min_y = MIN(min_y, yp);
-            max_y = MAX(max_y, yp);
-            d[rp] = DT_SEG_ID_MASK | id;
-          }
-          lastXUp = FALSE;
-        }
-
-        if(yDown < h-border && d[yDown*w+xr] == 1)
-        {
-          if(!lastXDown) { _push_stack(xr, yDown, stack); lastXDown = TRUE; }
-        }
-        else
+        const uint32_t r = parent[p];
+        parent[i] = r;
+        d[i] = r;
+        d[r]++;
+        if((d[r] & DT_SEG_SIZE) == 4)
         {
-          xp = xr;
-          yp = yDown;
-          rp = yp*w + xp;
-          if(yp < h-border-2 && d[rp] == 0)
-          {
-            min_x = MIN(min_x, xp);
-            max_x = MAX(max_x, xp);
-            min_y = MIN(min_y, yp);
-            max_y = MAX(max_y, yp);
-            d[rp] = DT_SEG_ID_MASK | id;
-          }
-          lastXDown = FALSE;
+          d[r] |= DT_SEG_LISTED;
+          list[cnt++] = r;
         }
-        xr++;
-      }
-
-      xp = xr;
-      yp = y;
-      rp = yp*w + xp;
-      if(xp < w-border-2 && d[rp] == 0)
-      {
-        min_x = MIN(min_x, xp);
-        max_x = MAX(max_x, xp);
-        min_y = MIN(min_y, yp);
-        max_y = MAX(max_y, yp);
-        d[rp] = DT_SEG_ID_MASK | id;
-      }
-
-      int xl = x - 1;
-      lastXUp = firstXUp;
-      lastXDown = firstXDown;
-      while(xl >= border && d[y*w+xl] == 1)
-      {
-        d[y*w+xl] = id;
-        cnt++;
-        if(yUp >= border && d[yUp*w+xl] == 1)
-        {
-          if(!lastXUp) { _push_stack(xl, yUp, stack); lastXUp = TRUE; }
-        }
-        else
-        {
-          xp = xl;
-          yp = yUp;
-          rp = yp*w + xp;
-          if(yp > border+1 && d[rp] == 0)
-          {
-            min_x = MIN(min_x, xp);
-            max_x = MAX(max_x, xp);
-            min_y = MIN(min_y, yp);
-            max_y = MAX(max_y, yp);
-            d[rp] = DT_SEG_ID_MASK | id;
-          }
-          lastXUp = FALSE;
-        }
-
-        if(yDown < h-border && d[yDown*w+xl] == 1)
-        {
-          if(!lastXDown) { _push_stack(xl, yDown, stack); lastXDown = TRUE; }
-        }
-        else
-        {
-          xp = xl;
-          yp = yDown;
-          rp = yp*w + xp;
-          if(yp < h-border-2 && d[rp] == 0)
-          {
-            min_x = MIN(min_x, xp);
-            max_x = MAX(max_x, xp);
-            min_y = MIN(min_y, yp);
-            max_y = MAX(max_y, yp);
-            d[rp] = DT_SEG_ID_MASK | id;
-          }
-          lastXDown = FALSE;
-        }
-        xl--;
-      }
-
-      d[y*w+x] = id;
-
-      xp = xl;
-      yp = y;
-      rp = yp*w + xp;
-      if(xp > border+1 && d[rp] == 0)
-      {
-        min_x = MIN(min_x, xp);
-        max_x = MAX(max_x, xp);
-        min_y = MIN(min_y, yp);
-        max_y = MAX(max_y, yp);
-        d[rp] = DT_SEG_ID_MASK | id;
       }
     }
   }
 
-  const gboolean success = cnt > 3;
-  if(!success) // To avoid oversegmentizing we only use segments with a minimum size of 4
+  // small components might grow across the strip borders
+  for(int row = rfrom; row < rto; row += MAX(1, rto - rfrom - 1))
   {
-    // data in too In any case we want to revert border markings too
-    for(int row = min_y; row <= max_y; row++)
+    for(uint32_t i = (uint32_t)row * width + span[2*row]; i < (uint32_t)row * width + span[2*row+1]; i++)
     {
-      for(int col = min_x; col <= max_x; col++)
+      if(!d[i]) continue;
+      const uint32_t r = _local_root(d, i);
+      if(!(d[r] & DT_SEG_LISTED))
       {
-        size_t loc = (size_t)w*row + col;
-        if(d[loc] == id)
-          d[loc] = 1;
-        else if(d[loc] == (id | DT_SEG_ID_MASK))
-          d[loc] = 0;
+        d[r] |= DT_SEG_LISTED;
+        list[cnt++] = r;
       }
     }
   }
-  else
+
+  qsort(list, cnt, sizeof(uint32_t), _cmp_location);
+  return cnt;
+}
+
+// write the final id's of a row, parent is only read
+static inline void _finalize_row(uint32_t *d, const uint32_t *parent, const int *span, const int row, const int width)
+{
+  uint32_t label = 0;
+  uint32_t id = 0;
+  for(uint32_t i = (uint32_t)row * width + span[2*row]; i < (uint32_t)row * width + span[2*row+1]; i++)
   {
-    seg->size[id] = cnt;
-    seg->xmin[id] = min_x;
-    seg->xmax[id] = max_x;
-    seg->ymin[id] = min_y;
-    seg->ymax[id] = max_y;
-
-    seg->nr += 1;
-    _clear_segment_slot(seg, id+1);
+    if(!d[i]) continue;
+    const uint32_t r = _local_root(d, i);
+    // all locations of a run share the root
+    if(r != label)
+    {
+      label = r;
+      id = _final_id(parent, r);
+    }
+    d[i] = id;
   }
+}
 
-  return success;
+// mark the border locations of a row with the lowest neighbouring segment id, staying away
+// from the duplicated image borders. The rows above and below must be final.
+static inline void _mark_row(uint32_t *d,
+                             dt_iop_segment_t *ts,
+                             const int *span,
+                             const int row,
+                             const int width,
+                             const int height,
+                             const int border)
+{
+  const int cfrom = MAX(border, MIN(MIN(span[2*row-2], span[2*row]), span[2*row+2]) - 1);
+  const int cto = MIN(width - border, MAX(MAX(span[2*row-1], span[2*row+1]), span[2*row+3]) + 1);
+#define DT_SEG_VALID(v) ((v) > 1 && !((v) & DT_SEG_ID_MASK))
+  for(int col = cfrom; col < cto; col++)
+  {
+    const size_t i = (size_t)row * width + col;
+    if(d[i] || !(d[i-width] | d[i+width] | d[i-1] | d[i+1])) continue;
+
+    uint32_t mark = UINT32_MAX;
+    if(row > border + 1 && DT_SEG_VALID(d[i+width]))          mark = MIN(mark, d[i+width]);
+    if(row < height - border - 2 && DT_SEG_VALID(d[i-width])) mark = MIN(mark, d[i-width]);
+    if(col < width - border - 2 && DT_SEG_VALID(d[i-1]))      mark = MIN(mark, d[i-1]);
+    if(col > border + 1 && DT_SEG_VALID(d[i+1]))              mark = MIN(mark, d[i+1]);
+    if(mark == UINT32_MAX) continue;
+
+    d[i] = DT_SEG_ID_MASK | mark;
+    ts[mark].xmin = MIN(ts[mark].xmin, col);
+    ts[mark].xmax = MAX(ts[mark].xmax, col);
+    ts[mark].ymin = MIN(ts[mark].ymin, row);
+    ts[mark].ymax = MAX(ts[mark].ymax, row);
+  }
+#undef DT_SEG_VALID
 }
 
 // User interface
 void dt_segmentize_plane(dt_iop_segmentation_t *seg)
 {
-  dt_ff_stack_t stack;
+  uint32_t *d = seg->data;
+  uint32_t *parent = seg->tmp;
   const int width = seg->width;
   const int height = seg->height;
-  stack.size = (size_t)width * height / 32;
-  stack.el = dt_alloc_align_type(dt_pos_t, stack.size);
-  if(!stack.el)
+  const int border = seg->border;
+  const int rows = height - 2 * border;
+  if(rows <= 0 || width - 2 * border <= 0) return;
+
+  const int strips = (rows + DT_SEG_STRIP - 1) / DT_SEG_STRIP;
+  // a strip has at most a quarter of its locations in components of size 4 and
+  // at most one component per location of the border rows
+  const size_t list_size = (size_t)DT_SEG_STRIP * width / 4 + width + 1;
+  uint32_t *lists = dt_alloc_align_type(uint32_t, list_size * strips);
+  int *list_cnt = dt_alloc_align_int(strips);
+  int *span = dt_alloc_align_int(2 * height);
+  dt_iop_segment_t *tstats = NULL;
+  if(!lists || !list_cnt || !span)
   {
-    dt_print(DT_DEBUG_ALWAYS, "[segmentize_plane] can't allocate segmentation stack");
-    return;
+    dt_print(DT_DEBUG_ALWAYS, "[segmentize_plane] can't allocate labelling buffers");
+    goto finish;
   }
-  const int border = seg->border;
+  for(int row = 0; row < height; row++)
+  {
+    span[2*row] = width;
+    span[2*row+1] = 0;
+  }
+
+  // 1. label all strips independently
+  DT_OMP_PRAGMA(parallel for default(firstprivate) schedule(dynamic))
+  for(int s = 0; s < strips; s++)
+  {
+    const int rfrom = border + s * DT_SEG_STRIP;
+    const int rto = MIN(rfrom + DT_SEG_STRIP, height - border);
+    list_cnt[s] = _label_strip(d, parent, lists + s * list_size, span, rfrom, rto, width, border);
+  }
+
+  // 2. merge the strips, the roots keep the sizes
+  for(int s = 1; s < strips; s++)
+  {
+    const int row = border + s * DT_SEG_STRIP;
+    const int cto = MIN(span[2*row+1], span[2*row-1]);
+    for(int col = MAX(span[2*row], span[2*row-2]); col < cto; col++)
+    {
+      const uint32_t i = (uint32_t)row * width + col;
+      if(!d[i] || !d[i-width] || (d[i-1] && d[i-width-1])) continue;
+
+      const uint32_t ra = _uf_find(parent, _local_root(d, i-width));
+      const uint32_t rb = _uf_find(parent, _local_root(d, i));
+      if(ra == rb) continue;
+      const uint32_t r = _uf_union(parent, ra, rb);
+      d[r] += d[r == ra ? rb : ra] & DT_SEG_SIZE;
+    }
+  }
+
+  // 3. segment id's are given in raster order of the roots. To avoid oversegmentizing
+  //    we only use segments with a minimum size of 4
   int id = 2;
-  for(int row = border; row < height - border; row++)
+  gboolean overflow = FALSE;
+  for(int s = 0; s < strips; s++)
   {
-    for(int col = border; col < width - border; col++)
+    const uint32_t *list = lists + s * list_size;
+    for(int k = 0; k < list_cnt[s]; k++)
     {
-      if(id >= (seg->slots - 2))
-        goto finish;
-      if(seg->data[(size_t)width * row + col] == 1)
+      const uint32_t r = list[k];
+      if(parent[r] != r) continue;
+
+      const int size = d[r] & DT_SEG_SIZE;
+      if(size > 3 && id < seg->slots - 2)
       {
-        if(_floodfill_segmentize(row, col, seg, width, height, id, &stack))
-          id++;
+        dt_iop_segment_t *sg = &seg->stats[id];
+        memset(sg, 0, sizeof(dt_iop_segment_t));
+        sg->size = size;
+        sg->xmin = sg->xmax = r % width;
+        sg->ymin = sg->ymax = r / width;
+        parent[r] = DT_SEG_ROOT | id++;
+      }
+      else
+      {
+        overflow |= size > 3;
+        parent[r] = DT_SEG_ROOT | 1;
       }
     }
   }
+  seg->nr = id;
+  _clear_segment_slot(seg, id);
 
-  finish:
+  size_t padded_size;
+  tstats = dt_alloc_perthread(id, sizeof(dt_iop_segment_t), &padded_size);
+  if(!tstats)
+  {
+    dt_print(DT_DEBUG_ALWAYS, "[segmentize_plane] can't allocate segment buffer");
+    goto finish;
+  }
+  for(int t = 0; t < dt_get_num_threads(); t++)
+  {
+    dt_iop_segment_t *ts = dt_get_bythread(tstats, padded_size, t);
+    for(int k = 2; k < id; k++)
+      ts[k] = seg->stats[k];
+  }
 
-  if(id >= (seg->slots - 2))
+  // 4. write the final id's and mark the borders. Neighbouring strips are never processed
+  //    at the same time, the first and last rows of the even strips are marked later
+  for(int odd = 0; odd < 2; odd++)
+  {
+    DT_OMP_PRAGMA(parallel for default(firstprivate) schedule(dynamic))
+    for(int s = odd; s < strips; s += 2)
+    {
+      dt_iop_segment_t *ts = dt_get_perthread(tstats, padded_size);
+      const int rfrom = border + s * DT_SEG_STRIP;
+      const int rto = MIN(rfrom + DT_SEG_STRIP, height - border);
+      _finalize_row(d, parent, span, rfrom, width);
+      for(int row = rfrom; row < rto; row++)
+      {
+        if(row + 1 < rto) _finalize_row(d, parent, span, row + 1, width);
+        const gboolean later = !odd && ((row == rfrom && s > 0) || (row == rto - 1 && s < strips - 1));
+        if(!later) _mark_row(d, ts, span, row, width, height, border);
+      }
+    }
+  }
+  DT_OMP_FOR()
+  for(int s = 0; s < strips; s += 2)
+  {
+    dt_iop_segment_t *ts = dt_get_perthread(tstats, padded_size);
+    const int rfrom = border + s * DT_SEG_STRIP;
+    const int rto = MIN(rfrom + DT_SEG_STRIP, height - border);
+    if(s > 0) _mark_row(d, ts, span, rfrom, width, height, border);
+    if(s < strips - 1) _mark_row(d, ts, span, rto - 1, width, height, border);
+  }
+
+  // 5. the surrounding rectangles include the root and the border locations
+  DT_OMP_FOR()
+  for(int k = 2; k < id; k++)
+  {
+    dt_iop_segment_t *sg = &seg->stats[k];
+    for(int t = 0; t < dt_get_num_threads(); t++)
+    {
+      const dt_iop_segment_t *ts = dt_get_bythread(tstats, padded_size, t);
+      sg->xmin = MIN(sg->xmin, ts[k].xmin);
+      sg->xmax = MAX(sg->xmax, ts[k].xmax);
+      sg->ymin = MIN(sg->ymin, ts[k].ymin);
+      sg->ymax = MAX(sg->ymax, ts[k].ymax);
+    }
+  }
+
+  if(overflow)
     dt_print(DT_DEBUG_ALWAYS, "[segmentize_plane] %ix%i number of segments exceeds maximum=%i",
              (int)width, (int)height, seg->slots);
 
-  dt_free_align(stack.el);
+finish:
+  dt_free_align(span);
+  dt_free_align(tstats);
+  dt_free_align(list_cnt);
+  dt_free_align(lists);
 }
 
 void dt_segments_combine(dt_iop_segmentation_t *seg, const int radius)
@@ -605,41 +659,26 @@ void dt_segments_combine(dt_iop_segmentation_t *seg, const int radius)
 void dt_segmentation_free_struct(dt_iop_segmentation_t *seg)
 {
   dt_free_align(seg->data);
-  dt_free_align(seg->tmp);
-  dt_free_align(seg->size);
-  dt_free_align(seg->xmin);
-  dt_free_align(seg->ymin);
-  dt_free_align(seg->xmax);
-  dt_free_align(seg->ymax);
-  dt_free_align(seg->val1);
-  dt_free_align(seg->val2);
+  dt_free_align(seg->stats);
   memset(seg, 0, sizeof(dt_iop_segmentation_t));
 }
 
-// returns TRUE in case of errors
+// returns TRUE in case of errors, tmp must hold width * height locations
 gboolean dt_segmentation_init_struct(dt_iop_segmentation_t *seg,
                                      const int width,
                                      const int height,
                                      const int border,
-                                     const int islots)
+                                     const int islots,
+                                     uint32_t *tmp)
 {
   memset(seg, 0, sizeof(dt_iop_segmentation_t));
   const int slots = MAX(256, MIN(islots, DT_SEG_ID_MASK - 2));
   const size_t bsize = (size_t) width * height * sizeof(uint32_t);
 
   seg->data =   dt_calloc_aligned(bsize);
-  seg->tmp =    dt_alloc_aligned(bsize);
-  seg->size =   dt_alloc_align_int(slots);
-  seg->xmin =   dt_alloc_align_int(slots);
-  seg->xmax =   dt_alloc_align_int(slots);
-  seg->ymin =   dt_alloc_align_int(slots);
-  seg->ymax =   dt_alloc_align_int(slots);
-  seg->val1 =   dt_alloc_align_float(slots);
-  seg->val2 =   dt_alloc_align_float(slots);
-
-  if(!seg->data || !seg->size
-                || !seg->xmin || !seg->xmax || !seg->ymin || !seg->ymax
-                || !seg->val2 || !seg->val2)
+  seg->stats =  dt_alloc_align_type(dt_iop_segment_t, slots);
+
+  if(!seg->data || !seg->stats || !tmp)
   {
     dt_segmentation_free_struct(seg);
     return TRUE;
@@ -651,6 +690,7 @@ gboolean dt_segmentation_init_struct(dt_iop_segmentation_t *seg,
   seg->slots = slots;
   seg->width = width;
   seg->height = height;
+  seg->tmp = tmp;
   _clear_segment_slot(seg, 0);
   _clear_segment_slot(seg, 1);
 
@@ -43,6 +43,8 @@ struct dt_dev_pixelpipe_iop_t;
 struct dt_iop_roi_t;
 struct dt_develop_tiling_t;
 struct dt_iop_buffer_dsc_t;
+struct dt_dev_raw_frontend_t;
+struct dt_dev_warp_step_t;
 struct _GtkWidget;
 
 #ifndef DT_IOP_PARAMS_T
@@ -291,6 +293,36 @@ DEFAULT(int, process_tiling_cl, struct dt_iop_module_t *self,
                                 const int bpp);
 #endif
 
+/** describe the pointwise operation of a raw module for the fused raw front-end and
+ *  do the side effects process() would have on the pipe. Only called if the module set
+ *  piece->raw_frontend_ready in commit_params, returning FALSE falls back to process(). */
+OPTIONAL(gboolean, fuse_raw_frontend, struct dt_iop_module_t *self,
+                                     struct dt_dev_pixelpipe_iop_t *piece,
+                                     struct dt_dev_raw_frontend_t *fe,
+                                     const struct dt_iop_roi_t *const roi_in,
+                                     const struct dt_iop_roi_t *const roi_out);
+
+/** prepare the strip processing of a pointwise module and do the side effects process()
+ *  would have on the pipe. Returning FALSE falls back to process(). */
+OPTIONAL(gboolean, fuse_pointwise, struct dt_iop_module_t *self,
+                                   struct dt_dev_pixelpipe_iop_t *piece,
+                                   const struct dt_iop_roi_t *const roi);
+/** process a strip of npixels 4-channel pixels, in and out might be the same buffer.
+ *  Only called if the module set piece->pointwise_ready in commit_params. */
+OPTIONAL(void, process_pointwise, struct dt_iop_module_t *self,
+                                  struct dt_dev_pixelpipe_iop_t *piece,
+                                  const float *const in,
+                                  float *const out,
+                                  const size_t npixels);
+
+/** describe the mapping from output to input buffer coordinates of a distorting module
+ *  for a composed warp, must not have side effects. Returning FALSE falls back to process(). */
+OPTIONAL(gboolean, fuse_warp, struct dt_iop_module_t *self,
+                              struct dt_dev_pixelpipe_iop_t *piece,
+                              const struct dt_iop_roi_t *const roi_in,
+                              const struct dt_iop_roi_t *const roi_out,
+                              struct dt_dev_warp_step_t *step);
+
 /** this functions are used for distort iop
  * points is an array of float {x1,y1,x2,y2,...}
  * size is 2*points_count */
@@ -193,6 +193,23 @@ typedef struct dt_iop_lens_gui_data_t
 } dt_iop_lens_gui_data_t;
 
 
+// grid spacing, number of cached distortion maps and their total size
+// in bytes, see "distortion map cache"
+#define LENS_MAP_STEP 8
+#define LENS_MAP_ENTRIES 4
+#define LENS_MAP_MAX_SIZE ((size_t)32 << 20)
+
+typedef struct dt_iop_lens_map_t
+{
+  dt_hash_t hash;
+  int gw, gh;          // number of grid nodes
+  int x0, y0, x1, y1;  // roi pixels outside [x0,x1) x [y0,y1) are evaluated exactly
+  int users;           // processes currently reading the grid
+  gboolean cached;     // owned by the cache
+  uint64_t stamp;      // last access, for replacement
+  float *grid;         // x/y of red, green and blue for every node
+} dt_iop_lens_map_t;
+
 typedef struct dt_iop_lens_global_data_t
 {
   int kernel_lens_distort_bilinear;
@@ -204,6 +221,9 @@ typedef struct dt_iop_lens_global_data_t
   int kernel_md_vignette;
   int kernel_md_correct;
   lfDatabase *db;
+  dt_pthread_mutex_t map_lock;
+  dt_iop_lens_map_t *maps[LENS_MAP_ENTRIES];
+  uint64_t map_stamp;
 } dt_iop_lens_global_data_t;
 
 typedef struct dt_iop_lens_data_t
@@ -244,6 +264,8 @@ typedef struct dt_iop_lens_data_t
   float reserved[2];
   float vigspline[VIGSPLINES];
   dt_hash_t vighash;
+  // hash of everything the distortion map depends on except the roi
+  dt_hash_t map_hash;
 } dt_iop_lens_data_t;
 
 
@@ -948,6 +970,213 @@ int legacy_params(dt_iop_module_t *self,
   return 1;
 }
 
+/* distortion map cache
+ *
+ * the distorted coordinates only depend on the correction parameters
+ * and the region of interest, not on the pixel data. we keep them for
+ * the last few requests on a grid of LENS_MAP_STEP pixels that is
+ * refined bilinearly, so darkroom refreshes and batch exports with the
+ * same lens setup don't have to evaluate the correction model again.
+ * the maps are shared by all pipes.
+ *
+ * the error of the bilinear refinement grows with the curvature of the
+ * distortion, which is largest at the image borders. pixels within
+ * LENS_MAP_STEP of the image borders are therefore always evaluated
+ * exactly, inside the error stays far below the resampling error, see
+ * src/tests/unittests/iop/test_lens.cc for the measured tolerance.
+ *
+ * a map holds 6 floats per LENS_MAP_STEP^2 pixels, about 9MB for a 24MP
+ * export. the cache keeps at most LENS_MAP_MAX_SIZE bytes of maps, which
+ * is accounted for as overhead in the tiling callbacks.
+ */
+static dt_hash_t _lens_map_hash(const dt_hash_t hash,
+                                const dt_iop_roi_t *const roi_in,
+                                const dt_iop_roi_t *const roi_out,
+                                dt_dev_pixelpipe_iop_t *piece,
+                                const int mask)
+{
+  const int key[7] = { roi_out->x, roi_out->y, roi_out->width, roi_out->height,
+                       piece->buf_in.width, piece->buf_in.height, mask };
+  const dt_hash_t h = dt_hash(hash, key, sizeof(key));
+  return dt_hash(h, &roi_in->scale, sizeof(roi_in->scale));
+}
+
+// look up a map, the caller has to _lens_map_release() it after use.
+// on a miss a new map with an uncomputed grid is returned, the caller
+// fills it and hands it over with _lens_map_insert().
+static dt_iop_lens_map_t *_lens_map_acquire(dt_iop_lens_global_data_t *gd,
+                                            const dt_hash_t hash,
+                                            dt_dev_pixelpipe_iop_t *piece,
+                                            const dt_iop_roi_t *const roi_out,
+                                            gboolean *found)
+{
+  *found = FALSE;
+  dt_pthread_mutex_lock(&gd->map_lock);
+  for(int k = 0; k < LENS_MAP_ENTRIES; k++)
+  {
+    dt_iop_lens_map_t *map = gd->maps[k];
+    if(map && map->hash == hash)
+    {
+      map->users++;
+      map->stamp = ++gd->map_stamp;
+      dt_pthread_mutex_unlock(&gd->map_lock);
+      *found = TRUE;
+      return map;
+    }
+  }
+  dt_pthread_mutex_unlock(&gd->map_lock);
+
+  dt_iop_lens_map_t *map = (dt_iop_lens_map_t *)calloc(1, sizeof(dt_iop_lens_map_t));
+  if(!map) return NULL;
+  map->hash = hash;
+  map->gw = (roi_out->width - 1) / LENS_MAP_STEP + 2;
+  map->gh = (roi_out->height - 1) / LENS_MAP_STEP + 2;
+  // image borders in roi coordinates
+  const int width = roundf(roi_out->scale * piece->buf_out.width);
+  const int height = roundf(roi_out->scale * piece->buf_out.height);
+  map->x0 = LENS_MAP_STEP - roi_out->x;
+  map->y0 = LENS_MAP_STEP - roi_out->y;
+  map->x1 = width - LENS_MAP_STEP - roi_out->x;
+  map->y1 = height - LENS_MAP_STEP - roi_out->y;
+  map->users = 1;
+  map->grid = dt_alloc_align_float((size_t)6 * map->gw * map->gh);
+  if(!map->grid)
+  {
+    free(map);
+    return NULL;
+  }
+  return map;
+}
+
+static void _lens_map_free(dt_iop_lens_map_t *map)
+{
+  dt_free_align(map->grid);
+  free(map);
+}
+
+static size_t _lens_map_size(const dt_iop_lens_map_t *const map)
+{
+  return sizeof(float) * 6 * map->gw * map->gh;
+}
+
+// put a freshly computed map into the cache, dropping the least recently
+// used ones not in use until it fits into LENS_MAP_ENTRIES and
+// LENS_MAP_MAX_SIZE. if that is not possible the map stays private and
+// is freed on release.
+static void _lens_map_insert(dt_iop_lens_global_data_t *gd,
+                             dt_iop_lens_map_t *map)
+{
+  dt_pthread_mutex_lock(&gd->map_lock);
+  // if another pipe was faster ours stays private
+  gboolean duplicate = FALSE;
+  size_t total = _lens_map_size(map);
+  for(int k = 0; k < LENS_MAP_ENTRIES; k++)
+  {
+    if(!gd->maps[k]) continue;
+    duplicate = duplicate || gd->maps[k]->hash == map->hash;
+    total += _lens_map_size(gd->maps[k]);
+  }
+
+  int slot = -1;
+  while(!duplicate && _lens_map_size(map) <= LENS_MAP_MAX_SIZE)
+  {
+    slot = -1;
+    for(int k = 0; k < LENS_MAP_ENTRIES && slot < 0; k++)
+      if(!gd->maps[k]) slot = k;
+    if(slot >= 0 && total <= LENS_MAP_MAX_SIZE) break;
+
+    int lru = -1;
+    for(int k = 0; k < LENS_MAP_ENTRIES; k++)
+      if(gd->maps[k] && gd->maps[k]->users == 0
+         && (lru < 0 || gd->maps[k]->stamp < gd->maps[lru]->stamp))
+        lru = k;
+    slot = -1;
+    if(lru < 0) break;
+
+    total -= _lens_map_size(gd->maps[lru]);
+    _lens_map_free(gd->maps[lru]);
+    gd->maps[lru] = NULL;
+  }
+
+  if(slot >= 0)
+  {
+    map->cached = TRUE;
+    map->stamp = ++gd->map_stamp;
+    gd->maps[slot] = map;
+  }
+  dt_pthread_mutex_unlock(&gd->map_lock);
+}
+
+static void _lens_map_release(dt_iop_lens_global_data_t *gd,
+                              dt_iop_lens_map_t *map)
+{
+  if(!map) return;
+  dt_pthread_mutex_lock(&gd->map_lock);
+  map->users--;
+  const gboolean drop = !map->cached && map->users == 0;
+  dt_pthread_mutex_unlock(&gd->map_lock);
+  if(drop) _lens_map_free(map);
+}
+
+static void _lens_map_cleanup(dt_iop_lens_global_data_t *gd)
+{
+  for(int k = 0; k < LENS_MAP_ENTRIES; k++)
+  {
+    if(gd->maps[k]) _lens_map_free(gd->maps[k]);
+    gd->maps[k] = NULL;
+  }
+}
+
+// is pixel x, y of the output roi close to the image borders?
+static inline gboolean _lens_map_border(const dt_iop_lens_map_t *const map,
+                                        const int x,
+                                        const int y)
+{
+  return x < map->x0 || x >= map->x1 || y < map->y0 || y >= map->y1;
+}
+
+// bilinearly refine row y of the output roi from the map grid into 6
+// coordinates per pixel, laid out like lensfun's subpixel distortion.
+// if a modifier is given, pixels close to the image borders and cells
+// touching undefined coordinates are computed exactly.
+static void _lens_map_row(const dt_iop_lens_map_t *const map,
+                          const lfModifier *modifier,
+                          const dt_iop_roi_t *const roi_out,
+                          const int y,
+                          float *out)
+{
+  if(modifier && (y < map->y0 || y >= map->y1))
+  {
+    modifier->ApplySubpixelGeometryDistortion(roi_out->x, roi_out->y + y,
+                                              roi_out->width, 1, out);
+    return;
+  }
+
+  const int j = y / LENS_MAP_STEP;
+  const float fy = (float)(y - j * LENS_MAP_STEP) / LENS_MAP_STEP;
+  const float *const g0 = map->grid + (size_t)6 * j * map->gw;
+  const float *const g1 = g0 + (size_t)6 * map->gw;
+
+  for(int x = 0; x < roi_out->width; x++, out += 6)
+  {
+    const int i = x / LENS_MAP_STEP;
+    const float fx = (float)(x - i * LENS_MAP_STEP) / LENS_MAP_STEP;
+    const float *const a = g0 + 6 * i;
+    const float *const b = g1 + 6 * i;
+    gboolean valid = TRUE;
+    for(int k = 0; k < 6; k++)
+    {
+      const float top = a[k] + fx * (a[k + 6] - a[k]);
+      const float bottom = b[k] + fx * (b[k + 6] - b[k]);
+      out[k] = top + fy * (bottom - top);
+      valid = valid && isfinite(out[k]);
+    }
+    if(modifier && (!valid || _lens_map_border(map, x, y)))
+      modifier->ApplySubpixelGeometryDistortion(roi_out->x + x, roi_out->y + y,
+                                                1, 1, out);
+  }
+}
+
 /* Lensfun processing start */
 static lfModifier * _get_modifier(int *mods_done,
                                   const int w,
@@ -1041,6 +1270,42 @@ static float _get_autoscale_lf(dt_iop_module_t *self,
   return scale;
 }
 
+// evaluate the lensfun distortion at the grid nodes of a new map
+static void _lens_map_fill_lf(dt_iop_lens_map_t *map,
+                              const lfModifier *modifier,
+                              const dt_iop_roi_t *const roi_out)
+{
+  DT_OMP_FOR(collapse(2) shared(modifier))
+  for(int j = 0; j < map->gh; j++)
+    for(int i = 0; i < map->gw; i++)
+      modifier->ApplySubpixelGeometryDistortion(roi_out->x + i * LENS_MAP_STEP,
+                                                roi_out->y + j * LENS_MAP_STEP,
+                                                1, 1,
+                                                map->grid + (size_t)6 * (j * map->gw + i));
+}
+
+// get the cached distortion map for this piece and roi, computing it on a miss
+static dt_iop_lens_map_t *_lens_map_get_lf(dt_iop_module_t *self,
+                                           dt_dev_pixelpipe_iop_t *piece,
+                                           const lfModifier *modifier,
+                                           const dt_iop_roi_t *const roi_in,
+                                           const dt_iop_roi_t *const roi_out,
+                                           const int used_lf_mask)
+{
+  const dt_iop_lens_data_t *const d = (dt_iop_lens_data_t *)piece->data;
+  dt_iop_lens_global_data_t *gd = (dt_iop_lens_global_data_t *)self->global_data;
+
+  const dt_hash_t hash = _lens_map_hash(d->map_hash, roi_in, roi_out, piece, used_lf_mask);
+  gboolean found;
+  dt_iop_lens_map_t *map = _lens_map_acquire(gd, hash, piece, roi_out, &found);
+  if(map && !found)
+  {
+    _lens_map_fill_lf(map, modifier, roi_out);
+    _lens_map_insert(gd, map);
+  }
+  return map;
+}
+
 static void _process_lf(dt_iop_module_t *self,
                         dt_dev_pixelpipe_iop_t *piece,
                         const void *const ivoid,
@@ -1098,13 +1363,18 @@ static void _process_lf(dt_iop_module_t *self,
 
       size_t padded_bufsize;
       float *const buf = dt_alloc_perthread_float(bufsize, &padded_bufsize);
+      dt_iop_lens_map_t *map = _lens_map_get_lf(self, piece, modifier,
+                                                roi_in, roi_out, used_lf_mask);
 
-      DT_OMP_FOR(dt_omp_sharedconst(buf) shared(modifier))
+      DT_OMP_FOR(dt_omp_sharedconst(buf) shared(modifier, map))
       for(int y = 0; y < roi_out->height; y++)
       {
         float *bufptr = (float*)dt_get_perthread(buf, padded_bufsize);
-        modifier->ApplySubpixelGeometryDistortion(roi_out->x, roi_out->y + y,
-                                                  roi_out->width, 1, bufptr);
+        if(map)
+          _lens_map_row(map, modifier, roi_out, y, bufptr);
+        else
+          modifier->ApplySubpixelGeometryDistortion(roi_out->x, roi_out->y + y,
+                                                    roi_out->width, 1, bufptr);
 
         // reverse transform the global coords from lf to our buffer
         float *out = ((float *)ovoid) + (size_t)y * roi_out->width * ch;
@@ -1155,6 +1425,7 @@ static void _process_lf(dt_iop_module_t *self,
           }
         }
       }
+      _lens_map_release((dt_iop_lens_global_data_t *)self->global_data, map);
       dt_free_align(buf);
     }
     else
@@ -1208,15 +1479,20 @@ static void _process_lf(dt_iop_module_t *self,
       const size_t buf2size = (size_t)roi_out->width * 2 * 3;
       size_t padded_buf2size;
       float *const buf2 = dt_alloc_perthread_float(buf2size, &padded_buf2size);
+      dt_iop_lens_map_t *map = _lens_map_get_lf(self, piece, modifier,
+                                                roi_in, roi_out, used_lf_mask);
 
-      DT_OMP_FOR(dt_omp_sharedconst(buf2) shared(buf, modifier))
+      DT_OMP_FOR(dt_omp_sharedconst(buf2) shared(buf, modifier, map))
       for(int y = 0; y < roi_out->height; y++)
       {
         float *buf2ptr = (float*)dt_get_perthread(buf2, padded_buf2size);
-        modifier->ApplySubpixelGeometryDistortion(roi_out->x,
-                                                  roi_out->y + y,
-                                                  roi_out->width,
-                                                  1, buf2ptr);
+        if(map)
+          _lens_map_row(map, modifier, roi_out, y, buf2ptr);
+        else
+          modifier->ApplySubpixelGeometryDistortion(roi_out->x,
+                                                    roi_out->y + y,
+                                                    roi_out->width,
+                                                    1, buf2ptr);
         // reverse transform the global coords from lf to our buffer
         float *out = ((float *)ovoid) + (size_t)y * roi_out->width * ch;
         for(int x = 0; x < roi_out->width; x++, buf2ptr += 6, out += ch)
@@ -1266,6 +1542,7 @@ static void _process_lf(dt_iop_module_t *self,
           }
         }
       }
+      _lens_map_release((dt_iop_lens_global_data_t *)self->global_data, map);
       dt_free_align(buf2);
     }
     else
@@ -1376,14 +1653,20 @@ static int _process_cl_lf(dt_iop_module_t *self,
                    | LF_MODIFY_GEOMETRY
                    | LF_MODIFY_SCALE))
     {
-      DT_OMP_FOR(dt_omp_sharedconst(raw_monochrome) shared(tmpbuf, d, modifier))
+      dt_iop_lens_map_t *map = _lens_map_get_lf(self, piece, modifier,
+                                                roi_in, roi_out, used_lf_mask);
+      DT_OMP_FOR(shared(tmpbuf, modifier, map))
       for(int y = 0; y < roi_out->height; y++)
       {
         float *pi = tmpbuf + (size_t)y * tmpbufwidth;
-        modifier->ApplySubpixelGeometryDistortion(roi_out->x,
-                                                  roi_out->y + y,
-                                                  roi_out->width, 1, pi);
+        if(map)
+          _lens_map_row(map, modifier, roi_out, y, pi);
+        else
+          modifier->ApplySubpixelGeometryDistortion(roi_out->x,
+                                                    roi_out->y + y,
+                                                    roi_out->width, 1, pi);
       }
+      _lens_map_release(gd, map);
 
       err = dt_opencl_write_buffer_to_device(devid, tmpbuf,
                                              dev_tmpbuf, 0,
@@ -1487,14 +1770,20 @@ static int _process_cl_lf(dt_iop_module_t *self,
                    | LF_MODIFY_GEOMETRY
                    | LF_MODIFY_SCALE))
     {
-      DT_OMP_FOR(dt_omp_sharedconst(raw_monochrome) shared(tmpbuf, d, modifier))
+      dt_iop_lens_map_t *map = _lens_map_get_lf(self, piece, modifier,
+                                                roi_in, roi_out, used_lf_mask);
+      DT_OMP_FOR(shared(tmpbuf, modifier, map))
       for(int y = 0; y < roi_out->height; y++)
       {
         float *pi = tmpbuf + (size_t)y * tmpbufwidth;
-        modifier->ApplySubpixelGeometryDistortion(roi_out->x,
-                                                  roi_out->y + y,
-                                                  roi_out->width, 1, pi);
+        if(map)
+          _lens_map_row(map, modifier, roi_out, y, pi);
+        else
+          modifier->ApplySubpixelGeometryDistortion(roi_out->x,
+                                                    roi_out->y + y,
+                                                    roi_out->width, 1, pi);
       }
+      _lens_map_release(gd, map);
 
       err = dt_opencl_write_buffer_to_device(devid, tmpbuf,
                                              dev_tmpbuf, 0,
@@ -1531,9 +1820,10 @@ static void _tiling_callback_lf(dt_iop_module_t *self,
                                 const dt_iop_roi_t *roi_out,
                                 dt_develop_tiling_t *tiling)
 {
-  tiling->factor = 4.5f; // in + out + tmp + tmpbuf
+  // in + out + tmp + tmpbuf + map grid
+  tiling->factor = 4.5f + 6.0f / (4 * LENS_MAP_STEP * LENS_MAP_STEP);
   tiling->maxbuf = 1.5f;
-  tiling->overhead = 0;
+  tiling->overhead = LENS_MAP_MAX_SIZE; // cached distortion maps
   tiling->overlap = 4;
   tiling->xalign = 1;
   tiling->yalign = 1;
@@ -1884,6 +2174,16 @@ static void _commit_params_lf(dt_iop_module_t *self,
   d->do_nan_checks = TRUE;
   d->tca_override = p->tca_override;
 
+  dt_hash_t hash = dt_hash(DT_INITHASH, &d->method, sizeof(d->method));
+  hash = dt_hash(hash, p->camera, strlen(p->camera));
+  hash = dt_hash(hash, p->lens, strlen(p->lens));
+  const float geometry[8] = { d->crop, d->scale, d->focal, d->distance,
+                              (float)d->inverse, (float)d->target_geom,
+                              p->tca_override ? p->tca_r : 0.0f,
+                              p->tca_override ? p->tca_b : 0.0f };
+  hash = dt_hash(hash, geometry, sizeof(geometry));
+  d->map_hash = dt_hash(hash, &d->modify_flags, sizeof(d->modify_flags));
+
   /*
    * there are certain situations when Lensfun can return NAN coordinated.
    * most common case would be when the FOV is increased.
@@ -2025,6 +2325,29 @@ static inline float _interpolate_linear_spline(const float *xi,
   return yi[ni - 1];
 }
 
+// absolute source coordinates of the three planes for the output
+// position x, y, laid out like the lens map
+static inline void _distort_md(const dt_iop_lens_data_t *const d,
+                               const float w2,
+                               const float h2,
+                               const float r,
+                               const float inv_scale_md,
+                               const float x,
+                               const float y,
+                               float *const out)
+{
+  const float cx = (x - w2) * inv_scale_md;
+  const float cy = (y - h2) * inv_scale_md;
+  const float radius = r*sqrtf(cx*cx + cy*cy);
+  for(int c = 0; c < 3; c++)
+  {
+    const float dr =
+      _interpolate_linear_spline(d->knots_dist, d->cor_rgb[c], d->nc, radius);
+    out[2 * c] = dr*cx + w2;
+    out[2 * c + 1] = dr*cy + h2;
+  }
+}
+
 static int _init_coeffs_md_v1(const dt_image_t *img,
                               const dt_iop_lens_params_t *p,
                               const float scale,
@@ -2563,6 +2886,12 @@ static void _commit_params_md(dt_iop_module_t *self,
      || (d->scale_md > 2.0f)) // reset image scale if unproper data
     d->scale_md = 1.0f;
 
+  dt_hash_t hash = dt_hash(DT_INITHASH, &d->method, sizeof(d->method));
+  hash = dt_hash(hash, &d->nc, sizeof(d->nc));
+  hash = dt_hash(hash, &d->scale_md, sizeof(d->scale_md));
+  hash = dt_hash(hash, d->knots_dist, sizeof(d->knots_dist));
+  d->map_hash = dt_hash(hash, d->cor_rgb, sizeof(d->cor_rgb));
+
   if(self->dev->gui_attached && g
      && (piece->pipe->type & DT_DEV_PIXELPIPE_PREVIEW))
   {
@@ -2594,9 +2923,10 @@ static void _tiling_callback_md(dt_iop_module_t *self,
                                 const dt_iop_roi_t *roi_out,
                                 dt_develop_tiling_t *tiling)
 {
-  tiling->factor = 4.5f; // in + out + tmp + tmpbuf
+  // in + out + tmp + tmpbuf + map grid
+  tiling->factor = 4.5f + 6.0f / (4 * LENS_MAP_STEP * LENS_MAP_STEP);
   tiling->maxbuf = 1.5f;
-  tiling->overhead = 0;
+  tiling->overhead = LENS_MAP_MAX_SIZE; // cached distortion maps
   tiling->overlap = 4;
   tiling->xalign = 1;
   tiling->yalign = 1;
@@ -2792,31 +3122,86 @@ static void _process_md(dt_iop_module_t *self,
 
   const float limw = roi_in->width - 1;
   const float limh = roi_in->height - 1;
-  DT_OMP_FOR(collapse(2))
-  for(int y = 0; y < roi_out->height; y++)
+
+  dt_iop_lens_global_data_t *gd = (dt_iop_lens_global_data_t *)self->global_data;
+  const dt_hash_t hash = _lens_map_hash(d->map_hash, roi_in, roi_out, piece, 0);
+  gboolean found;
+  dt_iop_lens_map_t *map = _lens_map_acquire(gd, hash, piece, roi_out, &found);
+  if(map && !found)
   {
-    for(int x = 0; x < roi_out->width; x++)
+    // absolute source coordinates of the three planes at the grid nodes
+    DT_OMP_FOR(collapse(2))
+    for(int j = 0; j < map->gh; j++)
     {
-      const size_t odx = 4 * (y * roi_out->width + x);
-      const float cx = (roi_out->x + x - w2) * inv_scale_md;
-      const float cy = (roi_out->y + y - h2) * inv_scale_md;
+      for(int i = 0; i < map->gw; i++)
+        _distort_md(d, w2, h2, r, inv_scale_md,
+                    roi_out->x + i * LENS_MAP_STEP, roi_out->y + j * LENS_MAP_STEP,
+                    map->grid + (size_t)6 * (j * map->gw + i));
+    }
+    _lens_map_insert(gd, map);
+  }
 
-      const float radius = r*sqrtf(cx*cx + cy*cy);
+  size_t padded_coordsize;
+  float *const coords = map ? dt_alloc_perthread_float((size_t)6 * roi_out->width,
+                                                       &padded_coordsize)
+                            : NULL;
 
-      for_each_channel(c)
+  if(coords)
+  {
+    DT_OMP_FOR(shared(map))
+    for(int y = 0; y < roi_out->height; y++)
+    {
+      float *const xy = (float *)dt_get_perthread(coords, padded_coordsize);
+      _lens_map_row(map, NULL, roi_out, y, xy);
+      for(int x = 0; x < roi_out->width; x++)
+      {
+        if(_lens_map_border(map, x, y))
+          _distort_md(d, w2, h2, r, inv_scale_md,
+                      roi_out->x + x, roi_out->y + y, xy + 6 * x);
+        const size_t odx = 4 * ((size_t)y * roi_out->width + x);
+        for_each_channel(c)
+        {
+          // use green data for alpha channel
+          const int plane = (c == 3 || pass_mode) ? 1 : c;
+          const float xs = CLAMP(xy[6 * x + 2 * plane] - roi_in->x, 0.0f, limw);
+          const float ys = CLAMP(xy[6 * x + 2 * plane + 1] - roi_in->y, 0.0f, limh);
+          out[odx+c] = dt_interpolation_compute_sample(interpolation, buf + c,
+                                                       xs, ys,
+                                                       roi_in->width, roi_in->height, 4, 4*roi_in->width);
+        }
+      }
+    }
+    dt_free_align(coords);
+  }
+  else
+  {
+    DT_OMP_FOR(collapse(2))
+    for(int y = 0; y < roi_out->height; y++)
+    {
+      for(int x = 0; x < roi_out->width; x++)
       {
-        // use green data for alpha channel
-        const int plane = (c == 3 || pass_mode) ? 1 : c;
-        const float dr =
-          _interpolate_linear_spline(d->knots_dist, d->cor_rgb[plane], d->nc, radius);
-        const float xs = CLAMP(dr*cx + w2 - roi_in->x, 0.0f, limw);
-        const float ys = CLAMP(dr*cy + h2 - roi_in->y, 0.0f, limh);
-        out[odx+c] = dt_interpolation_compute_sample(interpolation, buf + c,
-                                                     xs, ys,
-                                                     roi_in->width, roi_in->height, 4, 4*roi_in->width);
+        const size_t odx = 4 * (y * roi_out->width + x);
+        const float cx = (roi_out->x + x - w2) * inv_scale_md;
+        const float cy = (roi_out->y + y - h2) * inv_scale_md;
+
+        const float radius = r*sqrtf(cx*cx + cy*cy);
+
+        for_each_channel(c)
+        {
+          // use green data for alpha channel
+          const int plane = (c == 3 || pass_mode) ? 1 : c;
+          const float dr =
+            _interpolate_linear_spline(d->knots_dist, d->cor_rgb[plane], d->nc, radius);
+          const float xs = CLAMP(dr*cx + w2 - roi_in->x, 0.0f, limw);
+          const float ys = CLAMP(dr*cy + h2 - roi_in->y, 0.0f, limh);
+          out[odx+c] = dt_interpolation_compute_sample(interpolation, buf + c,
+                                                       xs, ys,
+                                                       roi_in->width, roi_in->height, 4, 4*roi_in->width);
+        }
       }
     }
   }
+  _lens_map_release(gd, map);
 
   if(!backbuf)
     dt_free_align(buf);
@@ -3350,6 +3735,7 @@ void init_global(dt_iop_module_so_t *self)
 
   lfDatabase *dt_iop_lensfun_db = new lfDatabase;
   gd->db = (lfDatabase *)dt_iop_lensfun_db;
+  dt_pthread_mutex_init(&gd->map_lock, NULL);
 
 #if defined(__MACH__) || defined(__APPLE__)
 #else
@@ -3596,6 +3982,8 @@ void cleanup_global(dt_iop_module_so_t *self)
   dt_opencl_free_kernel(gd->kernel_lens_man_vignette);
   dt_opencl_free_kernel(gd->kernel_md_vignette);
   dt_opencl_free_kernel(gd->kernel_md_correct);
+  _lens_map_cleanup(gd);
+  dt_pthread_mutex_destroy(&gd->map_lock);
   free(self->data);
   self->data = NULL;
 }
@@ -224,6 +224,45 @@ int legacy_params(dt_iop_module_t *self,
   return 1;
 }
 
+// the interpolation kernels work on batches of pixels: a first pass locates
+// all pixels of the batch in the LUT grid (branch-free and vectorizable), a
+// second pass fetches and blends the grid points.  This keeps the integer
+// and comparison work out of the gather loop and lets the compiler
+// vectorize the grid lookup across pixels instead of across 3 channels.
+#define LUT3D_BATCH 16
+
+typedef struct dt_lut3d_batch_t
+{
+  size_t idx[LUT3D_BATCH];     // offset of P000 in the clut
+  float d[3][LUT3D_BATCH];     // position inside the grid cell, per channel
+} dt_lut3d_batch_t;
+
+static inline void _lut3d_locate(dt_lut3d_batch_t *const restrict b,
+                                 const float *const restrict in,
+                                 const size_t n,
+                                 const uint16_t level)
+{
+  const int level_minus_2 = level - 2;
+  const float flevel_1 = (float)(level - 1);
+  const size_t level2 = (size_t)level * level;
+
+  DT_OMP_SIMD()
+  for(size_t j = 0; j < n; j++)
+  {
+    // scale the input according to grid size, then quantize to grid
+    const float r = CLIP(in[4*j]) * flevel_1;
+    const float g = CLIP(in[4*j+1]) * flevel_1;
+    const float bl = CLIP(in[4*j+2]) * flevel_1;
+    const int ri = CLAMP((int)r, 0, level_minus_2);
+    const int gi = CLAMP((int)g, 0, level_minus_2);
+    const int bi = CLAMP((int)bl, 0, level_minus_2);
+    b->d[0][j] = r - ri;
+    b->d[1][j] = g - gi;
+    b->d[2][j] = bl - bi;
+    b->idx[j] = 3 * (ri + level * gi + level2 * bi);
+  }
+}
+
 // From `HaldCLUT_correct.c' by Eskil Steenberg (http://www.quelsolaar.com) (BSD licensed)
 static void _correct_pixel_trilinear(const float *const in,
                                      float *const out,
@@ -231,66 +270,52 @@ static void _correct_pixel_trilinear(const float *const in,
                                      const float *const restrict clut,
                                      const uint16_t level)
 {
-  const int level_minus_2 = (level - 2);
-  const size_t level2 = level * level;
-  const float flevel_1 = (float)(level - 1);
   const size_t level1_stride = 3 * level;
-  const size_t level2_stride = 3 * level2;
-  const size_t level12_stride = 3 * (level + level2);
+  const size_t level2_stride = 3 * level * level;
+  const size_t level12_stride = level1_stride + level2_stride;
 
   DT_OMP_FOR()
-  for(size_t k = 0; k < (size_t)(pixel_nb * 4); k+=4)
+  for(size_t k = 0; k < pixel_nb; k += LUT3D_BATCH)
   {
-    const float *const input = in + k;
-    float *const output = ((float *const)out) + k;
-
-    DT_ALIGNED_PIXEL int rgbi[4];
-    dt_aligned_pixel_t rgbd;
-    dt_aligned_pixel_t tmp1, tmp2, tmp3;
-
-    // scale the input according to grid size
-    for_each_channel(c, aligned(input))
-      rgbd[c] = CLIP(input[c]) * flevel_1;
-    // quantize to grid
-    for_each_channel(c)
-      rgbi[c] = (int)rgbd[c];
-    for_each_channel(c)
-      rgbi[c] = CLAMP(rgbi[c], 0, level_minus_2);
-    // compute deltas for each channel
-    for_each_channel(c)
-      rgbd[c] -= rgbi[c]; // delta red/green/blue
-
-    size_t color = rgbi[0] + level * rgbi[1] + level2 * rgbi[2];
+    const size_t n = MIN(LUT3D_BATCH, pixel_nb - k);
+    dt_lut3d_batch_t b;
+    _lut3d_locate(&b, in + 4 * k, n, level);
 
-    const size_t i = color * 3;  // P000
-
-    const float one_minus_rgbd0 = 1.0f - rgbd[0];
-    const float one_minus_rgbd1 = 1.0f - rgbd[1];
+    for(size_t j = 0; j < n; j++)
+    {
+      const float *const p = clut + b.idx[j];  // P000
+      float *const output = out + 4 * (k + j);
+      const float rd = b.d[0][j];
+      const float gd = b.d[1][j];
+      const float bd = b.d[2][j];
+      const float one_minus_rd = 1.0f - rd;
+      const float one_minus_gd = 1.0f - gd;
+      dt_aligned_pixel_t tmp1, tmp2, tmp3;
 
-    // process indexes of P000 to P111 in clut
-    for_each_channel(c) // P000 and P100
-      tmp1[c] = clut[i+c] * one_minus_rgbd0 + clut[i+3+c] * rgbd[0];
+      for_each_channel(c) // P000 and P100
+        tmp1[c] = p[c] * one_minus_rd + p[3+c] * rd;
 
-    for_each_channel(c) // P010 and P110
-      tmp2[c] = clut[i+level1_stride+c] * one_minus_rgbd0 + clut[i+level1_stride+3+c] * rgbd[0];
+      for_each_channel(c) // P010 and P110
+        tmp2[c] = p[level1_stride+c] * one_minus_rd + p[level1_stride+3+c] * rd;
 
-    for_each_channel(c) // blend P000/P100 with P010/P110
-      tmp3[c] = tmp1[c] * one_minus_rgbd1 + tmp2[c] * rgbd[1];
+      for_each_channel(c) // blend P000/P100 with P010/P110
+        tmp3[c] = tmp1[c] * one_minus_gd + tmp2[c] * gd;
 
-    for_each_channel(c) // P001 and P101
-      tmp1[c] = clut[i+level2_stride+c] * one_minus_rgbd0 + clut[i+level2_stride+3+c] * rgbd[0];
+      for_each_channel(c) // P001 and P101
+        tmp1[c] = p[level2_stride+c] * one_minus_rd + p[level2_stride+3+c] * rd;
 
-    for_each_channel(c) // P011 and P111
-      tmp2[c] = clut[i+level12_stride+c] * one_minus_rgbd0 + clut[i+level12_stride+3+c] * rgbd[0];
+      for_each_channel(c) // P011 and P111
+        tmp2[c] = p[level12_stride+c] * one_minus_rd + p[level12_stride+3+c] * rd;
 
-    for_each_channel(c) // blend P001/P101 and P011/P111
-      tmp1[c] = tmp1[c] * one_minus_rgbd1 + tmp2[c] * rgbd[1];
+      for_each_channel(c) // blend P001/P101 and P011/P111
+        tmp1[c] = tmp1[c] * one_minus_gd + tmp2[c] * gd;
 
-    for_each_channel(c, aligned(output))
-      output[c] = tmp3[c] * (1.0f - rgbd[2]) + tmp1[c] * rgbd[2];
-    // not using non-temporal writes here, as those are substantially slower when in==out....
-    // (which is the case when performing a colorspace conversion)
- }
+      for_each_channel(c)
+        output[c] = tmp3[c] * (1.0f - bd) + tmp1[c] * bd;
+      // not using non-temporal writes here, as those are substantially slower when in==out....
+      // (which is the case when performing a colorspace conversion)
+    }
+  }
 }
 
 // from OpenColorIO
@@ -301,90 +326,55 @@ static void _correct_pixel_tetrahedral(const float *const in,
                                        const float *const restrict clut,
                                        const uint16_t level)
 {
-  const size_t level2 = level * level;
-  const size_t level1_stride = 3 * level;
-  const size_t level2_stride = 3 * level2;
-  const size_t level12_stride = 3 * (level + level2);
-  const float flevel_1 = (float)(level - 1);
+  const size_t stride[3] = { 3, 3 * level, 3 * level * level };
+  const size_t i111 = stride[0] + stride[1] + stride[2];
 
   DT_OMP_FOR()
-  for(size_t k = 0; k < (size_t)(pixel_nb * 4); k+=4)
+  for(size_t k = 0; k < pixel_nb; k += LUT3D_BATCH)
   {
-    const float *const input = in + k;
-    float *const output = ((float *const)out) + k;
-
-    dt_aligned_pixel_t rgbi;
-    dt_aligned_pixel_t rgbd;
-    for_each_channel(c)
-      rgbd[c] = CLIP(input[c]) * flevel_1;
-
-    for_each_channel(c)
+    const size_t n = MIN(LUT3D_BATCH, pixel_nb - k);
+    dt_lut3d_batch_t b;
+    _lut3d_locate(&b, in + 4 * k, n, level);
+
+    // the tetrahedron walks from P000 to P111 along the channel with the
+    // largest delta first, then along the second largest one.  Select its
+    // two inner vertices and the four weights without branching.
+    size_t i1[LUT3D_BATCH], i2[LUT3D_BATCH];
+    float w0[LUT3D_BATCH], w1[LUT3D_BATCH], w2[LUT3D_BATCH], w3[LUT3D_BATCH];
+    DT_OMP_SIMD()
+    for(size_t j = 0; j < n; j++)
     {
-      rgbi[c] = CLAMP((int)rgbd[c], 0, level - 2);
-      rgbd[c] = rgbd[c] - rgbi[c]; // delta red/green/blue
+      const float r = b.d[0][j];
+      const float g = b.d[1][j];
+      const float bl = b.d[2][j];
+      const gboolean r_g = r > g;
+      const gboolean g_b = g > bl;
+      const gboolean r_b = r > bl;
+      const gboolean b_g = bl > g;
+      // same case distinction (and tie handling) as the original per-pixel code
+      const int hi = r_g ? (g_b || r_b ? 0 : 2) : (b_g ? 2 : 1);
+      const int lo = r_g ? (g_b ? 2 : 1) : (b_g || bl > r ? 0 : 2);
+      const int mid = 3 - hi - lo;
+      const float dhi = b.d[hi][j];
+      const float dmid = b.d[mid][j];
+      const float dlo = b.d[lo][j];
+      i1[j] = stride[hi];
+      i2[j] = stride[hi] + stride[mid];
+      w0[j] = 1 - dhi;
+      w1[j] = dhi - dmid;
+      w2[j] = dmid - dlo;
+      w3[j] = dlo;
     }
 
-  // indexes of P000 to P111 in clut
-    const size_t color = rgbi[0] + rgbi[1] * level + rgbi[2] * level2;
-    const size_t i000 = color * 3;                     // P000
-    const size_t i100 = i000 + 3;                      // P100
-    const size_t i010 = i000 + level1_stride;          // P010
-    const size_t i110 = i010 + 3;                      // P110
-    const size_t i001 = i000 + level2_stride;          // P001
-    const size_t i101 = i001 + 3;                      // P101
-    const size_t i011 = i000 + level12_stride;         // P011
-    const size_t i111 = i011 + 3;                      // P111
-
-    if(rgbd[0] > rgbd[1])
+    for(size_t j = 0; j < n; j++)
     {
-      if(rgbd[1] > rgbd[2])
-      {
-        // rgbd[0] > rgbd[1] > rgbd[2]
-        for_each_channel(c, aligned(output))
-          output[c] = ((1-rgbd[0])*clut[i000+c] + (rgbd[0]-rgbd[1])*clut[i100+c]
-                      + (rgbd[1]-rgbd[2])*clut[i110+c] + rgbd[2]*clut[i111+c]);
-      }
-      else if(rgbd[0] > rgbd[2])
-      {
-        // rgbd[0] > rgbd[2] >= rgbd[1]
-        for_each_channel(c, aligned(output))
-          output[c] = ((1-rgbd[0])*clut[i000+c] + (rgbd[0]-rgbd[2])*clut[i100+c]
-                      + (rgbd[2]-rgbd[1])*clut[i101+c] + rgbd[1]*clut[i111+c]);
-      }
-      else
-      {
-        // rgbd[2] >= rgbd[0] > rgbd[2]
-        for_each_channel(c, aligned(output))
-          output[c] = ((1-rgbd[2])*clut[i000+c] + (rgbd[2]-rgbd[0])*clut[i001+c]
-                      + (rgbd[0]-rgbd[1])*clut[i101+c] + rgbd[1]*clut[i111+c]);
-      }
-    }
-    else
-    {
-      if(rgbd[2] > rgbd[1])
-      {
-        // rgbd[2] > rgbd[1] >= rgbd[0]
-        for_each_channel(c, aligned(output))
-          output[c] = ((1-rgbd[2])*clut[i000+c] + (rgbd[2]-rgbd[1])*clut[i001+c]
-                      + (rgbd[1]-rgbd[0])*clut[i011+c] + rgbd[0]*clut[i111+c]);
-      }
-      else if(rgbd[2] > rgbd[0])
-      {
-        // rgbd[1] >= rgbd[2] > rgbd[0]
-        for_each_channel(c, aligned(output))
-          output[c] = ((1-rgbd[1])*clut[i000+c] + (rgbd[1]-rgbd[2])*clut[i010+c]
-                      + (rgbd[2]-rgbd[0])*clut[i011+c] + rgbd[0]*clut[i111+c]);
-      }
-      else
-      {
-        // rgbd[1] >= rgbd[0] >= rgbd[2]
-        for_each_channel(c, aligned(output))
-          output[c] = ((1-rgbd[1])*clut[i000+c] + (rgbd[1]-rgbd[0])*clut[i010+c]
-                      + (rgbd[0]-rgbd[2])*clut[i110+c] + rgbd[2]*clut[i111+c]);
-      }
+      const float *const p = clut + b.idx[j];  // P000
+      float *const output = out + 4 * (k + j);
+      for_each_channel(c)
+        output[c] = (w0[j]*p[c] + w1[j]*p[i1[j]+c] + w2[j]*p[i2[j]+c] + w3[j]*p[i111+c]);
+      // not using non-temporal writes here, as those are substantially slower when in==out....
+      // (which is the case when performing a colorspace conversion)
     }
-    // not using non-temporal writes here, as those are substantially slower when in==out....
-    // (which is the case when performing a colorspace conversion)
   }
 }
 
@@ -396,65 +386,57 @@ static void _correct_pixel_pyramid(const float *const in,
                                    const float *const restrict clut,
                                    const uint16_t level)
 {
-  const int level2 = level * level;
-  const float flevel_1 = (float)(level - 1);
+  const size_t level1_stride = 3 * level;
+  const size_t level2_stride = 3 * level * level;
 
   DT_OMP_FOR()
-  for(size_t k = 0; k < (size_t)(pixel_nb * 4); k+=4)
+  for(size_t k = 0; k < pixel_nb; k += LUT3D_BATCH)
   {
-    const float *const input = in + k;
-    float *const output = ((float *const)out) + k;
-
-    DT_ALIGNED_PIXEL int rgbi[4];
-    dt_aligned_pixel_t rgbd;
-    // scale the input according to grid size
-    for_each_channel(c)
-      rgbd[c] = CLIP(input[c]) * flevel_1;
-    // clip coordinates to LUT grid
-    for_each_channel(c)
-      rgbi[c] = (int)rgbd[c];
-    for_each_channel(c)
-      rgbi[c] = CLAMP(rgbi[c], 0, level - 2);
-    // compute deltas for each channel
-    for_each_channel(c)
-      rgbd[c] -= rgbi[c];
-
-  // indexes of P000 to P111 in clut
-    const int color = rgbi[0] + rgbi[1] * level + rgbi[2] * level2;
-    const size_t i000 = color * 3;                     // P000
-    const size_t i100 = i000 + 3;                      // P100
-    const size_t i010 = (color + level) * 3;           // P010
-    const size_t i110 = i010 + 3;                      // P110
-    const size_t i001 = (color + level2) * 3;          // P001
-    const size_t i101 = i001 + 3;                      // P101
-    const size_t i011 = (color + level + level2) * 3;  // P011
-    const size_t i111 = i011 + 3;                      // P111
-
-    dt_aligned_pixel_t outpx;
-    if(rgbd[1] > rgbd[0] && rgbd[2] > rgbd[0])
-    {
-      for_each_channel(c)
-        outpx[c] = (clut[i000+c] + (clut[i111+c]-clut[i011+c])*rgbd[0]
-                    + (clut[i010+c]-clut[i000+c])*rgbd[1] + (clut[i001+c]-clut[i000+c])*rgbd[2]
-                    + (clut[i011+c]-clut[i001+c]-clut[i010+c]+clut[i000+c])*rgbd[1]*rgbd[2]);
-    }
-    else if(rgbd[0] > rgbd[1] && rgbd[2] > rgbd[1])
-    {
-      for_each_channel(c)
-        outpx[c] = (clut[i000+c] + (clut[i100+c]-clut[i000+c])*rgbd[0]
-                    + (clut[i111+c]-clut[i101+c])*rgbd[1] + (clut[i001+c]-clut[i000+c])*rgbd[2]
-                    + (clut[i101+c]-clut[i001+c]-clut[i100+c]+clut[i000+c])*rgbd[0]*rgbd[2]);
-    }
-    else
+    const size_t n = MIN(LUT3D_BATCH, pixel_nb - k);
+    dt_lut3d_batch_t b;
+    _lut3d_locate(&b, in + 4 * k, n, level);
+
+    for(size_t j = 0; j < n; j++)
     {
-      for_each_channel(c)
-         outpx[c] = clut[i000+c] + (clut[i100+c]-clut[i000+c])*rgbd[0]
-                  + (clut[i010+c]-clut[i000+c])*rgbd[1] + (clut[i111+c]-clut[i110+c])*rgbd[2]
-                  + (clut[i110+c]-clut[i100+c]-clut[i010+c]+clut[i000+c])*rgbd[0]*rgbd[1];
+      const float rd = b.d[0][j];
+      const float gd = b.d[1][j];
+      const float bd = b.d[2][j];
+      // indexes of P000 to P111 in clut
+      const size_t i000 = b.idx[j];                      // P000
+      const size_t i100 = i000 + 3;                      // P100
+      const size_t i010 = i000 + level1_stride;          // P010
+      const size_t i110 = i010 + 3;                      // P110
+      const size_t i001 = i000 + level2_stride;          // P001
+      const size_t i101 = i001 + 3;                      // P101
+      const size_t i011 = i010 + level2_stride;          // P011
+      const size_t i111 = i011 + 3;                      // P111
+
+      dt_aligned_pixel_t outpx;
+      if(gd > rd && bd > rd)
+      {
+        for_each_channel(c)
+          outpx[c] = (clut[i000+c] + (clut[i111+c]-clut[i011+c])*rd
+                      + (clut[i010+c]-clut[i000+c])*gd + (clut[i001+c]-clut[i000+c])*bd
+                      + (clut[i011+c]-clut[i001+c]-clut[i010+c]+clut[i000+c])*gd*bd);
+      }
+      else if(rd > gd && bd > gd)
+      {
+        for_each_channel(c)
+          outpx[c] = (clut[i000+c] + (clut[i100+c]-clut[i000+c])*rd
+                      + (clut[i111+c]-clut[i101+c])*gd + (clut[i001+c]-clut[i000+c])*bd
+                      + (clut[i101+c]-clut[i001+c]-clut[i100+c]+clut[i000+c])*rd*bd);
+      }
+      else
+      {
+        for_each_channel(c)
+          outpx[c] = clut[i000+c] + (clut[i100+c]-clut[i000+c])*rd
+                   + (clut[i010+c]-clut[i000+c])*gd + (clut[i111+c]-clut[i110+c])*bd
+                   + (clut[i110+c]-clut[i100+c]-clut[i010+c]+clut[i000+c])*rd*gd;
+      }
+      // not using non-temporal writes here, as those are substantially slower when in==out....
+      // (which is the case when performing a colorspace conversion)
+      copy_pixel(out + 4 * (k + j), outpx);
     }
-    // not using non-temporal writes here, as those are substantially slower when in==out....
-    // (which is the case when performing a colorspace conversion)
-    copy_pixel(output, outpx);
   }
 }
 
@@ -995,6 +977,97 @@ static uint16_t _calculate_clut_3dl(const char *const filepath, float **clut)
   return level;
 }
 
+// parsed LUT files are kept in a binary cache in the user cache directory,
+// keyed by a hash of the file contents, so that text LUTs (a 65^3 cube has
+// about 275k lines) and png haldcluts are decoded only once.
+#define DT_IOP_LUT3D_CACHE_MAGIC "dtlut3d"
+#define DT_IOP_LUT3D_CACHE_VERSION 1
+
+typedef struct dt_iop_lut3d_cache_header_t
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t level;
+} dt_iop_lut3d_cache_header_t;
+
+static gchar *_clut_cache_filename(const char *const filepath)
+{
+  gchar *data = NULL;
+  gsize length = 0;
+  if(!g_file_get_contents(filepath, &data, &length, NULL))
+    return NULL;
+  gchar *hash = g_compute_checksum_for_data(G_CHECKSUM_SHA1, (guchar *)data, length);
+  g_free(data);
+
+  char cachedir[PATH_MAX] = { 0 };
+  dt_loc_get_user_cache_dir(cachedir, sizeof(cachedir));
+  gchar *basename = g_strconcat(hash, ".lut", NULL);
+  gchar *filename = g_build_filename(cachedir, "lut3d", basename, NULL);
+  g_free(basename);
+  g_free(hash);
+  return filename;
+}
+
+static uint16_t _read_clut_cache(const char *const cache_filename, float **clut)
+{
+  FILE *f = g_fopen(cache_filename, "rb");
+  if(!f) return 0;
+
+  dt_iop_lut3d_cache_header_t header;
+  uint16_t level = 0;
+  if(fread(&header, sizeof(header), 1, f) == 1
+     && !memcmp(header.magic, DT_IOP_LUT3D_CACHE_MAGIC, sizeof(header.magic))
+     && header.version == DT_IOP_LUT3D_CACHE_VERSION
+     && header.level >= 2 && header.level <= 256)
+  {
+    const size_t buf_size = (size_t)header.level * header.level * header.level * 3;
+    // over-allocate by one float as the _correct variants read 4 channels
+    float *lclut = dt_alloc_align_float(buf_size + 1);
+    if(lclut && fread(lclut, sizeof(float), buf_size, f) == buf_size)
+    {
+      lclut[buf_size] = 0.0f;
+      *clut = lclut;
+      level = header.level;
+    }
+    else
+      dt_free_align(lclut);
+  }
+  fclose(f);
+
+  if(level)
+    dt_print(DT_DEBUG_DEV, "[lut3d] LUT level %d read from cache %s", level, cache_filename);
+  else
+    dt_print(DT_DEBUG_ALWAYS, "[lut3d] ignoring invalid LUT cache file %s", cache_filename);
+  return level;
+}
+
+static void _write_clut_cache(const char *const cache_filename, const float *const clut, const uint16_t level)
+{
+  gchar *dir = g_path_get_dirname(cache_filename);
+  const int res = g_mkdir_with_parents(dir, 0700);
+  g_free(dir);
+  if(res) return;
+
+  // write to a temporary file first so that concurrent pipes never read a partial cache
+  gchar *tmp_filename = g_strdup_printf("%s.%p", cache_filename, (void *)clut);
+  FILE *f = g_fopen(tmp_filename, "wb");
+  if(!f)
+  {
+    g_free(tmp_filename);
+    return;
+  }
+  dt_iop_lut3d_cache_header_t header = { .version = DT_IOP_LUT3D_CACHE_VERSION, .level = level };
+  memcpy(header.magic, DT_IOP_LUT3D_CACHE_MAGIC, sizeof(header.magic));
+  const size_t buf_size = (size_t)level * level * level * 3;
+  const gboolean ok = fwrite(&header, sizeof(header), 1, f) == 1
+                      && fwrite(clut, sizeof(float), buf_size, f) == buf_size;
+  if(fclose(f) == 0 && ok)
+    g_rename(tmp_filename, cache_filename);
+  else
+    g_unlink(tmp_filename);
+  g_free(tmp_filename);
+}
+
 #ifdef HAVE_OPENCL
 int process_cl(dt_iop_module_t *self, dt_dev_pixelpipe_iop_t *piece, cl_mem dev_in, cl_mem dev_out,
                const dt_iop_roi_t *const roi_in, const dt_iop_roi_t *const roi_out)
@@ -1177,18 +1250,27 @@ static int _calculate_clut(dt_iop_lut3d_params_t *const p, float **clut)
     if(filepath[0] && lutfolder[0])
     {
       char *fullpath = g_build_filename(lutfolder, filepath, NULL);
-      if(g_str_has_suffix (filepath, ".png") || g_str_has_suffix (filepath, ".PNG"))
-      {
-        level = _calculate_clut_haldclut(p, fullpath, clut);
-      }
-      else if(g_str_has_suffix (filepath, ".cube") || g_str_has_suffix (filepath, ".CUBE"))
-      {
-        level = _calculate_clut_cube(fullpath, clut);
-      }
-      else if(g_str_has_suffix (filepath, ".3dl") || g_str_has_suffix (filepath, ".3DL"))
+      gchar *cache_filename = _clut_cache_filename(fullpath);
+      if(cache_filename)
+        level = _read_clut_cache(cache_filename, clut);
+      if(!level)
       {
-        level = _calculate_clut_3dl(fullpath, clut);
+        if(g_str_has_suffix (filepath, ".png") || g_str_has_suffix (filepath, ".PNG"))
+        {
+          level = _calculate_clut_haldclut(p, fullpath, clut);
+        }
+        else if(g_str_has_suffix (filepath, ".cube") || g_str_has_suffix (filepath, ".CUBE"))
+        {
+          level = _calculate_clut_cube(fullpath, clut);
+        }
+        else if(g_str_has_suffix (filepath, ".3dl") || g_str_has_suffix (filepath, ".3DL"))
+        {
+          level = _calculate_clut_3dl(fullpath, clut);
+        }
+        if(level && cache_filename)
+          _write_clut_cache(cache_filename, *clut, level);
       }
+      g_free(cache_filename);
       g_free(fullpath);
     }
     g_free(lutfolder);
@@ -38,7 +38,7 @@
 
 // this is the version of the modules parameters,
 // and includes version information about compile-time dt
-DT_MODULE_INTROSPECTION(2, dt_iop_nlmeans_params_t)
+DT_MODULE_INTROSPECTION(3, dt_iop_nlmeans_params_t)
 
 typedef struct dt_iop_nlmeans_params_t
 {
@@ -47,6 +47,7 @@ typedef struct dt_iop_nlmeans_params_t
   float strength; // $MIN: 0.0 $MAX: 100000.0 $DEFAULT: 50.0
   float luma;     // $MIN: 0.0 $MAX: 1.0 $DEFAULT: 0.5
   float chroma;   // $MIN: 0.0 $MAX: 1.0 $DEFAULT: 1.0
+  gboolean fast;  // $DEFAULT: FALSE $DESCRIPTION: "fast mode"
 } dt_iop_nlmeans_params_t;
 
 typedef struct dt_iop_nlmeans_gui_data_t
@@ -55,6 +56,7 @@ typedef struct dt_iop_nlmeans_gui_data_t
   GtkWidget *strength;
   GtkWidget *luma;
   GtkWidget *chroma;
+  GtkWidget *fast;
 } dt_iop_nlmeans_gui_data_t;
 
 typedef dt_iop_nlmeans_params_t dt_iop_nlmeans_data_t;
@@ -104,6 +106,15 @@ int legacy_params(dt_iop_module_t *self,
                   int32_t *new_params_size,
                   int *new_version)
 {
+  typedef struct dt_iop_nlmeans_params_v3_t
+  {
+    float radius;
+    float strength;
+    float luma;
+    float chroma;
+    gboolean fast;
+  } dt_iop_nlmeans_params_v3_t;
+
   typedef struct dt_iop_nlmeans_params_v2_t
   {
     float radius;
@@ -133,6 +144,19 @@ int legacy_params(dt_iop_module_t *self,
     *new_version = 2;
     return 0;
   }
+  if(old_version == 2)
+  {
+    const dt_iop_nlmeans_params_v2_t *o = (dt_iop_nlmeans_params_v2_t *)old_params;
+    dt_iop_nlmeans_params_v3_t *n = malloc(sizeof(dt_iop_nlmeans_params_v3_t));
+
+    memcpy(n, o, sizeof(dt_iop_nlmeans_params_v2_t));
+    n->fast = FALSE;
+
+    *new_params = n;
+    *new_params_size = sizeof(dt_iop_nlmeans_params_v3_t);
+    *new_version = 3;
+    return 0;
+  }
   return 1;
 }
 
@@ -393,6 +417,7 @@ void process(
                                       .patch_radius = P,
                                       .search_radius = K,
                                       .decimate = decimate,
+                                      .fast = d->fast,
                                       .norm = norm2 };
 
   nlmeans_denoise(ivoid, ovoid, roi_in, roi_out, &params);
@@ -433,6 +458,9 @@ void commit_params(dt_iop_module_t *self, dt_iop_params_t *params, dt_dev_pixelp
   memcpy(d, p, sizeof(*d));
   d->luma = MAX(0.0001f, p->luma);
   d->chroma = MAX(0.0001f, p->chroma);
+
+  // fast mode not implemented in OpenCL yet
+  if(d->fast) piece->process_cl_ready = FALSE;
 }
 
 void init_pipe(dt_iop_module_t *self, dt_dev_pixelpipe_t *pipe, dt_dev_pixelpipe_iop_t *piece)
@@ -465,6 +493,11 @@ void gui_init(dt_iop_module_t *self)
   g->chroma = dt_bauhaus_slider_from_params(self, N_("chroma"));
   dt_bauhaus_slider_set_format(g->chroma, "%");
   gtk_widget_set_tooltip_text(g->chroma, _("how much to smooth colors"));
+  g->fast = dt_bauhaus_toggle_from_params(self, "fast");
+  gtk_widget_set_tooltip_text(g->fast, _("skip candidate patches which are clearly dissimilar\n"
+                                         "over a whole tile of the image.\n"
+                                         "much faster on textured images at a small loss of accuracy.\n"
+                                         "the module is always processed on the CPU when enabled."));
 }
 
 // clang-format off
@@ -447,6 +447,39 @@ void process(dt_iop_module_t *self,
   for(int k = 0; k < 4; k++) piece->pipe->dsc.processed_maximum[k] = 1.0f;
 }
 
+gboolean fuse_raw_frontend(dt_iop_module_t *self,
+                           dt_dev_pixelpipe_iop_t *piece,
+                           dt_dev_raw_frontend_t *fe,
+                           const dt_iop_roi_t *const roi_in,
+                           const dt_iop_roi_t *const roi_out)
+{
+  const dt_iop_rawprepare_data_t *const d = piece->data;
+  if(!piece->pipe->dsc.filters || piece->dsc_in.channels != 1 || d->apply_gainmaps)
+    return FALSE;
+
+  const int csx = _compute_proper_crop(piece, roi_in, d->left);
+  const int csy = _compute_proper_crop(piece, roi_in, d->top);
+
+  // same as the raw mosaic path of process()
+  fe->crop_x = csx;
+  fe->crop_y = csy;
+  for(int j = 0; j < DT_RAW_FRONTEND_ROWS; j++)
+  {
+    for(int i = 0; i < DT_RAW_FRONTEND_COLS; i++)
+    {
+      const int id = _BL(roi_out, d, j, i);
+      fe->sub[j][i] = d->sub[id];
+      fe->div[j][i] = d->div[id];
+    }
+  }
+
+  piece->pipe->dsc.filters =
+    dt_rawspeed_crop_dcraw_filters(self->dev->image_storage.buf_dsc.filters, csx, csy);
+  _adjust_xtrans_filters(piece->pipe, csx, csy);
+  for(int k = 0; k < 4; k++) piece->pipe->dsc.processed_maximum[k] = 1.0f;
+  return TRUE;
+}
+
 #ifdef HAVE_OPENCL
 int process_cl(dt_iop_module_t *self,
                dt_dev_pixelpipe_iop_t *piece,
@@ -737,6 +770,8 @@ void commit_params(dt_iop_module_t *self,
 
   if(piece->pipe->want_detail_mask)
     piece->process_tiling_ready = FALSE;
+
+  piece->raw_frontend_ready = piece->pipe->dsc.filters && !d->apply_gainmaps;
 }
 
 void init_pipe(dt_iop_module_t *self, dt_dev_pixelpipe_t *pipe, dt_dev_pixelpipe_iop_t *piece)
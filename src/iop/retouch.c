@@ -3759,6 +3759,180 @@ static void rt_process_forms(float *layer, dwt_params_t *const wt_p, const int s
   }
 }
 
+// sparse processing: when all the shapes are small compared to the roi we
+// decompose only windows around them. the wavelet decomposition is
+// perfectly reconstructing and the support of S scales is 2^S - 1 pixels,
+// so a window padded by more than that yields the same layers inside as
+// the whole image does, and leaves everything outside the shapes untouched.
+#define RETOUCH_SPARSE_MAX_AREA 0.5f
+
+static inline gboolean rt_rois_overlap(const dt_iop_roi_t *const a, const dt_iop_roi_t *const b)
+{
+  return !(a->x >= b->x + b->width || b->x >= a->x + a->width
+           || a->y >= b->y + b->height || b->y >= a->y + a->height);
+}
+
+// collect the padded bounding boxes (destination plus source) of all forms
+// within roi_in, merged until they are disjoint. returns FALSE if sparse
+// processing is not worth it.
+static gboolean rt_get_sparse_windows(dt_iop_module_t *self,
+                                      dt_dev_pixelpipe_iop_t *piece,
+                                      const dt_iop_roi_t *const roi_in,
+                                      const int padding,
+                                      dt_iop_roi_t *windows,
+                                      int *num_windows)
+{
+  dt_iop_retouch_params_t *p = piece->data;
+  dt_develop_blend_params_t *bp = piece->blendop_data;
+
+  int count = 0;
+
+  const dt_masks_form_t *grp = dt_masks_get_from_id_ext(piece->pipe->forms, bp->mask_id);
+  if(grp && (grp->type & DT_MASKS_GROUP))
+  {
+    for(const GList *forms = grp->points; forms; forms = g_list_next(forms))
+    {
+      const dt_masks_point_group_t *grpt = forms->data;
+      if(!grpt) continue;
+
+      const int index = rt_get_index_from_formid(p, grpt->formid);
+      if(index == -1) continue;
+
+      dt_masks_form_t *form = dt_masks_get_from_id_ext(piece->pipe->forms, grpt->formid);
+      if(!form || !rt_masks_form_is_in_roi(self, piece, form, roi_in, roi_in)) continue;
+
+      int fl, ft, fw, fh;
+      if(!dt_masks_get_area(self, piece, form, &fw, &fh, &fl, &ft)) continue;
+      fw *= roi_in->scale;
+      fh *= roi_in->scale;
+      fl *= roi_in->scale;
+      ft *= roi_in->scale;
+
+      int roix = fl;
+      int roiy = ft;
+      int roir = fl + fw;
+      int roib = ft + fh;
+
+      const dt_iop_retouch_algo_type_t algo = p->rt_forms[index].algorithm;
+      if(algo == DT_IOP_RETOUCH_HEAL || algo == DT_IOP_RETOUCH_CLONE)
+      {
+        float dx = 0.f, dy = 0.f;
+        if(!rt_masks_get_delta_to_destination(self, piece, roi_in, form, &dx, &dy,
+                                              p->rt_forms[index].distort_mode))
+          continue;
+        roix = MIN(roix, (int)floorf(fl - dx));
+        roiy = MIN(roiy, (int)floorf(ft - dy));
+        roir = MAX(roir, (int)ceilf(fl + fw - dx));
+        roib = MAX(roib, (int)ceilf(ft + fh - dy));
+      }
+
+      roix = MAX(roix - padding, roi_in->x);
+      roiy = MAX(roiy - padding, roi_in->y);
+      roir = MIN(roir + padding, roi_in->x + roi_in->width);
+      roib = MIN(roib + padding, roi_in->y + roi_in->height);
+      if(roir <= roix || roib <= roiy) continue;
+      if(count == RETOUCH_NO_FORMS) return FALSE;
+
+      windows[count++] = (dt_iop_roi_t){ .x = roix, .y = roiy,
+                                         .width = roir - roix, .height = roib - roiy,
+                                         .scale = roi_in->scale };
+    }
+  }
+
+  // merge overlapping windows, a form may use the result of a previous
+  // one as its source so they must be processed together
+  gboolean merged = TRUE;
+  while(merged)
+  {
+    merged = FALSE;
+    for(int i = 0; i < count && !merged; i++)
+      for(int j = i + 1; j < count && !merged; j++)
+      {
+        if(!rt_rois_overlap(&windows[i], &windows[j])) continue;
+
+        const int roir = MAX(windows[i].x + windows[i].width, windows[j].x + windows[j].width);
+        const int roib = MAX(windows[i].y + windows[i].height, windows[j].y + windows[j].height);
+        windows[i].x = MIN(windows[i].x, windows[j].x);
+        windows[i].y = MIN(windows[i].y, windows[j].y);
+        windows[i].width = roir - windows[i].x;
+        windows[i].height = roib - windows[i].y;
+        windows[j] = windows[--count];
+        merged = TRUE;
+      }
+  }
+
+  size_t area = 0;
+  for(int i = 0; i < count; i++)
+    area += (size_t)windows[i].width * windows[i].height;
+
+  *num_windows = count;
+  return area < RETOUCH_SPARSE_MAX_AREA * roi_in->width * roi_in->height;
+}
+
+// returns FALSE if the image has to be processed as a whole
+static gboolean rt_process_sparse(dt_iop_module_t *self,
+                                  dt_dev_pixelpipe_iop_t *piece,
+                                  float *const in_retouch,
+                                  const dt_iop_roi_t *const roi_in,
+                                  dwt_params_t *const dwt_p,
+                                  retouch_user_data_t *usr_data)
+{
+  if(dwt_p->preview_scale <= 0.f) dwt_p->preview_scale = 1.f;
+  const int scales = MIN(dwt_p->scales, dwt_get_max_scale(dwt_p));
+  const int padding = 1 << (scales + 1);
+
+  dt_iop_roi_t windows[RETOUCH_NO_FORMS];
+  int num_windows = 0;
+  if(!rt_get_sparse_windows(self, piece, roi_in, padding, windows, &num_windows))
+    return FALSE;
+
+  // nothing to retouch in this roi
+  if(num_windows == 0) return TRUE;
+
+  // all windows must support the same number of scales as the whole image
+  for(int i = 0; i < num_windows; i++)
+  {
+    dwt_params_t wp = *dwt_p;
+    wp.width = windows[i].width;
+    wp.height = windows[i].height;
+    if(dwt_get_max_scale(&wp) < scales) return FALSE;
+  }
+
+  size_t max_size = 0;
+  for(int i = 0; i < num_windows; i++)
+    max_size = MAX(max_size, (size_t)windows[i].width * windows[i].height);
+
+  float *img = dt_alloc_align_float(4 * max_size);
+  if(img == NULL) return FALSE;
+
+  dt_print_pipe(DT_DEBUG_PIPE, "retouch sparse", piece->pipe, self, DT_DEVICE_CPU, roi_in, NULL,
+                "%i windows", num_windows);
+
+  for(int i = 0; i < num_windows; i++)
+  {
+    const dt_iop_roi_t *const win = &windows[i];
+    const size_t rowsize = sizeof(float) * 4 * win->width;
+    const size_t offset = 4 * ((size_t)(win->y - roi_in->y) * roi_in->width + win->x - roi_in->x);
+
+    rt_copy_in_to_out(in_retouch, roi_in, img, win, 4, 0, 0);
+
+    usr_data->roi = *win;
+    dwt_params_t *wp = dt_dwt_init(img, win->width, win->height, 4, scales,
+                                   0, dwt_p->merge_from_scale, usr_data, dwt_p->preview_scale);
+    if(wp) dwt_decompose(wp, rt_process_forms);
+    dt_dwt_free(wp);
+
+    DT_OMP_FOR()
+    for(int y = 0; y < win->height; y++)
+      memcpy(in_retouch + offset + (size_t)4 * y * roi_in->width,
+             img + (size_t)4 * y * win->width, rowsize);
+  }
+
+  dt_free_align(img);
+  usr_data->roi = *roi_in;
+  return TRUE;
+}
+
 void process(dt_iop_module_t *self,
              dt_dev_pixelpipe_iop_t *piece,
              const void *const ivoid,
@@ -3844,8 +4018,13 @@ void process(dt_iop_module_t *self,
     if(g) g->first_scale_visible = dt_dwt_first_scale_visible(dwt_p);
   }
 
-  // decompose it
-  dwt_decompose(dwt_p, rt_process_forms);
+  // decompose it, only around the shapes if they cover a small part of the image
+  const gboolean sparse = dwt_p->return_layer == 0
+                          && !usr_data.mask_display
+                          && !usr_data.suppress_mask
+                          && rt_process_sparse(self, piece, in_retouch, roi_rt, dwt_p, &usr_data);
+  if(!sparse)
+    dwt_decompose(dwt_p, rt_process_forms);
 
   dt_aligned_pixel_t levels = { p->preview_levels[0],
                                 p->preview_levels[1],
@@ -1766,6 +1766,8 @@ void commit_params(dt_iop_module_t *self,
   // working color profile
   d->type_work = DT_COLORSPACE_NONE;
   d->filename_work[0] = '\0';
+
+  piece->pointwise_ready = TRUE;
 }
 
 #ifdef HAVE_OPENCL
@@ -1864,40 +1866,34 @@ cleanup:
 }
 #endif
 
-void process(dt_iop_module_t *self,
-             dt_dev_pixelpipe_iop_t *piece,
-             const void *const ivoid,
-             void *const ovoid,
-             const dt_iop_roi_t *const roi_in,
-             const dt_iop_roi_t *const roi_out)
+gboolean fuse_pointwise(dt_iop_module_t *self,
+                        dt_dev_pixelpipe_iop_t *piece,
+                        const dt_iop_roi_t *const roi)
+{
+  _generate_curve_lut(piece->pipe, piece->data);
+  return TRUE;
+}
+
+void process_pointwise(dt_iop_module_t *self,
+                       dt_dev_pixelpipe_iop_t *piece,
+                       const float *const in,
+                       float *const out,
+                       const size_t npixels)
 {
   const dt_iop_order_iccprofile_info_t *const work_profile =
     dt_ioppr_get_pipe_work_profile_info(piece->pipe);
-
-  const float *const restrict in = (float*)ivoid;
-  float *const restrict out = (float*)ovoid;
-  if(!dt_iop_have_required_input_format(4 /*we need full-color pixels*/,
-                                        self, piece->colors,
-                                        in, out, roi_in, roi_out))
-    return; // image has been copied through to output and module's
-            // trouble flag has been updated
-
-  dt_iop_rgbcurve_data_t *const restrict d = piece->data;
-  _generate_curve_lut(piece->pipe, d);
+  dt_iop_rgbcurve_data_t *const d = piece->data;
 
   const float xm_L = 1.0f / d->unbounded_coeffs[DT_IOP_RGBCURVE_R][0];
   const float xm_g = 1.0f / d->unbounded_coeffs[DT_IOP_RGBCURVE_G][0];
   const float xm_b = 1.0f / d->unbounded_coeffs[DT_IOP_RGBCURVE_B][0];
 
-  const int width = roi_out->width;
-  const int height = roi_out->height;
-  const size_t npixels = (size_t)width * height;
   const int autoscale = d->params.curve_autoscale;
-  const _curve_table_ptr restrict table = d->table;
-  const _coeffs_table_ptr restrict unbounded_coeffs = d->unbounded_coeffs;
+  const _curve_table_ptr table = d->table;
+  const _coeffs_table_ptr unbounded_coeffs = d->unbounded_coeffs;
 
-  DT_OMP_FOR()
-  for(int y = 0; y < 4*npixels; y += 4)
+  // in and out might be the same buffer
+  for(size_t y = 0; y < 4 * npixels; y += 4)
   {
     if(autoscale == DT_S_SCALE_MANUAL_RGB)
     {
@@ -1940,6 +1936,24 @@ void process(dt_iop_module_t *self,
   }
 }
 
+void process(dt_iop_module_t *self,
+             dt_dev_pixelpipe_iop_t *piece,
+             const void *const ivoid,
+             void *const ovoid,
+             const dt_iop_roi_t *const roi_in,
+             const dt_iop_roi_t *const roi_out)
+{
+  if(!dt_iop_have_required_input_format(4 /*we need full-color pixels*/,
+                                        self, piece->colors,
+                                        ivoid, ovoid, roi_in, roi_out))
+    return; // image has been copied through to output and module's
+            // trouble flag has been updated
+
+  fuse_pointwise(self, piece, roi_out);
+  dt_dev_pointwise_process(&piece, 1, (const float *)ivoid, (float *)ovoid,
+                           (size_t)roi_out->width * roi_out->height);
+}
+
 #undef DT_GUI_CURVE_EDITOR_INSET
 #undef DT_IOP_RGBCURVE_RES
 #undef DT_IOP_RGBCURVE_MAXNODES
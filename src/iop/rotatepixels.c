@@ -272,42 +272,64 @@ void modify_roi_in(dt_iop_module_t *self, dt_dev_pixelpipe_iop_t *piece, const d
   roi_in->height = CLAMP(roi_in->height, 1, (int)ceilf(orig_h) - roi_in->y);
 }
 
-// 3rd (final) pass: you get this input region (may be different from what was requested above),
-// do your best to fill the output region!
-void process(dt_iop_module_t *self, dt_dev_pixelpipe_iop_t *piece, const void *const ivoid, void *const ovoid,
-             const dt_iop_roi_t *const roi_in, const dt_iop_roi_t *const roi_out)
+typedef struct _rotatepixels_warp_t
 {
-  const int ch = piece->colors;
-  const int ch_width = ch * roi_in->width;
-
-  const float scale = roi_in->scale / piece->iscale;
+  const dt_dev_pixelpipe_iop_t *piece;
+  dt_iop_roi_t roi_in;
+  dt_iop_roi_t roi_out;
+  float scale;
+} _rotatepixels_warp_t;
+
+// output to input buffer coordinates for dt_interpolation_warp()
+static void _rotatepixels_warp_map(const void *data,
+                                   const float x,
+                                   const float y,
+                                   float *xin,
+                                   float *yin)
+{
+  const _rotatepixels_warp_t *w = data;
+  float pi[2], po[2];
 
-  assert(ch == 4);
+  pi[0] = w->roi_out.x + x;
+  pi[1] = w->roi_out.y + y;
 
-  const dt_interpolation_t *interpolation = dt_interpolation_new(DT_INTERPOLATION_USERPREF);
+  backtransform(w->piece, w->scale, pi, po);
 
-  DT_OMP_FOR()
-  // (slow) point-by-point transformation.
-  // TODO: optimize with scanlines and linear steps between?
-  for(int j = 0; j < roi_out->height; j++)
-  {
-    float *out = ((float *)ovoid) + (size_t)ch * j * roi_out->width;
-    for(int i = 0; i < roi_out->width; i++, out += ch)
-    {
-      float pi[2], po[2];
+  *xin = po[0] - w->roi_in.x;
+  *yin = po[1] - w->roi_in.y;
+}
 
-      pi[0] = roi_out->x + i;
-      pi[1] = roi_out->y + j;
+gboolean fuse_warp(dt_iop_module_t *self,
+                   dt_dev_pixelpipe_iop_t *piece,
+                   const dt_iop_roi_t *const roi_in,
+                   const dt_iop_roi_t *const roi_out,
+                   dt_dev_warp_step_t *step)
+{
+  _rotatepixels_warp_t *w = dt_alloc1_align_type(_rotatepixels_warp_t);
+  w->piece = piece;
+  w->roi_in = *roi_in;
+  w->roi_out = *roi_out;
+  w->scale = roi_in->scale / piece->iscale;
+  step->map = _rotatepixels_warp_map;
+  step->data = w;
+  return TRUE;
+}
 
-      backtransform(piece, scale, pi, po);
+// 3rd (final) pass: you get this input region (may be different from what was requested above),
+// do your best to fill the output region!
+void process(dt_iop_module_t *self, dt_dev_pixelpipe_iop_t *piece, const void *const ivoid, void *const ovoid,
+             const dt_iop_roi_t *const roi_in, const dt_iop_roi_t *const roi_out)
+{
+  assert(piece->colors == 4);
 
-      po[0] -= roi_in->x;
-      po[1] -= roi_in->y;
+  const dt_interpolation_t *interpolation = dt_interpolation_new(DT_INTERPOLATION_USERPREF);
+  const _rotatepixels_warp_t w = { .piece = piece,
+                                   .roi_in = *roi_in,
+                                   .roi_out = *roi_out,
+                                   .scale = roi_in->scale / piece->iscale };
 
-      dt_interpolation_compute_pixel4c(interpolation, (float *)ivoid, out, po[0], po[1], roi_in->width,
-                                       roi_in->height, ch_width);
-    }
-  }
+  dt_interpolation_warp(interpolation, (float *)ovoid, roi_out, (const float *)ivoid, roi_in,
+                        _rotatepixels_warp_map, &w, DT_INTERPOLATION_WARP_PRECISION);
 }
 
 void commit_params(dt_iop_module_t *self, dt_iop_params_t *p1, dt_dev_pixelpipe_t *pipe,
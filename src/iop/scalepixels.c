@@ -201,29 +201,38 @@ void modify_roi_in(dt_iop_module_t *self, dt_dev_pixelpipe_iop_t *piece, const d
   roi_in->y = roi_out->y * d->y_scale;
 }
 
+// output to input buffer coordinates for dt_interpolation_warp()
+static void _scalepixels_warp_map(const void *data,
+                                  const float x,
+                                  const float y,
+                                  float *xin,
+                                  float *yin)
+{
+  const dt_iop_scalepixels_data_t *const d = data;
+  *xin = x * d->x_scale;
+  *yin = y * d->y_scale;
+}
+
+gboolean fuse_warp(dt_iop_module_t *self,
+                   dt_dev_pixelpipe_iop_t *piece,
+                   const dt_iop_roi_t *const roi_in,
+                   const dt_iop_roi_t *const roi_out,
+                   dt_dev_warp_step_t *step)
+{
+  dt_iop_scalepixels_data_t *d = dt_alloc1_align_type(dt_iop_scalepixels_data_t);
+  *d = *(dt_iop_scalepixels_data_t *)piece->data;
+  step->map = _scalepixels_warp_map;
+  step->data = d;
+  return TRUE;
+}
+
 void process(dt_iop_module_t *self, dt_dev_pixelpipe_iop_t *piece, const void *const ivoid, void *const ovoid,
              const dt_iop_roi_t *const roi_in, const dt_iop_roi_t *const roi_out)
 {
-  const int ch = piece->colors;
-  const int ch_width = ch * roi_in->width;
   const dt_interpolation_t *interpolation = dt_interpolation_new(DT_INTERPOLATION_USERPREF);
-  const dt_iop_scalepixels_data_t * const d = piece->data;
 
-  DT_OMP_FOR()
-  // (slow) point-by-point transformation.
-  // TODO: optimize with scanlines and linear steps between?
-  for(int j = 0; j < roi_out->height; j++)
-  {
-    float *out = ((float *)ovoid) + (size_t)4 * j * roi_out->width;
-    for(int i = 0; i < roi_out->width; i++, out += 4)
-    {
-      float x = i*d->x_scale;
-      float y = j*d->y_scale;
-
-      dt_interpolation_compute_pixel4c(interpolation, (float *)ivoid, out, x, y, roi_in->width,
-                                       roi_in->height, ch_width);
-    }
-  }
+  dt_interpolation_warp(interpolation, (float *)ovoid, roi_out, (const float *)ivoid, roi_in,
+                        _scalepixels_warp_map, piece->data, DT_INTERPOLATION_WARP_PRECISION);
 }
 
 void commit_params(dt_iop_module_t *self, dt_iop_params_t *params, dt_dev_pixelpipe_t *pipe,
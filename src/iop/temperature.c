@@ -638,6 +638,29 @@ void process(dt_iop_module_t *self,
   _publish_chroma(piece);
 }
 
+gboolean fuse_raw_frontend(dt_iop_module_t *self,
+                           dt_dev_pixelpipe_iop_t *piece,
+                           dt_dev_raw_frontend_t *fe,
+                           const dt_iop_roi_t *const roi_in,
+                           const dt_iop_roi_t *const roi_out)
+{
+  const uint32_t filters = piece->pipe->dsc.filters;
+  const uint8_t(*const xtrans)[6] = (const uint8_t(*const)[6])piece->pipe->dsc.xtrans;
+  const dt_iop_temperature_data_t *const d = piece->data;
+  if(!filters)
+    return FALSE;
+
+  // same coefficients per location as process()
+  for(int j = 0; j < DT_RAW_FRONTEND_ROWS; j++)
+    for(int i = 0; i < DT_RAW_FRONTEND_COLS; i++)
+      fe->coeff[j][i] = d->coeffs[filters == 9u
+                                  ? FCxtrans(j, i, roi_out, xtrans)
+                                  : FC(j + roi_out->y, i + roi_out->x, filters)];
+
+  _publish_chroma(piece);
+  return TRUE;
+}
+
 #ifdef HAVE_OPENCL
 int process_cl(dt_iop_module_t *self,
                dt_dev_pixelpipe_iop_t *piece,
@@ -716,6 +739,8 @@ void commit_params(dt_iop_module_t *self,
   if(self->dev->image_storage.flags & DT_IMAGE_4BAYER)
     piece->process_cl_ready = FALSE;
 
+  piece->raw_frontend_ready = self->dev->image_storage.buf_dsc.filters != 0;
+
   d->preset = p->preset;
 
   /* Make sure the chroma information stuff is valid
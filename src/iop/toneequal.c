@@ -96,6 +96,7 @@
 #include "common/darktable.h"
 #include "common/fast_guided_filter.h"
 #include "common/eigf.h"
+#include "common/histogram.h"
 #include "common/interpolation.h"
 #include "common/luminance_mask.h"
 #include "common/opencl.h"
@@ -202,9 +203,26 @@ typedef struct dt_iop_toneequalizer_data_t
 } dt_iop_toneequalizer_data_t;
 
 
+// Luminance masks are cached for all pipes and instances, keyed by the
+// upstream pipe, the mask parameters and the roi, so exports can reuse the
+// masks of the darkroom.
+#define MASK_CACHE_ENTRIES 4
+#define MASK_CACHE_MAX_ELEM (32 * 1024 * 1024) // 128 MB of floats
+
+typedef struct dt_iop_toneequalizer_mask_t
+{
+  dt_hash_t hash;        // upstream, mask params, roi and pipe quality
+  dt_iop_roi_t roi;
+  uint64_t used;
+  float *luminance;
+} dt_iop_toneequalizer_mask_t;
+
 typedef struct dt_iop_toneequalizer_global_data_t
 {
   // TODO: put OpenCL kernels here at some point
+  dt_pthread_mutex_t lock;
+  uint64_t clock;
+  dt_iop_toneequalizer_mask_t masks[MASK_CACHE_ENTRIES];
 } dt_iop_toneequalizer_global_data_t;
 
 
@@ -938,6 +956,137 @@ static inline void compute_luminance_mask(const float *const restrict in,
   }
 }
 
+/***
+ * Luminance mask cache
+ **/
+
+static dt_hash_t _mask_hash(dt_dev_pixelpipe_iop_t *piece,
+                            const dt_iop_toneequalizer_data_t *const d,
+                            const dt_iop_roi_t *const roi_in)
+{
+  // the upstream hash ignores the pipe type, preview and thumbnail pipes
+  // demosaic differently though, so they don't share their masks with the others
+  const gboolean preview = piece->pipe->type & (DT_DEV_PIXELPIPE_PREVIEW | DT_DEV_PIXELPIPE_THUMBNAIL);
+  const struct
+  {
+    float blending, feathering, contrast_boost, exposure_boost, quantization;
+    int radius, iterations;
+    dt_iop_luminance_mask_method_t method;
+    dt_iop_toneequalizer_filter_t details;
+  } params = { d->blending, d->feathering, d->contrast_boost, d->exposure_boost, d->quantization,
+               d->radius, d->iterations, d->method, d->details };
+
+  dt_hash_t hash = dt_dev_pixelpipe_piece_hash(piece, NULL, FALSE);
+  hash = dt_hash(hash, &piece->module->iop_order, sizeof(piece->module->iop_order));
+  hash = dt_hash(hash, &params, sizeof(params));
+  hash = dt_hash(hash, &preview, sizeof(preview));
+
+  const struct { int x, y, width, height; float scale; } roi =
+    { roi_in->x, roi_in->y, roi_in->width, roi_in->height, roi_in->scale };
+  return dt_hash(hash, &roi, sizeof(roi));
+}
+
+static gboolean _mask_cache_get(dt_iop_toneequalizer_global_data_t *gd,
+                                const dt_hash_t hash,
+                                float *const restrict luminance,
+                                const size_t num_elem)
+{
+  gboolean found = FALSE;
+  dt_pthread_mutex_lock(&gd->lock);
+  for(int k = 0; k < MASK_CACHE_ENTRIES; k++)
+  {
+    dt_iop_toneequalizer_mask_t *m = &gd->masks[k];
+    if(m->luminance && m->hash == hash)
+    {
+      dt_iop_image_copy(luminance, m->luminance, num_elem);
+      m->used = ++gd->clock;
+      found = TRUE;
+      break;
+    }
+  }
+  dt_pthread_mutex_unlock(&gd->lock);
+  return found;
+}
+
+static void _mask_cache_put(dt_iop_toneequalizer_global_data_t *gd,
+                            const dt_hash_t hash,
+                            const dt_iop_roi_t *const roi_in,
+                            const float *const restrict luminance)
+{
+  const size_t num_elem = (size_t)roi_in->width * roi_in->height;
+  if(num_elem > MASK_CACHE_MAX_ELEM) return;
+
+  dt_pthread_mutex_lock(&gd->lock);
+
+  // replace an entry for the same roi, or the least recently used one,
+  // and evict the older ones if we would hold too much memory
+  int slot = 0;
+  size_t total = num_elem;
+  for(int k = 0; k < MASK_CACHE_ENTRIES; k++)
+  {
+    const dt_iop_toneequalizer_mask_t *m = &gd->masks[k];
+    if(m->luminance && m->hash == hash)
+    {
+      dt_pthread_mutex_unlock(&gd->lock);
+      return;
+    }
+    if(m->used < gd->masks[slot].used) slot = k;
+    if(m->luminance) total += (size_t)m->roi.width * m->roi.height;
+  }
+
+  dt_iop_toneequalizer_mask_t *m = &gd->masks[slot];
+  total -= m->luminance ? (size_t)m->roi.width * m->roi.height : 0;
+  dt_free_align(m->luminance);
+  m->luminance = NULL;
+  m->used = 0;
+
+  while(total > MASK_CACHE_MAX_ELEM)
+  {
+    int oldest = -1;
+    for(int k = 0; k < MASK_CACHE_ENTRIES; k++)
+      if(gd->masks[k].luminance && (oldest < 0 || gd->masks[k].used < gd->masks[oldest].used))
+        oldest = k;
+    if(oldest < 0) break;
+    total -= (size_t)gd->masks[oldest].roi.width * gd->masks[oldest].roi.height;
+    dt_free_align(gd->masks[oldest].luminance);
+    gd->masks[oldest].luminance = NULL;
+    gd->masks[oldest].used = 0;
+  }
+
+  m->luminance = dt_alloc_align_float(num_elem);
+  if(m->luminance)
+  {
+    dt_iop_image_copy(m->luminance, luminance, num_elem);
+    m->hash = hash;
+    m->roi = *roi_in;
+    m->used = ++gd->clock;
+  }
+
+  dt_pthread_mutex_unlock(&gd->lock);
+}
+
+static void get_luminance_mask(dt_iop_module_t *self,
+                               dt_dev_pixelpipe_iop_t *piece,
+                               const float *const restrict in,
+                               float *const restrict luminance,
+                               const dt_iop_roi_t *const roi_in,
+                               const dt_hash_t hash)
+{
+  dt_iop_toneequalizer_global_data_t *gd = self->global_data;
+  const dt_iop_toneequalizer_data_t *const d = piece->data;
+  const size_t width = roi_in->width;
+  const size_t height = roi_in->height;
+
+  if(_mask_cache_get(gd, hash, luminance, width * height))
+  {
+    dt_print_pipe(DT_DEBUG_PIPE, "toneequal mask cached", piece->pipe, self, DT_DEVICE_CPU, roi_in, NULL);
+    return;
+  }
+
+  compute_luminance_mask(in, luminance, width, height, d);
+  _mask_cache_put(gd, hash, roi_in, luminance);
+}
+
 /***
  * Actual transfer functions
  **/
@@ -1007,8 +1156,8 @@ void toneeq_process(dt_iop_module_t *self,
   const size_t height = roi_in->height;
   const size_t num_elem = width * height;
 
-  // Get the hash of the upstream pipe to track changes
-  const dt_hash_t hash = dt_dev_pixelpipe_piece_hash(piece, roi_out, TRUE);
+  // Get the hash of the upstream pipe and mask params to track changes
+  const dt_hash_t hash = _mask_hash(piece, d, roi_in);
 
   // Sanity checks
   if(width < 1 || height < 1) return;
@@ -1109,7 +1258,7 @@ void toneeq_process(dt_iop_module_t *self,
       if(hash != saved_hash || !luminance_valid)
       {
         /* compute only if upstream pipe state has changed */
-        compute_luminance_mask(in, luminance, width, height, d);
+        get_luminance_mask(self, piece, in, luminance, roi_in, hash);
         hash_set_get(&hash, &g->ui_preview_hash, &self->gui_lock);
       }
     }
@@ -1128,7 +1277,7 @@ void toneeq_process(dt_iop_module_t *self,
         dt_iop_gui_enter_critical_section(self);
         g->thumb_preview_hash = hash;
         g->histogram_valid = FALSE;
-        compute_luminance_mask(in, luminance, width, height, d);
+        get_luminance_mask(self, piece, in, luminance, roi_in, hash);
         g->luminance_valid = TRUE;
         dt_iop_gui_leave_critical_section(self);
         dt_dev_pixelpipe_cache_invalidate_later(piece->pipe, self->iop_order);
@@ -1136,13 +1285,13 @@ void toneeq_process(dt_iop_module_t *self,
     }
     else // make it dummy-proof
     {
-      compute_luminance_mask(in, luminance, width, height, d);
+      get_luminance_mask(self, piece, in, luminance, roi_in, hash);
     }
   }
   else
   {
-    // no caching path : compute no matter what
-    compute_luminance_mask(in, luminance, width, height, d);
+    // no GUI caching path : reuse a mask of another pipe or compute it
+    get_luminance_mask(self, piece, in, luminance, roi_in, hash);
   }
 
   // Display output
@@ -1392,7 +1541,6 @@ static inline void build_interpolation_matrix(float A[CHANNELS * PIXEL_CHAN],
 }
 
 
-__DT_CLONE_TARGETS__
 static inline void compute_log_histogram_and_stats(const float *const restrict luminance,
                                                    int histogram[UI_SAMPLES],
                                                    const size_t num_elem,
@@ -1400,72 +1548,23 @@ static inline void compute_log_histogram_and_stats(const float *const restrict l
                                                    float *first_decile,
                                                    float *last_decile)
 {
-  // (Re)init the histogram
-  memset(histogram, 0, sizeof(int) * UI_SAMPLES);
-
-  // we first calculate an extended histogram for better accuracy
-  #define TEMP_SAMPLES 2 * UI_SAMPLES
-  int temp_hist[TEMP_SAMPLES];
-  memset(temp_hist, 0, sizeof(int) * TEMP_SAMPLES);
-
-  // Split exposure in bins
-  DT_OMP_FOR_SIMD(reduction(+:temp_hist[:TEMP_SAMPLES]))
-  for(size_t k = 0; k < num_elem; k++)
-  {
-    // extended histogram bins between [-10; +6] EV remapped between [0 ; 2 * UI_SAMPLES]
-    const int index =
-      CLAMP((int)(((log2f(luminance[k]) + 10.0f) / 16.0f) * (float)TEMP_SAMPLES),
-            0, TEMP_SAMPLES - 1);
-    temp_hist[index] += 1;
-  }
-
-  const int first = (int)((float)num_elem * 0.05f);
-  const int last = (int)((float)num_elem * (1.0f - 0.95f));
-  int population = 0;
-  int first_pos = 0;
-  int last_pos = 0;
-
-  // scout the extended histogram bins looking for deciles
-  // these would not be accurate with the regular histogram
-  for(int k = 0; k < TEMP_SAMPLES; ++k)
-  {
-    const size_t prev_population = population;
-    population += temp_hist[k];
-    if(prev_population < first && first <= population)
-    {
-      first_pos = k;
-      break;
-    }
-  }
-  population = 0;
-  for(int k = TEMP_SAMPLES - 1; k >= 0; --k)
-  {
-    const size_t prev_population = population;
-    population += temp_hist[k];
-    if(prev_population < last && last <= population)
-    {
-      last_pos = k;
-      break;
-    }
-  }
+  // 32 bins per EV give accurate deciles
+  dt_histogram_log_stats_t stats;
+  dt_histogram_log_stats(luminance, num_elem, 1, NULL, &stats);
 
-  // Convert decile positions to exposures
-  *first_decile = 16.0 * (float)first_pos / (float)(TEMP_SAMPLES - 1) - 10.0;
-  *last_decile = 16.0 * (float)last_pos / (float)(TEMP_SAMPLES - 1) - 10.0;
+  *first_decile = dt_histogram_log_percentile(&stats, 0.05f);
+  *last_decile = dt_histogram_log_percentile(&stats, 0.95f);
 
-  // remap the extended histogram into the normal one
-  // bins between [-8; 0] EV remapped between [0 ; UI_SAMPLES]
-  for(size_t k = 0; k < TEMP_SAMPLES; ++k)
-  {
-    const float EV = 16.0 * (float)k / (float)(TEMP_SAMPLES - 1) - 10.0;
-    const int i =
-      CLAMP((int)(((EV + 8.0f) / 8.0f) * (float)UI_SAMPLES),
-            0, UI_SAMPLES - 1);
-    histogram[i] += temp_hist[k];
+  // the UI histogram has the same bins between [-8; 0] EV,
+  // everything outside goes to the first and last bin
+  memset(histogram, 0, sizeof(int) * UI_SAMPLES);
+  const int offset = (int)((-8.0f - DT_HISTOGRAM_LOG_MIN_EV) * DT_HISTOGRAM_LOG_BINS_PER_EV);
+  for(int k = 0; k < DT_HISTOGRAM_LOG_BINS; k++)
+    histogram[CLAMP(k - offset, 0, UI_SAMPLES - 1)] += stats.bins[k];
 
-    // store the max numbers of elements in bins for later normalization
+  // store the max numbers of elements in bins for later normalization
+  for(int i = 0; i < UI_SAMPLES; i++)
     *max_histogram = histogram[i] > *max_histogram ? histogram[i] : *max_histogram;
-  }
 }
 
 static inline void update_histogram(dt_iop_module_t *const self)
@@ -1565,7 +1664,8 @@ static inline gboolean update_curve_lut(dt_iop_module_t *self)
 
 void init_global(dt_iop_module_so_t *self)
 {
-  dt_iop_toneequalizer_global_data_t *gd = malloc(sizeof(dt_iop_toneequalizer_global_data_t));
+  dt_iop_toneequalizer_global_data_t *gd = calloc(1, sizeof(dt_iop_toneequalizer_global_data_t));
+  dt_pthread_mutex_init(&gd->lock, NULL);
 
   self->data = gd;
 }
@@ -1573,6 +1673,10 @@ void init_global(dt_iop_module_so_t *self)
 
 void cleanup_global(dt_iop_module_so_t *self)
 {
+  dt_iop_toneequalizer_global_data_t *gd = self->data;
+  for(int k = 0; k < MASK_CACHE_ENTRIES; k++)
+    dt_free_align(gd->masks[k].luminance);
+  dt_pthread_mutex_destroy(&gd->lock);
   free(self->data);
   self->data = NULL;
 }
@@ -1813,10 +1917,7 @@ static void auto_adjust_exposure_boost(GtkWidget *quad, dt_iop_module_t *self)
   // Controls nodes are between -8 and 0 EV,
   // so we aim at centering the exposure distribution on -4 EV
 
-  dt_iop_gui_enter_critical_section(self);
-  g->histogram_valid = FALSE;
-  dt_iop_gui_leave_critical_section(self);
-
+  // the histogram is up to date with the luminance mask
   update_histogram(self);
 
   // calculate exposure correction
@@ -1875,10 +1976,7 @@ static void auto_adjust_contrast_boost(GtkWidget *quad, dt_iop_module_t *self)
   }
 
   // The goal is to spread 90 % of the exposure histogram in the [-7, -1] EV
-  dt_iop_gui_enter_critical_section(self);
-  g->histogram_valid = FALSE;
-  dt_iop_gui_leave_critical_section(self);
-
+  // the histogram is up to date with the luminance mask
   update_histogram(self);
 
   // calculate contrast correction
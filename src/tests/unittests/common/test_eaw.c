@@ -0,0 +1,212 @@
+/*
+    This file is part of darktable,
+    Copyright (C) 2025 darktable developers.
+
+    darktable is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    darktable is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with darktable.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*
+ * cmocka unit tests for the fused wavelet decomposition and synthesis
+ * used by denoiseprofile, see common/eaw.c
+ *
+ * Please see ../README.md for more detailed documentation.
+ */
+#include <float.h>
+#include <limits.h>
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <math.h>
+
+#include <cmocka.h>
+
+#include "../util/assert.h"
+#include "../util/tracing.h"
+#include "../util/testimg.h"
+
+#include "common/eaw.c"
+
+#ifdef _WIN32
+#include "win/main_wrapper.h"
+#endif
+
+/*
+ * DEFINITIONS
+ */
+
+// relative tolerance between the fused and the reference wavelet denoising:
+#define E 1e-5f
+
+#define TEST_WIDTH 317
+#define TEST_HEIGHT 211
+#define TEST_SCALES 5
+
+/*
+ * HELPERS
+ */
+
+static Testimg *_gen_pattern(const int width, const int height)
+{
+  Testimg *ti = testimg_alloc(width, height);
+  for_testimg_pixels_p_yx(ti)
+  {
+    const unsigned int h = ((unsigned)x * 73856093u) ^ ((unsigned)y * 19349663u);
+    const float noise = (float)((h * 2654435761u) >> 16 & 0xffff) / 65536.0f - 0.5f;
+    p[0] = 2.0f * x / width + noise;
+    p[1] = ((x / 5 + y / 3) & 1) ? 3.0f : 1.0f + 0.5f * noise;
+    p[2] = 1.5f + sinf(0.09f * x) * cosf(0.05f * y) + 0.3f * noise;
+    p[3] = 0.0f;
+  }
+  ti->name = "pattern";
+  return ti;
+}
+
+// any threshold depending on the band statistics will do
+static void _threshold(dt_aligned_pixel_t thrs, const dt_aligned_pixel_t sum_y2, const size_t npixels)
+{
+  for_four_channels(c)
+    thrs[c] = 0.5f * sqrtf(sum_y2[c] / npixels);
+}
+
+// the former decomposition, storing the full detail band, with the
+// boundary handled by clamping every tap
+static void _decompose_reference(float *const out, const float *const in, float *const detail,
+                                 dt_aligned_pixel_t sum_squared, const int scale, const float inv_sigma2,
+                                 const int width, const int height)
+{
+  const int mult = 1u << scale;
+  static const float filter[5] = { 1.0f / 16.0f, 4.0f / 16.0f, 6.0f / 16.0f, 4.0f / 16.0f, 1.0f / 16.0f };
+  double sum_sq[4] = { 0.0, 0.0, 0.0, 0.0 };
+  for(int j = 0; j < height; j++)
+    for(int i = 0; i < width; i++)
+    {
+      const float *px = in + (size_t)4 * (j * width + i);
+      dt_aligned_pixel_t sum = { 0.0f, 0.0f, 0.0f, 0.0f };
+      dt_aligned_pixel_t wgt = { 0.0f, 0.0f, 0.0f, 0.0f };
+      for(int jj = 0; jj < 5; jj++)
+        for(int ii = 0; ii < 5; ii++)
+        {
+          const int y = CLAMP(j + mult * (jj - 2), 0, height - 1);
+          const int x = CLAMP(i + mult * (ii - 2), 0, width - 1);
+          const float *px2 = in + (size_t)4 * (y * width + x);
+          const float w = filter[jj] * filter[ii] * dn_weight(px, px2, inv_sigma2);
+          for_each_channel(c)
+          {
+            wgt[c] += w;
+            sum[c] += w * px2[c];
+          }
+        }
+      for_each_channel(c)
+      {
+        sum[c] /= wgt[c];
+        out[4 * (j * width + i) + c] = sum[c];
+        detail[4 * (j * width + i) + c] = px[c] - sum[c];
+        sum_sq[c] += (px[c] - sum[c]) * (px[c] - sum[c]);
+      }
+    }
+  for_four_channels(c)
+    sum_squared[c] = sum_sq[c];
+}
+
+/*
+ * TEST FUNCTIONS
+ */
+
+static void test_fused_matches_reference(void **state)
+{
+  Testimg *ti = _gen_pattern(TEST_WIDTH, TEST_HEIGHT);
+  const int width = ti->width, height = ti->height;
+  const size_t npixels = (size_t)width * height;
+  float *ref_out = dt_calloc_align_float(4 * npixels);
+  float *ref_in = dt_alloc_align_float(4 * npixels);
+  float *ref_coarse = dt_alloc_align_float(4 * npixels);
+  float *detail = dt_alloc_align_float(4 * npixels);
+  float *out = dt_alloc_align_float(4 * npixels);
+  float *buf1 = dt_alloc_align_float(4 * npixels);
+  float *buf2 = dt_alloc_align_float(4 * npixels);
+  memcpy(ref_in, ti->pixels, sizeof(float) * 4 * npixels);
+  memcpy(buf1, ti->pixels, sizeof(float) * 4 * npixels);
+
+  // reference: decompose, threshold and synthesize in separate sweeps
+  for(int scale = 0; scale < TEST_SCALES; scale++)
+  {
+    dt_aligned_pixel_t sum_y2, thrs;
+    _decompose_reference(ref_coarse, ref_in, detail, sum_y2, scale, 1.0f, width, height);
+    _threshold(thrs, sum_y2, npixels);
+    const dt_aligned_pixel_t boost = { 1.0f, 1.0f, 1.0f, 1.0f };
+    eaw_synthesize(ref_out, ref_out, detail, thrs, boost, width, height);
+    float *tmp = ref_in;
+    ref_in = ref_coarse;
+    ref_coarse = tmp;
+  }
+  for(size_t k = 0; k < 4 * npixels; k++)
+    ref_out[k] += ref_in[k];
+
+  // fused: each band is folded into the output while decomposing the next one
+  dt_aligned_pixel_t thrs = { 0.0f, 0.0f, 0.0f, 0.0f };
+  for(int scale = 0; scale < TEST_SCALES; scale++)
+  {
+    dt_aligned_pixel_t sum_y2;
+    eaw_dn_decompose(buf2, buf1, out, sum_y2, scale > 0 ? thrs : NULL, scale == 1,
+                     scale, 1.0f, width, height);
+    _threshold(thrs, sum_y2, npixels);
+    float *tmp = buf2;
+    buf2 = buf1;
+    buf1 = tmp;
+  }
+  eaw_dn_synthesize_residue(out, buf2, buf1, thrs, FALSE, width, height);
+
+  for(size_t k = 0; k < npixels; k++)
+    for(int c = 0; c < 3; c++)
+    {
+      const float ref = ref_out[4 * k + c];
+      const float diff = fabsf(out[4 * k + c] - ref);
+      if(diff > E * fmaxf(1.0f, fabsf(ref)))
+        fail_msg("pixel %zu channel %d: fused %f, reference %f", k, c, out[4 * k + c], ref);
+    }
+
+  dt_free_align(buf2);
+  dt_free_align(buf1);
+  dt_free_align(out);
+  dt_free_align(detail);
+  dt_free_align(ref_coarse);
+  dt_free_align(ref_in);
+  dt_free_align(ref_out);
+  testimg_free(ti);
+}
+
+static int setup(void **state)
+{
+  darktable.num_openmp_threads = dt_get_num_procs();
+  return 0;
+}
+
+/*
+ * MAIN FUNCTION
+ */
+int main(int argc, char* argv[])
+{
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test(test_fused_matches_reference)
+  };
+
+  TR_DEBUG("epsilon = %e", E);
+
+  return cmocka_run_group_tests(tests, setup, NULL);
+}
+// clang-format off
+// modelines: These editor modelines have been set for all relevant files by tools/update_modelines.py
+// vim: shiftwidth=2 expandtab tabstop=2 cindent
+// kate: tab-indents: off; indent-width 2; replace-tabs on; indent-mode cstyle; remove-trailing-spaces modified;
+// clang-format on
@@ -0,0 +1,340 @@
+/*
+    This file is part of darktable,
+    Copyright (C) 2025 darktable developers.
+
+    darktable is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    darktable is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with darktable.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*
+ * cmocka unit tests and benchmark for the blocked recursive gaussian
+ * blur, see common/gaussian.c
+ *
+ * The benchmark compares against the former implementation on 24, 45 and
+ * 100MP images and needs several GB of memory, so it only runs if the
+ * environment variable DT_BENCH_GAUSSIAN is set.
+ *
+ * Please see ../README.md for more detailed documentation.
+ */
+#include <float.h>
+#include <limits.h>
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include <cmocka.h>
+
+#include "../util/assert.h"
+#include "../util/tracing.h"
+
+#include "common/gaussian.c"
+
+#ifdef _WIN32
+#include "win/main_wrapper.h"
+#endif
+
+/*
+ * DEFINITIONS
+ */
+
+// relative tolerance between the blocked and the reference blur, which
+// only differ by floating point contraction:
+#define E 1e-5f
+
+#define TEST_WIDTH 317
+#define TEST_HEIGHT 211
+
+/*
+ * HELPERS
+ */
+
+static float *_gen_pattern(const size_t width, const size_t height)
+{
+  float *img = dt_alloc_align_float(4 * width * height);
+  if(!img) return NULL;
+  DT_OMP_FOR()
+  for(size_t j = 0; j < height; j++)
+    for(size_t i = 0; i < width; i++)
+    {
+      float *p = img + 4 * (j * width + i);
+      const unsigned int h = ((unsigned)i * 73856093u) ^ ((unsigned)j * 19349663u);
+      const float noise = (float)((h * 2654435761u) >> 16 & 0xffff) / 65536.0f - 0.5f;
+      p[0] = (float)i / width + 0.1f * noise;
+      p[1] = ((i / 7 + j / 5) & 1) ? 0.8f : 0.2f;
+      p[2] = 0.5f + noise;
+      p[3] = noise;
+    }
+  return img;
+}
+
+// the former column-by-column implementation
+static void _blur_4c_reference(dt_gaussian_t *g, const float *const in, float *const out)
+{
+  assert(g->channels == 4);
+  const size_t width = g->width;
+  const size_t height = g->height;
+
+  float a0, a1, a2, a3, b1, b2, coefp, coefn;
+
+  _compute_gauss_params(g->sigma, g->order, &a0, &a1, &a2, &a3, &b1, &b2, &coefp, &coefn);
+
+  float *const temp = g->buf;
+
+  dt_aligned_pixel_t Labmin, Labmax;
+  copy_pixel(Labmin, g->min);
+  copy_pixel(Labmax, g->max);
+
+// vertical blur column by column
+  DT_OMP_FOR()
+  for(size_t i = 0; i < width; i++)
+  {
+    // forward filter
+    dt_aligned_pixel_t xp;
+    dt_aligned_pixel_t yb;
+    dt_aligned_pixel_t yp;
+    for_four_channels(k)
+    {
+      xp[k] = CLAMPF(in[4*i + k], Labmin[k], Labmax[k]);
+      yb[k] = xp[k] * coefp;
+      yp[k] = yb[k];
+    }
+
+    dt_aligned_pixel_t xc;
+    dt_aligned_pixel_t xn;
+    dt_aligned_pixel_t xa;
+    for(size_t j = 0; j < height; j++)
+    {
+      size_t offset = 4 * (j * width + i);
+
+      dt_aligned_pixel_t yc;
+      for_four_channels(k)
+      {
+        xc[k] = CLAMPF(in[offset + k], Labmin[k], Labmax[k]);
+        yc[k] = (a0 * xc[k]) + (a1 * xp[k]) - (b1 * yp[k]) - (b2 * yb[k]);
+
+        xp[k] = xc[k];
+        yb[k] = yp[k];
+        yp[k] = yc[k];
+      }
+      copy_pixel(temp + offset, yc);
+    }
+
+    // backward filter
+    dt_aligned_pixel_t yn;
+    dt_aligned_pixel_t ya;
+    for_four_channels(k)
+    {
+      xn[k] = CLAMPF(in[4*((height - 1) * width + i) + k], Labmin[k], Labmax[k]);
+      xa[k] = xn[k];
+      yn[k] = xn[k] * coefn;
+      ya[k] = yn[k];
+    }
+
+    for(size_t j = height; j > 0; j--)
+    {
+      size_t offset = 4 * ((j-1) * width + i);
+
+      dt_aligned_pixel_t yc;
+      for_four_channels(k)
+      {
+        xc[k] = CLAMPF(in[offset + k], Labmin[k], Labmax[k]);
+
+        yc[k] = (a2 * xn[k]) + (a3 * xa[k]) - (b1 * yn[k]) - (b2 * ya[k]);
+
+        xa[k] = xn[k];
+        xn[k] = xc[k];
+        ya[k] = yn[k];
+        yn[k] = yc[k];
+        temp[offset + k] += yc[k];
+      }
+    }
+  }
+
+// horizontal blur line by line
+  DT_OMP_FOR()
+  for(size_t j = 0; j < height; j++)
+  {
+    // forward filter
+    dt_aligned_pixel_t xp;
+    dt_aligned_pixel_t yb;
+    dt_aligned_pixel_t yp;
+    dt_aligned_pixel_t xc;
+    for_four_channels(k)
+    {
+      xp[k] = CLAMPF(temp[4*(j * width) + k], Labmin[k], Labmax[k]);
+      yb[k] = xp[k] * coefp;
+      yp[k] = yb[k];
+    }
+
+    for(size_t i = 0; i < width; i++)
+    {
+      size_t offset = 4 * (j * width + i);
+      dt_aligned_pixel_t yc;
+
+      for_four_channels(k)
+      {
+        xc[k] = CLAMPF(temp[offset + k], Labmin[k], Labmax[k]);
+        yc[k] = (a0 * xc[k]) + (a1 * xp[k]) - (b1 * yp[k]) - (b2 * yb[k]);
+
+        out[offset + k] = yc[k];
+
+        xp[k] = xc[k];
+        yb[k] = yp[k];
+        yp[k] = yc[k];
+      }
+    }
+
+    // backward filter
+    dt_aligned_pixel_t xn;
+    dt_aligned_pixel_t xa;
+    dt_aligned_pixel_t ya;
+    dt_aligned_pixel_t yn;
+    for_four_channels(k)
+    {
+      xn[k] = CLAMPF(temp[4*((j + 1) * width - 1) + k], Labmin[k], Labmax[k]);
+      xa[k] = xn[k];
+      yn[k] = xn[k] * coefn;
+      ya[k] = yn[k];
+    }
+
+    for(int i = width - 1; i > -1; i--)
+    {
+      size_t offset = 4 * (j * width + i);
+
+      dt_aligned_pixel_t yc;
+      for_four_channels(k)
+      {
+        xc[k] = CLAMPF(temp[offset + k], Labmin[k], Labmax[k]);
+
+        yc[k] = (a2 * xn[k]) + (a3 * xa[k]) - (b1 * yn[k]) - (b2 * ya[k]);
+
+        xa[k] = xn[k];
+        xn[k] = xc[k];
+        ya[k] = yn[k];
+        yn[k] = yc[k];
+
+        out[offset + k] += yc[k];
+      }
+    }
+  }
+}
+
+/*
+ * TEST FUNCTIONS
+ */
+
+static void test_blocked_matches_reference(void **state)
+{
+  static const float sigmas[] = { 0.8f, 3.0f, 25.0f };
+  static const int sizes[][2] = { { TEST_WIDTH, TEST_HEIGHT }, { 1, TEST_HEIGHT }, { TEST_WIDTH, 1 }, { 15, 9 } };
+  const dt_aligned_pixel_t max = { 1.0f, 1.0f, 1.0f, 1.0f };
+  const dt_aligned_pixel_t min = { 0.0f, 0.0f, 0.0f, -1.0f };
+
+  for(int s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+  {
+    const int width = sizes[s][0], height = sizes[s][1];
+    float *in = _gen_pattern(width, height);
+    float *ref = dt_alloc_align_float(4 * (size_t)width * height);
+    float *out = dt_alloc_align_float(4 * (size_t)width * height);
+
+    for(int order = DT_IOP_GAUSSIAN_ZERO; order <= DT_IOP_GAUSSIAN_TWO; order++)
+      for(int k = 0; k < sizeof(sigmas) / sizeof(sigmas[0]); k++)
+      {
+        dt_gaussian_t *g = dt_gaussian_init(width, height, 4, max, min, sigmas[k], order);
+        assert_non_null(g);
+        _blur_4c_reference(g, in, ref);
+        dt_gaussian_blur_4c(g, in, out);
+        dt_gaussian_free(g);
+
+        for(size_t p = 0; p < 4 * (size_t)width * height; p++)
+          if(fabsf(out[p] - ref[p]) > E * fmaxf(1.0f, fabsf(ref[p])))
+            fail_msg("%dx%d order %d sigma %f at %zu: %f, reference %f",
+                     width, height, order, sigmas[k], p, out[p], ref[p]);
+      }
+
+    dt_free_align(out);
+    dt_free_align(ref);
+    dt_free_align(in);
+  }
+}
+
+// not a correctness test: compares the throughput of the blocked and the
+// former implementation
+static void test_benchmark(void **state)
+{
+  if(!getenv("DT_BENCH_GAUSSIAN"))
+  {
+    print_message("[ SKIPPED  ] set DT_BENCH_GAUSSIAN to run the benchmark\n");
+    return;
+  }
+
+  static const size_t sizes[][2] = { { 6000, 4000 },     // 24MP
+                                     { 8256, 5504 },     // 45MP
+                                     { 11648, 8736 } };  // 100MP
+  const dt_aligned_pixel_t max = { INFINITY, INFINITY, INFINITY, INFINITY };
+  const dt_aligned_pixel_t min = { -INFINITY, -INFINITY, -INFINITY, -INFINITY };
+  for(int s = 0; s < 3; s++)
+  {
+    const size_t width = sizes[s][0], height = sizes[s][1];
+    const double mpix = width * height * 1e-6;
+    float *in = _gen_pattern(width, height);
+    float *out = dt_alloc_align_float(4 * width * height);
+    dt_gaussian_t *g = dt_gaussian_init(width, height, 4, max, min, 10.0f, DT_IOP_GAUSSIAN_ZERO);
+    if(!in || !out || !g)
+    {
+      print_message("[ SKIPPED  ] not enough memory for %.0fMP\n", mpix);
+    }
+    else
+    {
+      double t0 = dt_get_wtime();
+      _blur_4c_reference(g, in, out);
+      const double t_ref = dt_get_wtime() - t0;
+      t0 = dt_get_wtime();
+      dt_gaussian_blur_4c(g, in, out);
+      const double t_new = dt_get_wtime() - t0;
+      print_message("[ BENCH    ] %5zux%4zu (%3.0fMP): reference %6.3f s, blocked %6.3f s, speedup %.2f\n",
+                    width, height, mpix, t_ref, t_new, t_ref / t_new);
+    }
+    dt_gaussian_free(g);
+    dt_free_align(out);
+    dt_free_align(in);
+  }
+}
+
+static int setup(void **state)
+{
+  darktable.num_openmp_threads = dt_get_num_procs();
+  return 0;
+}
+
+/*
+ * MAIN FUNCTION
+ */
+int main(int argc, char* argv[])
+{
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test(test_blocked_matches_reference),
+    cmocka_unit_test(test_benchmark)
+  };
+
+  TR_DEBUG("epsilon = %e", E);
+
+  return cmocka_run_group_tests(tests, setup, NULL);
+}
+// clang-format off
+// modelines: These editor modelines have been set for all relevant files by tools/update_modelines.py
+// vim: shiftwidth=2 expandtab tabstop=2 cindent
+// kate: tab-indents: off; indent-width 2; replace-tabs on; indent-mode cstyle; remove-trailing-spaces modified;
+// clang-format on
@@ -0,0 +1,453 @@
+/*
+    This file is part of darktable,
+    Copyright (C) 2025 darktable developers.
+
+    darktable is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    darktable is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with darktable.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*
+ * cmocka unit tests and benchmark for the image resampling and warping in
+ * common/interpolation.c and the composed warps of develop/pixelpipe_fuse.c
+ *
+ * The benchmark only runs if the environment variable DT_BENCH_RESAMPLE is
+ * set.
+ *
+ * Please see ../README.md for more detailed documentation.
+ */
+#include <float.h>
+#include <limits.h>
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include <cmocka.h>
+
+#include "../util/assert.h"
+#include "../util/tracing.h"
+#include "../util/testimg.h"
+
+#include "common/interpolation.c"
+
+#ifdef _WIN32
+#include "win/main_wrapper.h"
+#endif
+
+/*
+ * DEFINITIONS
+ */
+
+// relative tolerance between the separable and the reference resampling,
+// both sum the same products but in a different order:
+#define E 1e-5f
+
+// input size for the benchmark:
+#define BENCH_WIDTH 3000
+#define BENCH_HEIGHT 2000
+#define BENCH_RUNS 3
+
+static const enum dt_interpolation_type itors[] =
+{
+  DT_INTERPOLATION_BILINEAR,
+  DT_INTERPOLATION_BICUBIC,
+  DT_INTERPOLATION_LANCZOS2,
+  DT_INTERPOLATION_LANCZOS3
+};
+
+// common export ratios, downscales and a mild upscale:
+static const float scales[] = { 0.5f, 1.0f / 3.0f, 0.25f, 0.125f, 1.5f };
+
+/*
+ * HELPERS
+ */
+
+// deterministic test pattern with smooth and high frequency content:
+static Testimg *_gen_pattern(const int width, const int height)
+{
+  Testimg *ti = testimg_alloc(width, height);
+  for_testimg_pixels_p_yx(ti)
+  {
+    p[0] = (float)x / width;
+    p[1] = (float)y / height;
+    p[2] = ((x / 3 + y / 5) & 1) ? 0.9f : 0.1f;
+    p[3] = 0.5f + 0.5f * sinf(0.07f * x) * cosf(0.05f * y);
+  }
+  ti->name = "pattern";
+  return ti;
+}
+
+static void _rois(const int width, const int height, const float scale,
+                  dt_iop_roi_t *roi_in, dt_iop_roi_t *roi_out)
+{
+  *roi_in = (dt_iop_roi_t){ 0, 0, width, height, 1.0f };
+  *roi_out = (dt_iop_roi_t){ 0, 0, (int)(scale * width), (int)(scale * height), scale };
+}
+
+// the former single pass implementation of dt_interpolation_resample(),
+// applying the full 2d kernel for every output pixel
+static void _resample_reference(const dt_interpolation_t *itor,
+                                float *out,
+                                const dt_iop_roi_t *const roi_out,
+                                const float *const in,
+                                const dt_iop_roi_t *const roi_in)
+{
+  int *hindex = NULL, *hlength = NULL, *vindex = NULL, *vlength = NULL, *vmeta = NULL;
+  float *hkernel = NULL, *vkernel = NULL;
+
+  const size_t in_stride_floats = roi_in->width * 4;
+  const size_t out_stride_floats = roi_out->width * 4;
+
+  if(_prepare_resampling_plan(itor, roi_in->width, roi_out->width, 0, roi_out->scale,
+                              &hlength, &hkernel, &hindex, NULL)
+     || _prepare_resampling_plan(itor, roi_in->height, roi_out->height, 0, roi_out->scale,
+                                 &vlength, &vkernel, &vindex, &vmeta))
+    goto exit;
+
+  DT_OMP_FOR()
+  for(size_t oy = 0; oy < (size_t)roi_out->height; oy++)
+  {
+    int vkidx = vmeta[3 * oy + 1];
+    int viidx = vmeta[3 * oy + 2];
+    const int vl = vlength[vmeta[3 * oy + 0]];
+    int hkidx = 0;
+
+    for(size_t ox = 0; ox < (size_t)roi_out->width; ox++)
+    {
+      dt_aligned_pixel_t vs = { 0.0f, 0.0f, 0.0f, 0.0f };
+      const int hl = hlength[ox];
+
+      for(int iy = 0; iy < vl; iy++)
+      {
+        const size_t baseidx_vindex = (size_t)vindex[viidx++] * in_stride_floats;
+        dt_aligned_pixel_t vhs = { 0.0f, 0.0f, 0.0f, 0.0f };
+        for(int ix = 0; ix < hl; ix++)
+        {
+          const size_t baseidx = baseidx_vindex + (size_t)hindex[hkidx] * 4;
+          const float htap = hkernel[hkidx++];
+          for_each_channel(c) vhs[c] += in[baseidx + c] * htap;
+        }
+        const float vtap = vkernel[vkidx++];
+        for_each_channel(c) vs[c] += vhs[c] * vtap;
+        hkidx -= hl;
+      }
+
+      for_each_channel(c)
+        out[oy * out_stride_floats + ox * 4 + c] = MAX(vs[c], 0.f);
+
+      viidx -= vl;
+      vkidx -= vl;
+      hkidx += hl;
+    }
+  }
+
+exit:
+  dt_free_align(hlength);
+  dt_free_align(vlength);
+}
+
+// mild perspective distortion as done by the perspective correction modules,
+// maps the output into the interior of the input
+static void _warp_homography(const void *data,
+                             const float x,
+                             const float y,
+                             float *xin,
+                             float *yin)
+{
+  const float *const h = data;
+  const float w = h[6] * x + h[7] * y + h[8];
+  *xin = (h[0] * x + h[1] * y + h[2]) / w;
+  *yin = (h[3] * x + h[4] * y + h[5]) / w;
+}
+
+static const float homography[9] = { 0.95f,  0.08f,   20.0f,
+                                    -0.05f,  0.9f,    15.0f,
+                                     1e-4f, -2e-4f,   1.0f };
+
+// plain per pixel warp the grid based one has to reproduce
+static void _warp_reference(const dt_interpolation_t *itor,
+                            float *out,
+                            const dt_iop_roi_t *const roi_out,
+                            const float *const in,
+                            const dt_iop_roi_t *const roi_in)
+{
+  for(int j = 0; j < roi_out->height; j++)
+    for(int i = 0; i < roi_out->width; i++)
+    {
+      float xin, yin;
+      _warp_homography(homography, i, j, &xin, &yin);
+      dt_interpolation_compute_pixel4c(itor, in, out + (size_t)4 * (j * roi_out->width + i),
+                                       xin, yin, roi_in->width, roi_in->height, 4 * roi_in->width);
+    }
+}
+
+// rotation by 2 degrees around the center of a 281x191 buffer, mapped into a 301x203 one
+static void _warp_rotation(const void *data,
+                           const float x,
+                           const float y,
+                           float *xin,
+                           float *yin)
+{
+  const float a = 2.0f * M_PI_F / 180.0f;
+  const float dx = x - 140.0f, dy = y - 95.0f;
+  *xin = cosf(a) * dx - sinf(a) * dy + 150.0f;
+  *yin = sinf(a) * dx + cosf(a) * dy + 101.0f;
+}
+
+static inline gboolean _inside(const float x, const float y, const dt_iop_roi_t *const roi, const float margin)
+{
+  return x >= margin && y >= margin && x <= roi->width - 1 - margin && y <= roi->height - 1 - margin;
+}
+
+static void _assert_close(const float *a, const float *b, const size_t n)
+{
+  for(size_t k = 0; k < n; k++)
+    assert_float_equal(a[k], b[k], E * fmaxf(1.0f, fabsf(b[k])));
+}
+
+/*
+ * TEST FUNCTIONS
+ */
+
+static void test_resample_matches_reference(void **state)
+{
+  Testimg *ti = _gen_pattern(301, 203);
+
+  for(int i = 0; i < sizeof(itors) / sizeof(itors[0]); i++)
+  {
+    const dt_interpolation_t *itor = dt_interpolation_new(itors[i]);
+    for(int s = 0; s < sizeof(scales) / sizeof(scales[0]); s++)
+    {
+      dt_iop_roi_t roi_in, roi_out;
+      _rois(ti->width, ti->height, scales[s], &roi_in, &roi_out);
+      TR_DEBUG("%s, scale %.3f -> %dx%d", itor->name, scales[s],
+               roi_out.width, roi_out.height);
+
+      const size_t n = (size_t)4 * roi_out.width * roi_out.height;
+      float *out = dt_alloc_align_float(n);
+      float *ref = dt_alloc_align_float(n);
+      dt_interpolation_resample(itor, out, &roi_out, ti->pixels, &roi_in);
+      _resample_reference(itor, ref, &roi_out, ti->pixels, &roi_in);
+      _assert_close(out, ref, n);
+      dt_free_align(out);
+      dt_free_align(ref);
+    }
+  }
+  testimg_free(ti);
+}
+
+static void test_resample_1c_matches_4c(void **state)
+{
+  Testimg *ti = _gen_pattern(257, 129);
+  float *plane = dt_alloc_align_float((size_t)ti->width * ti->height);
+  for(size_t k = 0; k < (size_t)ti->width * ti->height; k++)
+    plane[k] = ti->pixels[4 * k + 3];
+
+  for(int i = 0; i < sizeof(itors) / sizeof(itors[0]); i++)
+  {
+    const dt_interpolation_t *itor = dt_interpolation_new(itors[i]);
+    for(int s = 0; s < sizeof(scales) / sizeof(scales[0]); s++)
+    {
+      dt_iop_roi_t roi_in, roi_out;
+      _rois(ti->width, ti->height, scales[s], &roi_in, &roi_out);
+
+      const size_t npix = (size_t)roi_out.width * roi_out.height;
+      float *out4 = dt_alloc_align_float(4 * npix);
+      float *out1 = dt_alloc_align_float(npix);
+      dt_interpolation_resample(itor, out4, &roi_out, ti->pixels, &roi_in);
+      dt_interpolation_resample_1c(itor, out1, &roi_out, plane, &roi_in);
+      // the 4 channel version clips negative values, the single channel one not
+      for(size_t k = 0; k < npix; k++)
+        assert_float_equal(MAX(out1[k], 0.0f), out4[4 * k + 3], E);
+      dt_free_align(out4);
+      dt_free_align(out1);
+    }
+  }
+  dt_free_align(plane);
+  testimg_free(ti);
+}
+
+static void test_warp_exact_matches_reference(void **state)
+{
+  Testimg *ti = _gen_pattern(301, 203);
+  const dt_iop_roi_t roi_in = { 0, 0, ti->width, ti->height, 1.0f };
+  const dt_iop_roi_t roi_out = { 0, 0, 257, 171, 1.0f };
+  const size_t n = (size_t)4 * roi_out.width * roi_out.height;
+  float *out = dt_alloc_align_float(n);
+  float *ref = dt_alloc_align_float(n);
+
+  for(int i = 0; i < sizeof(itors) / sizeof(itors[0]); i++)
+  {
+    const dt_interpolation_t *itor = dt_interpolation_new(itors[i]);
+    dt_interpolation_warp(itor, out, &roi_out, ti->pixels, &roi_in, _warp_homography, homography, 0.0f);
+    _warp_reference(itor, ref, &roi_out, ti->pixels, &roi_in);
+    assert_memory_equal(out, ref, sizeof(float) * n);
+  }
+  dt_free_align(out);
+  dt_free_align(ref);
+  testimg_free(ti);
+}
+
+// the input holds its own coordinates, bilinear interpolation reproduces them,
+// so the output shows the sampling position of every pixel
+static void test_warp_grid_precision(void **state)
+{
+  Testimg *ti = testimg_alloc(301, 203);
+  for_testimg_pixels_p_yx(ti)
+  {
+    p[0] = x;
+    p[1] = y;
+    p[2] = p[3] = 0.0f;
+  }
+  const dt_iop_roi_t roi_in = { 0, 0, ti->width, ti->height, 1.0f };
+  const dt_iop_roi_t roi_out = { 0, 0, 257, 171, 1.0f };
+  const size_t n = (size_t)4 * roi_out.width * roi_out.height;
+  float *out = dt_alloc_align_float(n);
+  float *ref = dt_alloc_align_float(n);
+
+  const dt_interpolation_t *itor = dt_interpolation_new(DT_INTERPOLATION_BILINEAR);
+  dt_interpolation_warp(itor, out, &roi_out, ti->pixels, &roi_in, _warp_homography, homography,
+                        DT_INTERPOLATION_WARP_PRECISION);
+  _warp_reference(itor, ref, &roi_out, ti->pixels, &roi_in);
+  for(size_t k = 0; k < n; k += 4)
+  {
+    assert_float_equal(out[k], ref[k], DT_INTERPOLATION_WARP_PRECISION + 1e-3f);
+    assert_float_equal(out[k + 1], ref[k + 1], DT_INTERPOLATION_WARP_PRECISION + 1e-3f);
+  }
+  dt_free_align(out);
+  dt_free_align(ref);
+  testimg_free(ti);
+}
+
+// two distorting modules in a row resampled once must match the modules one after
+// the other, apart from the second interpolation and the borders of the intermediate
+static void test_warp_composed_matches_sequential(void **state)
+{
+  Testimg *ti = testimg_alloc(301, 203);
+  for_testimg_pixels_p_yx(ti)
+  {
+    for(int c = 0; c < 4; c++)
+      p[c] = 0.5f + 0.4f * sinf(0.05f * x + c) * cosf(0.04f * y);
+  }
+  const dt_iop_roi_t roi_in = { 0, 0, ti->width, ti->height, 1.0f };
+  const dt_iop_roi_t roi_mid = { 0, 0, 281, 191, 1.0f };
+  const dt_iop_roi_t roi_out = { 0, 0, 257, 171, 1.0f };
+  const size_t n = (size_t)4 * roi_out.width * roi_out.height;
+  float *mid = dt_alloc_align_float((size_t)4 * roi_mid.width * roi_mid.height);
+  float *seq = dt_alloc_align_float(n);
+  float *out = dt_alloc_align_float(n);
+
+  const dt_interpolation_t *itor = dt_interpolation_new(DT_INTERPOLATION_BICUBIC);
+  dt_interpolation_warp(itor, mid, &roi_mid, ti->pixels, &roi_in, _warp_rotation, NULL,
+                        DT_INTERPOLATION_WARP_PRECISION);
+  dt_interpolation_warp(itor, seq, &roi_out, mid, &roi_mid, _warp_homography, homography,
+                        DT_INTERPOLATION_WARP_PRECISION);
+
+  // the last module comes first
+  const dt_dev_warp_step_t steps[2] = { { _warp_homography, (void *)homography },
+                                        { _warp_rotation, NULL } };
+  dt_dev_warp_process(steps, 2, itor, ti->pixels, out, &roi_in, &roi_out);
+
+  int checked = 0;
+  for(int j = 0; j < roi_out.height; j++)
+    for(int i = 0; i < roi_out.width; i++)
+    {
+      float xm, ym, xi, yi;
+      _warp_homography(homography, i, j, &xm, &ym);
+      _warp_rotation(NULL, xm, ym, &xi, &yi);
+      if(!_inside(xm, ym, &roi_mid, 3.0f) || !_inside(xi, yi, &roi_in, 3.0f)) continue;
+      const size_t k = (size_t)4 * (j * roi_out.width + i);
+      for(int c = 0; c < 4; c++)
+        assert_float_equal(out[k + c], seq[k + c], 1e-3f);
+      checked++;
+    }
+  assert_true(checked > roi_out.width * roi_out.height / 2);
+
+  dt_free_align(mid);
+  dt_free_align(seq);
+  dt_free_align(out);
+  testimg_free(ti);
+}
+
+// not a correctness test: reports input Mpix/s of the separable
+// implementation against the former single pass one
+static void test_resample_benchmark(void **state)
+{
+  if(!getenv("DT_BENCH_RESAMPLE"))
+  {
+    print_message("[ SKIPPED  ] set DT_BENCH_RESAMPLE to run the benchmark\n");
+    return;
+  }
+
+  Testimg *ti = _gen_pattern(BENCH_WIDTH, BENCH_HEIGHT);
+  const double mpix = (double)BENCH_WIDTH * BENCH_HEIGHT * 1e-6;
+
+  for(int i = 0; i < sizeof(itors) / sizeof(itors[0]); i++)
+  {
+    const dt_interpolation_t *itor = dt_interpolation_new(itors[i]);
+    for(int s = 0; s < sizeof(scales) / sizeof(scales[0]); s++)
+    {
+      dt_iop_roi_t roi_in, roi_out;
+      _rois(ti->width, ti->height, scales[s], &roi_in, &roi_out);
+      float *out = dt_alloc_align_float((size_t)4 * roi_out.width * roi_out.height);
+
+      double best_new = DBL_MAX, best_ref = DBL_MAX;
+      for(int run = 0; run < BENCH_RUNS; run++)
+      {
+        double t0 = dt_get_wtime();
+        dt_interpolation_resample(itor, out, &roi_out, ti->pixels, &roi_in);
+        best_new = MIN(best_new, dt_get_wtime() - t0);
+
+        t0 = dt_get_wtime();
+        _resample_reference(itor, out, &roi_out, ti->pixels, &roi_in);
+        best_ref = MIN(best_ref, dt_get_wtime() - t0);
+      }
+      print_message("[ BENCH    ] %-8s scale %.3f: %8.1f Mpix/s (single pass %8.1f Mpix/s)\n",
+                    itor->name, scales[s], mpix / best_new, mpix / best_ref);
+      dt_free_align(out);
+    }
+  }
+  testimg_free(ti);
+}
+
+static int setup(void **state)
+{
+  // the per thread buffers are sized by the configured thread count
+  darktable.num_openmp_threads = dt_get_num_procs();
+  return 0;
+}
+
+/*
+ * MAIN FUNCTION
+ */
+int main(int argc, char* argv[])
+{
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test(test_resample_matches_reference),
+    cmocka_unit_test(test_resample_1c_matches_4c),
+    cmocka_unit_test(test_warp_exact_matches_reference),
+    cmocka_unit_test(test_warp_grid_precision),
+    cmocka_unit_test(test_warp_composed_matches_sequential),
+    cmocka_unit_test(test_resample_benchmark)
+  };
+
+  TR_DEBUG("epsilon = %e", E);
+
+  return cmocka_run_group_tests(tests, setup, NULL);
+}
+// clang-format off
+// modelines: These editor modelines have been set for all relevant files by tools/update_modelines.py
+// vim: shiftwidth=2 expandtab tabstop=2 cindent
+// kate: tab-indents: off; indent-width 2; replace-tabs on; indent-mode cstyle; remove-trailing-spaces modified;
+// clang-format on
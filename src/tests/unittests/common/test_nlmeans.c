@@ -0,0 +1,209 @@
+/*
+    This file is part of darktable,
+    Copyright (C) 2025 darktable developers.
+
+    darktable is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    darktable is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with darktable.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*
+ * cmocka unit tests and benchmark for the fast mode of the non-local
+ * means denoiser in common/nlmeans_core.c
+ *
+ * Please see ../README.md for more detailed documentation.
+ */
+#include <float.h>
+#include <limits.h>
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <math.h>
+
+#include <cmocka.h>
+
+#include "../util/assert.h"
+#include "../util/tracing.h"
+#include "../util/testimg.h"
+
+#include "common/darktable.h"
+#include "common/nlmeans_core.h"
+
+#ifdef _WIN32
+#include "win/main_wrapper.h"
+#endif
+
+/*
+ * DEFINITIONS
+ */
+
+// minimal PSNR of the fast result against the exact one, in dB on a [0,1] range:
+#define MIN_PSNR 40.0
+
+#define TEST_WIDTH 400
+#define TEST_HEIGHT 300
+
+// input size for the benchmark:
+#define BENCH_WIDTH 1500
+#define BENCH_HEIGHT 1000
+
+/*
+ * HELPERS
+ */
+
+// deterministic pseudo-random noise in [-0.5, 0.5)
+static float _noise(const int x, const int y, const int c)
+{
+  const unsigned int h = ((unsigned)x * 73856093u) ^ ((unsigned)y * 19349663u) ^ ((unsigned)c * 83492791u);
+  return (float)((h * 2654435761u) >> 16 & 0xffff) / 65536.0f - 0.5f;
+}
+
+// noisy test pattern with flat areas, gradients, edges and fine texture
+static Testimg *_gen_noisy_pattern(const int width, const int height)
+{
+  Testimg *ti = testimg_alloc(width, height);
+  for_testimg_pixels_p_yx(ti)
+  {
+    const float stripes = ((x / 4 + y / 7) & 1) ? 0.8f : 0.2f;
+    const float base[3] = { x < width / 2 ? 0.3f : stripes,
+                            (float)y / height,
+                            0.5f + 0.4f * sinf(0.11f * x) * cosf(0.07f * y) };
+    for(int c = 0; c < 3; c++)
+      p[c] = base[c] + 0.1f * _noise(x, y, c);
+    p[3] = 0.0f;
+  }
+  ti->name = "noisy pattern";
+  return ti;
+}
+
+static double _psnr(const float *a, const float *b, const size_t npix)
+{
+  double sse = 0.0;
+  for(size_t k = 0; k < npix; k++)
+    for(int c = 0; c < 3; c++)
+    {
+      const double d = a[4*k+c] - b[4*k+c];
+      sse += d * d;
+    }
+  const double mse = sse / (3.0 * npix);
+  return mse > 0.0 ? 10.0 * log10(1.0 / mse) : INFINITY;
+}
+
+// settings as used by the astrophoto denoise (center_weight < 0) and
+// denoiseprofile (center_weight >= 0) modules
+static dt_nlmeans_param_t _params(const float center_weight, const gboolean fast, const float *norm)
+{
+  const dt_nlmeans_param_t params = { .scattering = 0.0f,
+                                      .scale = 1.0f,
+                                      .luma = 1.0f,
+                                      .chroma = 1.0f,
+                                      .center_weight = center_weight,
+                                      .sharpness = 3.0f,
+                                      .patch_radius = 2,
+                                      .search_radius = 7,
+                                      .decimate = 0,
+                                      .fast = fast,
+                                      .norm = norm };
+  return params;
+}
+
+static void _check_psnr(const float center_weight)
+{
+  const dt_aligned_pixel_t norm = { 1.0f, 1.0f, 1.0f, 1.0f };
+  Testimg *ti = _gen_noisy_pattern(TEST_WIDTH, TEST_HEIGHT);
+  const dt_iop_roi_t roi = { 0, 0, ti->width, ti->height, 1.0f };
+  const size_t npix = (size_t)ti->width * ti->height;
+  float *exact = dt_alloc_align_float(4 * npix);
+  float *fast = dt_alloc_align_float(4 * npix);
+
+  const dt_nlmeans_param_t p_exact = _params(center_weight, FALSE, norm);
+  const dt_nlmeans_param_t p_fast = _params(center_weight, TRUE, norm);
+  nlmeans_denoise(ti->pixels, exact, &roi, &roi, &p_exact);
+  nlmeans_denoise(ti->pixels, fast, &roi, &roi, &p_fast);
+
+  const double psnr = _psnr(exact, fast, npix);
+  TR_DEBUG("center weight %f: PSNR fast vs. exact %.2f dB", center_weight, psnr);
+  assert_true(psnr > MIN_PSNR);
+
+  dt_free_align(fast);
+  dt_free_align(exact);
+  testimg_free(ti);
+}
+
+/*
+ * TEST FUNCTIONS
+ */
+
+static void test_fast_psnr_nlmeans(void **state)
+{
+  _check_psnr(-1.0f);
+}
+
+static void test_fast_psnr_denoiseprofile(void **state)
+{
+  _check_psnr(0.1f);
+}
+
+// not a correctness test: reports input Mpix/s of the fast mode
+// against the exact one
+static void test_fast_benchmark(void **state)
+{
+  const dt_aligned_pixel_t norm = { 1.0f, 1.0f, 1.0f, 1.0f };
+  Testimg *ti = _gen_noisy_pattern(BENCH_WIDTH, BENCH_HEIGHT);
+  const dt_iop_roi_t roi = { 0, 0, ti->width, ti->height, 1.0f };
+  const double mpix = (double)BENCH_WIDTH * BENCH_HEIGHT * 1e-6;
+  float *out = dt_alloc_align_float((size_t)4 * ti->width * ti->height);
+
+  const dt_nlmeans_param_t p_exact = _params(0.1f, FALSE, norm);
+  const dt_nlmeans_param_t p_fast = _params(0.1f, TRUE, norm);
+
+  double t0 = dt_get_wtime();
+  nlmeans_denoise(ti->pixels, out, &roi, &roi, &p_exact);
+  const double t_exact = dt_get_wtime() - t0;
+  t0 = dt_get_wtime();
+  nlmeans_denoise(ti->pixels, out, &roi, &roi, &p_fast);
+  const double t_fast = dt_get_wtime() - t0;
+
+  print_message("[ BENCH    ] nlmeans: %8.2f Mpix/s fast, %8.2f Mpix/s exact\n",
+                mpix / t_fast, mpix / t_exact);
+
+  dt_free_align(out);
+  testimg_free(ti);
+}
+
+static int setup(void **state)
+{
+  // the per thread buffers are sized by the configured thread count
+  darktable.num_openmp_threads = dt_get_num_procs();
+  return 0;
+}
+
+/*
+ * MAIN FUNCTION
+ */
+int main(int argc, char* argv[])
+{
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test(test_fast_psnr_nlmeans),
+    cmocka_unit_test(test_fast_psnr_denoiseprofile),
+    cmocka_unit_test(test_fast_benchmark)
+  };
+
+  TR_DEBUG("minimal PSNR = %f dB", MIN_PSNR);
+
+  return cmocka_run_group_tests(tests, setup, NULL);
+}
+// clang-format off
+// modelines: These editor modelines have been set for all relevant files by tools/update_modelines.py
+// vim: shiftwidth=2 expandtab tabstop=2 cindent
+// kate: tab-indents: off; indent-width 2; replace-tabs on; indent-mode cstyle; remove-trailing-spaces modified;
+// clang-format on
@@ -0,0 +1,234 @@
+/*
+    This file is part of darktable,
+    Copyright (C) 2025 darktable developers.
+
+    darktable is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    darktable is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with darktable.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*
+ * cmocka unit tests for the one-pass demosaic and downscale of the demosaic
+ * module, dt_iop_clip_and_zoom_demosaic_f() in develop/imageop_math.c
+ *
+ * The result is compared against the reference path of the module: a full
+ * resolution demosaic followed by dt_iop_clip_and_zoom(), here a plane fit
+ * demosaic and the bilinear resampling. On a smooth test image both paths
+ * agree to about 1.3e-3 away from the image borders.
+ *
+ * Please see README.md for more detailed documentation.
+ */
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <math.h>
+
+#include <cmocka.h>
+
+#include "../util/assert.h"
+
+#include "common/darktable.h"
+#include "common/interpolation.h"
+#include "develop/imageop_math.h"
+
+#ifdef _WIN32
+#include "win/main_wrapper.h"
+#endif
+
+/*
+ * DEFINITIONS
+ */
+
+#define WIDTH 300
+#define HEIGHT 200
+
+// maximum difference to the reference path
+#define TOLERANCE 2.5e-3f
+
+// output pixels close to the borders are not compared, both paths
+// handle the missing input samples differently
+#define MARGIN 4
+
+#define BAYER_FILTERS 0x94949494u
+
+static const uint8_t xtrans[6][6] = { { 1, 1, 0, 1, 1, 2 },
+                                      { 1, 1, 2, 1, 1, 0 },
+                                      { 2, 0, 1, 0, 2, 1 },
+                                      { 1, 1, 2, 1, 1, 0 },
+                                      { 1, 1, 0, 1, 1, 2 },
+                                      { 0, 2, 1, 2, 0, 1 } };
+
+// the scales between the half/third size samplers and 1:1
+static const float scales[] = { 0.55f, 0.6f, 0.75f, 0.9f };
+
+/*
+ * HELPERS
+ */
+
+static inline int _color(const int row, const int col, const uint32_t filters)
+{
+  return filters == 9u ? FCxtrans(row, col, NULL, xtrans) : FC(row, col, filters);
+}
+
+static inline float _smooth(const int x, const int y, const int c)
+{
+  return 0.4f + 0.25f * sinf(0.021f * x + c) * cosf(0.017f * y + 0.5f * c);
+}
+
+static float *_mosaic(const uint32_t filters, const gboolean flat)
+{
+  float *const cfa = dt_alloc_align_float((size_t)WIDTH * HEIGHT);
+  for(int y = 0; y < HEIGHT; y++)
+    for(int x = 0; x < WIDTH; x++)
+    {
+      const int c = _color(y, x, filters);
+      cfa[(size_t)y * WIDTH + x] = flat ? 0.2f + 0.3f * c : _smooth(x, y, c);
+    }
+  return cfa;
+}
+
+// full resolution demosaic: least squares plane through the samples of
+// each color in a 5x5 window, evaluated at the center
+static void _demosaic_reference(const float *const cfa,
+                                float *const rgb,
+                                const uint32_t filters)
+{
+  for(int y = 0; y < HEIGHT; y++)
+    for(int x = 0; x < WIDTH; x++)
+      for(int c = 0; c < 3; c++)
+      {
+        double m[3][3] = { { 0.0 } };
+        double b[3] = { 0.0 };
+        for(int j = MAX(0, y - 2); j <= MIN(HEIGHT - 1, y + 2); j++)
+          for(int i = MAX(0, x - 2); i <= MIN(WIDTH - 1, x + 2); i++)
+          {
+            if(_color(j, i, filters) != c) continue;
+            const double v[3] = { 1.0, i - x, j - y };
+            for(int p = 0; p < 3; p++)
+            {
+              b[p] += v[p] * cfa[(size_t)j * WIDTH + i];
+              for(int q = 0; q < 3; q++) m[p][q] += v[p] * v[q];
+            }
+          }
+        // Cramer's rule for the constant term
+        const double det = m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1])
+                         - m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0])
+                         + m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+        const double det0 = b[0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1])
+                          - m[0][1] * (b[1] * m[2][2] - m[1][2] * b[2])
+                          + m[0][2] * (b[1] * m[2][1] - m[1][1] * b[2]);
+        rgb[4 * ((size_t)y * WIDTH + x) + c] = det0 / det;
+      }
+}
+
+static void _compare_to_reference(const uint32_t filters)
+{
+  float *const cfa = _mosaic(filters, FALSE);
+  float *const rgb = dt_alloc_align_float((size_t)WIDTH * HEIGHT * 4);
+  _demosaic_reference(cfa, rgb, filters);
+
+  const dt_interpolation_t *itor = dt_interpolation_new(DT_INTERPOLATION_BILINEAR);
+  const dt_iop_roi_t roi_in = { 0, 0, WIDTH, HEIGHT, 1.0f };
+
+  for(int s = 0; s < sizeof(scales) / sizeof(scales[0]); s++)
+  {
+    const dt_iop_roi_t roi_out = { 0, 0, (int)(scales[s] * WIDTH), (int)(scales[s] * HEIGHT), scales[s] };
+    float *const out = dt_alloc_align_float((size_t)roi_out.width * roi_out.height * 4);
+    float *const ref = dt_alloc_align_float((size_t)roi_out.width * roi_out.height * 4);
+
+    dt_iop_clip_and_zoom_demosaic_f(out, cfa, &roi_out, &roi_in, roi_out.width, WIDTH, filters, xtrans);
+    dt_interpolation_resample(itor, ref, &roi_out, rgb, &roi_in);
+
+    float max_diff = 0.0f;
+    for(int y = MARGIN; y < roi_out.height - MARGIN; y++)
+      for(int x = MARGIN; x < roi_out.width - MARGIN; x++)
+        for(int c = 0; c < 3; c++)
+        {
+          const size_t k = 4 * ((size_t)y * roi_out.width + x) + c;
+          max_diff = fmaxf(max_diff, fabsf(out[k] - ref[k]));
+        }
+    assert_true(max_diff < TOLERANCE);
+
+    dt_free_align(out);
+    dt_free_align(ref);
+  }
+
+  dt_free_align(cfa);
+  dt_free_align(rgb);
+}
+
+// a uniformly colored image has to come out exactly, borders included
+static void _check_flat(const uint32_t filters)
+{
+  float *const cfa = _mosaic(filters, TRUE);
+  const dt_iop_roi_t roi_in = { 0, 0, WIDTH, HEIGHT, 1.0f };
+
+  for(int s = 0; s < sizeof(scales) / sizeof(scales[0]); s++)
+  {
+    const dt_iop_roi_t roi_out = { 0, 0, (int)(scales[s] * WIDTH), (int)(scales[s] * HEIGHT), scales[s] };
+    float *const out = dt_alloc_align_float((size_t)roi_out.width * roi_out.height * 4);
+
+    dt_iop_clip_and_zoom_demosaic_f(out, cfa, &roi_out, &roi_in, roi_out.width, WIDTH, filters, xtrans);
+
+    for(size_t k = 0; k < (size_t)roi_out.width * roi_out.height; k++)
+      for(int c = 0; c < 3; c++)
+        assert_float_equal(out[4 * k + c], 0.2f + 0.3f * c, 1e-6f);
+
+    dt_free_align(out);
+  }
+
+  dt_free_align(cfa);
+}
+
+/*
+ * TEST FUNCTIONS
+ */
+
+static void test_bayer_flat(void **state)
+{
+  _check_flat(BAYER_FILTERS);
+}
+
+static void test_xtrans_flat(void **state)
+{
+  _check_flat(9u);
+}
+
+static void test_bayer_reference(void **state)
+{
+  _compare_to_reference(BAYER_FILTERS);
+}
+
+static void test_xtrans_reference(void **state)
+{
+  _compare_to_reference(9u);
+}
+
+/*
+ * MAIN FUNCTION
+ */
+int main(int argc, char* argv[])
+{
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test(test_bayer_flat),
+    cmocka_unit_test(test_xtrans_flat),
+    cmocka_unit_test(test_bayer_reference),
+    cmocka_unit_test(test_xtrans_reference)
+  };
+
+  return cmocka_run_group_tests(tests, NULL, NULL);
+}
+// clang-format off
+// modelines: These editor modelines have been set for all relevant files by tools/update_modelines.py
+// vim: shiftwidth=2 expandtab tabstop=2 cindent
+// kate: tab-indents: off; indent-width 2; replace-tabs on; indent-mode cstyle; remove-trailing-spaces modified;
+// clang-format on
@@ -0,0 +1,183 @@
+/*
+    This file is part of darktable,
+    Copyright (C) 2025 darktable developers.
+
+    darktable is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    darktable is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with darktable.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*
+ * cmocka unit tests for the coarse-to-fine solver of the module
+ * iop/diffuse.c
+ *
+ * The coarse-to-fine solver does not reproduce the reference solver
+ * exactly. The RMS difference between both solvers is checked relative
+ * to the RMS change the reference solver makes to the image. On the test
+ * image below, the deblurring preset deviates by 11.2%, local contrast by
+ * 3.4%, the tolerances leave little headroom above that to catch
+ * regressions.
+ *
+ * Please see README.md for more detailed documentation.
+ */
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <math.h>
+
+#include <cmocka.h>
+
+#include "../util/assert.h"
+
+#include "iop/diffuse.c"
+
+#ifdef _WIN32
+#include "win/main_wrapper.h"
+#endif
+
+/*
+ * DEFINITIONS
+ */
+
+#define WIDTH 256
+#define HEIGHT 192
+
+// maximum RMS difference between the solvers, relative to the RMS effect
+// of the reference solver
+#define TOLERANCE_DEBLUR 0.12
+#define TOLERANCE_LOCAL_CONTRAST 0.04
+
+/*
+ * HELPERS
+ */
+
+// smooth gradients plus blurred edges and some noise, close to what the
+// deblurring presets get as input
+static float *_test_image(void)
+{
+  float *const img = dt_alloc_align_float((size_t)WIDTH * HEIGHT * 4);
+  float *const tmp = dt_alloc_align_float((size_t)WIDTH * HEIGHT * 4);
+  size_t padded_size;
+  float *const tempbuf = dt_alloc_perthread_float(4 * WIDTH, &padded_size);
+
+  uint32_t state = 1;
+  for(size_t i = 0; i < HEIGHT; i++)
+    for(size_t j = 0; j < WIDTH; j++)
+      for(int c = 0; c < 4; c++)
+      {
+        state = state * 1664525u + 1013904223u;
+        const float noise = 0.02f * ((state >> 8) / 16777216.f - 0.5f);
+        const float edges = (((i / 40) + (j / 40)) % 2) ? 0.2f : 0.f;
+        img[4 * (i * WIDTH + j) + c] = 0.18f + 0.1f * sinf(j * 0.05f + c) * cosf(i * 0.03f) + edges + noise;
+      }
+
+  for(int s = 0; s < 2; s++)
+  {
+    blur_2D_Bspline(img, tmp, tempbuf, padded_size, WIDTH, HEIGHT, 1 << s, FALSE);
+    memcpy(img, tmp, sizeof(float) * WIDTH * HEIGHT * 4);
+  }
+
+  dt_free_align(tmp);
+  dt_free_align(tempbuf);
+  return img;
+}
+
+static void _compare_solvers(const dt_iop_diffuse_data_t *const data,
+                             const double tolerance)
+{
+  float *const in = _test_image();
+  float *const ref = dt_alloc_align_float((size_t)WIDTH * HEIGHT * 4);
+  float *const mg = dt_alloc_align_float((size_t)WIDTH * HEIGHT * 4);
+
+  assert_true(_use_multigrid(data, 1.f, WIDTH, HEIGHT));
+  assert_true(_diffuse_iterations(in, ref, NULL, WIDTH, HEIGHT, data, 1.f, 1.f,
+                                  _diffuse_scales(data, 1.f), data->iterations, FALSE));
+  assert_true(_diffuse_multigrid(in, mg, NULL, WIDTH, HEIGHT, data, 1.f, data->iterations, FALSE));
+
+  double error = 0.0;
+  double effect = 0.0;
+  for(size_t k = 0; k < (size_t)WIDTH * HEIGHT * 4; k++)
+  {
+    if(k % 4 == 3) continue;
+    error += (ref[k] - mg[k]) * (ref[k] - mg[k]);
+    effect += (ref[k] - in[k]) * (ref[k] - in[k]);
+  }
+
+  assert_true(effect > 0.0);
+  assert_true(sqrt(error / effect) < tolerance);
+
+  dt_free_align(in);
+  dt_free_align(ref);
+  dt_free_align(mg);
+}
+
+/*
+ * TEST FUNCTIONS
+ */
+
+static void test_multigrid_deblur(void **state)
+{
+  const dt_iop_diffuse_data_t data = { .iterations = 16,
+                                       .radius = 8,
+                                       .radius_center = 0,
+                                       .first = -0.25f,
+                                       .second = -0.25f,
+                                       .third = -0.25f,
+                                       .fourth = -0.25f,
+                                       .anisotropy_first = 1.f,
+                                       .anisotropy_second = 1.f,
+                                       .anisotropy_third = 1.f,
+                                       .anisotropy_fourth = 1.f,
+                                       .regularization = 2.5f,
+                                       .variance_threshold = 0.5f,
+                                       .solver = DT_DIFFUSE_SOLVER_MULTIGRID };
+  _compare_solvers(&data, TOLERANCE_DEBLUR);
+}
+
+static void test_multigrid_local_contrast(void **state)
+{
+  const dt_iop_diffuse_data_t data = { .iterations = 10,
+                                       .radius = 384,
+                                       .radius_center = 512,
+                                       .first = -0.5f,
+                                       .third = -0.5f,
+                                       .anisotropy_first = 1.f,
+                                       .anisotropy_third = 1.f,
+                                       .regularization = 1.f,
+                                       .solver = DT_DIFFUSE_SOLVER_MULTIGRID };
+  _compare_solvers(&data, TOLERANCE_LOCAL_CONTRAST);
+}
+
+static void test_reference_solver_by_default(void **state)
+{
+  const dt_iop_diffuse_data_t data = { .iterations = 10, .radius = 8 };
+  assert_false(_use_multigrid(&data, 1.f, WIDTH, HEIGHT));
+}
+
+/*
+ * MAIN FUNCTION
+ */
+int main(int argc, char* argv[])
+{
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test(test_multigrid_deblur),
+    cmocka_unit_test(test_multigrid_local_contrast),
+    cmocka_unit_test(test_reference_solver_by_default)
+  };
+
+  return cmocka_run_group_tests(tests, NULL, NULL);
+}
+// clang-format off
+// modelines: These editor modelines have been set for all relevant files by tools/update_modelines.py
+// vim: shiftwidth=2 expandtab tabstop=2 cindent
+// kate: tab-indents: off; indent-width 2; replace-tabs on; indent-mode cstyle; remove-trailing-spaces modified;
+// clang-format on
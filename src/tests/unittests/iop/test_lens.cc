@@ -0,0 +1,357 @@
+/*
+    This file is part of darktable,
+    Copyright (C) 2025 darktable developers.
+
+    darktable is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    darktable is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with darktable.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*
+ * cmocka unit tests for the distortion map cache of the module
+ * iop/lens.cc
+ *
+ * The bilinearly refined map grid is compared against the exact
+ * coordinates lensfun computes for a synthetic wide angle lens with
+ * strong barrel distortion (about 120px in the corners of a 6MP image)
+ * and lateral chromatic aberration. The maximum error inside the image
+ * is 0.003px for this lens, the tolerance leaves some headroom for other
+ * lensfun builds. Pixels within LENS_MAP_STEP of the image borders have
+ * to be evaluated exactly.
+ *
+ * The cache itself is checked to stay within LENS_MAP_ENTRIES and
+ * LENS_MAP_MAX_SIZE without dropping maps that are in use.
+ *
+ * Please see README.md for more detailed documentation.
+ */
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <math.h>
+
+extern "C" {
+#include <cmocka.h>
+}
+
+#include "../util/assert.h"
+
+#include "iop/lens.cc"
+
+#ifdef _WIN32
+#include "win/main_wrapper.h"
+#endif
+
+/*
+ * DEFINITIONS
+ */
+
+#define WIDTH 3000
+#define HEIGHT 2000
+#define CROP 1.5f
+#define FOCAL 14.0f
+
+// maximum distance in pixels between the refined grid and lensfun:
+#define TOLERANCE 1e-2f
+
+// the border band is computed by lensfun pixel by pixel instead of row by
+// row, which may only differ in rounding:
+#define E_EXACT 1e-3f
+
+/*
+ * HELPERS
+ */
+
+// lens with ptlens distortion and linear TCA calibrated at FOCAL
+static lfLens *_test_lens()
+{
+  lfLens *lens = new lfLens();
+  lens->Type = LF_RECTILINEAR;
+  lens->CropFactor = CROP;
+  lens->AspectRatio = (float)WIDTH / HEIGHT;
+  lens->MinFocal = lens->MaxFocal = FOCAL;
+
+  lfLensCalibDistortion dist;
+  memset(&dist, 0, sizeof(dist));
+  dist.Model = LF_DIST_MODEL_PTLENS;
+  dist.Focal = FOCAL;
+  dist.Terms[0] = 0.01f;
+  dist.Terms[1] = -0.06f;
+  dist.Terms[2] = 0.02f;
+  lens->AddCalibDistortion(&dist);
+
+  lfLensCalibTCA tca;
+  memset(&tca, 0, sizeof(tca));
+  tca.Model = LF_TCA_MODEL_LINEAR;
+  tca.Focal = FOCAL;
+  tca.Terms[0] = 1.0005f;
+  tca.Terms[1] = 0.9995f;
+  lens->AddCalibTCA(&tca);
+
+  return lens;
+}
+
+static lfModifier *_test_modifier(lfLens *lens)
+{
+  dt_iop_lens_data_t d;
+  memset(&d, 0, sizeof(d));
+  d.modify_flags = DT_IOP_LENS_MODFLAG_DIST_TCA;
+  d.lens = lens;
+  d.inverse = 0;
+  d.scale = 1.0f;
+  d.crop = CROP;
+  d.focal = FOCAL;
+  d.aperture = 4.0f;
+  d.distance = 1000.0f;
+  d.target_geom = LF_RECTILINEAR;
+  d.custom_tca.Model = LF_TCA_MODEL_NONE;
+
+  int mods_done = 0;
+  lfModifier *modifier = _get_modifier(&mods_done, WIDTH, HEIGHT, &d,
+                                       LF_MODIFY_ALL, FALSE);
+  assert_true(mods_done & LF_MODIFY_DISTORTION);
+  assert_true(mods_done & LF_MODIFY_TCA);
+  return modifier;
+}
+
+static void _init_global_data(dt_iop_lens_global_data_t *gd)
+{
+  memset(gd, 0, sizeof(*gd));
+  dt_pthread_mutex_init(&gd->map_lock, NULL);
+}
+
+static void _cleanup_global_data(dt_iop_lens_global_data_t *gd)
+{
+  _lens_map_cleanup(gd);
+  dt_pthread_mutex_destroy(&gd->map_lock);
+}
+
+static void _init_roi(dt_iop_roi_t *roi,
+                      const int x,
+                      const int y,
+                      const int width,
+                      const int height)
+{
+  roi->x = x;
+  roi->y = y;
+  roi->width = width;
+  roi->height = height;
+  roi->scale = 1.0f;
+}
+
+static void _init_piece(dt_dev_pixelpipe_iop_t *piece,
+                        const int width,
+                        const int height)
+{
+  memset(piece, 0, sizeof(*piece));
+  _init_roi(&piece->buf_in, 0, 0, width, height);
+  _init_roi(&piece->buf_out, 0, 0, width, height);
+}
+
+// maximum distance between the refined map and lensfun for the pixels of
+// roi inside (border == FALSE) or outside (border == TRUE) the band
+// around the image borders
+static float _max_error(const dt_iop_lens_map_t *map,
+                        const lfModifier *modifier,
+                        const dt_iop_roi_t *roi,
+                        const gboolean border)
+{
+  float *refined = dt_alloc_align_float((size_t)6 * roi->width);
+  float *exact = dt_alloc_align_float((size_t)6 * roi->width);
+  float max_err = 0.0f;
+  for(int y = 0; y < roi->height; y++)
+  {
+    _lens_map_row(map, modifier, roi, y, refined);
+    modifier->ApplySubpixelGeometryDistortion(roi->x, roi->y + y, roi->width, 1, exact);
+    for(int x = 0; x < roi->width; x++)
+    {
+      if(_lens_map_border(map, x, y) != border) continue;
+      for(int c = 0; c < 3; c++)
+      {
+        const float *r = refined + 6 * x + 2 * c;
+        const float *e = exact + 6 * x + 2 * c;
+        max_err = fmaxf(max_err, hypotf(r[0] - e[0], r[1] - e[1]));
+      }
+    }
+  }
+  dt_free_align(refined);
+  dt_free_align(exact);
+  return max_err;
+}
+
+static dt_iop_lens_map_t *_computed_map(dt_iop_lens_global_data_t *gd,
+                                        dt_dev_pixelpipe_iop_t *piece,
+                                        const lfModifier *modifier,
+                                        const dt_iop_roi_t *roi)
+{
+  gboolean found;
+  dt_iop_lens_map_t *map = _lens_map_acquire(gd, 1, piece, roi, &found);
+  assert_non_null(map);
+  assert_false(found);
+  _lens_map_fill_lf(map, modifier, roi);
+  return map;
+}
+
+static size_t _cache_size(const dt_iop_lens_global_data_t *gd, int *count)
+{
+  size_t total = 0;
+  *count = 0;
+  for(int k = 0; k < LENS_MAP_ENTRIES; k++)
+    if(gd->maps[k])
+    {
+      total += _lens_map_size(gd->maps[k]);
+      (*count)++;
+    }
+  return total;
+}
+
+/*
+ * TEST FUNCTIONS
+ */
+
+static void test_distortion_is_significant(void **state)
+{
+  lfLens *lens = _test_lens();
+  lfModifier *modifier = _test_modifier(lens);
+
+  float corner[6];
+  modifier->ApplySubpixelGeometryDistortion(0, 0, 1, 1, corner);
+  assert_true(hypotf(corner[2], corner[3]) > 50.0f);
+  assert_true(fabsf(corner[0] - corner[4]) > 0.5f);
+
+  delete modifier;
+  delete lens;
+}
+
+static void test_full_roi(void **state)
+{
+  lfLens *lens = _test_lens();
+  lfModifier *modifier = _test_modifier(lens);
+  dt_iop_lens_global_data_t gd;
+  _init_global_data(&gd);
+  dt_dev_pixelpipe_iop_t piece;
+  _init_piece(&piece, WIDTH, HEIGHT);
+  dt_iop_roi_t roi;
+  _init_roi(&roi, 0, 0, WIDTH, HEIGHT);
+
+  dt_iop_lens_map_t *map = _computed_map(&gd, &piece, modifier, &roi);
+  assert_true(_max_error(map, modifier, &roi, FALSE) <= TOLERANCE);
+  assert_true(_max_error(map, modifier, &roi, TRUE) <= E_EXACT);
+  _lens_map_release(&gd, map);
+
+  _cleanup_global_data(&gd);
+  delete modifier;
+  delete lens;
+}
+
+static void test_cropped_roi(void **state)
+{
+  lfLens *lens = _test_lens();
+  lfModifier *modifier = _test_modifier(lens);
+  dt_iop_lens_global_data_t gd;
+  _init_global_data(&gd);
+  dt_dev_pixelpipe_iop_t piece;
+  _init_piece(&piece, WIDTH, HEIGHT);
+
+  // a roi in the corner only shares the top and left image borders
+  dt_iop_roi_t corner;
+  _init_roi(&corner, 0, 0, 1003, 701);
+  dt_iop_lens_map_t *map = _computed_map(&gd, &piece, modifier, &corner);
+  assert_int_equal(map->x1, WIDTH - LENS_MAP_STEP);
+  assert_int_equal(map->y1, HEIGHT - LENS_MAP_STEP);
+  assert_true(_max_error(map, modifier, &corner, FALSE) <= TOLERANCE);
+  assert_true(_max_error(map, modifier, &corner, TRUE) <= E_EXACT);
+  _lens_map_release(&gd, map);
+
+  // a roi off the grid in the bottom right corner
+  dt_iop_roi_t offset;
+  _init_roi(&offset, 1997, 1299, WIDTH - 1997, HEIGHT - 1299);
+  map = _computed_map(&gd, &piece, modifier, &offset);
+  assert_int_equal(map->x0, LENS_MAP_STEP - 1997);
+  assert_true(_max_error(map, modifier, &offset, FALSE) <= TOLERANCE);
+  assert_true(_max_error(map, modifier, &offset, TRUE) <= E_EXACT);
+  _lens_map_release(&gd, map);
+
+  _cleanup_global_data(&gd);
+  delete modifier;
+  delete lens;
+}
+
+static void test_cache_size_limit(void **state)
+{
+  dt_iop_lens_global_data_t gd;
+  _init_global_data(&gd);
+  dt_dev_pixelpipe_iop_t piece;
+  _init_piece(&piece, 6000, 4000);
+  dt_iop_roi_t roi;
+  _init_roi(&roi, 0, 0, 6000, 4000);
+
+  // a 24MP map takes about 9MB, only three of them fit. the first one
+  // stays in use and must survive.
+  gboolean found;
+  dt_iop_lens_map_t *busy = _lens_map_acquire(&gd, 1, &piece, &roi, &found);
+  _lens_map_insert(&gd, busy);
+  assert_true(busy->cached);
+  for(dt_hash_t hash = 2; hash < 8; hash++)
+  {
+    dt_iop_lens_map_t *map = _lens_map_acquire(&gd, hash, &piece, &roi, &found);
+    _lens_map_insert(&gd, map);
+    _lens_map_release(&gd, map);
+
+    int count;
+    assert_true(_cache_size(&gd, &count) <= LENS_MAP_MAX_SIZE);
+    assert_true(count <= LENS_MAP_ENTRIES);
+  }
+  dt_iop_lens_map_t *again = _lens_map_acquire(&gd, 1, &piece, &roi, &found);
+  assert_true(found);
+  assert_ptr_equal(again, busy);
+  _lens_map_release(&gd, again);
+  _lens_map_release(&gd, busy);
+
+  // a map larger than the limit stays private and leaves the cache alone
+  int count_before;
+  const size_t size_before = _cache_size(&gd, &count_before);
+  dt_dev_pixelpipe_iop_t large_piece;
+  _init_piece(&large_piece, 12000, 9000);
+  dt_iop_roi_t large;
+  _init_roi(&large, 0, 0, 12000, 9000);
+  dt_iop_lens_map_t *map = _lens_map_acquire(&gd, 100, &large_piece, &large, &found);
+  assert_true(_lens_map_size(map) > LENS_MAP_MAX_SIZE);
+  _lens_map_insert(&gd, map);
+  assert_false(map->cached);
+  int count_after;
+  assert_int_equal(_cache_size(&gd, &count_after), size_before);
+  assert_int_equal(count_after, count_before);
+  _lens_map_release(&gd, map);
+
+  _cleanup_global_data(&gd);
+}
+
+/*
+ * MAIN FUNCTION
+ */
+
+int main(int argc, char* argv[])
+{
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test(test_distortion_is_significant),
+    cmocka_unit_test(test_full_roi),
+    cmocka_unit_test(test_cropped_roi),
+    cmocka_unit_test(test_cache_size_limit)
+  };
+
+  return cmocka_run_group_tests(tests, NULL, NULL);
+}
+// clang-format off
+// modelines: These editor modelines have been set for all relevant files by tools/update_modelines.py
+// vim: shiftwidth=2 expandtab tabstop=2 cindent
+// kate: tab-indents: off; indent-width 2; replace-tabs on; indent-mode cstyle; remove-trailing-spaces modified;
+// clang-format on
@@ -0,0 +1,244 @@
+/*
+    This file is part of darktable,
+    Copyright (C) 2025 darktable developers.
+
+    darktable is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    darktable is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with darktable.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*
+ * cmocka unit tests and benchmark for the permutohedral lattice used by
+ * the surface blur (bilateral) module, see iop/Permutohedral.h
+ *
+ * The benchmark filters 12, 24 and 50MP images with a 5D lattice and
+ * needs several GB of memory, so it only runs if the environment
+ * variable DT_BENCH_PERMUTOHEDRAL is set.
+ *
+ * Please see ../README.md for more detailed documentation.
+ */
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+extern "C" {
+#include <cmocka.h>
+}
+
+#include "../util/assert.h"
+
+#include "common/darktable.h"
+#include "iop/Permutohedral.h"
+
+#ifdef _WIN32
+#include "win/main_wrapper.h"
+#endif
+
+/*
+ * DEFINITIONS
+ */
+
+// relative tolerance between single and multi-threaded splatting, which
+// sum the same contributions in a different order:
+#define E 1e-4f
+
+#define TEST_WIDTH 256
+#define TEST_HEIGHT 192
+
+// spatial and range sigmas as commonly used by surface blur
+static const float test_sigma[5] = { 15.0f, 15.0f, 0.05f, 0.05f, 0.05f };
+
+/*
+ * HELPERS
+ */
+
+// deterministic pattern with flat areas, edges and gradients
+static float *_gen_pattern(const size_t width, const size_t height)
+{
+  float *img = dt_alloc_align_float(4 * width * height);
+  for(size_t j = 0; j < height; j++)
+    for(size_t i = 0; i < width; i++)
+    {
+      float *p = img + 4 * (j * width + i);
+      const unsigned int h = ((unsigned)i * 73856093u) ^ ((unsigned)j * 19349663u);
+      const float noise = 0.02f * ((float)((h * 2654435761u) >> 16 & 0xffff) / 65536.0f - 0.5f);
+      p[0] = (i < width / 2 ? 0.2f : 0.7f) + noise;
+      p[1] = (float)j / height + noise;
+      p[2] = (((i / 16) + (j / 16)) & 1 ? 0.3f : 0.6f) + noise;
+      p[3] = 0.0f;
+    }
+  return img;
+}
+
+// the permutohedral path of the surface blur.  Rows are distributed over
+// 'tables' hash tables in bands, either by the OpenMP threads or, if
+// 'parallel' is false, sequentially to get a reproducible assignment.
+static void _filter(const float *in, float *out, const size_t width, const size_t height,
+                    const size_t tables, const bool parallel)
+{
+  float sigma[5];
+  for(int k = 0; k < 5; k++) sigma[k] = 1.0f / test_sigma[k];
+  const size_t grid_points = (height * sigma[0]) * (width * sigma[1]) * sigma[2] * sigma[3] * sigma[4];
+  PermutohedralLattice<5, 4> lattice(width * height, tables, grid_points);
+
+  if(parallel)
+  {
+    DT_OMP_FOR(shared(lattice))
+    for(size_t j = 0; j < height; j++)
+    {
+      const int thread = dt_get_thread_num();
+      for(size_t i = 0; i < width; i++)
+      {
+        const float *px = in + 4 * (j * width + i);
+        float pos[5] = { i * sigma[0], j * sigma[1], px[0] * sigma[2], px[1] * sigma[3], px[2] * sigma[4] };
+        dt_aligned_pixel_t val = { px[0], px[1], px[2], 1.0f };
+        lattice.splat(pos, val, j * width + i, thread);
+      }
+    }
+  }
+  else
+  {
+    for(size_t j = 0; j < height; j++)
+      for(size_t i = 0; i < width; i++)
+      {
+        const float *px = in + 4 * (j * width + i);
+        float pos[5] = { i * sigma[0], j * sigma[1], px[0] * sigma[2], px[1] * sigma[3], px[2] * sigma[4] };
+        dt_aligned_pixel_t val = { px[0], px[1], px[2], 1.0f };
+        lattice.splat(pos, val, j * width + i, (int)(j * tables / height));
+      }
+  }
+
+  lattice.merge_splat_threads();
+  lattice.blur();
+
+  DT_OMP_FOR(shared(lattice))
+  for(size_t index = 0; index < width * height; index++)
+  {
+    dt_aligned_pixel_t val;
+    lattice.slice(val, index);
+    for_each_channel(k)
+      val[k] /= val[3];
+    copy_pixel(out + 4 * index, val);
+  }
+}
+
+/*
+ * TEST FUNCTIONS
+ */
+
+// merging the per-thread hash tables must not change the result
+static void test_merge_matches_single_table(void **state)
+{
+  const size_t npixels = (size_t)TEST_WIDTH * TEST_HEIGHT;
+  float *in = _gen_pattern(TEST_WIDTH, TEST_HEIGHT);
+  float *single = dt_alloc_align_float(4 * npixels);
+  float *merged = dt_alloc_align_float(4 * npixels);
+
+  _filter(in, single, TEST_WIDTH, TEST_HEIGHT, 1, false);
+  for(size_t tables = 2; tables <= 7; tables++)
+  {
+    _filter(in, merged, TEST_WIDTH, TEST_HEIGHT, tables, false);
+    for(size_t k = 0; k < npixels; k++)
+      for(int c = 0; c < 3; c++)
+      {
+        const float ref = single[4 * k + c];
+        if(fabsf(merged[4 * k + c] - ref) > E * fmaxf(1.0f, fabsf(ref)))
+          fail_msg("%zu tables, pixel %zu channel %d: %f, single table %f",
+                   tables, k, c, merged[4 * k + c], ref);
+      }
+  }
+
+  dt_free_align(merged);
+  dt_free_align(single);
+  dt_free_align(in);
+}
+
+// a constant image must come out unchanged
+static void test_constant_image(void **state)
+{
+  const size_t npixels = (size_t)TEST_WIDTH * TEST_HEIGHT;
+  float *in = dt_alloc_align_float(4 * npixels);
+  float *out = dt_alloc_align_float(4 * npixels);
+  for(size_t k = 0; k < npixels; k++)
+  {
+    in[4 * k + 0] = 0.25f;
+    in[4 * k + 1] = 0.5f;
+    in[4 * k + 2] = 0.75f;
+    in[4 * k + 3] = 0.0f;
+  }
+
+  _filter(in, out, TEST_WIDTH, TEST_HEIGHT, dt_get_num_threads(), true);
+  for(size_t k = 0; k < npixels; k++)
+    for(int c = 0; c < 3; c++)
+      assert_float_equal(out[4 * k + c], in[4 * k + c], 1e-5f);
+
+  dt_free_align(out);
+  dt_free_align(in);
+}
+
+// not a correctness test: reports the throughput of the whole
+// splat/merge/blur/slice sequence for a 5D lattice
+static void test_benchmark(void **state)
+{
+  if(!getenv("DT_BENCH_PERMUTOHEDRAL"))
+  {
+    print_message("[ SKIPPED  ] set DT_BENCH_PERMUTOHEDRAL to run the benchmark\n");
+    return;
+  }
+
+  static const size_t sizes[][2] = { { 4240, 2832 },   // 12MP
+                                     { 6000, 4000 },   // 24MP
+                                     { 8688, 5792 } }; // 50MP
+  for(int s = 0; s < 3; s++)
+  {
+    const size_t width = sizes[s][0], height = sizes[s][1];
+    float *in = _gen_pattern(width, height);
+    float *out = dt_alloc_align_float(4 * width * height);
+
+    const double t0 = dt_get_wtime();
+    _filter(in, out, width, height, dt_get_num_threads(), true);
+    const double t = dt_get_wtime() - t0;
+    print_message("[ BENCH    ] %4zux%4zu (%2.0fMP): %6.3f s, %6.1f Mpix/s\n",
+                  width, height, width * height * 1e-6, t, width * height * 1e-6 / t);
+
+    dt_free_align(out);
+    dt_free_align(in);
+  }
+}
+
+static int setup(void **state)
+{
+  // the lattice uses one hash table per configured thread
+  darktable.num_openmp_threads = dt_get_num_procs();
+  return 0;
+}
+
+/*
+ * MAIN FUNCTION
+ */
+int main(int argc, char* argv[])
+{
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test(test_merge_matches_single_table),
+    cmocka_unit_test(test_constant_image),
+    cmocka_unit_test(test_benchmark)
+  };
+
+  return cmocka_run_group_tests(tests, setup, NULL);
+}
+// clang-format off
+// modelines: These editor modelines have been set for all relevant files by tools/update_modelines.py
+// vim: shiftwidth=2 expandtab tabstop=2 cindent
+// kate: tab-indents: off; indent-width 2; replace-tabs on; indent-mode cstyle; remove-trailing-spaces modified;
+// clang-format on
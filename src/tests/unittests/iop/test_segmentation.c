@@ -0,0 +1,315 @@
+/*
+    This file is part of darktable,
+    Copyright (C) 2025 darktable developers.
+
+    darktable is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    darktable is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with darktable.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*
+ * cmocka unit tests for the segmentation used by the segmentation based
+ * highlights reconstruction in iop/hlreconstruct/segmentation.c
+ *
+ * The parallel labelling is compared against a plain serial labeller
+ * implementing the documented result: 4-connected segments with at least
+ * 4 locations get id's in raster order of their first location, smaller
+ * ones keep 1, and background locations next to a segment are marked with
+ * the lowest neighbouring id.
+ *
+ * The benchmark is not run by default, it is enabled if the environment
+ * variable DT_BENCH_SEGMENTATION is set.
+ *
+ * Please see README.md for more detailed documentation.
+ */
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include <cmocka.h>
+
+#include "../util/assert.h"
+#include "../util/testimg.h"
+
+#include "common/darktable.h"
+#include "iop/hlreconstruct/segmentation.c"
+
+#ifdef _WIN32
+#include "win/main_wrapper.h"
+#endif
+
+/*
+ * DEFINITIONS
+ */
+
+// same as the highlights module
+#define BORDER 9
+#define SLOTS 100000
+
+/*
+ * HELPERS
+ */
+
+// reduce a clipped CFA image to the 3x3 downscaled clipping plane of one color
+// like the segmentation based highlights reconstruction does
+static void _clip_plane(const Testimg *ti, dt_iop_segmentation_t *seg, const int color)
+{
+  const int width = seg->width;
+  for(int row = 0; row < 3 * (seg->height - 2 * BORDER); row += 3)
+  {
+    for(int col = 0; col < 3 * (width - 2 * BORDER); col += 3)
+    {
+      float sum = 0.0f;
+      int cnt = 0;
+      for(int dy = 0; dy < 3; dy++)
+        for(int dx = 0; dx < 3; dx++)
+        {
+          const float *p = get_pixel(ti, MIN(col + dx, ti->width - 1), MIN(row + dy, ti->height - 1));
+          if((int)p[3] != color) continue;
+          sum += p[0];
+          cnt++;
+        }
+      seg->data[(size_t)(BORDER + row / 3) * width + BORDER + col / 3] = (sum >= 0.99f * cnt) ? 1 : 0;
+    }
+  }
+}
+
+// serial flood fill labelling, writes the expected data and statistics
+static int _reference_segmentize(const uint32_t *in,
+                                 uint32_t *out,
+                                 dt_iop_segment_t *stats,
+                                 const int width,
+                                 const int height,
+                                 const int border)
+{
+  const size_t npix = (size_t)width * height;
+  memcpy(out, in, sizeof(uint32_t) * npix);
+  size_t *stack = malloc(sizeof(size_t) * npix);
+  size_t *members = malloc(sizeof(size_t) * npix);
+  int id = 2;
+
+  for(int row = border; row < height - border; row++)
+  {
+    for(int col = border; col < width - border; col++)
+    {
+      const size_t start = (size_t)row * width + col;
+      if(out[start] != 1) continue;
+
+      // collect the segment, the locations are temporarily tagged with the mask bit
+      size_t sp = 0, cnt = 0;
+      stack[sp++] = start;
+      out[start] = DT_SEG_ID_MASK;
+      while(sp)
+      {
+        const size_t i = stack[--sp];
+        members[cnt++] = i;
+        const int r = i / width, c = i % width;
+        const size_t nb[4] = { i - width, i + width, i - 1, i + 1 };
+        const gboolean inside[4] = { r > border, r < height - border - 1, c > border, c < width - border - 1 };
+        for(int k = 0; k < 4; k++)
+        {
+          if(inside[k] && out[nb[k]] == 1)
+          {
+            out[nb[k]] = DT_SEG_ID_MASK;
+            stack[sp++] = nb[k];
+          }
+        }
+      }
+
+      const gboolean valid = cnt > 3 && id < SLOTS - 2;
+      if(valid)
+      {
+        memset(&stats[id], 0, sizeof(dt_iop_segment_t));
+        stats[id].size = cnt;
+        stats[id].xmin = stats[id].xmax = col;
+        stats[id].ymin = stats[id].ymax = row;
+      }
+      for(size_t k = 0; k < cnt; k++)
+        out[members[k]] = valid ? id : 1;
+      if(valid) id++;
+    }
+  }
+
+  // border marks and surrounding rectangles
+#define VALID(v) ((v) > 1 && !((v) & DT_SEG_ID_MASK))
+  for(int row = border; row < height - border; row++)
+  {
+    for(int col = border; col < width - border; col++)
+    {
+      const size_t i = (size_t)row * width + col;
+      if(out[i] == 0)
+      {
+        uint32_t mark = UINT32_MAX;
+        if(row > border + 1 && VALID(out[i + width]))          mark = MIN(mark, out[i + width]);
+        if(row < height - border - 2 && VALID(out[i - width])) mark = MIN(mark, out[i - width]);
+        if(col < width - border - 2 && VALID(out[i - 1]))      mark = MIN(mark, out[i - 1]);
+        if(col > border + 1 && VALID(out[i + 1]))              mark = MIN(mark, out[i + 1]);
+        if(mark != UINT32_MAX) out[i] = DT_SEG_ID_MASK | mark;
+      }
+    }
+  }
+  for(int row = border; row < height - border; row++)
+  {
+    for(int col = border; col < width - border; col++)
+    {
+      const uint32_t v = out[(size_t)row * width + col];
+      if(v < 2) continue;
+      dt_iop_segment_t *sg = &stats[v & (DT_SEG_ID_MASK - 1)];
+      sg->xmin = MIN(sg->xmin, col);
+      sg->xmax = MAX(sg->xmax, col);
+      sg->ymin = MIN(sg->ymin, row);
+      sg->ymax = MAX(sg->ymax, row);
+    }
+  }
+#undef VALID
+
+  free(members);
+  free(stack);
+  return id;
+}
+
+static void _compare_segmentation(const int width, const int height, const float sky, const unsigned int seed)
+{
+  Testimg *ti = testimg_gen_clipped_cfa(width, height, sky, seed);
+  const int pwidth = width / 3 + 2 * BORDER;
+  const int pheight = height / 3 + 2 * BORDER;
+  const size_t npix = (size_t)pwidth * pheight;
+
+  uint32_t *tmp = dt_alloc_align_type(uint32_t, npix);
+  uint32_t *expected = dt_alloc_align_type(uint32_t, npix);
+  dt_iop_segment_t *stats = dt_alloc_align_type(dt_iop_segment_t, SLOTS);
+  dt_iop_segmentation_t seg;
+  assert_false(dt_segmentation_init_struct(&seg, pwidth, pheight, BORDER, SLOTS, tmp));
+
+  for(int color = 0; color < 3; color++)
+  {
+    memset(seg.data, 0, sizeof(uint32_t) * npix);
+    _clip_plane(ti, &seg, color);
+    dt_segments_combine(&seg, 2);
+    const int nr = _reference_segmentize(seg.data, expected, stats, pwidth, pheight, BORDER);
+
+    seg.nr = 2;
+    dt_segmentize_plane(&seg);
+
+    assert_int_equal(seg.nr, nr);
+    assert_true(nr > 2);
+    assert_memory_equal(seg.data, expected, sizeof(uint32_t) * npix);
+    for(int id = 2; id < nr; id++)
+    {
+      assert_int_equal(seg.stats[id].size, stats[id].size);
+      assert_int_equal(seg.stats[id].xmin, stats[id].xmin);
+      assert_int_equal(seg.stats[id].xmax, stats[id].xmax);
+      assert_int_equal(seg.stats[id].ymin, stats[id].ymin);
+      assert_int_equal(seg.stats[id].ymax, stats[id].ymax);
+    }
+  }
+
+  dt_segmentation_free_struct(&seg);
+  dt_free_align(stats);
+  dt_free_align(expected);
+  dt_free_align(tmp);
+  testimg_free(ti);
+}
+
+/*
+ * TEST FUNCTIONS
+ */
+
+// several strips, segments crossing the strip boundaries
+static void test_blobs(void **state)
+{
+  _compare_segmentation(1203, 905, 0.0f, 1);
+}
+
+// a blown sky is one segment spanning all strips
+static void test_sky(void **state)
+{
+  _compare_segmentation(1200, 900, 0.3f, 7);
+}
+
+// plane smaller than a single strip
+static void test_small(void **state)
+{
+  _compare_segmentation(150, 120, 0.1f, 3);
+}
+
+// not a correctness test: compares the throughput of the parallel and the
+// serial labelling
+static void test_benchmark(void **state)
+{
+  if(!getenv("DT_BENCH_SEGMENTATION"))
+  {
+    print_message("[ SKIPPED  ] set DT_BENCH_SEGMENTATION to run the benchmark\n");
+    return;
+  }
+
+  // 100MP sensor
+  const int width = 11648, height = 8736;
+  Testimg *ti = testimg_gen_clipped_cfa(width, height, 0.25f, 1);
+  const int pwidth = width / 3 + 2 * BORDER;
+  const int pheight = height / 3 + 2 * BORDER;
+  const size_t npix = (size_t)pwidth * pheight;
+  uint32_t *tmp = dt_alloc_align_type(uint32_t, npix);
+  uint32_t *expected = dt_alloc_align_type(uint32_t, npix);
+  dt_iop_segment_t *stats = dt_alloc_align_type(dt_iop_segment_t, SLOTS);
+  dt_iop_segmentation_t seg;
+  if(!tmp || !expected || !stats || dt_segmentation_init_struct(&seg, pwidth, pheight, BORDER, SLOTS, tmp))
+  {
+    print_message("[ SKIPPED  ] not enough memory\n");
+  }
+  else
+  {
+    _clip_plane(ti, &seg, 1);
+    dt_segments_combine(&seg, 2);
+    double t0 = dt_get_wtime();
+    _reference_segmentize(seg.data, expected, stats, pwidth, pheight, BORDER);
+    const double t_ref = dt_get_wtime() - t0;
+    t0 = dt_get_wtime();
+    dt_segmentize_plane(&seg);
+    const double t_new = dt_get_wtime() - t0;
+    print_message("[ BENCH    ] %dx%d plane, %d segments: serial %6.3f s, parallel %6.3f s, speedup %.2f\n",
+                  pwidth, pheight, seg.nr - 2, t_ref, t_new, t_ref / t_new);
+    dt_segmentation_free_struct(&seg);
+  }
+  dt_free_align(stats);
+  dt_free_align(expected);
+  dt_free_align(tmp);
+  testimg_free(ti);
+}
+
+static int setup(void **state)
+{
+  darktable.num_openmp_threads = dt_get_num_procs();
+  return 0;
+}
+
+/*
+ * MAIN FUNCTION
+ */
+int main(int argc, char* argv[])
+{
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test(test_blobs),
+    cmocka_unit_test(test_sky),
+    cmocka_unit_test(test_small),
+    cmocka_unit_test(test_benchmark)
+  };
+
+  return cmocka_run_group_tests(tests, setup, NULL);
+}
+// clang-format off
+// modelines: These editor modelines have been set for all relevant files by tools/update_modelines.py
+// vim: shiftwidth=2 expandtab tabstop=2 cindent
+// kate: tab-indents: off; indent-width 2; replace-tabs on; indent-mode cstyle; remove-trailing-spaces modified;
+// clang-format on
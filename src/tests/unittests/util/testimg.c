@@ -278,6 +278,29 @@ Testimg *testimg_gen_grey_with_rgb_clipping(const int width)
   }
   return ti;
 }
+
+Testimg *testimg_gen_clipped_cfa(const int width, const int height,
+                                 const float sky, const unsigned int seed)
+{
+  Testimg *ti = testimg_alloc(width, height);
+  ti->name = "clipped cfa";
+
+  // the channels of a pixel are clipped at different scene intensities
+  const float gain[3] = { 0.55f, 1.0f, 0.7f };
+  unsigned int state = seed;
+  for_testimg_pixels_p_yx(ti)
+  {
+    state = state * 1664525u + 1013904223u;
+    const int color = (y & 1) + (x & 1);
+    const float noise = 0.4f * ((state >> 8) / 16777216.f);
+    const float scene = (y < sky * height)
+      ? 2.0f
+      : 0.6f * sinf(x * 0.05f) * cosf(y * 0.07f) + 0.5f * sinf((x + y) * 0.013f) + noise + 0.45f;
+    p[0] = p[1] = p[2] = fminf(1.0f, scene * gain[color]);
+    p[3] = color;
+  }
+  return ti;
+}
 // clang-format off
 // modelines: These editor modelines have been set for all relevant files by tools/update_modelines.py
 // vim: shiftwidth=2 expandtab tabstop=2 cindent
@@ -161,6 +161,13 @@ Testimg *testimg_gen_grey_max_dr_neg();
 // create 3 "grey'ish" gradients where in each one a color dominates and clips:
 // height: 3, y=0 => red clips, y=1 => green clips, y=2 => blue clips
 Testimg *testimg_gen_grey_with_rgb_clipping(const int width);
+
+// create a bayer (RGGB) mosaic of a scene with a blown sky in the top rows and
+// blown blobs plus some noise below, the sensor value is stored in all color
+// channels (clipping at 1.0), [3] holds the CFA color index (0=red, 1=green,
+// 2=blue). The same seed gives the same image.
+Testimg *testimg_gen_clipped_cfa(const int width, const int height,
+                                 const float sky, const unsigned int seed);
 // clang-format off
 // modelines: These editor modelines have been set for all relevant files by tools/update_modelines.py
 // vim: shiftwidth=2 expandtab tabstop=2 cindent
@@ -1333,6 +1333,20 @@ static void _view_darkroom_filmstrip_activate_callback(gpointer instance,
   }
 }
 
+static int32_t _dev_readahead_job_run(dt_job_t *job)
+{
+  const int rowid = GPOINTER_TO_INT(dt_control_job_get_params(job));
+  sqlite3_stmt *stmt;
+  DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db),
+                              "SELECT imgid FROM memory.collected_images WHERE rowid = ?1",
+                              -1, &stmt, NULL);
+  DT_DEBUG_SQLITE3_BIND_INT(stmt, 1, rowid);
+  if(sqlite3_step(stmt) == SQLITE_ROW)
+    dt_imageio_readahead(sqlite3_column_int(stmt, 0));
+  sqlite3_finalize(stmt);
+  return 0;
+}
+
 static void _dev_jump_image(dt_develop_t *dev, int diff, gboolean by_key)
 {
   if(dt_check_gimpmode("file"))
@@ -1400,6 +1414,15 @@ static void _dev_jump_image(dt_develop_t *dev, int diff, gboolean by_key)
   _dev_change_image(dev, new_id);
   dt_thumbtable_set_offset(dt_ui_thumbtable(darktable.gui->ui), new_offset, TRUE);
 
+  // the user is likely to continue in the same direction, have the
+  // file of the following image read ahead.
+  dt_job_t *job = dt_control_job_create(&_dev_readahead_job_run, "read ahead image");
+  if(job)
+  {
+    dt_control_job_set_params(job, GINT_TO_POINTER(new_offset + (diff > 0 ? 1 : -1)), NULL);
+    dt_control_add_job(DT_JOB_QUEUE_SYSTEM_BG, job);
+  }
+
   // if it's a change by key_press, we set mouse_over to the active image
   if(by_key) dt_control_set_mouse_over_id(new_id);
 }